@@ -35,9 +35,17 @@
 /* Define to 1 if you have the <openssl/des.h> header file. */
 #cmakedefine HAVE_OPENSSL_DES_H 1
 
+/* Define to 1 if you have the <openssl/ecdh.h> header file. */
+#cmakedefine HAVE_OPENSSL_ECDH_H 1
+
 /* Define to 1 if you have the <pthread.h> header file. */
 #cmakedefine HAVE_PTHREAD_H 1
 
+/**************************** STRUCTS ****************************/
+
+/* Define to 1 if struct stat has the nanosecond st_mtim member. */
+#cmakedefine HAVE_STRUCT_STAT_ST_MTIM 1
+
 
 /*************************** FUNCTIONS ***************************/
 
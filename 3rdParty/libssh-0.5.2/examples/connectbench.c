@@ -0,0 +1,257 @@
+/*
+ * connectbench.c
+ * Connects to a SSH server a number of times and prints how long each phase
+ * of the connection took, as percentiles over all the runs.
+ *
+ * samplesshd serves a single connection and exits, so run it in a loop:
+ *   while ./samplesshd -p 2222 127.0.0.1; do :; done
+ *   ./connectbench -n 100 -p 2222 -l aris -P lala 127.0.0.1
+ */
+
+/*
+This file is part of the SSH Library
+
+You are free to copy this file, modify it in any way, consider it being public
+domain. This does not apply to the rest of the library though, but it is
+allowed to cut-and-paste working code from this file to any license of
+program.
+The goal is to show the API in action. It's not a reference on how terminal
+clients must be made or how a client should react.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libssh/libssh.h>
+
+/* the server may still be restarting when the next run begins */
+#define CONNECT_RETRIES 50
+#define CONNECT_RETRY_USEC 20000
+
+enum phase {
+  PHASE_DNS,
+  PHASE_TCP,
+  PHASE_BANNER,
+  PHASE_KEX,
+  PHASE_HOSTKEY,
+  PHASE_AUTH,
+  PHASE_CHANNEL,
+  PHASE_PTY,
+  PHASE_SHELL,
+  PHASE_TOTAL,
+  PHASE_COUNT
+};
+
+static const char *phase_names[PHASE_COUNT] = {
+  "dns", "tcp", "banner", "kex", "hostkey", "auth", "channel", "pty",
+  "shell", "total"
+};
+
+static const char *host;
+static const char *port = "22";
+static const char *user;
+static const char *password = "";
+static int runs = 10;
+
+static long now_usec(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static void usage(void) {
+  fprintf(stderr,"Usage : connectbench [-n runs] [-p port] [-l user] "
+      "[-P password] host\n");
+  exit(1);
+}
+
+static int opts(int argc, char **argv) {
+  int i;
+
+  while ((i = getopt(argc, argv, "n:p:l:P:")) != -1) {
+    switch (i) {
+      case 'n':
+        runs = atoi(optarg);
+        break;
+      case 'p':
+        port = optarg;
+        break;
+      case 'l':
+        user = optarg;
+        break;
+      case 'P':
+        password = optarg;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind >= argc || runs <= 0) {
+    usage();
+  }
+  host = argv[optind];
+  return 0;
+}
+
+static ssh_session connect_retry(void) {
+  ssh_session session;
+  int i;
+
+  for (i = 0; i < CONNECT_RETRIES; i++) {
+    session = ssh_new();
+    if (session == NULL) {
+      return NULL;
+    }
+
+    ssh_options_set(session, SSH_OPTIONS_HOST, host);
+    ssh_options_set(session, SSH_OPTIONS_PORT_STR, port);
+    if (user != NULL) {
+      ssh_options_set(session, SSH_OPTIONS_USER, user);
+    }
+
+    if (ssh_connect(session) == SSH_OK) {
+      return session;
+    }
+    if (i == CONNECT_RETRIES - 1) {
+      fprintf(stderr, "Connection failed : %s\n", ssh_get_error(session));
+    }
+    ssh_free(session);
+    usleep(CONNECT_RETRY_USEC);
+  }
+
+  return NULL;
+}
+
+/* Runs one connection and fills in the time spent in each phase */
+static int run(long *usec) {
+  ssh_session session;
+  ssh_channel channel = NULL;
+  long start;
+  long t;
+  int rc = -1;
+
+  start = now_usec();
+  session = connect_retry();
+  if (session == NULL) {
+    return -1;
+  }
+  ssh_get_connect_timing(session, &usec[PHASE_DNS], &usec[PHASE_TCP]);
+  ssh_get_handshake_timing(session, &usec[PHASE_BANNER], &usec[PHASE_KEX]);
+
+  /* the key of a test server is rarely known, only the lookup is timed */
+  t = now_usec();
+  if (ssh_is_server_known(session) == SSH_SERVER_ERROR) {
+    fprintf(stderr, "Host key check failed : %s\n", ssh_get_error(session));
+    goto out;
+  }
+  usec[PHASE_HOSTKEY] = now_usec() - t;
+
+  t = now_usec();
+  ssh_userauth_none(session, NULL);
+  if (ssh_userauth_password(session, NULL, password) != SSH_AUTH_SUCCESS) {
+    fprintf(stderr, "Authentication failed : %s\n", ssh_get_error(session));
+    goto out;
+  }
+  usec[PHASE_AUTH] = now_usec() - t;
+
+  t = now_usec();
+  channel = ssh_channel_new(session);
+  if (channel == NULL || ssh_channel_open_session(channel) != SSH_OK) {
+    fprintf(stderr, "Channel open failed : %s\n", ssh_get_error(session));
+    goto out;
+  }
+  usec[PHASE_CHANNEL] = now_usec() - t;
+
+  /* samplesshd denies the pty, which costs the same round trip */
+  t = now_usec();
+  ssh_channel_request_pty_size(channel, "xterm", 237, 58);
+  usec[PHASE_PTY] = now_usec() - t;
+
+  t = now_usec();
+  if (ssh_channel_request_shell(channel) != SSH_OK) {
+    fprintf(stderr, "Shell request failed : %s\n", ssh_get_error(session));
+    goto out;
+  }
+  usec[PHASE_SHELL] = now_usec() - t;
+  usec[PHASE_TOTAL] = now_usec() - start;
+  rc = 0;
+
+out:
+  if (channel != NULL) {
+    ssh_channel_free(channel);
+  }
+  ssh_disconnect(session);
+  ssh_free(session);
+  return rc;
+}
+
+static int compare_long(const void *a, const void *b) {
+  long x = *(const long *) a;
+  long y = *(const long *) b;
+
+  return (x > y) - (x < y);
+}
+
+/* nearest rank percentile of a sorted array */
+static long percentile(const long *sorted, int count, int p) {
+  int rank = (p * count + 99) / 100;
+
+  if (rank < 1) {
+    rank = 1;
+  }
+  return sorted[rank - 1];
+}
+
+int main(int argc, char **argv) {
+  long *samples[PHASE_COUNT];
+  int done = 0;
+  int i;
+  int j;
+
+  opts(argc, argv);
+
+  for (j = 0; j < PHASE_COUNT; j++) {
+    samples[j] = calloc(runs, sizeof(long));
+    if (samples[j] == NULL) {
+      return 1;
+    }
+  }
+
+  for (i = 0; i < runs; i++) {
+    long usec[PHASE_COUNT];
+
+    memset(usec, 0, sizeof(usec));
+    if (run(usec) < 0) {
+      continue;
+    }
+    for (j = 0; j < PHASE_COUNT; j++) {
+      samples[j][done] = usec[j];
+    }
+    done++;
+  }
+
+  printf("%d of %d connection(s) succeeded, times in microseconds\n", done, runs);
+  if (done > 0) {
+    printf("%-8s %10s %10s %10s %10s %10s\n",
+        "phase", "min", "p50", "p90", "p99", "max");
+    for (j = 0; j < PHASE_COUNT; j++) {
+      qsort(samples[j], done, sizeof(long), compare_long);
+      printf("%-8s %10ld %10ld %10ld %10ld %10ld\n", phase_names[j],
+          samples[j][0],
+          percentile(samples[j], done, 50),
+          percentile(samples[j], done, 90),
+          percentile(samples[j], done, 99),
+          samples[j][done - 1]);
+    }
+  }
+
+  for (j = 0; j < PHASE_COUNT; j++) {
+    free(samples[j]);
+  }
+  ssh_finalize();
+  return done == runs ? 0 : 1;
+}
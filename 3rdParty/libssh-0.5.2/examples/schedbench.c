@@ -0,0 +1,243 @@
+/*
+ * schedbench.c
+ * Measures how long a keystroke takes to come back from "cat" on one channel
+ * while another channel of the same session uploads into "cat > /dev/null",
+ * and prints the round trip times as percentiles.
+ *
+ * Run it once without upload for the baseline:
+ *   ./schedbench -s 0 -l user -P password host
+ *   ./schedbench -s 256 -l user -P password host
+ */
+
+/*
+This file is part of the SSH Library
+
+You are free to copy this file, modify it in any way, consider it being public
+domain. This does not apply to the rest of the library though, but it is
+allowed to cut-and-paste working code from this file to any license of
+program.
+The goal is to show the API in action. It's not a reference on how terminal
+clients must be made or how a client should react.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libssh/libssh.h>
+
+/* time between two keystrokes, like a fast typist */
+#define KEY_INTERVAL_USEC 20000
+#define UPLOAD_CHUNK (64 * 1024)
+
+static const char *host;
+static const char *port = "22";
+static const char *user;
+static const char *password = "";
+static int keys = 200;
+static long upload_mb = 64;
+
+static long now_usec(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static void usage(void) {
+  fprintf(stderr,"Usage : schedbench [-n keys] [-s upload MB] [-p port] "
+      "[-l user] [-P password] host\n");
+  exit(1);
+}
+
+static int opts(int argc, char **argv) {
+  int i;
+
+  while ((i = getopt(argc, argv, "n:s:p:l:P:")) != -1) {
+    switch (i) {
+      case 'n':
+        keys = atoi(optarg);
+        break;
+      case 's':
+        upload_mb = atol(optarg);
+        break;
+      case 'p':
+        port = optarg;
+        break;
+      case 'l':
+        user = optarg;
+        break;
+      case 'P':
+        password = optarg;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind >= argc || keys <= 0 || upload_mb < 0) {
+    usage();
+  }
+  host = argv[optind];
+  return 0;
+}
+
+static ssh_channel open_exec(ssh_session session, const char *command) {
+  ssh_channel channel = ssh_channel_new(session);
+
+  if (channel == NULL) {
+    return NULL;
+  }
+  if (ssh_channel_open_session(channel) != SSH_OK ||
+      ssh_channel_request_exec(channel, command) != SSH_OK) {
+    fprintf(stderr, "Exec of %s failed : %s\n", command,
+        ssh_get_error(session));
+    ssh_channel_free(channel);
+    return NULL;
+  }
+  return channel;
+}
+
+static int compare_long(const void *a, const void *b) {
+  long x = *(const long *) a;
+  long y = *(const long *) b;
+
+  return (x > y) - (x < y);
+}
+
+/* nearest rank percentile of a sorted array */
+static long percentile(const long *sorted, int count, int p) {
+  int rank = (p * count + 99) / 100;
+
+  if (rank < 1) {
+    rank = 1;
+  }
+  return sorted[rank - 1];
+}
+
+int main(int argc, char **argv) {
+  ssh_session session;
+  ssh_channel echo = NULL;
+  ssh_channel sink = NULL;
+  ssh_event event = NULL;
+  char chunk[UPLOAD_CHUNK];
+  char c;
+  long *samples;
+  long left;
+  long sent_at = 0;
+  long next_key;
+  long start;
+  int done = 0;
+  int rc = 1;
+  int n;
+
+  opts(argc, argv);
+  samples = calloc(keys, sizeof(long));
+  if (samples == NULL) {
+    return 1;
+  }
+  memset(chunk, 'x', sizeof(chunk));
+  left = upload_mb * 1024 * 1024;
+
+  session = ssh_new();
+  if (session == NULL) {
+    return 1;
+  }
+  ssh_options_set(session, SSH_OPTIONS_HOST, host);
+  ssh_options_set(session, SSH_OPTIONS_PORT_STR, port);
+  if (user != NULL) {
+    ssh_options_set(session, SSH_OPTIONS_USER, user);
+  }
+  if (ssh_connect(session) != SSH_OK) {
+    fprintf(stderr, "Connection failed : %s\n", ssh_get_error(session));
+    goto out;
+  }
+  /* the key of a test server is rarely known */
+  if (ssh_is_server_known(session) == SSH_SERVER_ERROR) {
+    fprintf(stderr, "Host key check failed : %s\n", ssh_get_error(session));
+    goto out;
+  }
+  ssh_userauth_none(session, NULL);
+  if (ssh_userauth_password(session, NULL, password) != SSH_AUTH_SUCCESS) {
+    fprintf(stderr, "Authentication failed : %s\n", ssh_get_error(session));
+    goto out;
+  }
+
+  echo = open_exec(session, "cat");
+  sink = open_exec(session, "cat > /dev/null");
+  event = ssh_event_new();
+  if (echo == NULL || sink == NULL || event == NULL ||
+      ssh_event_add_session(event, session) != SSH_OK) {
+    goto out;
+  }
+  ssh_set_blocking(session, 0);
+
+  start = now_usec();
+  next_key = start;
+  while (done < keys) {
+    /* keep the upload queued, as far as the library takes it */
+    if (left > 0) {
+      n = ssh_channel_write(sink, chunk,
+          left < UPLOAD_CHUNK ? left : UPLOAD_CHUNK);
+      if (n == SSH_ERROR) {
+        fprintf(stderr, "Upload failed : %s\n", ssh_get_error(session));
+        goto out;
+      }
+      left -= n;
+    }
+
+    if (sent_at == 0 && now_usec() >= next_key) {
+      sent_at = now_usec();
+      if (ssh_channel_write(echo, "k", 1) != 1) {
+        fprintf(stderr, "Keystroke failed : %s\n", ssh_get_error(session));
+        goto out;
+      }
+    }
+
+    n = ssh_channel_read_nonblocking(echo, &c, 1, 0);
+    if (n == SSH_ERROR) {
+      fprintf(stderr, "Read failed : %s\n", ssh_get_error(session));
+      goto out;
+    }
+    if (n == 1 && sent_at != 0) {
+      samples[done++] = now_usec() - sent_at;
+      sent_at = 0;
+      next_key += KEY_INTERVAL_USEC;
+    }
+
+    ssh_event_dopoll(event, 1);
+  }
+
+  qsort(samples, done, sizeof(long), compare_long);
+  printf("%d keystroke(s), %ld MB written to the upload meanwhile, %ld KB/s\n",
+      done,
+      (upload_mb * 1024 * 1024 - left) / (1024 * 1024),
+      (upload_mb * 1024 * 1024 - left) / 1024 * 1000000 /
+      (now_usec() - start));
+  printf("%-8s %10s %10s %10s %10s %10s\n",
+      "usec", "min", "p50", "p90", "p99", "max");
+  printf("%-8s %10ld %10ld %10ld %10ld %10ld\n", "echo",
+      samples[0],
+      percentile(samples, done, 50),
+      percentile(samples, done, 90),
+      percentile(samples, done, 99),
+      samples[done - 1]);
+  rc = 0;
+
+out:
+  if (event != NULL) {
+    ssh_event_free(event);
+  }
+  if (echo != NULL) {
+    ssh_channel_free(echo);
+  }
+  if (sink != NULL) {
+    ssh_channel_free(sink);
+  }
+  ssh_disconnect(session);
+  ssh_free(session);
+  free(samples);
+  ssh_finalize();
+  return rc;
+}
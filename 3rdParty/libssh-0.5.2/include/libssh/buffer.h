@@ -35,6 +35,7 @@ struct ssh_buffer_struct {
     uint32_t used;
     uint32_t allocated;
     uint32_t pos;
+    uint32_t reallocs; /* growth count, for the session stats */
 };
 
 LIBSSH_API void ssh_buffer_free(ssh_buffer buffer);
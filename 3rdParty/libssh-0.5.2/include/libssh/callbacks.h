@@ -348,6 +348,20 @@ typedef void (*ssh_channel_exit_signal_callback) (ssh_session session,
                                             const char *lang,
                                             void *userdata);
 
+/**
+ * @brief SSH channel write wontblock callback. Called when a channel can take
+ * data again: it has been opened, or the remote window or the send queue of
+ * the channel made room.
+ * @param session Current session handler
+ * @param channel the actual channel
+ * @param bytes the remote window of the channel
+ * @param userdata Userdata to be passed to the callback function.
+ */
+typedef void (*ssh_channel_write_wontblock_callback) (ssh_session session,
+                                            ssh_channel channel,
+                                            uint32_t bytes,
+                                            void *userdata);
+
 struct ssh_channel_callbacks_struct {
   /** DON'T SET THIS use ssh_callbacks_init() instead. */
   size_t size;
@@ -379,6 +393,10 @@ struct ssh_channel_callbacks_struct {
    * This functions will be called when an exit signal has been received
    */
   ssh_channel_exit_signal_callback channel_exit_signal_function;
+  /**
+   * This functions will be called when a nonblocking writer may write again
+   */
+  ssh_channel_write_wontblock_callback channel_write_wontblock_function;
 };
 typedef struct ssh_channel_callbacks_struct *ssh_channel_callbacks;
 
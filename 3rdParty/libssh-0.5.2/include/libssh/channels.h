@@ -42,6 +42,7 @@ enum ssh_channel_request_state_e {
 
 enum ssh_channel_state_e {
   SSH_CHANNEL_STATE_NOT_OPEN = 0,
+  SSH_CHANNEL_STATE_OPENING,
   SSH_CHANNEL_STATE_OPEN_DENIED,
   SSH_CHANNEL_STATE_OPEN,
   SSH_CHANNEL_STATE_CLOSED
@@ -68,6 +69,9 @@ struct ssh_channel_struct {
     int exit_status;
     enum ssh_channel_request_state_e request_state;
     ssh_channel_callbacks callbacks;
+    struct ssh_channel_stats stats; /* in_queue and out_queue are filled on read */
+    ssh_buffer send_queue; /* data messages waiting for the scheduler */
+    uint32_t send_deficit; /* bytes the scheduler lets it send in its turn */
 };
 
 SSH_PACKET_CALLBACK(ssh_packet_channel_open_conf);
@@ -90,6 +94,7 @@ uint32_t ssh_channel_new_id(ssh_session session);
 ssh_channel ssh_channel_from_local(ssh_session session, uint32_t id);
 int channel_write_common(ssh_channel channel, const void *data,
     uint32_t len, int is_stderr);
+void ssh_channel_write_wontblock(ssh_channel channel);
 #ifdef WITH_SSH1
 SSH_PACKET_CALLBACK(ssh_packet_data1);
 SSH_PACKET_CALLBACK(ssh_packet_close1);
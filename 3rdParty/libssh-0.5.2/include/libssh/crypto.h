@@ -33,6 +33,11 @@
 #endif
 #include "libssh/wrapper.h"
 
+#ifdef HAVE_ECDH
+#include <openssl/ec.h>
+#endif
+#include "libssh/curve25519.h"
+
 #ifdef cbc_encrypt
 #undef cbc_encrypt
 #endif
@@ -40,18 +45,39 @@
 #undef cbc_decrypt
 #endif
 
+/* largest exchange hash of the supported key exchange methods */
+#define DIGEST_MAX_LEN SHA256_DIGEST_LEN
+
+enum ssh_key_exchange_e {
+  /* diffie-hellman-group1-sha1 */
+  SSH_KEX_DH_GROUP1_SHA1=1,
+  /* ecdh-sha2-nistp256 */
+  SSH_KEX_ECDH_SHA2_NISTP256,
+  /* curve25519-sha256@libssh.org */
+  SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG
+};
+
 struct ssh_crypto_struct {
     bignum e,f,x,k,y;
-    unsigned char session_id[SHA_DIGEST_LEN];
+    enum ssh_key_exchange_e kex_type;
+    /* length of the exchange hash, depends on kex_type */
+    int digest_len;
+#ifdef HAVE_ECDH
+    EC_KEY *ecdh_privkey;
+#endif
+    ssh_string ecdh_client_pubkey;
+    ssh_string ecdh_server_pubkey;
+    ssh_curve25519_privkey curve25519_privkey;
+    unsigned char session_id[DIGEST_MAX_LEN];
 
-    unsigned char encryptIV[SHA_DIGEST_LEN*2];
-    unsigned char decryptIV[SHA_DIGEST_LEN*2];
+    unsigned char encryptIV[DIGEST_MAX_LEN*2];
+    unsigned char decryptIV[DIGEST_MAX_LEN*2];
 
-    unsigned char decryptkey[SHA_DIGEST_LEN*2];
-    unsigned char encryptkey[SHA_DIGEST_LEN*2];
+    unsigned char decryptkey[DIGEST_MAX_LEN*2];
+    unsigned char encryptkey[DIGEST_MAX_LEN*2];
 
-    unsigned char encryptMAC[SHA_DIGEST_LEN];
-    unsigned char decryptMAC[SHA_DIGEST_LEN];
+    unsigned char encryptMAC[DIGEST_MAX_LEN];
+    unsigned char decryptMAC[DIGEST_MAX_LEN];
     unsigned char hmacbuf[EVP_MAX_MD_SIZE];
     struct crypto_struct *in_cipher, *out_cipher; /* the cipher structures/objects */
     ssh_string server_pubkey;
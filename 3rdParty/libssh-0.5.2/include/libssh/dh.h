@@ -26,11 +26,14 @@
 /* DH key generation */
 #include "libssh/keys.h"
 
+struct ssh_crypto_struct;
+
 void ssh_print_bignum(const char *which,bignum num);
 int dh_generate_e(ssh_session session);
 int dh_generate_f(ssh_session session);
 int dh_generate_x(ssh_session session);
 int dh_generate_y(ssh_session session);
+int dh_generate_keypair(struct ssh_crypto_struct *crypto);
 
 int ssh_crypto_init(void);
 void ssh_crypto_finalize(void);
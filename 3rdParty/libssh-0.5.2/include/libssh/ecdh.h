@@ -0,0 +1,33 @@
+/*
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+#ifndef ECDH_H_
+#define ECDH_H_
+
+#include "config.h"
+#include "libssh/libssh.h"
+#include "libssh/crypto.h"
+
+#ifdef HAVE_ECDH
+int ssh_ecdh_keypair(struct ssh_crypto_struct *crypto);
+int ssh_ecdh_build_k(ssh_session session);
+#endif /* HAVE_ECDH */
+
+#endif /* ECDH_H_ */
+/* vim: set ts=2 sw=2 et cindent: */
@@ -24,10 +24,20 @@
 
 #include "libssh/priv.h"
 #include "libssh/callbacks.h"
+#include "libssh/crypto.h"
 
 SSH_PACKET_CALLBACK(ssh_packet_kexinit);
 #ifdef WITH_SSH1
 SSH_PACKET_CALLBACK(ssh_packet_publickey1);
 #endif
 
+enum ssh_key_exchange_e ssh_kex_type(const char *name);
+const char *ssh_kex_type_name(enum ssh_key_exchange_e type);
+int ssh_kex_digest_len(enum ssh_key_exchange_e type);
+int ssh_kex_keypair_generate(struct ssh_crypto_struct *crypto);
+
+int ssh_kex_pool_init(void);
+void ssh_kex_pool_finalize(void);
+int ssh_kex_pool_take(struct ssh_crypto_struct *crypto);
+
 #endif /* KEX_H_ */
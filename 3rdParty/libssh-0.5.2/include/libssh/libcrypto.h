@@ -32,10 +32,12 @@
 #include <openssl/md5.h>
 #include <openssl/hmac.h>
 typedef SHA_CTX* SHACTX;
+typedef SHA256_CTX* SHA256CTX;
 typedef MD5_CTX*  MD5CTX;
 typedef HMAC_CTX* HMACCTX;
 
 #define SHA_DIGEST_LEN SHA_DIGEST_LENGTH
+#define SHA256_DIGEST_LEN SHA256_DIGEST_LENGTH
 #ifdef MD5_DIGEST_LEN
     #undef MD5_DIGEST_LEN
 #endif
@@ -43,6 +45,9 @@ typedef HMAC_CTX* HMACCTX;
 
 #include <openssl/bn.h>
 #include <openssl/opensslv.h>
+#ifdef HAVE_OPENSSL_ECDH_H
+#define HAVE_ECDH 1
+#endif
 #define OPENSSL_0_9_7b 0x0090702fL
 #if (OPENSSL_VERSION_NUMBER <= OPENSSL_0_9_7b)
 #define BROKEN_AES_CTR
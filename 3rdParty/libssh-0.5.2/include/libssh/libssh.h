@@ -109,6 +109,7 @@ extern "C" {
 typedef struct ssh_agent_struct* ssh_agent;
 typedef struct ssh_buffer_struct* ssh_buffer;
 typedef struct ssh_channel_struct* ssh_channel;
+typedef struct ssh_event_struct* ssh_event;
 typedef struct ssh_message_struct* ssh_message;
 typedef struct ssh_pcap_file_struct* ssh_pcap_file;
 typedef struct ssh_private_key_struct* ssh_private_key;
@@ -131,6 +132,40 @@ typedef int socket_t;
 
 #define SSH_INVALID_SOCKET ((socket_t) -1)
 
+/* Called by ssh_event_dopoll() for a file descriptor added with ssh_event_add_fd() */
+typedef int (*ssh_event_callback)(socket_t fd, int revents, void *userdata);
+
+/* Counters of a session, filled by ssh_get_session_stats() */
+struct ssh_session_stats {
+  uint64_t bytes_in;        /* bytes read from the socket */
+  uint64_t bytes_out;       /* bytes written to the socket */
+  uint64_t packets_in;
+  uint64_t packets_out;
+  uint64_t read_calls;      /* recv() or read() system calls */
+  uint64_t write_calls;     /* send() or write() system calls */
+  uint64_t encrypt_ns;      /* time spent encrypting outgoing packets */
+  uint64_t decrypt_ns;      /* time spent decrypting incoming packets */
+  uint64_t mac_ns;          /* time spent computing and checking MACs */
+  uint32_t buffer_reallocs; /* times the session and socket buffers grew */
+  uint32_t in_queue;        /* bytes read but not yet parsed into packets */
+  uint32_t out_queue;       /* bytes waiting to be written to the socket */
+  uint32_t rtt_samples;
+  long srtt_us;             /* smoothed round trip time, 0 until measured */
+  uint32_t keepalives_sent;
+  uint32_t keepalives_answered;
+  long keepalive_rtt_us;    /* round trip of the last keepalive answered */
+};
+
+/* Counters of a channel, filled by ssh_channel_get_stats() */
+struct ssh_channel_stats {
+  uint64_t data_in;         /* payload bytes received */
+  uint64_t data_out;        /* payload bytes sent */
+  uint64_t window_stall_ns; /* time writes spent waiting for window space */
+  uint32_t window_stalls;   /* writes that found the remote window empty */
+  uint32_t in_queue;        /* payload received but not read yet */
+  uint32_t out_queue;       /* data written but waiting behind other channels */
+};
+
 /* the offsets of methods */
 enum ssh_kex_types_e {
 	SSH_KEX=0,
@@ -299,7 +334,9 @@ enum ssh_options_e {
   SSH_OPTIONS_BINDADDR,
   SSH_OPTIONS_STRICTHOSTKEYCHECK,
   SSH_OPTIONS_COMPRESSION,
-  SSH_OPTIONS_COMPRESSION_LEVEL
+  SSH_OPTIONS_COMPRESSION_LEVEL,
+  SSH_OPTIONS_KEY_EXCHANGE,
+  SSH_OPTIONS_TRACE_SIZE
 };
 
 enum {
@@ -330,6 +367,7 @@ LIBSSH_API int ssh_channel_close(ssh_channel channel);
 LIBSSH_API void ssh_channel_free(ssh_channel channel);
 LIBSSH_API int ssh_channel_get_exit_status(ssh_channel channel);
 LIBSSH_API ssh_session ssh_channel_get_session(ssh_channel channel);
+LIBSSH_API int ssh_channel_get_stats(ssh_channel channel, struct ssh_channel_stats *stats);
 LIBSSH_API int ssh_channel_is_closed(ssh_channel channel);
 LIBSSH_API int ssh_channel_is_eof(ssh_channel channel);
 LIBSSH_API int ssh_channel_is_open(ssh_channel channel);
@@ -369,13 +407,26 @@ LIBSSH_API int ssh_connect(ssh_session session);
 LIBSSH_API const char *ssh_copyright(void);
 LIBSSH_API void ssh_disconnect(ssh_session session);
 LIBSSH_API char *ssh_dirname (const char *path);
+LIBSSH_API int ssh_event_add_fd(ssh_event event, socket_t fd, short events,
+    ssh_event_callback cb, void *userdata);
+LIBSSH_API int ssh_event_add_session(ssh_event event, ssh_session session);
+LIBSSH_API int ssh_event_dopoll(ssh_event event, int timeout);
+LIBSSH_API void ssh_event_free(ssh_event event);
+LIBSSH_API ssh_event ssh_event_new(void);
+LIBSSH_API int ssh_event_remove_fd(ssh_event event, socket_t fd);
+LIBSSH_API int ssh_event_remove_session(ssh_event event, ssh_session session);
+LIBSSH_API int ssh_event_set_fd_events(ssh_event event, socket_t fd, short events);
 LIBSSH_API int ssh_finalize(void);
 LIBSSH_API ssh_channel ssh_forward_accept(ssh_session session, int timeout_ms);
 LIBSSH_API int ssh_forward_cancel(ssh_session session, const char *address, int port);
 LIBSSH_API int ssh_forward_listen(ssh_session session, const char *address, int port, int *bound_port);
 LIBSSH_API void ssh_free(ssh_session session);
+LIBSSH_API int ssh_get_connect_timing(ssh_session session, long *dns_usec, long *tcp_usec);
 LIBSSH_API const char *ssh_get_disconnect_message(ssh_session session);
+LIBSSH_API long ssh_get_kex_cpu_time(ssh_session session, const char **algorithm);
+LIBSSH_API int ssh_get_session_stats(ssh_session session, struct ssh_session_stats *stats);
 LIBSSH_API const char *ssh_get_error(void *error);
+LIBSSH_API int ssh_get_handshake_timing(ssh_session session, long *banner_usec, long *kex_usec);
 LIBSSH_API int ssh_get_error_code(void *error);
 LIBSSH_API socket_t ssh_get_fd(ssh_session session);
 LIBSSH_API char *ssh_get_hexa(const unsigned char *what, size_t len);
@@ -390,6 +441,7 @@ LIBSSH_API int ssh_init(void);
 LIBSSH_API int ssh_is_blocking(ssh_session session);
 LIBSSH_API int ssh_is_connected(ssh_session session);
 LIBSSH_API int ssh_is_server_known(ssh_session session);
+LIBSSH_API int ssh_kex_precompute(const char *algorithm, int count);
 LIBSSH_API void ssh_log(ssh_session session, int prioriry, const char *format, ...) PRINTF_ATTRIBUTE(3, 4);
 LIBSSH_API ssh_channel ssh_message_channel_request_open_reply_accept(ssh_message msg);
 LIBSSH_API int ssh_message_channel_request_reply_success(ssh_message msg);
@@ -407,8 +459,11 @@ LIBSSH_API int ssh_options_set(ssh_session session, enum ssh_options_e type,
     const void *value);
 LIBSSH_API int ssh_pcap_file_close(ssh_pcap_file pcap);
 LIBSSH_API void ssh_pcap_file_free(ssh_pcap_file pcap);
+LIBSSH_API uint64_t ssh_pcap_file_get_dropped(ssh_pcap_file pcap);
 LIBSSH_API ssh_pcap_file ssh_pcap_file_new(void);
 LIBSSH_API int ssh_pcap_file_open(ssh_pcap_file pcap, const char *filename);
+LIBSSH_API int ssh_pcap_file_set_async(ssh_pcap_file pcap, uint32_t ring_size);
+LIBSSH_API int ssh_pcap_file_set_rotation(ssh_pcap_file pcap, uint64_t size);
 
 LIBSSH_API enum ssh_keytypes_e ssh_privatekey_type(ssh_private_key privatekey);
 
@@ -429,6 +484,7 @@ LIBSSH_API int ssh_scp_request_get_permissions(ssh_scp scp);
 LIBSSH_API size_t ssh_scp_request_get_size(ssh_scp scp);
 LIBSSH_API const char *ssh_scp_request_get_warning(ssh_scp scp);
 LIBSSH_API int ssh_scp_write(ssh_scp scp, const void *buffer, size_t len);
+LIBSSH_API int ssh_send_keepalive(ssh_session session);
 LIBSSH_API int ssh_select(ssh_channel *channels, ssh_channel *outchannels, socket_t maxfd,
     fd_set *readfds, struct timeval *timeout);
 LIBSSH_API int ssh_service_request(ssh_session session, const char *service);
@@ -438,6 +494,7 @@ LIBSSH_API void ssh_set_fd_toread(ssh_session session);
 LIBSSH_API void ssh_set_fd_towrite(ssh_session session);
 LIBSSH_API void ssh_silent_disconnect(ssh_session session);
 LIBSSH_API int ssh_set_pcap_file(ssh_session session, ssh_pcap_file pcapfile);
+LIBSSH_API void ssh_trace_dump(ssh_session session);
 #ifndef _WIN32
 LIBSSH_API int ssh_userauth_agent_pubkey(ssh_session session, const char *username,
     ssh_public_key publickey);
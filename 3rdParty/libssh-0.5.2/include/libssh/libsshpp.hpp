@@ -304,6 +304,32 @@ public:
   int getOpensshVersion(){
     return ssh_get_openssh_version(c_session);
   }
+  /** @brief returns the time spent resolving and connecting to the host
+   * @param[out] dnsUsec time spent in name resolution, in microseconds
+   * @param[out] tcpUsec time spent in the TCP handshake, in microseconds
+   * @returns number of connection attempts
+   * @see ssh_get_connect_timing
+   */
+  int getConnectTiming(long *dnsUsec, long *tcpUsec){
+    return ssh_get_connect_timing(c_session, dnsUsec, tcpUsec);
+  }
+  /** @brief returns the time spent in the SSH handshake
+   * @param[out] bannerUsec time until the server banner arrived, in microseconds
+   * @param[out] kexUsec time spent in the key exchange, in microseconds
+   * @returns SSH_OK or SSH_ERROR
+   * @see ssh_get_handshake_timing
+   */
+  int getHandshakeTiming(long *bannerUsec, long *kexUsec){
+    return ssh_get_handshake_timing(c_session, bannerUsec, kexUsec);
+  }
+  /** @brief returns the CPU time spent in the key exchange
+   * @param[out] algorithm name of the key exchange method used
+   * @returns CPU time in microseconds, or SSH_ERROR
+   * @see ssh_get_kex_cpu_time
+   */
+  long getKexCpuTime(const char **algorithm){
+    return ssh_get_kex_cpu_time(c_session, algorithm);
+  }
   /** @brief returns the version of the SSH protocol being used
    * @returns the SSH protocol version
    * @see ssh_get_version
@@ -398,11 +424,12 @@ public:
   	ssh_set_fd_toread(c_session);
   }
 
-private:
-  ssh_session c_session;
   ssh_session getCSession(){
     return c_session;
   }
+
+private:
+  ssh_session c_session;
   /* No copy constructor, no = operator */
   Session(const Session &);
   Session& operator=(const Session &);
@@ -586,10 +613,14 @@ public:
     ssh_throw(ret);
     return ret;
   }
-private:
+
+  ssh_channel getCChannel(){
+    return channel;
+  }
   ssh_session getCSession(){
     return session->getCSession();
   }
+private:
   Channel (Session &session, ssh_channel c_channel){
     this->channel=c_channel;
     this->session=&session;
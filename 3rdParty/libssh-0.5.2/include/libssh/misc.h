@@ -55,6 +55,14 @@ struct ssh_timestamp {
   long useconds;
 };
 
+/* identifies a version of a file, to notice when it changed */
+struct ssh_file_stamp {
+  long mtime;
+  long mtime_nsec;
+  long long size;
+  unsigned long inode;
+};
+
 struct ssh_list *ssh_list_new(void);
 void ssh_list_free(struct ssh_list *list);
 struct ssh_iterator *ssh_list_get_iterator(const struct ssh_list *list);
@@ -81,5 +89,11 @@ const void *_ssh_list_pop_head(struct ssh_list *list);
 void ssh_timestamp_init(struct ssh_timestamp *ts);
 int ssh_timeout_elapsed(struct ssh_timestamp *ts, int timeout);
 int ssh_timeout_update(struct ssh_timestamp *ts, int timeout);
+long ssh_timestamp_elapsed_us(struct ssh_timestamp *ts);
+long ssh_cpu_time_us(void);
+uint64_t ssh_clock_ns(void);
+int ssh_file_stamp_get(const char *filename, struct ssh_file_stamp *stamp);
+int ssh_file_stamp_equal(const struct ssh_file_stamp *a,
+    const struct ssh_file_stamp *b);
 
 #endif /* MISC_H_ */
@@ -7,7 +7,11 @@
 #ifdef WITH_PCAP
 typedef struct ssh_pcap_context_struct* ssh_pcap_context;
 
-int ssh_pcap_file_write_packet(ssh_pcap_file pcap, ssh_buffer packet, uint32_t original_len);
+/* length of the header in front of every packet of a pcap file */
+#define PCAPREC_HDR_LEN 16
+
+int ssh_pcap_file_write_packet(ssh_pcap_file pcap, uint8_t *header,
+		uint32_t header_len, const void *data, uint32_t len, uint32_t original_len);
 
 ssh_pcap_context ssh_pcap_context_new(ssh_session session);
 void ssh_pcap_context_free(ssh_pcap_context ctx);
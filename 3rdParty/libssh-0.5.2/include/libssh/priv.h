@@ -149,6 +149,8 @@ SSH_PACKET_CALLBACK(ssh_packet_service_accept);
 
 /* config.c */
 int ssh_config_parse_file(ssh_session session, const char *filename);
+int ssh_config_cache_init(void);
+void ssh_config_cache_finalize(void);
 
 /* errors.c */
 void ssh_set_error(void *error, int code, const char *descr, ...) PRINTF_ATTRIBUTE(3, 4);
@@ -176,6 +178,9 @@ socket_t ssh_connect_host(ssh_session session, const char *host,const char
         *bind_addr, int port, long timeout, long usec);
 socket_t ssh_connect_host_nonblocking(ssh_session session, const char *host,
 		const char *bind_addr, int port);
+struct addrinfo;
+socket_t ssh_connect_ai_race(ssh_session session, struct addrinfo *ai,
+    const char *bind_addr, int timeout);
 void ssh_sock_set_nonblocking(socket_t sock);
 void ssh_sock_set_blocking(socket_t sock);
 
@@ -202,11 +207,20 @@ int decompress_buffer(ssh_session session,ssh_buffer buf, size_t maxlen);
 uint32_t ssh_crc32(const char *buf, uint32_t len);
 
 
+/* keyfiles.c */
+int ssh_keyfile_cache_init(void);
+void ssh_keyfile_cache_finalize(void);
+
+/* known_hosts.c */
+int ssh_knownhosts_cache_init(void);
+void ssh_knownhosts_cache_finalize(void);
+
 /* match.c */
 int match_hostname(const char *host, const char *pattern, unsigned int len);
 
 int message_handle(ssh_session session, void *user, uint8_t type, ssh_buffer packet);
 /* log.c */
+void ssh_log_line(ssh_session session, int verbosity, const char *line);
 
 /* misc.c */
 #ifdef _WIN32
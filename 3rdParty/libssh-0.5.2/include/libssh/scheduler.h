@@ -0,0 +1,41 @@
+/*
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "libssh/priv.h"
+
+/* channel data packets of at most this many payload bytes skip the queues */
+#define SSH_SCHED_INTERACTIVE 512
+/* queued data only moves to the socket while less than this is buffered there */
+#define SSH_SCHED_LOW_WATER (64 * 1024)
+/* bytes a bulk channel may send each time its turn comes */
+#define SSH_SCHED_QUANTUM (32 * 1024)
+/* nonblocking writes stop once this much is queued on their channel */
+#define SSH_SCHED_QUEUE_MAX (256 * 1024)
+
+int ssh_sched_send(ssh_channel channel, uint32_t len);
+int ssh_sched_pump(ssh_session session);
+int ssh_sched_flush_channel(ssh_channel channel);
+uint32_t ssh_sched_queued(ssh_channel channel);
+void ssh_sched_channel_free(ssh_channel channel);
+void ssh_sched_controlflow(int code, void *userdata);
+
+#endif /* SCHEDULER_H_ */
@@ -27,6 +27,7 @@
 #include "libssh/auth.h"
 #include "libssh/channels.h"
 #include "libssh/poll.h"
+#include "libssh/trace.h"
 typedef struct ssh_kbdint_struct* ssh_kbdint;
 
 /* These are the different states a SSH session can be into its life */
@@ -58,9 +59,24 @@ enum ssh_pending_call_e {
 	SSH_PENDING_CALL_AUTH_PASSWORD
 };
 
+/* time spent in the connection phases, in microseconds */
+struct ssh_connect_timing_struct {
+    long dns; /* getaddrinfo() */
+    long tcp; /* from the first connect() until a socket won the race */
+    int attempts; /* number of connect() calls made */
+    long kex_cpu; /* CPU time spent in the key exchange computations */
+    int kex_type; /* enum ssh_key_exchange_e of that key exchange */
+    long banner; /* from the socket connection until the server banner */
+    long kex; /* from the server banner until the first key exchange ended */
+    uint64_t phase_start; /* ssh_clock_ns() when the current phase began */
+};
+
 /* libssh calls may block an undefined amount of time */
 #define SSH_SESSION_FLAG_BLOCKING 1
 
+/* keepalives that may wait for their reply at the same time */
+#define SSH_KEEPALIVE_MAX 8
+
 struct ssh_session_struct {
     struct error_struct error;
     struct ssh_socket_struct *socket;
@@ -141,6 +157,7 @@ struct ssh_session_struct {
 #ifdef WITH_PCAP
     ssh_pcap_context pcap_ctx; /* pcap debugging context */
 #endif
+    struct ssh_trace_ring trace; /* recent hot path events */
     char *username;
     char *host;
     char *bindaddr; /* bind the client to an ip addr */
@@ -154,6 +171,16 @@ struct ssh_session_struct {
     unsigned long timeout_usec;
     unsigned int port;
     socket_t fd;
+    struct ssh_connect_timing_struct connect_timing;
+    struct ssh_session_stats stats; /* queue and realloc fields are filled on read */
+    uint64_t rtt_probe_ns; /* when the request we await a reply for was sent */
+    /* send times of the unanswered keepalives, oldest at keepalive_first */
+    uint64_t keepalive_sent_ns[SSH_KEEPALIVE_MAX];
+    int keepalive_first;
+    int keepalive_pending;
+    /* channel data messages waiting in the channel queues, in bytes */
+    uint32_t sched_queued;
+    ssh_channel sched_last; /* the channel the scheduler served last */
     int ssh2;
     int ssh1;
     int StrictHostKeyChecking;
@@ -170,5 +197,8 @@ int ssh_handle_packets(ssh_session session, int timeout);
 int ssh_handle_packets_termination(ssh_session session, int timeout,
     ssh_termination_function fct, void *user);
 void ssh_socket_exception_callback(int code, int errno_code, void *user);
+void ssh_stats_rtt_sample(ssh_session session, long usec);
+void ssh_stats_rtt_start(ssh_session session);
+void ssh_stats_rtt_end(ssh_session session);
 
 #endif /* SESSION_H_ */
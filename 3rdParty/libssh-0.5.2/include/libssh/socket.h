@@ -54,6 +54,8 @@ void ssh_socket_set_read_wontblock(ssh_socket s);
 void ssh_socket_set_except(ssh_socket s);
 int ssh_socket_get_status(ssh_socket s);
 int ssh_socket_buffered_write_bytes(ssh_socket s);
+void ssh_socket_get_buffer_stats(ssh_socket s, uint32_t *in_bytes,
+    uint32_t *out_bytes, uint32_t *reallocs);
 int ssh_socket_data_available(ssh_socket s);
 int ssh_socket_data_writable(ssh_socket s);
 
@@ -29,4 +29,9 @@ int ssh_threads_init(void);
 void ssh_threads_finalize(void);
 const char *ssh_threads_get_type(void);
 
+int ssh_mutex_init(void **lock);
+int ssh_mutex_destroy(void **lock);
+int ssh_mutex_lock(void **lock);
+int ssh_mutex_unlock(void **lock);
+
 #endif /* THREADS_H_ */
@@ -0,0 +1,73 @@
+/*
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "libssh/libssh.h"
+
+/* events recorded by the hot paths, with the meaning of their arguments */
+enum ssh_trace_event_e {
+  SSH_TRACE_NONE = 0,
+  SSH_TRACE_PACKET_IN,         /* packet length, padding, message type */
+  SSH_TRACE_PACKET_LEFTOVER,   /* bytes left in the socket buffer */
+  SSH_TRACE_PACKET_OUT,        /* payload length, padding, packet length */
+  SSH_TRACE_SOCKET_POLLOUT,    /* bytes waiting in the socket buffer */
+  SSH_TRACE_CHANNEL_DATA,      /* channel, length, stderr */
+  SSH_TRACE_CHANNEL_WINDOWS,   /* channel, local window, remote window */
+  SSH_TRACE_CHANNEL_ADJUST,    /* channel, bytes added, remote window */
+  SSH_TRACE_CHANNEL_GROW,      /* channel, new local window */
+  SSH_TRACE_CHANNEL_WRITE,     /* channel, length, remote window */
+  SSH_TRACE_CHANNEL_STALL,     /* channel, remote window */
+  SSH_TRACE_CHANNEL_READ,      /* channel, bytes wanted, bytes buffered */
+  SSH_TRACE_MAX
+};
+
+struct ssh_trace_event {
+  uint64_t ns;
+  uint32_t id;
+  uint32_t args[3];
+};
+
+/*
+ * A session is only driven by one thread at a time, so its ring has a single
+ * writer and needs neither locks nor atomics.
+ */
+struct ssh_trace_ring {
+  struct ssh_trace_event *events;
+  uint32_t mask; /* number of events - 1, the size is a power of two */
+  uint32_t head; /* number of events recorded */
+};
+
+int ssh_trace_set_size(ssh_session session, uint32_t size);
+void ssh_trace_free(ssh_session session);
+void ssh_trace_event(ssh_session session, int id, uint32_t a, uint32_t b,
+    uint32_t c);
+
+/* the arguments are only evaluated when the event goes somewhere */
+#define ssh_trace(session, id, a, b, c) \
+  do { \
+    if ((session)->trace.events != NULL || \
+        (session)->log_verbosity >= SSH_LOG_PACKET) { \
+      ssh_trace_event((session), (id), (uint32_t) (a), (uint32_t) (b), \
+          (uint32_t) (c)); \
+    } \
+  } while(0)
+
+#endif /* TRACE_H_ */
@@ -124,6 +124,7 @@ static int realloc_buffer(struct ssh_buffer_struct *buffer, int needed) {
   }
   buffer->data = new;
   buffer->allocated = needed;
+  buffer->reallocs++;
   buffer_verify(buffer);
   return 0;
 }
@@ -42,6 +42,7 @@
 #include "libssh/session.h"
 #include "libssh/misc.h"
 #include "libssh/messages.h"
+#include "libssh/scheduler.h"
 #if WITH_SERVER
 #include "libssh/server.h"
 #endif
@@ -102,6 +103,7 @@ ssh_channel ssh_channel_new(ssh_session session) {
 
   channel->session = session;
   channel->version = session->version;
+  channel->blocking = 1;
   channel->exit_status = -1;
 
   if(session->channels == NULL) {
@@ -152,6 +154,8 @@ SSH_PACKET_CALLBACK(ssh_packet_channel_open_conf){
     return SSH_PACKET_USED;
   }
 
+  ssh_stats_rtt_end(session);
+
   buffer_get_u32(packet, &tmp);
   channel->remote_channel = ntohl(tmp);
 
@@ -171,6 +175,7 @@ SSH_PACKET_CALLBACK(ssh_packet_channel_open_conf){
       (long unsigned int) channel->remote_maxpacket);
 
   channel->state = SSH_CHANNEL_STATE_OPEN;
+  ssh_channel_write_wontblock(channel);
   leave_function();
   return SSH_PACKET_USED;
 }
@@ -193,6 +198,7 @@ SSH_PACKET_CALLBACK(ssh_packet_channel_open_fail){
     ssh_log(session,SSH_LOG_RARE,"Invalid channel in packet");
     return SSH_PACKET_USED;
   }
+  ssh_stats_rtt_end(session);
   buffer_get_u32(packet, &code);
 
   error_s = buffer_get_ssh_string(packet);
@@ -211,6 +217,13 @@ SSH_PACKET_CALLBACK(ssh_packet_channel_open_fail){
       error);
   SAFE_FREE(error);
   channel->state=SSH_CHANNEL_STATE_OPEN_DENIED;
+  /* nobody waits in channel_open() for a nonblocking channel */
+  if (!channel->blocking &&
+      ssh_callbacks_exists(channel->callbacks, channel_close_function)) {
+    channel->callbacks->channel_close_function(channel->session,
+                                               channel,
+                                               channel->callbacks->userdata);
+  }
   return SSH_PACKET_USED;
 }
 
@@ -220,6 +233,9 @@ SSH_PACKET_CALLBACK(ssh_packet_channel_open_fail){
  * @brief Open a channel by sending a SSH_OPEN_CHANNEL message and
  *        wait for the reply.
  *
+ * A nonblocking channel does not wait: SSH_AGAIN is returned, and calling
+ * again tells whether the reply has come in yet.
+ *
  * @param[in]  channel  The current channel.
  *
  * @param[in]  type_c   A C string describing the kind of channel (e.g. "exec").
@@ -239,6 +255,9 @@ static int channel_open(ssh_channel channel, const char *type_c, int window,
   int err=SSH_ERROR;
 
   enter_function();
+  if (channel->state != SSH_CHANNEL_STATE_NOT_OPEN) {
+    goto pending;
+  }
   channel->local_channel = ssh_channel_new_id(session);
   channel->local_maxpacket = maxpacket;
   channel->local_window = window;
@@ -283,10 +302,19 @@ static int channel_open(ssh_channel channel, const char *type_c, int window,
   ssh_log(session, SSH_LOG_PACKET,
       "Sent a SSH_MSG_CHANNEL_OPEN type %s for channel %d",
       type_c, channel->local_channel);
-
+  ssh_stats_rtt_start(session);
+  channel->state = SSH_CHANNEL_STATE_OPENING;
+
+pending:
+  if (!channel->blocking) {
+    err = SSH_AGAIN;
+    if (channel->state == SSH_CHANNEL_STATE_OPEN_DENIED) {
+      err = SSH_ERROR;
+    }
+  }
   /* Todo: fix this into a correct loop */
   /* wait until channel is opened by server */
-  while(channel->state == SSH_CHANNEL_STATE_NOT_OPEN){
+  while(channel->state == SSH_CHANNEL_STATE_OPENING && channel->blocking){
       err = ssh_handle_packets(session, -2);
       if (err != SSH_OK) {
           break;
@@ -339,10 +367,6 @@ static int grow_window(ssh_session session, ssh_channel channel, int minimumsize
   }
 #endif
   if(new_window <= channel->local_window){
-    ssh_log(session,SSH_LOG_PROTOCOL,
-        "growing window (channel %d:%d) to %d bytes : not needed (%d bytes)",
-        channel->local_channel, channel->remote_channel, new_window,
-        channel->local_window);
     leave_function();
     return SSH_OK;
   }
@@ -360,11 +384,8 @@ static int grow_window(ssh_session session, ssh_channel channel, int minimumsize
     goto error;
   }
 
-  ssh_log(session, SSH_LOG_PROTOCOL,
-      "growing window (channel %d:%d) to %d bytes",
-      channel->local_channel,
-      channel->remote_channel,
-      new_window);
+  ssh_trace(session, SSH_TRACE_CHANNEL_GROW, channel->local_channel,
+      new_window, 0);
 
   channel->local_window = new_window;
 
@@ -438,14 +459,10 @@ SSH_PACKET_CALLBACK(channel_rcv_change_window) {
   }
 
   bytes = ntohl(bytes);
-  ssh_log(session, SSH_LOG_PROTOCOL,
-      "Adding %d bytes to channel (%d:%d) (from %d bytes)",
-      bytes,
-      channel->local_channel,
-      channel->remote_channel,
-      channel->remote_window);
-
   channel->remote_window += bytes;
+  ssh_trace(session, SSH_TRACE_CHANNEL_ADJUST, channel->local_channel, bytes,
+      channel->remote_window);
+  ssh_channel_write_wontblock(channel);
 
   leave_function();
   return SSH_PACKET_USED;
@@ -488,12 +505,8 @@ SSH_PACKET_CALLBACK(channel_rcv_data){
   }
   len = ssh_string_len(str);
 
-  ssh_log(session, SSH_LOG_PROTOCOL,
-      "Channel receiving %" PRIdS " bytes data in %d (local win=%d remote win=%d)",
-      len,
-      is_stderr,
-      channel->local_window,
-      channel->remote_window);
+  ssh_trace(session, SSH_TRACE_CHANNEL_DATA, channel->local_channel, len,
+      is_stderr);
 
   /* What shall we do in this case? Let's accept it anyway */
   if (len > channel->local_window) {
@@ -503,6 +516,8 @@ SSH_PACKET_CALLBACK(channel_rcv_data){
         channel->local_window);
   }
 
+  channel->stats.data_in += len;
+
   if (channel_default_bufferize(channel, ssh_string_data(str), len,
         is_stderr) < 0) {
     ssh_string_free(str);
@@ -516,10 +531,8 @@ SSH_PACKET_CALLBACK(channel_rcv_data){
     channel->local_window = 0; /* buggy remote */
   }
 
-  ssh_log(session, SSH_LOG_PROTOCOL,
-      "Channel windows are now (local win=%d remote win=%d)",
-      channel->local_window,
-      channel->remote_window);
+  ssh_trace(session, SSH_TRACE_CHANNEL_WINDOWS, channel->local_channel,
+      channel->local_window, channel->remote_window);
 
   ssh_string_free(str);
 
@@ -1012,6 +1025,7 @@ void ssh_channel_free(ssh_channel channel) {
   if(it != NULL){
     ssh_list_remove(session->channels, it);
   }
+  ssh_sched_channel_free(channel);
   ssh_buffer_free(channel->stdout_buffer);
   ssh_buffer_free(channel->stderr_buffer);
 
@@ -1040,6 +1054,12 @@ int ssh_channel_send_eof(ssh_channel channel){
 
   enter_function();
 
+  /* the data still queued goes before the EOF */
+  if (ssh_sched_flush_channel(channel) == SSH_ERROR) {
+    leave_function();
+    return SSH_ERROR;
+  }
+
   if (buffer_add_u8(session->out_buffer, SSH2_MSG_CHANNEL_EOF) < 0) {
     ssh_set_error_oom(session);
     goto error;
@@ -1124,6 +1144,8 @@ int channel_write_common(ssh_channel channel, const void *data,
   uint32_t origlen = len;
   size_t effectivelen;
   size_t maxpacketlen;
+  uint64_t stall_start;
+  int stalled = 0;
   int timeout;
   int rc;
 
@@ -1143,7 +1165,7 @@ int channel_write_common(ssh_channel channel, const void *data,
   }
 
   enter_function();
-  if(ssh_is_blocking(session))
+  if(ssh_is_blocking(session) && channel->blocking)
     timeout = -2;
   else
     timeout = 0;
@@ -1177,17 +1199,29 @@ int channel_write_common(ssh_channel channel, const void *data,
 #endif
 
   while (len > 0) {
+    /* past this a nonblocking writer is told to come back later */
+    if (timeout == 0 && ssh_sched_queued(channel) >= SSH_SCHED_QUEUE_MAX) {
+      break;
+    }
+    ssh_trace(session, SSH_TRACE_CHANNEL_WRITE, channel->local_channel, len,
+        channel->remote_window);
     if (channel->remote_window < len) {
-      ssh_log(session, SSH_LOG_PROTOCOL,
-          "Remote window is %d bytes. going to write %d bytes",
-          channel->remote_window,
-          len);
       /* What happens when the channel window is zero? */
       if(channel->remote_window == 0) {
           /* nothing can be written */
-          ssh_log(session, SSH_LOG_PROTOCOL,
-                "Wait for a growing window message...");
+          ssh_trace(session, SSH_TRACE_CHANNEL_STALL, channel->local_channel,
+              channel->remote_window, 0);
+          if (!stalled) {
+            channel->stats.window_stalls++;
+            stalled = 1;
+          }
+          /* the event loop polling the session tells it when to go on */
+          if (!channel->blocking) {
+            goto out;
+          }
+          stall_start = ssh_clock_ns();
           rc = ssh_handle_packets(session, timeout);
+          channel->stats.window_stall_ns += ssh_clock_ns() - stall_start;
           if (rc == SSH_ERROR || (channel->remote_window == 0 && timeout==0))
             goto out;
           continue;
@@ -1217,22 +1251,28 @@ int channel_write_common(ssh_channel channel, const void *data,
       goto error;
     }
 
-    if (packet_send(session) == SSH_ERROR) {
+    if (ssh_sched_send(channel, effectivelen) == SSH_ERROR) {
       leave_function();
       return SSH_ERROR;
     }
 
     ssh_log(session, SSH_LOG_RARE,
         "channel_write wrote %ld bytes", (long int) effectivelen);
+    channel->stats.data_out += effectivelen;
 
     channel->remote_window -= effectivelen;
     len -= effectivelen;
     data = ((uint8_t*)data + effectivelen);
   }
-  /* it's a good idea to flush the socket now */
+  /* it's a good idea to flush the socket now, and blocking writes wait for
+   * their channel queue to drain as well */
+  if (!channel->blocking) {
+    goto out;
+  }
   do {
     rc = ssh_handle_packets(session, timeout);
-  } while(ssh_socket_buffered_write_bytes(session->socket) > 0 && timeout != 0);
+  } while((ssh_socket_buffered_write_bytes(session->socket) > 0 ||
+        ssh_sched_queued(channel) > 0) && timeout != 0 && rc != SSH_ERROR);
 out:
   leave_function();
   return (int)(origlen - len);
@@ -1244,6 +1284,21 @@ error:
   return SSH_ERROR;
 }
 
+/**
+ * @internal
+ *
+ * @brief Tells the writer of a channel that it can take data again.
+ */
+void ssh_channel_write_wontblock(ssh_channel channel) {
+  if (ssh_callbacks_exists(channel->callbacks,
+        channel_write_wontblock_function)) {
+    channel->callbacks->channel_write_wontblock_function(channel->session,
+                                                         channel,
+                                                         channel->remote_window,
+                                                         channel->callbacks->userdata);
+  }
+}
+
 uint32_t ssh_channel_window_size(ssh_channel channel) {
     return channel->remote_window;
 }
@@ -1314,10 +1369,13 @@ int ssh_channel_is_eof(ssh_channel channel) {
  *
  * @param[in]  channel  The channel to use.
  *
- * @param[in]  blocking A boolean for blocking or nonblocking.
+ * Opening a nonblocking channel returns SSH_AGAIN until the server replies,
+ * and writes to it only queue what the remote window takes, leaving the
+ * socket to whoever polls the session. Set a channel_write_wontblock_function
+ * callback to learn when to write again; a refused open calls the
+ * channel_close_function callback.
  *
- * @bug This functionality is still under development and
- *      doesn't work correctly.
+ * @param[in]  blocking A boolean for blocking or nonblocking.
  */
 void ssh_channel_set_blocking(ssh_channel channel, int blocking) {
   channel->blocking = (blocking == 0 ? 0 : 1);
@@ -1351,6 +1409,7 @@ SSH_PACKET_CALLBACK(ssh_packet_channel_success){
         channel->request_state);
   } else {
     channel->request_state=SSH_CHANNEL_REQ_STATE_ACCEPTED;
+    ssh_stats_rtt_end(session);
   }
 
   leave_function();
@@ -1385,6 +1444,7 @@ SSH_PACKET_CALLBACK(ssh_packet_channel_failure){
         channel->request_state);
   } else {
     channel->request_state=SSH_CHANNEL_REQ_STATE_DENIED;
+    ssh_stats_rtt_end(session);
   }
   leave_function();
   return SSH_PACKET_USED;
@@ -1438,6 +1498,7 @@ static int channel_request(ssh_channel channel, const char *request,
     leave_function();
     return SSH_OK;
   }
+  ssh_stats_rtt_start(session);
   while(channel->request_state == SSH_CHANNEL_REQ_STATE_PENDING){
     ssh_handle_packets(session, -2);
     if(session->session_state == SSH_SESSION_STATE_ERROR) {
@@ -1804,6 +1865,36 @@ ssh_channel ssh_channel_accept_x11(ssh_channel channel, int timeout_ms) {
   return ssh_channel_accept(channel->session, SSH_CHANNEL_X11, timeout_ms);
 }
 
+/**
+ * @internal
+ *
+ * @brief Take a global request reply as the answer to the oldest keepalive.
+ *
+ * Replies come in the order of the requests, and a blocking global request
+ * waits for its reply before the thread can send another keepalive, so the
+ * keepalives still unanswered were all sent before it.
+ *
+ * @return 1 if the reply was for a keepalive, 0 otherwise.
+ */
+static int keepalive_reply(ssh_session session) {
+  long usec;
+
+  if (session->keepalive_pending == 0) {
+    return 0;
+  }
+
+  usec = (long) ((ssh_clock_ns() -
+        session->keepalive_sent_ns[session->keepalive_first]) / 1000);
+  session->keepalive_first = (session->keepalive_first + 1) % SSH_KEEPALIVE_MAX;
+  session->keepalive_pending--;
+
+  session->stats.keepalives_answered++;
+  session->stats.keepalive_rtt_us = usec;
+  ssh_stats_rtt_sample(session, usec);
+  ssh_log(session, SSH_LOG_PACKET, "Keepalive answered in %ld us", usec);
+  return 1;
+}
+
 /**
  * @internal
  *
@@ -1818,11 +1909,16 @@ SSH_PACKET_CALLBACK(ssh_request_success){
 
   ssh_log(session, SSH_LOG_PACKET,
       "Received SSH_REQUEST_SUCCESS");
+  if (keepalive_reply(session)) {
+    leave_function();
+    return SSH_PACKET_USED;
+  }
   if(session->global_req_state != SSH_CHANNEL_REQ_STATE_PENDING){
     ssh_log(session, SSH_LOG_RARE, "SSH_REQUEST_SUCCESS received in incorrect state %d",
         session->global_req_state);
   } else {
     session->global_req_state=SSH_CHANNEL_REQ_STATE_ACCEPTED;
+    ssh_stats_rtt_end(session);
   }
 
   leave_function();
@@ -1843,11 +1939,17 @@ SSH_PACKET_CALLBACK(ssh_request_denied){
 
   ssh_log(session, SSH_LOG_PACKET,
       "Received SSH_REQUEST_FAILURE");
+  /* servers which do not know keepalive@openssh.com refuse it, that is alive */
+  if (keepalive_reply(session)) {
+    leave_function();
+    return SSH_PACKET_USED;
+  }
   if(session->global_req_state != SSH_CHANNEL_REQ_STATE_PENDING){
     ssh_log(session, SSH_LOG_RARE, "SSH_REQUEST_DENIED received in incorrect state %d",
         session->global_req_state);
   } else {
     session->global_req_state=SSH_CHANNEL_REQ_STATE_DENIED;
+    ssh_stats_rtt_end(session);
   }
 
   leave_function();
@@ -1917,6 +2019,7 @@ static int global_request(ssh_session session, const char *request,
     leave_function();
     return SSH_OK;
   }
+  ssh_stats_rtt_start(session);
   while(session->global_req_state == SSH_CHANNEL_REQ_STATE_PENDING){
     rc=ssh_handle_packets(session, -2);
     if(rc==SSH_ERROR){
@@ -2065,6 +2168,71 @@ error:
   return rc;
 }
 
+/**
+ * @brief Sends a "keepalive@openssh.com" global request without waiting for
+ *        the reply.
+ *
+ * The reply is handled whenever the session processes packets: its round
+ * trip time is folded into the smoothed RTT and counted in the session
+ * stats, see ssh_get_session_stats(). A link is alive while keepalives keep
+ * being answered, whether accepted or refused.
+ *
+ * @param[in]  session  The ssh session to send the keepalive.
+ *
+ * @return              SSH_OK on success, SSH_ERROR if an error occured or
+ *                      SSH_KEEPALIVE_MAX keepalives are still unanswered.
+ */
+int ssh_send_keepalive(ssh_session session) {
+  ssh_string req = NULL;
+  int slot;
+  int rc = SSH_ERROR;
+
+  if (session == NULL) {
+    return SSH_ERROR;
+  }
+
+  enter_function();
+  if (session->version != 2) {
+    ssh_set_error(session, SSH_REQUEST_DENIED,
+        "Keepalives need a SSH-2 session");
+    goto error;
+  }
+  if (session->keepalive_pending == SSH_KEEPALIVE_MAX) {
+    ssh_set_error(session, SSH_REQUEST_DENIED,
+        "%d keepalives are still unanswered", SSH_KEEPALIVE_MAX);
+    goto error;
+  }
+
+  req = ssh_string_from_char("keepalive@openssh.com");
+  if (req == NULL) {
+    ssh_set_error_oom(session);
+    goto error;
+  }
+  if (buffer_add_u8(session->out_buffer, SSH2_MSG_GLOBAL_REQUEST) < 0 ||
+      buffer_add_ssh_string(session->out_buffer, req) < 0 ||
+      buffer_add_u8(session->out_buffer, 1) < 0) {
+    ssh_set_error_oom(session);
+    goto error;
+  }
+  if (packet_send(session) == SSH_ERROR) {
+    goto error;
+  }
+
+  slot = (session->keepalive_first + session->keepalive_pending) %
+    SSH_KEEPALIVE_MAX;
+  session->keepalive_sent_ns[slot] = ssh_clock_ns();
+  session->keepalive_pending++;
+  session->stats.keepalives_sent++;
+  ssh_log(session, SSH_LOG_PACKET, "Sent a keepalive, %d unanswered",
+      session->keepalive_pending);
+  rc = SSH_OK;
+
+error:
+  ssh_string_free(req);
+  leave_function();
+  return rc;
+}
+
 /**
  * @brief Set environment variables.
  *
@@ -2369,11 +2537,8 @@ int ssh_channel_read(ssh_channel channel, void *dest, uint32_t count, int is_std
    * We may have problem if the window is too small to accept as much data
    * as asked
    */
-  ssh_log(session, SSH_LOG_PROTOCOL,
-      "Read (%d) buffered : %d bytes. Window: %d",
-      count,
-      buffer_get_rest_len(stdbuf),
-      channel->local_window);
+  ssh_trace(session, SSH_TRACE_CHANNEL_READ, channel->local_channel, count,
+      buffer_get_rest_len(stdbuf));
 
   if (count > buffer_get_rest_len(stdbuf) + channel->local_window) {
     if (grow_window(session, channel, count - buffer_get_rest_len(stdbuf)) < 0) {
@@ -2525,6 +2690,31 @@ ssh_session ssh_channel_get_session(ssh_channel channel) {
   return channel->session;
 }
 
+/**
+ * @brief Get the counters of a channel.
+ *
+ * The counters are updated by the thread using the channel without any
+ * locking; call this from that same thread to get a consistent snapshot.
+ *
+ * @param[in]  channel  The channel to get the counters from.
+ *
+ * @param[out] stats    Filled with the counters.
+ *
+ * @return              SSH_OK on success, SSH_ERROR on error.
+ */
+int ssh_channel_get_stats(ssh_channel channel, struct ssh_channel_stats *stats) {
+  if (channel == NULL || stats == NULL) {
+    return SSH_ERROR;
+  }
+
+  *stats = channel->stats;
+  stats->in_queue = buffer_get_rest_len(channel->stdout_buffer) +
+      buffer_get_rest_len(channel->stderr_buffer);
+  stats->out_queue = ssh_sched_queued(channel);
+
+  return SSH_OK;
+}
+
 /**
  * @brief Get the exit status of the channel (error code from the executed
  *        instruction).
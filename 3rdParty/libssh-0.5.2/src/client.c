@@ -38,6 +38,10 @@
 #include "libssh/dh.h"
 #include "libssh/threads.h"
 #include "libssh/misc.h"
+#include "libssh/kex.h"
+#include "libssh/curve25519.h"
+#include "libssh/ecdh.h"
+#include "libssh/scheduler.h"
 
 #define set_status(session, status) do {\
         if (session->callbacks && session->callbacks->connect_status_function) \
@@ -62,9 +66,10 @@ static void socket_callback_connected(int code, int errno_code, void *user){
 		return;
 	}
 	ssh_log(session,SSH_LOG_RARE,"Socket connection callback: %d (%d)",code, errno_code);
-	if(code == SSH_SOCKET_CONNECTED_OK)
+	if(code == SSH_SOCKET_CONNECTED_OK) {
 		session->session_state=SSH_SESSION_STATE_SOCKET_CONNECTED;
-	else {
+		session->connect_timing.phase_start = ssh_clock_ns();
+	} else {
 		session->session_state=SSH_SESSION_STATE_ERROR;
 		ssh_set_error(session,SSH_FATAL,"%s",strerror(errno_code));
 	}
@@ -72,6 +77,24 @@ static void socket_callback_connected(int code, int errno_code, void *user){
 	leave_function();
 }
 
+/**
+ * @internal
+ *
+ * @brief Stores the time spent in the current connection phase and starts
+ * the next one.
+ */
+static void ssh_connect_phase_end(ssh_session session, long *usec) {
+  uint64_t now;
+
+  if (session->connect_timing.phase_start == 0) {
+    return;
+  }
+
+  now = ssh_clock_ns();
+  *usec = (long) ((now - session->connect_timing.phase_start) / 1000);
+  session->connect_timing.phase_start = now;
+}
+
 /**
  * @internal
  *
@@ -110,6 +133,7 @@ static int callback_receive_banner(const void *data, size_t len, void *user) {
   		ret=i+1;
   		session->serverbanner=str;
   		session->session_state=SSH_SESSION_STATE_BANNER_RECEIVED;
+  		ssh_connect_phase_end(session, &session->connect_timing.banner);
   		ssh_log(session,SSH_LOG_PACKET,"Received banner: %s",str);
 		session->ssh_connection_callback(session);
   		leave_function();
@@ -179,9 +203,12 @@ end:
 
 
 SSH_PACKET_CALLBACK(ssh_packet_dh_reply){
+  struct ssh_crypto_struct *crypto = session->next_crypto;
   ssh_string f = NULL;
   ssh_string pubkey = NULL;
   ssh_string signature = NULL;
+  long cpu;
+  int rc;
   (void)type;
   (void)user;
   ssh_log(session,SSH_LOG_PROTOCOL,"Received SSH_KEXDH_REPLY");
@@ -199,18 +226,27 @@ SSH_PACKET_CALLBACK(ssh_packet_dh_reply){
   }
   dh_import_pubkey(session, pubkey);
 
-  f = buffer_get_ssh_string(packet);
-  if (f == NULL) {
-    ssh_set_error(session,SSH_FATAL, "No F number in packet");
-    goto error;
-  }
-  if (dh_import_f(session, f) < 0) {
-    ssh_set_error(session, SSH_FATAL, "Cannot import f number");
-    goto error;
+  if (crypto->kex_type == SSH_KEX_DH_GROUP1_SHA1) {
+    f = buffer_get_ssh_string(packet);
+    if (f == NULL) {
+      ssh_set_error(session,SSH_FATAL, "No F number in packet");
+      goto error;
+    }
+    if (dh_import_f(session, f) < 0) {
+      ssh_set_error(session, SSH_FATAL, "Cannot import f number");
+      goto error;
+    }
+    ssh_string_burn(f);
+    ssh_string_free(f);
+    f=NULL;
+  } else {
+    /* SSH_MSG_KEX_ECDH_REPLY carries Q_S in place of f */
+    crypto->ecdh_server_pubkey = buffer_get_ssh_string(packet);
+    if (crypto->ecdh_server_pubkey == NULL) {
+      ssh_set_error(session, SSH_FATAL, "No Q_S ECC point in packet");
+      goto error;
+    }
   }
-  ssh_string_burn(f);
-  ssh_string_free(f);
-  f=NULL;
   signature = buffer_get_ssh_string(packet);
   if (signature == NULL) {
     ssh_set_error(session, SSH_FATAL, "No signature in packet");
@@ -218,7 +254,23 @@ SSH_PACKET_CALLBACK(ssh_packet_dh_reply){
   }
   session->dh_server_signature = signature;
   signature=NULL; /* ownership changed */
-  if (dh_build_k(session) < 0) {
+
+  cpu = ssh_cpu_time_us();
+  switch (crypto->kex_type) {
+#ifdef HAVE_ECDH
+    case SSH_KEX_ECDH_SHA2_NISTP256:
+      rc = ssh_ecdh_build_k(session);
+      break;
+#endif
+    case SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG:
+      rc = ssh_curve25519_build_k(session);
+      break;
+    default:
+      rc = dh_build_k(session);
+      break;
+  }
+  session->connect_timing.kex_cpu += ssh_cpu_time_us() - cpu;
+  if (rc < 0) {
     ssh_set_error(session, SSH_FATAL, "Cannot build k number");
     goto error;
   }
@@ -240,6 +292,7 @@ error:
 
 SSH_PACKET_CALLBACK(ssh_packet_newkeys){
   ssh_string signature = NULL;
+  long cpu;
   int rc;
   (void)packet;
   (void)user;
@@ -256,6 +309,7 @@ SSH_PACKET_CALLBACK(ssh_packet_newkeys){
     session->dh_handshake_state=DH_STATE_FINISHED;
   } else {
     /* client */
+    cpu = ssh_cpu_time_us();
     rc = make_sessionid(session);
     if (rc != SSH_OK) {
       goto error;
@@ -279,6 +333,11 @@ SSH_PACKET_CALLBACK(ssh_packet_newkeys){
     if (signature_verify(session, signature)) {
       goto error;
     }
+    session->connect_timing.kex_cpu += ssh_cpu_time_us() - cpu;
+    session->connect_timing.kex_type = session->next_crypto->kex_type;
+    ssh_log(session, SSH_LOG_PROTOCOL, "Key exchange %s took %ld us of CPU",
+        ssh_kex_type_name(session->next_crypto->kex_type),
+        session->connect_timing.kex_cpu);
 
     /* forget it for now ... */
     ssh_string_burn(signature);
@@ -318,37 +377,51 @@ error:
  * completed
  */
 static int dh_handshake(ssh_session session) {
+  struct ssh_crypto_struct *crypto = session->next_crypto;
   ssh_string e = NULL;
   ssh_string f = NULL;
   ssh_string signature = NULL;
+  long cpu;
   int rc = SSH_ERROR;
 
   enter_function();
 
   switch (session->dh_handshake_state) {
     case DH_STATE_INIT:
+      /* SSH2_MSG_KEX_ECDH_INIT shares its number with SSH2_MSG_KEXDH_INIT */
       if (buffer_add_u8(session->out_buffer, SSH2_MSG_KEXDH_INIT) < 0) {
         goto error;
       }
 
-      if (dh_generate_x(session) < 0) {
-        goto error;
-      }
-      if (dh_generate_e(session) < 0) {
-        goto error;
-      }
-
-      e = dh_get_e(session);
-      if (e == NULL) {
+      cpu = ssh_cpu_time_us();
+      session->connect_timing.kex_cpu = 0;
+      if (ssh_kex_pool_take(crypto) == SSH_OK) {
+        ssh_log(session, SSH_LOG_PACKET, "Using a precomputed %s keypair",
+            ssh_kex_type_name(crypto->kex_type));
+      } else if (ssh_kex_keypair_generate(crypto) != SSH_OK) {
         goto error;
       }
-
-      if (buffer_add_ssh_string(session->out_buffer, e) < 0) {
-        goto error;
+      session->connect_timing.kex_cpu += ssh_cpu_time_us() - cpu;
+
+      if (crypto->kex_type == SSH_KEX_DH_GROUP1_SHA1) {
+        e = dh_get_e(session);
+        if (e == NULL) {
+          goto error;
+        }
+
+        if (buffer_add_ssh_string(session->out_buffer, e) < 0) {
+          goto error;
+        }
+        ssh_string_burn(e);
+        ssh_string_free(e);
+        e=NULL;
+      } else {
+        /* Q_C, the client ephemeral public key */
+        if (buffer_add_ssh_string(session->out_buffer,
+              crypto->ecdh_client_pubkey) < 0) {
+          goto error;
+        }
       }
-      ssh_string_burn(e);
-      ssh_string_free(e);
-      e=NULL;
 
       rc = packet_send(session);
       if (rc == SSH_ERROR) {
@@ -549,6 +622,7 @@ static void ssh_client_connection_callback(ssh_session session){
 					goto error;
 				set_status(session,0.6f);
 				session->connected = 1;
+				ssh_connect_phase_end(session, &session->connect_timing.kex);
 				break;
 			}
 #endif
@@ -572,6 +646,7 @@ static void ssh_client_connection_callback(ssh_session session){
 				set_status(session,1.0f);
 				session->connected = 1;
 				session->session_state=SSH_SESSION_STATE_AUTHENTICATING;
+				ssh_connect_phase_end(session, &session->connect_timing.kex);
 			}
 			break;
 		case SSH_SESSION_STATE_AUTHENTICATING:
@@ -638,6 +713,11 @@ int ssh_connect(ssh_session session) {
   }
   session->alive = 0;
   session->client = 1;
+  ZERO_STRUCT(session->stats);
+  ZERO_STRUCT(session->connect_timing);
+  session->rtt_probe_ns = 0;
+  session->keepalive_first = 0;
+  session->keepalive_pending = 0;
 
   if (ssh_init() < 0) {
     leave_function();
@@ -662,6 +742,7 @@ int ssh_connect(ssh_session session) {
   session->socket_callbacks.connected=socket_callback_connected;
   session->socket_callbacks.data=callback_receive_banner;
   session->socket_callbacks.exception=ssh_socket_exception_callback;
+  session->socket_callbacks.controlflow=ssh_sched_controlflow;
   session->socket_callbacks.userdata=session;
   if (session->fd != SSH_INVALID_SOCKET) {
     ssh_socket_set_fd(session->socket, session->fd);
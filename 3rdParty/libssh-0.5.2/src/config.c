@@ -23,11 +23,13 @@
 
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "libssh/priv.h"
 #include "libssh/session.h"
 #include "libssh/misc.h"
+#include "libssh/threads.h"
 
 enum ssh_config_opcode_e {
   SOC_UNSUPPORTED = -1,
@@ -66,6 +68,32 @@ static struct ssh_config_keyword_table_s ssh_config_keyword_table[] = {
   { NULL, SOC_UNSUPPORTED }
 };
 
+/* A configuration line, tokenized once */
+struct ssh_config_line_s {
+  enum ssh_config_opcode_e opcode;
+  unsigned int count;
+  /* the keyword of unsupported options, for the log */
+  char *keyword;
+  /* the Host patterns, or the value of the option */
+  char **args;
+};
+
+/*
+ * Configuration files are tokenized once per process and replayed for each
+ * session. A file is read again when its size, modification time or inode
+ * changes.
+ */
+struct ssh_config_file_s {
+  char *filename;
+  struct ssh_file_stamp stamp;
+  struct ssh_config_line_s *lines;
+  unsigned int nlines;
+  struct ssh_config_file_s *next;
+};
+
+static struct ssh_config_file_s *ssh_config_cache;
+static void *ssh_config_mutex;
+
 static enum ssh_config_opcode_e ssh_config_get_opcode(char *keyword) {
   int i;
 
@@ -105,17 +133,20 @@ static char *ssh_config_get_token(char **str) {
     }
   }
 
+  /* end of the line, stay on the terminating nul */
+  *str = c;
+  return r;
+
 out:
   *str = c + 1;
 
   return r;
 }
 
-static int ssh_config_get_int(char **str, int notfound) {
-  char *p, *endp;
+static int ssh_config_get_int(const char *p, int notfound) {
+  char *endp;
   int i;
 
-  p = ssh_config_get_token(str);
   if (p && *p) {
     i = strtol(p, &endp, 10);
     if (p == endp) {
@@ -138,10 +169,7 @@ static const char *ssh_config_get_str(char **str, const char *def) {
   return def;
 }
 
-static int ssh_config_get_yesno(char **str, int notfound) {
-  const char *p;
-
-  p = ssh_config_get_str(str, NULL);
+static int ssh_config_get_yesno(const char *p, int notfound) {
   if (p == NULL) {
     return notfound;
   }
@@ -155,19 +183,52 @@ static int ssh_config_get_yesno(char **str, int notfound) {
   return notfound;
 }
 
-static int ssh_config_parse_line(ssh_session session, const char *line,
-    unsigned int count, int *parsing) {
-  enum ssh_config_opcode_e opcode;
+static void ssh_config_line_free(struct ssh_config_line_s *line) {
+  int i;
+
+  SAFE_FREE(line->keyword);
+  if (line->args != NULL) {
+    for (i = 0; line->args[i] != NULL; i++) {
+      SAFE_FREE(line->args[i]);
+    }
+    SAFE_FREE(line->args);
+  }
+}
+
+static int ssh_config_line_add_arg(struct ssh_config_line_s *line, int n,
+    const char *arg) {
+  char **args;
+
+  args = realloc(line->args, (n + 2) * sizeof(char *));
+  if (args == NULL) {
+    return -1;
+  }
+  line->args = args;
+  line->args[n] = strdup(arg);
+  line->args[n + 1] = NULL;
+  if (line->args[n] == NULL) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Tokenize a line of the configuration file. Returns 1 if the line holds an
+ * option, 0 for empty lines and comments and -1 on error.
+ */
+static int ssh_config_compile_line(struct ssh_config_line_s *line,
+    const char *text, unsigned int count) {
   const char *p;
   char *s, *x;
   char *keyword;
-  char *lowerhost;
   size_t len;
-  int i;
+  int n;
+
+  ZERO_STRUCTP(line);
 
-  x = s = strdup(line);
+  x = s = strdup(text);
   if (s == NULL) {
-    ssh_set_error_oom(session);
     return -1;
   }
 
@@ -186,14 +247,54 @@ static int ssh_config_parse_line(ssh_session session, const char *line,
     return 0;
   }
 
-  opcode = ssh_config_get_opcode(keyword);
+  line->opcode = ssh_config_get_opcode(keyword);
+  line->count = count;
 
-  switch (opcode) {
+  switch (line->opcode) {
     case SOC_HOST:
-      *parsing = 0;
-      lowerhost = (session->host) ? ssh_lowercase(session->host) : NULL;
+      n = 0;
       for (p = ssh_config_get_str(&s, NULL); p && *p;
           p = ssh_config_get_str(&s, NULL)) {
+        if (ssh_config_line_add_arg(line, n++, p) < 0) {
+          goto error;
+        }
+      }
+      break;
+    case SOC_UNSUPPORTED:
+      line->keyword = strdup(keyword);
+      if (line->keyword == NULL) {
+        goto error;
+      }
+      break;
+    default:
+      p = ssh_config_get_str(&s, NULL);
+      if (p != NULL && ssh_config_line_add_arg(line, 0, p) < 0) {
+        goto error;
+      }
+      break;
+  }
+
+  SAFE_FREE(x);
+  return 1;
+
+error:
+  ssh_config_line_free(line);
+  SAFE_FREE(x);
+  return -1;
+}
+
+static int ssh_config_apply_line(ssh_session session,
+    const struct ssh_config_line_s *line, int *parsing) {
+  const char *p = line->args ? line->args[0] : NULL;
+  char *lowerhost;
+  int i;
+
+  switch (line->opcode) {
+    case SOC_HOST:
+      *parsing = 0;
+      lowerhost = (session->host) ? ssh_lowercase(session->host) : NULL;
+      for (i = 0; line->args && line->args[i]; i++) {
+        p = line->args[i];
         if (match_hostname(lowerhost, p, strlen(p))) {
           *parsing = 1;
         }
@@ -201,14 +302,12 @@ static int ssh_config_parse_line(ssh_session session, const char *line,
       SAFE_FREE(lowerhost);
       break;
     case SOC_HOSTNAME:
-      p = ssh_config_get_str(&s, NULL);
       if (p && *parsing) {
         ssh_options_set(session, SSH_OPTIONS_HOST, p);
       }
       break;
     case SOC_PORT:
       if (session->port == 22) {
-          p = ssh_config_get_str(&s, NULL);
           if (p && *parsing) {
               ssh_options_set(session, SSH_OPTIONS_PORT_STR, p);
           }
@@ -216,27 +315,24 @@ static int ssh_config_parse_line(ssh_session session, const char *line,
       break;
     case SOC_USERNAME:
       if (session->username == NULL) {
-          p = ssh_config_get_str(&s, NULL);
           if (p && *parsing) {
             ssh_options_set(session, SSH_OPTIONS_USER, p);
          }
       }
       break;
     case SOC_IDENTITY:
-      p = ssh_config_get_str(&s, NULL);
       if (p && *parsing) {
         ssh_options_set(session, SSH_OPTIONS_ADD_IDENTITY, p);
       }
       break;
     case SOC_CIPHERS:
-      p = ssh_config_get_str(&s, NULL);
       if (p && *parsing) {
         ssh_options_set(session, SSH_OPTIONS_CIPHERS_C_S, p);
         ssh_options_set(session, SSH_OPTIONS_CIPHERS_S_C, p);
       }
       break;
     case SOC_COMPRESSION:
-      i = ssh_config_get_yesno(&s, -1);
+      i = ssh_config_get_yesno(p, -1);
       if (i >= 0 && *parsing) {
         if (i) {
           ssh_options_set(session, SSH_OPTIONS_COMPRESSION, "yes");
@@ -246,12 +342,10 @@ static int ssh_config_parse_line(ssh_session session, const char *line,
       }
       break;
     case SOC_PROTOCOL:
-      p = ssh_config_get_str(&s, NULL);
       if (p && *parsing) {
         char *a, *b;
         b = strdup(p);
         if (b == NULL) {
-          SAFE_FREE(x);
           ssh_set_error_oom(session);
           return -1;
         }
@@ -277,67 +371,191 @@ static int ssh_config_parse_line(ssh_session session, const char *line,
       }
       break;
     case SOC_TIMEOUT:
-      i = ssh_config_get_int(&s, -1);
+      i = ssh_config_get_int(p, -1);
       if (i >= 0 && *parsing) {
         ssh_options_set(session, SSH_OPTIONS_TIMEOUT, &i);
       }
       break;
     case SOC_STRICTHOSTKEYCHECK:
-      i = ssh_config_get_yesno(&s, -1);
+      i = ssh_config_get_yesno(p, -1);
       if (i >= 0 && *parsing) {
         ssh_options_set(session, SSH_OPTIONS_STRICTHOSTKEYCHECK, &i);
       }
       break;
     case SOC_KNOWNHOSTS:
-      p = ssh_config_get_str(&s, NULL);
       if (p && *parsing) {
         ssh_options_set(session, SSH_OPTIONS_KNOWNHOSTS, p);
       }
       break;
     case SOC_PROXYCOMMAND:
-      p = ssh_config_get_str(&s, NULL);
       if (p && *parsing) {
         ssh_options_set(session, SSH_OPTIONS_PROXYCOMMAND, p);
       }
       break;
     case SOC_UNSUPPORTED:
       ssh_log(session, SSH_LOG_RARE, "Unsupported option: %s, line: %d\n",
-              keyword, count);
+              line->keyword, line->count);
       break;
     default:
       ssh_set_error(session, SSH_FATAL, "ERROR - unimplemented opcode: %d\n",
-              opcode);
-      SAFE_FREE(x);
+              line->opcode);
       return -1;
       break;
   }
 
-  SAFE_FREE(x);
   return 0;
 }
 
-/* ssh_config_parse_file */
-int ssh_config_parse_file(ssh_session session, const char *filename) {
+static void ssh_config_file_free(struct ssh_config_file_s *file) {
+  unsigned int i;
+
+  for (i = 0; i < file->nlines; i++) {
+    ssh_config_line_free(&file->lines[i]);
+  }
+  SAFE_FREE(file->lines);
+  SAFE_FREE(file->filename);
+  SAFE_FREE(file);
+}
+
+static struct ssh_config_file_s *ssh_config_file_read(const char *filename,
+    struct ssh_file_stamp *stamp, int *rc) {
+  struct ssh_config_file_s *file;
+  struct ssh_config_line_s *lines;
   char line[1024] = {0};
   unsigned int count = 0;
   FILE *f;
-  int parsing;
 
+  *rc = 0;
   if ((f = fopen(filename, "r")) == NULL) {
-    return 0;
+    return NULL;
   }
 
-  ssh_log(session, SSH_LOG_RARE, "Reading configuration data from %s", filename);
+  file = malloc(sizeof(struct ssh_config_file_s));
+  if (file == NULL) {
+    goto error;
+  }
+  ZERO_STRUCTP(file);
+  file->filename = strdup(filename);
+  if (file->filename == NULL) {
+    goto error;
+  }
+  file->stamp = *stamp;
 
-  parsing = 1;
   while (fgets(line, sizeof(line), f)) {
     count++;
-    if (ssh_config_parse_line(session, line, count, &parsing) < 0) {
-      fclose(f);
-      return -1;
+    lines = realloc(file->lines,
+        (file->nlines + 1) * sizeof(struct ssh_config_line_s));
+    if (lines == NULL) {
+      goto error;
+    }
+    file->lines = lines;
+
+    switch (ssh_config_compile_line(&file->lines[file->nlines], line, count)) {
+      case 1:
+        file->nlines++;
+        break;
+      case 0:
+        break;
+      default:
+        goto error;
     }
   }
 
   fclose(f);
-  return 0;
+  return file;
+
+error:
+  fclose(f);
+  if (file != NULL) {
+    ssh_config_file_free(file);
+  }
+  *rc = -1;
+  return NULL;
+}
+
+/*
+ * Returns the tokenized content of a configuration file, reading it again
+ * if it changed. NULL with rc set to 0 means the file does not exist. Must
+ * be called with the cache mutex.
+ */
+static struct ssh_config_file_s *ssh_config_cache_get(const char *filename,
+    int *rc) {
+  struct ssh_config_file_s **prev;
+  struct ssh_config_file_s *file;
+  struct ssh_file_stamp stamp;
+
+  *rc = 0;
+  for (prev = &ssh_config_cache; *prev != NULL; prev = &(*prev)->next) {
+    if (strcmp((*prev)->filename, filename) == 0) {
+      break;
+    }
+  }
+
+  if (ssh_file_stamp_get(filename, &stamp) == 0 && *prev != NULL &&
+      ssh_file_stamp_equal(&(*prev)->stamp, &stamp)) {
+    return *prev;
+  }
+
+  if (*prev != NULL) {
+    file = *prev;
+    *prev = file->next;
+    ssh_config_file_free(file);
+  }
+
+  file = ssh_config_file_read(filename, &stamp, rc);
+  if (file != NULL) {
+    file->next = ssh_config_cache;
+    ssh_config_cache = file;
+  }
+
+  return file;
+}
+
+int ssh_config_cache_init(void) {
+  return ssh_mutex_init(&ssh_config_mutex);
+}
+
+void ssh_config_cache_finalize(void) {
+  struct ssh_config_file_s *file;
+
+  ssh_mutex_lock(&ssh_config_mutex);
+  while (ssh_config_cache != NULL) {
+    file = ssh_config_cache;
+    ssh_config_cache = file->next;
+    ssh_config_file_free(file);
+  }
+  ssh_mutex_unlock(&ssh_config_mutex);
+
+  ssh_mutex_destroy(&ssh_config_mutex);
+}
+
+/* ssh_config_parse_file */
+int ssh_config_parse_file(ssh_session session, const char *filename) {
+  struct ssh_config_file_s *file;
+  unsigned int i;
+  int parsing;
+  int rc;
+
+  ssh_mutex_lock(&ssh_config_mutex);
+  file = ssh_config_cache_get(filename, &rc);
+  if (file == NULL) {
+    ssh_mutex_unlock(&ssh_config_mutex);
+    if (rc < 0) {
+      ssh_set_error_oom(session);
+    }
+    return rc;
+  }
+
+  ssh_log(session, SSH_LOG_RARE, "Reading configuration data from %s", filename);
+
+  parsing = 1;
+  for (i = 0; i < file->nlines; i++) {
+    if (ssh_config_apply_line(session, &file->lines[i], &parsing) < 0) {
+      rc = -1;
+      break;
+    }
+  }
+
+  ssh_mutex_unlock(&ssh_config_mutex);
+  return rc;
 }
@@ -83,6 +83,9 @@
 #error "Your system must have getaddrinfo()"
 #endif
 
+/* Delay between two connection attempts, RFC 8305 recommends 250 ms */
+#define SSH_CONNECT_ATTEMPT_DELAY 250
+
 #ifdef _WIN32
 void ssh_sock_set_nonblocking(socket_t sock) {
   u_long nonblocking = 1;
@@ -154,71 +157,263 @@ static int getai(ssh_session session, const char *host, int port, struct addrinf
   return getaddrinfo(host, service, &hints, ai);
 }
 
-static int ssh_connect_ai_timeout(ssh_session session, const char *host,
-    int port, struct addrinfo *ai, long timeout, long usec, socket_t s) {
-  int timeout_ms;
-  ssh_pollfd_t fds;
-  int rc = 0;
-  unsigned int len = sizeof(rc);
+static int ssh_connect_bind(ssh_session session, socket_t s,
+    const char *bind_addr) {
+  struct addrinfo *bind_ai;
+  struct addrinfo *bind_itr;
+  int rc;
+
+  ssh_log(session, SSH_LOG_PACKET, "Resolving %s\n", bind_addr);
+
+  rc = getai(session,bind_addr, 0, &bind_ai);
+  if (rc != 0) {
+    ssh_set_error(session, SSH_FATAL,
+        "Failed to resolve bind address %s (%s)",
+        bind_addr,
+        gai_strerror(rc));
+    return -1;
+  }
+
+  for (bind_itr = bind_ai; bind_itr != NULL; bind_itr = bind_itr->ai_next) {
+    if (bind(s, bind_itr->ai_addr, bind_itr->ai_addrlen) < 0) {
+      ssh_set_error(session, SSH_FATAL,
+          "Binding local address: %s", strerror(errno));
+      continue;
+    } else {
+      break;
+    }
+  }
+  freeaddrinfo(bind_ai);
+
+  /* Cannot bind to any local addresses */
+  if (bind_itr == NULL) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * Orders the addresses the way RFC 8305 section 4 asks for: the family of
+ * the first getaddrinfo() result goes first, then the families alternate.
+ * The relative order inside a family is kept.
+ */
+static struct addrinfo **ssh_connect_sort_ai(struct addrinfo *ai, int *count) {
+  struct addrinfo **sorted;
+  struct addrinfo *first = NULL;
+  struct addrinfo *other = NULL;
+  struct addrinfo *itr;
+  int n = 0;
+  int i;
+
+  for (itr = ai; itr != NULL; itr = itr->ai_next) {
+    n++;
+  }
+
+  sorted = malloc(n * sizeof(struct addrinfo *));
+  if (sorted == NULL) {
+    return NULL;
+  }
+
+  first = ai;
+  for (itr = ai; itr != NULL && other == NULL; itr = itr->ai_next) {
+    if (itr->ai_family != ai->ai_family) {
+      other = itr;
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    int want_first = (i % 2 == 0 || other == NULL) && first != NULL;
+
+    if (want_first) {
+      sorted[i] = first;
+      for (first = first->ai_next; first != NULL; first = first->ai_next) {
+        if (first->ai_family == ai->ai_family) {
+          break;
+        }
+      }
+    } else {
+      sorted[i] = other;
+      for (other = other->ai_next; other != NULL; other = other->ai_next) {
+        if (other->ai_family != ai->ai_family) {
+          break;
+        }
+      }
+    }
+  }
+
+  *count = n;
+  return sorted;
+}
+
+/**
+ * @internal
+ *
+ * @brief Races nonblocking connects to a list of addresses.
+ *
+ * The addresses are interleaved by family and a new attempt is started every
+ * SSH_CONNECT_ATTEMPT_DELAY milliseconds, or as soon as the previous one
+ * failed, while the earlier attempts are kept running. The first socket to
+ * connect wins and every other attempt is closed (RFC 8305).
+ *
+ * @param[in]  session  The session used for error reporting.
+ *
+ * @param[in]  ai       The getaddrinfo() result list, not freed.
+ *
+ * @param[in]  bind_addr The local address to bind to, or NULL.
+ *
+ * @param[in]  timeout  Overall timeout in milliseconds, < 0 for none.
+ *
+ * @returns A connected file descriptor in nonblocking mode, < 0 on error.
+ */
+socket_t ssh_connect_ai_race(ssh_session session, struct addrinfo *ai,
+    const char *bind_addr, int timeout) {
+  struct addrinfo **sorted;
+  ssh_pollfd_t *fds;
+  struct ssh_timestamp start;
+  struct ssh_timestamp last_attempt;
+  socket_t winner = SSH_INVALID_SOCKET;
+  int count = 0;
+  int next = 0;
+  int pending = 0;
+  int start_next = 1;
+  int rc;
+  int i;
 
   enter_function();
 
-  /* I know we're losing some precision. But it's not like poll-like family
-   * type of mechanisms are precise up to the microsecond.
-   */
-  timeout_ms=timeout * 1000 + usec / 1000;
+  sorted = ssh_connect_sort_ai(ai, &count);
+  fds = malloc(count * sizeof(ssh_pollfd_t));
+  if (sorted == NULL || fds == NULL) {
+    SAFE_FREE(sorted);
+    SAFE_FREE(fds);
+    ssh_set_error_oom(session);
+    leave_function();
+    return SSH_INVALID_SOCKET;
+  }
 
-  ssh_sock_set_nonblocking(s);
+  ssh_timestamp_init(&start);
+  ssh_timestamp_init(&last_attempt);
 
-  ssh_log(session, SSH_LOG_RARE, "Trying to connect to host: %s:%d with "
-      "timeout %d ms", host, port, timeout_ms);
+  while (winner == SSH_INVALID_SOCKET && (next < count || pending > 0)) {
+    int poll_timeout;
 
-  /* The return value is checked later */
-  connect(s, ai->ai_addr, ai->ai_addrlen);
-  freeaddrinfo(ai);
+    if (start_next && next < count) {
+      struct addrinfo *itr = sorted[next++];
+      socket_t s;
+
+      start_next = 0;
+      ssh_timestamp_init(&last_attempt);
 
-  fds.fd=s;
-  fds.revents=0;
-  fds.events=POLLOUT;
+      s = socket(itr->ai_family, itr->ai_socktype, itr->ai_protocol);
+      if (s < 0) {
+        ssh_set_error(session, SSH_FATAL,
+            "Socket create failed: %s", strerror(errno));
+        start_next = 1;
+        continue;
+      }
+      if (bind_addr && ssh_connect_bind(session, s, bind_addr) < 0) {
+        ssh_connect_socket_close(s);
+        start_next = 1;
+        continue;
+      }
+      ssh_sock_set_nonblocking(s);
+
+      session->connect_timing.attempts++;
+      rc = connect(s, itr->ai_addr, itr->ai_addrlen);
+      if (rc == 0) {
+        winner = s;
+        break;
+      }
 #ifdef _WIN32
-  fds.events |= POLLWRNORM;
+      if (WSAGetLastError() != WSAEWOULDBLOCK) {
+#else
+      if (errno != EINPROGRESS) {
 #endif
-  rc = ssh_poll(&fds,1,timeout_ms);
+        ssh_set_error(session, SSH_FATAL,
+            "Connect failed: %s", strerror(errno));
+        ssh_connect_socket_close(s);
+        start_next = 1;
+        continue;
+      }
 
-  if (rc == 0) {
-    /* timeout */
-    ssh_set_error(session, SSH_FATAL,
-        "Timeout while connecting to %s:%d", host, port);
-    ssh_connect_socket_close(s);
-    leave_function();
-    return -1;
-  }
+      fds[pending].fd = s;
+      fds[pending].events = POLLOUT;
+#ifdef _WIN32
+      fds[pending].events |= POLLWRNORM;
+#endif
+      fds[pending].revents = 0;
+      pending++;
+    }
 
-  if (rc < 0) {
-    ssh_set_error(session, SSH_FATAL,
-        "poll error: %s", strerror(errno));
-    ssh_connect_socket_close(s);
-    leave_function();
-    return -1;
+    if (pending == 0) {
+      continue;
+    }
+
+    if (ssh_timeout_elapsed(&start, timeout)) {
+      ssh_set_error(session, SSH_FATAL, "Timeout while connecting");
+      break;
+    }
+    poll_timeout = ssh_timeout_update(&start, timeout);
+    if (next < count) {
+      int delay = ssh_timeout_update(&last_attempt, SSH_CONNECT_ATTEMPT_DELAY);
+      if (poll_timeout < 0 || delay < poll_timeout) {
+        poll_timeout = delay;
+      }
+    }
+
+    rc = ssh_poll(fds, pending, poll_timeout);
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ssh_set_error(session, SSH_FATAL, "poll error: %s", strerror(errno));
+      break;
+    }
+    if (rc == 0) {
+      /* Nobody answered within the attempt delay, try the next address */
+      start_next = 1;
+      continue;
+    }
+
+    for (i = 0; i < pending; i++) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, (char *) &err, &len);
+      if (err == 0) {
+        winner = fds[i].fd;
+        fds[i] = fds[--pending];
+        break;
+      }
+
+      ssh_set_error(session, SSH_FATAL, "Connect failed: %s", strerror(err));
+      ssh_connect_socket_close(fds[i].fd);
+      fds[i] = fds[--pending];
+      i--;
+      /* A failed attempt lets the next one start right away */
+      start_next = 1;
+    }
   }
-  rc = 0;
 
-  /* Get connect(2) return code. Zero means no error */
-  getsockopt(s, SOL_SOCKET, SO_ERROR,(char *) &rc, &len);
-  if (rc != 0) {
-    ssh_set_error(session, SSH_FATAL,
-        "Connect to %s:%d failed: %s", host, port, strerror(rc));
-    ssh_connect_socket_close(s);
-    leave_function();
-    return -1;
+  /* Cancel the attempts which lost the race */
+  for (i = 0; i < pending; i++) {
+    ssh_connect_socket_close(fds[i].fd);
   }
 
-  /* s is connected ? */
-  ssh_log(session, SSH_LOG_PACKET, "Socket connected with timeout\n");
-  ssh_sock_set_blocking(s);
+  SAFE_FREE(sorted);
+  SAFE_FREE(fds);
+
+  if (winner != SSH_INVALID_SOCKET) {
+    ssh_log(session, SSH_LOG_PACKET, "Socket connected after %d attempt(s)",
+        session->connect_timing.attempts);
+  }
 
   leave_function();
-  return s;
+  return winner;
 }
 
 /**
@@ -227,6 +422,10 @@ static int ssh_connect_ai_timeout(ssh_session session, const char *host,
  * @brief Connect to an IPv4 or IPv6 host specified by its IP address or
  * hostname.
  *
+ * Every address the host resolves to takes part in the connection race, see
+ * ssh_connect_ai_race(). The time spent in name resolution and in the TCP
+ * handshake is recorded in the session's connect timing.
+ *
  * @returns A file descriptor, < 0 on error.
  */
 socket_t ssh_connect_host(ssh_session session, const char *host,
@@ -234,11 +433,23 @@ socket_t ssh_connect_host(ssh_session session, const char *host,
   socket_t s = -1;
   int rc;
   struct addrinfo *ai;
-  struct addrinfo *itr;
+  struct ssh_timestamp ts;
+  int timeout_ms = -1;
 
   enter_function();
 
+  if (timeout || usec) {
+    /* I know we're losing some precision. But it's not like poll-like family
+     * type of mechanisms are precise up to the microsecond.
+     */
+    timeout_ms = timeout * 1000 + usec / 1000;
+  }
+
+  ZERO_STRUCT(session->connect_timing);
+
+  ssh_timestamp_init(&ts);
   rc = getai(session,host, port, &ai);
+  session->connect_timing.dns = ssh_timestamp_elapsed_us(&ts);
   if (rc != 0) {
     ssh_set_error(session, SSH_FATAL,
         "Failed to resolve hostname %s (%s)", host, gai_strerror(rc));
@@ -246,70 +457,22 @@ socket_t ssh_connect_host(ssh_session session, const char *host,
     return -1;
   }
 
-  for (itr = ai; itr != NULL; itr = itr->ai_next){
-    /* create socket */
-    s = socket(itr->ai_family, itr->ai_socktype, itr->ai_protocol);
-    if (s < 0) {
-      ssh_set_error(session, SSH_FATAL,
-          "Socket create failed: %s", strerror(errno));
-      continue;
-    }
-
-    if (bind_addr) {
-      struct addrinfo *bind_ai;
-      struct addrinfo *bind_itr;
-
-      ssh_log(session, SSH_LOG_PACKET, "Resolving %s\n", bind_addr);
-
-      rc = getai(session,bind_addr, 0, &bind_ai);
-      if (rc != 0) {
-        ssh_set_error(session, SSH_FATAL,
-            "Failed to resolve bind address %s (%s)",
-            bind_addr,
-            gai_strerror(rc));
-        leave_function();
-        return -1;
-      }
-
-      for (bind_itr = bind_ai; bind_itr != NULL; bind_itr = bind_itr->ai_next) {
-        if (bind(s, bind_itr->ai_addr, bind_itr->ai_addrlen) < 0) {
-          ssh_set_error(session, SSH_FATAL,
-              "Binding local address: %s", strerror(errno));
-          continue;
-        } else {
-          break;
-        }
-      }
-      freeaddrinfo(bind_ai);
+  ssh_log(session, SSH_LOG_RARE, "Trying to connect to host: %s:%d with "
+      "timeout %d ms", host, port, timeout_ms);
 
-      /* Cannot bind to any local addresses */
-      if (bind_itr == NULL) {
-        ssh_connect_socket_close(s);
-        s = -1;
-        continue;
-      }
-    }
+  ssh_timestamp_init(&ts);
+  s = ssh_connect_ai_race(session, ai, bind_addr, timeout_ms);
+  session->connect_timing.tcp = ssh_timestamp_elapsed_us(&ts);
+  freeaddrinfo(ai);
 
-    if (timeout || usec) {
-      socket_t ret = ssh_connect_ai_timeout(session, host, port, itr,
-          timeout, usec, s);
-      leave_function();
-      return ret;
-    }
-
-    if (connect(s, itr->ai_addr, itr->ai_addrlen) < 0) {
-      ssh_set_error(session, SSH_FATAL, "Connect failed: %s", strerror(errno));
-      ssh_connect_socket_close(s);
-      s = -1;
-      leave_function();
-      continue;
-    } else {
-      /* We are connected */
-      break;
+  if (s != SSH_INVALID_SOCKET) {
+    ssh_sock_set_blocking(s);
+    /* a single handshake took one round trip; a race says little */
+    if (session->connect_timing.attempts == 1) {
+      ssh_stats_rtt_sample(session, session->connect_timing.tcp);
     }
   }
 
-  freeaddrinfo(ai);
   leave_function();
 
   return s;
@@ -350,40 +513,10 @@ socket_t ssh_connect_host_nonblocking(ssh_session session, const char *host,
       continue;
     }
 
-    if (bind_addr) {
-      struct addrinfo *bind_ai;
-      struct addrinfo *bind_itr;
-
-      ssh_log(session, SSH_LOG_PACKET, "Resolving %s\n", bind_addr);
-
-      rc = getai(session,bind_addr, 0, &bind_ai);
-      if (rc != 0) {
-        ssh_set_error(session, SSH_FATAL,
-            "Failed to resolve bind address %s (%s)",
-            bind_addr,
-            gai_strerror(rc));
-        close(s);
-        s=-1;
-        break;
-      }
-
-      for (bind_itr = bind_ai; bind_itr != NULL; bind_itr = bind_itr->ai_next) {
-        if (bind(s, bind_itr->ai_addr, bind_itr->ai_addrlen) < 0) {
-          ssh_set_error(session, SSH_FATAL,
-              "Binding local address: %s", strerror(errno));
-          continue;
-        } else {
-          break;
-        }
-      }
-      freeaddrinfo(bind_ai);
-
-      /* Cannot bind to any local addresses */
-      if (bind_itr == NULL) {
-        ssh_connect_socket_close(s);
-        s = -1;
-        continue;
-      }
+    if (bind_addr && ssh_connect_bind(session, s, bind_addr) < 0) {
+      ssh_connect_socket_close(s);
+      s = -1;
+      continue;
     }
     ssh_sock_set_nonblocking(s);
 
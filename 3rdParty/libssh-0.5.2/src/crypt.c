@@ -41,6 +41,7 @@
 #include "libssh/wrapper.h"
 #include "libssh/crypto.h"
 #include "libssh/buffer.h"
+#include "libssh/misc.h"
 
 uint32_t packet_decrypt_len(ssh_session session, char *crypted){
   uint32_t decrypted;
@@ -63,6 +64,7 @@ uint32_t packet_decrypt_len(ssh_session session, char *crypted){
 int packet_decrypt(ssh_session session, void *data,uint32_t len) {
   struct crypto_struct *crypto = session->current_crypto->in_cipher;
   char *out = NULL;
+  uint64_t start;
   if(len % session->current_crypto->in_cipher->blocksize != 0){
     ssh_set_error(session, SSH_FATAL, "Cryptographic functions must be set on at least one blocksize (received %d)",len);
     return SSH_ERROR;
@@ -73,6 +75,7 @@ int packet_decrypt(ssh_session session, void *data,uint32_t len) {
   }
 
   ssh_log(session,SSH_LOG_PACKET, "Decrypting %d bytes", len);
+  start = ssh_clock_ns();
 
 #ifdef HAVE_LIBGCRYPT
   if (crypto->set_decrypt_key(crypto, session->current_crypto->decryptkey,
@@ -91,6 +94,7 @@ int packet_decrypt(ssh_session session, void *data,uint32_t len) {
 
   memcpy(data,out,len);
   memset(out,0,len);
+  session->stats.decrypt_ns += ssh_clock_ns() - start;
 
   SAFE_FREE(out);
   return 0;
@@ -102,6 +106,7 @@ unsigned char *packet_encrypt(ssh_session session, void *data, uint32_t len) {
   char *out = NULL;
   unsigned int finallen;
   uint32_t seq;
+  uint64_t start;
 
   if (!session->current_crypto) {
     return NULL; /* nothing to do here */
@@ -136,6 +141,7 @@ unsigned char *packet_encrypt(ssh_session session, void *data, uint32_t len) {
 #endif
 
   if (session->version == 2) {
+    start = ssh_clock_ns();
     ctx = hmac_init(session->current_crypto->encryptMAC,20,HMAC_SHA1);
     if (ctx == NULL) {
       SAFE_FREE(out);
@@ -144,6 +150,7 @@ unsigned char *packet_encrypt(ssh_session session, void *data, uint32_t len) {
     hmac_update(ctx,(unsigned char *)&seq,sizeof(uint32_t));
     hmac_update(ctx,data,len);
     hmac_final(ctx,session->current_crypto->hmacbuf,&finallen);
+    session->stats.mac_ns += ssh_clock_ns() - start;
 #ifdef DEBUG_CRYPTO
     ssh_print_hexa("mac: ",data,len);
     if (finallen != 20) {
@@ -153,6 +160,7 @@ unsigned char *packet_encrypt(ssh_session session, void *data, uint32_t len) {
 #endif
   }
 
+  start = ssh_clock_ns();
 #ifdef HAVE_LIBGCRYPT
   crypto->cbc_encrypt(crypto, data, out, len);
 #elif defined HAVE_LIBCRYPTO
@@ -163,6 +171,7 @@ unsigned char *packet_encrypt(ssh_session session, void *data, uint32_t len) {
   memcpy(data, out, len);
   memset(out, 0, len);
   SAFE_FREE(out);
+  session->stats.encrypt_ns += ssh_clock_ns() - start;
 
   if (session->version == 2) {
     return session->current_crypto->hmacbuf;
@@ -189,6 +198,7 @@ int packet_hmac_verify(ssh_session session, ssh_buffer buffer,
   HMACCTX ctx;
   unsigned int len;
   uint32_t seq;
+  uint64_t start = ssh_clock_ns();
 
   ctx = hmac_init(session->current_crypto->decryptMAC, 20, HMAC_SHA1);
   if (ctx == NULL) {
@@ -200,6 +210,7 @@ int packet_hmac_verify(ssh_session session, ssh_buffer buffer,
   hmac_update(ctx, (unsigned char *) &seq, sizeof(uint32_t));
   hmac_update(ctx, buffer_get_rest(buffer), buffer_get_rest_len(buffer));
   hmac_final(ctx, hmacbuf, &len);
+  session->stats.mac_ns += ssh_clock_ns() - start;
 
 #ifdef DEBUG_CRYPTO
   ssh_print_hexa("received mac",mac,len);
@@ -0,0 +1,309 @@
+/*
+ * curve25519.c - Curve25519 ECDH functions for key exchange
+ * curve25519-sha256@libssh.org
+ *
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "libssh/priv.h"
+#include "libssh/crypto.h"
+#include "libssh/session.h"
+#include "libssh/dh.h"
+#include "libssh/curve25519.h"
+
+/*
+ * Field arithmetic modulo 2^255 - 19 on sixteen 16-bit limbs, after the
+ * public domain TweetNaCl implementation. Every operation runs in constant
+ * time, independent of the secret scalar.
+ */
+typedef int64_t gf25519[16];
+
+static const gf25519 gf_121665 = {0xDB41, 1};
+
+static void car25519(gf25519 o) {
+  int64_t c;
+  int i;
+
+  for (i = 0; i < 16; i++) {
+    o[i] += (1LL << 16);
+    c = o[i] >> 16;
+    o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
+    o[i] -= c * 65536;
+  }
+}
+
+static void sel25519(gf25519 p, gf25519 q, int b) {
+  int64_t t, c = ~(b - 1);
+  int i;
+
+  for (i = 0; i < 16; i++) {
+    t = c & (p[i] ^ q[i]);
+    p[i] ^= t;
+    q[i] ^= t;
+  }
+}
+
+static void pack25519(unsigned char *o, const gf25519 n) {
+  gf25519 m, t;
+  int i, j, b;
+
+  for (i = 0; i < 16; i++) {
+    t[i] = n[i];
+  }
+  car25519(t);
+  car25519(t);
+  car25519(t);
+  for (j = 0; j < 2; j++) {
+    m[0] = t[0] - 0xffed;
+    for (i = 1; i < 15; i++) {
+      m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+      m[i - 1] &= 0xffff;
+    }
+    m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+    b = (m[15] >> 16) & 1;
+    m[14] &= 0xffff;
+    sel25519(t, m, 1 - b);
+  }
+  for (i = 0; i < 16; i++) {
+    o[2 * i] = t[i] & 0xff;
+    o[2 * i + 1] = t[i] >> 8;
+  }
+}
+
+static void unpack25519(gf25519 o, const unsigned char *n) {
+  int i;
+
+  for (i = 0; i < 16; i++) {
+    o[i] = n[2 * i] + ((int64_t) n[2 * i + 1] << 8);
+  }
+  o[15] &= 0x7fff;
+}
+
+static void add25519(gf25519 o, const gf25519 a, const gf25519 b) {
+  int i;
+
+  for (i = 0; i < 16; i++) {
+    o[i] = a[i] + b[i];
+  }
+}
+
+static void sub25519(gf25519 o, const gf25519 a, const gf25519 b) {
+  int i;
+
+  for (i = 0; i < 16; i++) {
+    o[i] = a[i] - b[i];
+  }
+}
+
+static void mul25519(gf25519 o, const gf25519 a, const gf25519 b) {
+  int64_t t[31];
+  int i, j;
+
+  for (i = 0; i < 31; i++) {
+    t[i] = 0;
+  }
+  for (i = 0; i < 16; i++) {
+    for (j = 0; j < 16; j++) {
+      t[i + j] += a[i] * b[j];
+    }
+  }
+  for (i = 0; i < 15; i++) {
+    t[i] += 38 * t[i + 16];
+  }
+  for (i = 0; i < 16; i++) {
+    o[i] = t[i];
+  }
+  car25519(o);
+  car25519(o);
+}
+
+static void inv25519(gf25519 o, const gf25519 i) {
+  gf25519 c;
+  int a;
+
+  for (a = 0; a < 16; a++) {
+    c[a] = i[a];
+  }
+  /* i^(p-2) */
+  for (a = 253; a >= 0; a--) {
+    mul25519(c, c, c);
+    if (a != 2 && a != 4) {
+      mul25519(c, c, i);
+    }
+  }
+  for (a = 0; a < 16; a++) {
+    o[a] = c[a];
+  }
+}
+
+/**
+ * @internal
+ * @brief Montgomery ladder on curve25519, as specified by RFC 7748.
+ *
+ * @param[out] q  32 bytes receiving the u-coordinate of n * p.
+ * @param[in]  n  32 bytes scalar, clamped before use.
+ * @param[in]  p  32 bytes u-coordinate of the point.
+ */
+void ssh_curve25519_scalarmult(unsigned char *q, const unsigned char *n,
+    const unsigned char *p) {
+  unsigned char z[32];
+  gf25519 x, a, b, c, d, e, f;
+  int64_t r;
+  int i;
+
+  memcpy(z, n, 32);
+  z[31] = (n[31] & 127) | 64;
+  z[0] &= 248;
+
+  unpack25519(x, p);
+  for (i = 0; i < 16; i++) {
+    b[i] = x[i];
+    d[i] = a[i] = c[i] = 0;
+  }
+  a[0] = d[0] = 1;
+
+  for (i = 254; i >= 0; --i) {
+    r = (z[i >> 3] >> (i & 7)) & 1;
+    sel25519(a, b, r);
+    sel25519(c, d, r);
+    add25519(e, a, c);
+    sub25519(a, a, c);
+    add25519(c, b, d);
+    sub25519(b, b, d);
+    mul25519(d, e, e);
+    mul25519(f, a, a);
+    mul25519(a, c, a);
+    mul25519(c, b, e);
+    add25519(e, a, c);
+    sub25519(a, a, c);
+    mul25519(b, a, a);
+    sub25519(c, d, f);
+    mul25519(a, c, gf_121665);
+    add25519(a, a, d);
+    mul25519(c, c, a);
+    mul25519(a, d, f);
+    mul25519(d, b, x);
+    mul25519(b, e, e);
+    sel25519(a, b, r);
+    sel25519(c, d, r);
+  }
+
+  inv25519(c, c);
+  mul25519(a, a, c);
+  pack25519(q, a);
+
+  memset(z, 0, sizeof(z));
+}
+
+void ssh_curve25519_scalarmult_base(unsigned char *q, const unsigned char *n) {
+  static const unsigned char base[32] = {9};
+
+  ssh_curve25519_scalarmult(q, n, base);
+}
+
+/**
+ * @internal
+ * @brief Generates an ephemeral curve25519 keypair into a crypto structure.
+ *
+ * The public key is stored as the Q_C string sent in SSH_MSG_KEX_ECDH_INIT.
+ *
+ * @returns SSH_OK on success, SSH_ERROR on error.
+ */
+int ssh_curve25519_keypair(struct ssh_crypto_struct *crypto) {
+  ssh_curve25519_pubkey pubkey;
+
+  if (!ssh_get_random(crypto->curve25519_privkey, CURVE25519_PRIVKEY_SIZE, 1)) {
+    return SSH_ERROR;
+  }
+  ssh_curve25519_scalarmult_base(pubkey, crypto->curve25519_privkey);
+
+  crypto->ecdh_client_pubkey = ssh_string_new(CURVE25519_PUBKEY_SIZE);
+  if (crypto->ecdh_client_pubkey == NULL) {
+    return SSH_ERROR;
+  }
+  ssh_string_fill(crypto->ecdh_client_pubkey, pubkey, CURVE25519_PUBKEY_SIZE);
+
+  return SSH_OK;
+}
+
+/**
+ * @internal
+ * @brief Computes the shared secret K from our private key and the Q_S
+ * received from the server.
+ *
+ * The 32 bytes of the shared point are interpreted as an unsigned
+ * big-endian number, as the curve25519-sha256@libssh.org spec requires.
+ *
+ * @returns SSH_OK on success, SSH_ERROR on error.
+ */
+int ssh_curve25519_build_k(ssh_session session) {
+  struct ssh_crypto_struct *crypto = session->next_crypto;
+  unsigned char k[CURVE25519_PUBKEY_SIZE];
+  unsigned char zero = 0;
+  ssh_string k_string;
+  int i;
+
+  if (crypto->ecdh_server_pubkey == NULL ||
+      ssh_string_len(crypto->ecdh_server_pubkey) != CURVE25519_PUBKEY_SIZE) {
+    ssh_set_error(session, SSH_FATAL, "Invalid curve25519 server public key");
+    return SSH_ERROR;
+  }
+
+  ssh_curve25519_scalarmult(k, crypto->curve25519_privkey,
+      ssh_string_data(crypto->ecdh_server_pubkey));
+  /* the ephemeral key is no longer needed */
+  memset(crypto->curve25519_privkey, 0, CURVE25519_PRIVKEY_SIZE);
+
+  /* a low order point from the server gives an all zero secret */
+  for (i = 0; i < CURVE25519_PUBKEY_SIZE; i++) {
+    zero |= k[i];
+  }
+  if (zero == 0) {
+    ssh_set_error(session, SSH_FATAL, "Invalid curve25519 shared secret");
+    return SSH_ERROR;
+  }
+
+  k_string = ssh_string_new(CURVE25519_PUBKEY_SIZE);
+  if (k_string == NULL) {
+    memset(k, 0, sizeof(k));
+    ssh_set_error_oom(session);
+    return SSH_ERROR;
+  }
+  ssh_string_fill(k_string, k, CURVE25519_PUBKEY_SIZE);
+  memset(k, 0, sizeof(k));
+
+  crypto->k = make_string_bn(k_string);
+  ssh_string_burn(k_string);
+  ssh_string_free(k_string);
+  if (crypto->k == NULL) {
+    return SSH_ERROR;
+  }
+
+#ifdef DEBUG_CRYPTO
+  ssh_print_bignum("Shared secret key", crypto->k);
+#endif
+
+  return SSH_OK;
+}
+
+/* vim: set ts=2 sw=2 et cindent: */
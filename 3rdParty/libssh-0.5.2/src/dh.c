@@ -339,6 +339,44 @@ int dh_generate_f(ssh_session session) {
   return 0;
 }
 
+/**
+ * @internal
+ * @brief Generates the client ephemeral DH keypair (x, e) into a crypto
+ * structure, which need not be attached to a session yet.
+ */
+int dh_generate_keypair(struct ssh_crypto_struct *crypto) {
+#ifdef HAVE_LIBCRYPTO
+  bignum_CTX ctx = bignum_ctx_new();
+  if (ctx == NULL) {
+    return -1;
+  }
+#endif
+
+  crypto->x = bignum_new();
+  crypto->e = bignum_new();
+  if (crypto->x == NULL || crypto->e == NULL) {
+#ifdef HAVE_LIBCRYPTO
+    bignum_ctx_free(ctx);
+#endif
+    return -1;
+  }
+
+#ifdef HAVE_LIBGCRYPT
+  bignum_rand(crypto->x, 128);
+  bignum_mod_exp(crypto->e, g, crypto->x, p);
+#elif defined HAVE_LIBCRYPTO
+  bignum_rand(crypto->x, 128, 0, -1);
+  bignum_mod_exp(crypto->e, g, crypto->x, p, ctx);
+  bignum_ctx_free(ctx);
+#endif
+
+#ifdef DEBUG_CRYPTO
+  ssh_print_bignum("e", crypto->e);
+#endif
+
+  return 0;
+}
+
 ssh_string make_bignum_string(bignum num) {
   ssh_string ptr = NULL;
   int pad = 0;
@@ -479,6 +517,31 @@ int dh_build_k(ssh_session session) {
   return 0;
 }
 
+/* hashes data with the hash function of the negotiated key exchange */
+static int kex_digest(struct ssh_crypto_struct *crypto, unsigned char *output,
+    const void *data, unsigned long len) {
+  SHACTX ctx;
+  SHA256CTX ctx256;
+
+  if (crypto->digest_len == SHA256_DIGEST_LEN) {
+    ctx256 = sha256_init();
+    if (ctx256 == NULL) {
+      return -1;
+    }
+    sha256_update(ctx256, data, len);
+    sha256_final(output, ctx256);
+  } else {
+    ctx = sha1_init();
+    if (ctx == NULL) {
+      return -1;
+    }
+    sha1_update(ctx, data, len);
+    sha1_final(output, ctx);
+  }
+
+  return 0;
+}
+
 /*
 static void sha_add(ssh_string str,SHACTX ctx){
     sha1_update(ctx,str,string_len(str)+4);
@@ -489,7 +552,7 @@ static void sha_add(ssh_string str,SHACTX ctx){
 */
 
 int make_sessionid(ssh_session session) {
-  SHACTX ctx;
+  struct ssh_crypto_struct *crypto = session->next_crypto;
   ssh_string num = NULL;
   ssh_string str = NULL;
   ssh_buffer server_hash = NULL;
@@ -500,11 +563,6 @@ int make_sessionid(ssh_session session) {
 
   enter_function();
 
-  ctx = sha1_init();
-  if (ctx == NULL) {
-    return rc;
-  }
-
   buf = ssh_buffer_new();
   if (buf == NULL) {
     return rc;
@@ -573,28 +631,41 @@ int make_sessionid(ssh_session session) {
     goto error;
   }
 
-  num = make_bignum_string(session->next_crypto->e);
-  if (num == NULL) {
-    goto error;
-  }
+  if (crypto->kex_type == SSH_KEX_DH_GROUP1_SHA1) {
+    num = make_bignum_string(crypto->e);
+    if (num == NULL) {
+      goto error;
+    }
 
-  len = ssh_string_len(num) + 4;
-  if (buffer_add_data(buf, num, len) < 0) {
-    goto error;
-  }
+    len = ssh_string_len(num) + 4;
+    if (buffer_add_data(buf, num, len) < 0) {
+      goto error;
+    }
 
-  ssh_string_free(num);
-  num = make_bignum_string(session->next_crypto->f);
-  if (num == NULL) {
-    goto error;
-  }
+    ssh_string_free(num);
+    num = make_bignum_string(crypto->f);
+    if (num == NULL) {
+      goto error;
+    }
 
-  len = ssh_string_len(num) + 4;
-  if (buffer_add_data(buf, num, len) < 0) {
-    goto error;
+    len = ssh_string_len(num) + 4;
+    if (buffer_add_data(buf, num, len) < 0) {
+      goto error;
+    }
+
+    ssh_string_free(num);
+  } else {
+    /* ECDH methods hash the public points Q_C and Q_S as strings */
+    if (crypto->ecdh_client_pubkey == NULL ||
+        crypto->ecdh_server_pubkey == NULL) {
+      goto error;
+    }
+    if (buffer_add_ssh_string(buf, crypto->ecdh_client_pubkey) < 0 ||
+        buffer_add_ssh_string(buf, crypto->ecdh_server_pubkey) < 0) {
+      goto error;
+    }
   }
 
-  ssh_string_free(num);
   num = make_bignum_string(session->next_crypto->k);
   if (num == NULL) {
     goto error;
@@ -609,12 +680,14 @@ int make_sessionid(ssh_session session) {
   ssh_print_hexa("hash buffer", ssh_buffer_get_begin(buf), ssh_buffer_get_len(buf));
 #endif
 
-  sha1_update(ctx, buffer_get_rest(buf), buffer_get_rest_len(buf));
-  sha1_final(session->next_crypto->session_id, ctx);
+  if (kex_digest(crypto, crypto->session_id, buffer_get_rest(buf),
+        buffer_get_rest_len(buf)) < 0) {
+    goto error;
+  }
 
 #ifdef DEBUG_CRYPTO
   printf("Session hash: ");
-  ssh_print_hexa("session id", session->next_crypto->session_id, SHA_DIGEST_LEN);
+  ssh_print_hexa("session id", crypto->session_id, crypto->digest_len);
 #endif
 
   rc = SSH_OK;
@@ -681,28 +754,58 @@ int hashbufin_add_cookie(ssh_session session, unsigned char *cookie) {
 }
 
 static int generate_one_key(ssh_string k,
-    unsigned char session_id[SHA_DIGEST_LEN],
-    unsigned char output[SHA_DIGEST_LEN],
-    char letter) {
-  SHACTX ctx = NULL;
+    struct ssh_crypto_struct *crypto, unsigned char *output, char letter) {
+  ssh_buffer buf;
+  int rc;
 
-  ctx = sha1_init();
-  if (ctx == NULL) {
+  buf = ssh_buffer_new();
+  if (buf == NULL) {
     return -1;
   }
 
-  sha1_update(ctx, k, ssh_string_len(k) + 4);
-  sha1_update(ctx, session_id, SHA_DIGEST_LEN);
-  sha1_update(ctx, &letter, 1);
-  sha1_update(ctx, session_id, SHA_DIGEST_LEN);
-  sha1_final(output, ctx);
+  if (buffer_add_data(buf, k, ssh_string_len(k) + 4) < 0 ||
+      buffer_add_data(buf, crypto->session_id, crypto->digest_len) < 0 ||
+      buffer_add_u8(buf, letter) < 0 ||
+      buffer_add_data(buf, crypto->session_id, crypto->digest_len) < 0) {
+    ssh_buffer_free(buf);
+    return -1;
+  }
 
-  return 0;
+  rc = kex_digest(crypto, output, buffer_get_rest(buf),
+      buffer_get_rest_len(buf));
+  ssh_buffer_free(buf);
+
+  return rc;
+}
+
+/* extends a key with K || H || key, for ciphers needing more than a digest */
+static int extend_key(ssh_string k, struct ssh_crypto_struct *crypto,
+    unsigned char *key) {
+  ssh_buffer buf;
+  int rc;
+
+  buf = ssh_buffer_new();
+  if (buf == NULL) {
+    return -1;
+  }
+
+  if (buffer_add_data(buf, k, ssh_string_len(k) + 4) < 0 ||
+      buffer_add_data(buf, crypto->session_id, crypto->digest_len) < 0 ||
+      buffer_add_data(buf, key, crypto->digest_len) < 0) {
+    ssh_buffer_free(buf);
+    return -1;
+  }
+
+  rc = kex_digest(crypto, key + crypto->digest_len, buffer_get_rest(buf),
+      buffer_get_rest_len(buf));
+  ssh_buffer_free(buf);
+
+  return rc;
 }
 
 int generate_session_keys(ssh_session session) {
   ssh_string k_string = NULL;
-  SHACTX ctx = NULL;
+  struct ssh_crypto_struct *crypto = session->next_crypto;
   int rc = -1;
 
   enter_function();
@@ -714,87 +817,80 @@ int generate_session_keys(ssh_session session) {
 
   /* IV */
   if (session->client) {
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->encryptIV, 'A') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->encryptIV, 'A') < 0) {
       goto error;
     }
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->decryptIV, 'B') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->decryptIV, 'B') < 0) {
       goto error;
     }
   } else {
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->decryptIV, 'A') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->decryptIV, 'A') < 0) {
       goto error;
     }
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->encryptIV, 'B') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->encryptIV, 'B') < 0) {
       goto error;
     }
   }
   if (session->client) {
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->encryptkey, 'C') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->encryptkey, 'C') < 0) {
       goto error;
     }
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->decryptkey, 'D') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->decryptkey, 'D') < 0) {
       goto error;
     }
   } else {
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->decryptkey, 'C') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->decryptkey, 'C') < 0) {
       goto error;
     }
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->encryptkey, 'D') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->encryptkey, 'D') < 0) {
       goto error;
     }
   }
 
-  /* some ciphers need more than 20 bytes of input key */
+  /* some ciphers need more than one digest of input key */
   /* XXX verify it's ok for server implementation */
-  if (session->next_crypto->out_cipher->keysize > SHA_DIGEST_LEN * 8) {
-    ctx = sha1_init();
-    if (ctx == NULL) {
+  if (crypto->out_cipher->keysize > (unsigned int) crypto->digest_len * 8) {
+    if (extend_key(k_string, crypto, crypto->encryptkey) < 0) {
       goto error;
     }
-    sha1_update(ctx, k_string, ssh_string_len(k_string) + 4);
-    sha1_update(ctx, session->next_crypto->session_id, SHA_DIGEST_LEN);
-    sha1_update(ctx, session->next_crypto->encryptkey, SHA_DIGEST_LEN);
-    sha1_final(session->next_crypto->encryptkey + SHA_DIGEST_LEN, ctx);
   }
 
-  if (session->next_crypto->in_cipher->keysize > SHA_DIGEST_LEN * 8) {
-    ctx = sha1_init();
-    sha1_update(ctx, k_string, ssh_string_len(k_string) + 4);
-    sha1_update(ctx, session->next_crypto->session_id, SHA_DIGEST_LEN);
-    sha1_update(ctx, session->next_crypto->decryptkey, SHA_DIGEST_LEN);
-    sha1_final(session->next_crypto->decryptkey + SHA_DIGEST_LEN, ctx);
+  if (crypto->in_cipher->keysize > (unsigned int) crypto->digest_len * 8) {
+    if (extend_key(k_string, crypto, crypto->decryptkey) < 0) {
+      goto error;
+    }
   }
   if(session->client) {
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->encryptMAC, 'E') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->encryptMAC, 'E') < 0) {
       goto error;
     }
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->decryptMAC, 'F') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->decryptMAC, 'F') < 0) {
       goto error;
     }
   } else {
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->decryptMAC, 'E') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->decryptMAC, 'E') < 0) {
       goto error;
     }
-    if (generate_one_key(k_string, session->next_crypto->session_id,
-          session->next_crypto->encryptMAC, 'F') < 0) {
+    if (generate_one_key(k_string, crypto,
+          crypto->encryptMAC, 'F') < 0) {
       goto error;
     }
   }
 
 #ifdef DEBUG_CRYPTO
-  ssh_print_hexa("Encrypt IV", session->next_crypto->encryptIV, SHA_DIGEST_LEN);
-  ssh_print_hexa("Decrypt IV", session->next_crypto->decryptIV, SHA_DIGEST_LEN);
+  ssh_print_hexa("Encrypt IV", crypto->encryptIV, crypto->digest_len);
+  ssh_print_hexa("Decrypt IV", crypto->decryptIV, crypto->digest_len);
   ssh_print_hexa("Encryption key", session->next_crypto->encryptkey,
       session->next_crypto->out_cipher->keysize);
   ssh_print_hexa("Decryption key", session->next_crypto->decryptkey,
@@ -1048,7 +1144,8 @@ int signature_verify(ssh_session session, ssh_string signature) {
       "Going to verify a %s type signature", pubkey->type_c);
 
   err = sig_verify(session,pubkey,sign,
-                            session->next_crypto->session_id,SHA_DIGEST_LEN);
+                            session->next_crypto->session_id,
+                            session->next_crypto->digest_len);
   signature_free(sign);
   session->next_crypto->server_pubkey_type = pubkey->type_c;
   publickey_free(pubkey);
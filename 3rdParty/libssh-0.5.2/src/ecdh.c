@@ -0,0 +1,175 @@
+/*
+ * ecdh.c - Elliptic curve Diffie-Hellman key exchange
+ * ecdh-sha2-nistp256, RFC 5656
+ *
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "libssh/priv.h"
+#include "libssh/crypto.h"
+#include "libssh/session.h"
+#include "libssh/dh.h"
+#include "libssh/ecdh.h"
+
+#ifdef HAVE_ECDH
+
+#include <openssl/ecdh.h>
+
+#define NISTP256 NID_X9_62_prime256v1
+
+/**
+ * @internal
+ * @brief Generates an ephemeral nistp256 keypair into a crypto structure.
+ *
+ * The public key is stored as the Q_C string sent in SSH_MSG_KEX_ECDH_INIT,
+ * encoded as an uncompressed point.
+ *
+ * @returns SSH_OK on success, SSH_ERROR on error.
+ */
+int ssh_ecdh_keypair(struct ssh_crypto_struct *crypto) {
+  EC_KEY *key;
+  const EC_GROUP *group;
+  const EC_POINT *pubkey;
+  ssh_string client_pubkey;
+  size_t len;
+  bignum_CTX ctx;
+
+  key = EC_KEY_new_by_curve_name(NISTP256);
+  if (key == NULL) {
+    return SSH_ERROR;
+  }
+  if (!EC_KEY_generate_key(key)) {
+    EC_KEY_free(key);
+    return SSH_ERROR;
+  }
+
+  ctx = bignum_ctx_new();
+  if (ctx == NULL) {
+    EC_KEY_free(key);
+    return SSH_ERROR;
+  }
+
+  group = EC_KEY_get0_group(key);
+  pubkey = EC_KEY_get0_public_key(key);
+  len = EC_POINT_point2oct(group, pubkey, POINT_CONVERSION_UNCOMPRESSED,
+      NULL, 0, ctx);
+
+  client_pubkey = ssh_string_new(len);
+  if (client_pubkey == NULL) {
+    bignum_ctx_free(ctx);
+    EC_KEY_free(key);
+    return SSH_ERROR;
+  }
+  EC_POINT_point2oct(group, pubkey, POINT_CONVERSION_UNCOMPRESSED,
+      ssh_string_data(client_pubkey), len, ctx);
+  bignum_ctx_free(ctx);
+
+  crypto->ecdh_privkey = key;
+  crypto->ecdh_client_pubkey = client_pubkey;
+
+  return SSH_OK;
+}
+
+/**
+ * @internal
+ * @brief Computes the shared secret K from our private key and the Q_S
+ * received from the server.
+ *
+ * @returns SSH_OK on success, SSH_ERROR on error.
+ */
+int ssh_ecdh_build_k(ssh_session session) {
+  struct ssh_crypto_struct *crypto = session->next_crypto;
+  const EC_GROUP *group;
+  EC_POINT *pubkey;
+  ssh_string k_string;
+  bignum_CTX ctx;
+  int len;
+  int rc;
+
+  if (crypto->ecdh_privkey == NULL || crypto->ecdh_server_pubkey == NULL) {
+    ssh_set_error(session, SSH_FATAL, "Missing ECDH key material");
+    return SSH_ERROR;
+  }
+
+  group = EC_KEY_get0_group(crypto->ecdh_privkey);
+  pubkey = EC_POINT_new(group);
+  if (pubkey == NULL) {
+    ssh_set_error_oom(session);
+    return SSH_ERROR;
+  }
+
+  ctx = bignum_ctx_new();
+  if (ctx == NULL) {
+    EC_POINT_free(pubkey);
+    ssh_set_error_oom(session);
+    return SSH_ERROR;
+  }
+
+  /* EC_POINT_oct2point() also checks that the point lies on the curve */
+  rc = EC_POINT_oct2point(group, pubkey,
+      ssh_string_data(crypto->ecdh_server_pubkey),
+      ssh_string_len(crypto->ecdh_server_pubkey), ctx);
+  bignum_ctx_free(ctx);
+  if (!rc) {
+    EC_POINT_free(pubkey);
+    ssh_set_error(session, SSH_FATAL, "Invalid ECDH server public key");
+    return SSH_ERROR;
+  }
+
+  len = (EC_GROUP_get_degree(group) + 7) / 8;
+  k_string = ssh_string_new(len);
+  if (k_string == NULL) {
+    EC_POINT_free(pubkey);
+    ssh_set_error_oom(session);
+    return SSH_ERROR;
+  }
+
+  rc = ECDH_compute_key(ssh_string_data(k_string), len, pubkey,
+      crypto->ecdh_privkey, NULL);
+  EC_POINT_free(pubkey);
+  if (rc != len) {
+    ssh_string_free(k_string);
+    ssh_set_error(session, SSH_FATAL, "Cannot compute the ECDH shared secret");
+    return SSH_ERROR;
+  }
+
+  crypto->k = make_string_bn(k_string);
+  ssh_string_burn(k_string);
+  ssh_string_free(k_string);
+  if (crypto->k == NULL) {
+    return SSH_ERROR;
+  }
+
+  /* the ephemeral key is no longer needed */
+  EC_KEY_free(crypto->ecdh_privkey);
+  crypto->ecdh_privkey = NULL;
+
+#ifdef DEBUG_CRYPTO
+  ssh_print_bignum("Shared secret key", crypto->k);
+#endif
+
+  return SSH_OK;
+}
+
+#endif /* HAVE_ECDH */
+
+/* vim: set ts=2 sw=2 et cindent: */
@@ -27,6 +27,7 @@
 #include "libssh/dh.h"
 #include "libssh/poll.h"
 #include "libssh/threads.h"
+#include "libssh/kex.h"
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -55,6 +56,14 @@ int ssh_init(void) {
     return -1;
   if(ssh_crypto_init())
     return -1;
+  if(ssh_kex_pool_init())
+    return -1;
+  if(ssh_knownhosts_cache_init())
+    return -1;
+  if(ssh_keyfile_cache_init())
+    return -1;
+  if(ssh_config_cache_init())
+    return -1;
   if(ssh_socket_init())
     return -1;
   return 0;
@@ -71,6 +80,10 @@ int ssh_init(void) {
    @returns 0 otherwise
  */
 int ssh_finalize(void) {
+  ssh_kex_pool_finalize();
+  ssh_knownhosts_cache_finalize();
+  ssh_keyfile_cache_finalize();
+  ssh_config_cache_finalize();
   ssh_crypto_finalize();
   ssh_socket_cleanup();
   /* It is important to finalize threading after CRYPTO because
@@ -42,6 +42,9 @@
 #include "libssh/dh.h"
 #include "libssh/kex.h"
 #include "libssh/string.h"
+#include "libssh/threads.h"
+#include "libssh/curve25519.h"
+#include "libssh/ecdh.h"
 
 #ifdef HAVE_LIBGCRYPT
 #define BLOWFISH "blowfish-cbc,"
@@ -66,6 +69,17 @@
 #define DES "3des-cbc"
 #endif
 
+#ifdef HAVE_ECDH
+#define ECDH "ecdh-sha2-nistp256,"
+#else
+#define ECDH ""
+#endif
+
+#define KEY_EXCHANGE "curve25519-sha256@libssh.org," ECDH "diffie-hellman-group1-sha1"
+
+/* maximum number of precomputed ephemeral keypairs kept in the pool */
+#define KEX_POOL_SIZE 16
+
 #if defined(HAVE_LIBZ) && defined(WITH_LIBZ)
 #define ZLIB "none,zlib,zlib@openssh.com"
 #else
@@ -73,7 +87,7 @@
 #endif
 
 const char *default_methods[] = {
-  "diffie-hellman-group1-sha1",
+  KEY_EXCHANGE,
   "ssh-rsa,ssh-dss",
   AES BLOWFISH DES,
   AES BLOWFISH DES,
@@ -87,7 +101,7 @@ const char *default_methods[] = {
 };
 
 const char *supported_methods[] = {
-  "diffie-hellman-group1-sha1",
+  KEY_EXCHANGE,
   "ssh-rsa,ssh-dss",
   AES BLOWFISH DES,
   AES BLOWFISH DES,
@@ -394,6 +408,15 @@ int set_kex(ssh_session session){
           }
         }
     }
+    session->next_crypto->kex_type = ssh_kex_type(client->methods[SSH_KEX]);
+    if (session->next_crypto->kex_type == 0) {
+        ssh_set_error(session,SSH_FATAL,"kex error : unsupported key exchange %s",
+            client->methods[SSH_KEX]);
+        leave_function();
+        return -1;
+    }
+    session->next_crypto->digest_len =
+        ssh_kex_digest_len(session->next_crypto->kex_type);
     leave_function();
     return 0;
 }
@@ -470,6 +493,239 @@ int verify_existing_algo(int algo, const char *name){
     return 0;
 }
 
+/** @internal
+ * @brief maps a key exchange method name to its kex type
+ * @returns the kex type, 0 if the method is not supported
+ */
+enum ssh_key_exchange_e ssh_kex_type(const char *name) {
+  if (name == NULL) {
+    return 0;
+  }
+  if (strcmp(name, "diffie-hellman-group1-sha1") == 0) {
+    return SSH_KEX_DH_GROUP1_SHA1;
+  }
+#ifdef HAVE_ECDH
+  if (strcmp(name, "ecdh-sha2-nistp256") == 0) {
+    return SSH_KEX_ECDH_SHA2_NISTP256;
+  }
+#endif
+  if (strcmp(name, "curve25519-sha256@libssh.org") == 0) {
+    return SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG;
+  }
+
+  return 0;
+}
+
+const char *ssh_kex_type_name(enum ssh_key_exchange_e type) {
+  switch (type) {
+    case SSH_KEX_DH_GROUP1_SHA1:
+      return "diffie-hellman-group1-sha1";
+    case SSH_KEX_ECDH_SHA2_NISTP256:
+      return "ecdh-sha2-nistp256";
+    case SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG:
+      return "curve25519-sha256@libssh.org";
+  }
+
+  return NULL;
+}
+
+/* length of the exchange hash H of a key exchange method */
+int ssh_kex_digest_len(enum ssh_key_exchange_e type) {
+  if (type == SSH_KEX_DH_GROUP1_SHA1) {
+    return SHA_DIGEST_LEN;
+  }
+
+  return SHA256_DIGEST_LEN;
+}
+
+/** @internal
+ * @brief generates the client ephemeral keypair of crypto->kex_type
+ * @returns SSH_OK on success, SSH_ERROR on error
+ */
+int ssh_kex_keypair_generate(struct ssh_crypto_struct *crypto) {
+  switch (crypto->kex_type) {
+    case SSH_KEX_DH_GROUP1_SHA1:
+      return dh_generate_keypair(crypto) < 0 ? SSH_ERROR : SSH_OK;
+#ifdef HAVE_ECDH
+    case SSH_KEX_ECDH_SHA2_NISTP256:
+      return ssh_ecdh_keypair(crypto);
+#endif
+    case SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG:
+      return ssh_curve25519_keypair(crypto);
+    default:
+      break;
+  }
+
+  return SSH_ERROR;
+}
+
+/*
+ * Pool of ephemeral keypairs computed ahead of time by ssh_kex_precompute(),
+ * so a client can send its KEXDH_INIT without doing the expensive part of
+ * the key exchange on the connect path. Every entry is a crypto structure
+ * holding only the keypair, and is used at most once.
+ */
+static struct ssh_crypto_struct *kex_pool[KEX_POOL_SIZE];
+static int kex_pool_count;
+static void *kex_pool_mutex;
+
+int ssh_kex_pool_init(void) {
+  return ssh_mutex_init(&kex_pool_mutex);
+}
+
+void ssh_kex_pool_finalize(void) {
+  int i;
+
+  ssh_mutex_lock(&kex_pool_mutex);
+  for (i = 0; i < kex_pool_count; i++) {
+    crypto_free(kex_pool[i]);
+    kex_pool[i] = NULL;
+  }
+  kex_pool_count = 0;
+  ssh_mutex_unlock(&kex_pool_mutex);
+
+  ssh_mutex_destroy(&kex_pool_mutex);
+}
+
+static int kex_pool_count_type(enum ssh_key_exchange_e type) {
+  int i;
+  int n = 0;
+
+  for (i = 0; i < kex_pool_count; i++) {
+    if (kex_pool[i]->kex_type == type) {
+      n++;
+    }
+  }
+
+  return n;
+}
+
+/** @internal
+ * @brief moves a precomputed keypair of crypto->kex_type into crypto
+ * @returns SSH_OK if a keypair was taken, SSH_ERROR if the pool has none
+ */
+int ssh_kex_pool_take(struct ssh_crypto_struct *crypto) {
+  struct ssh_crypto_struct *keypair = NULL;
+  int i;
+
+  ssh_mutex_lock(&kex_pool_mutex);
+  for (i = kex_pool_count - 1; i >= 0; i--) {
+    if (kex_pool[i]->kex_type == crypto->kex_type) {
+      keypair = kex_pool[i];
+      kex_pool[i] = kex_pool[--kex_pool_count];
+      kex_pool[kex_pool_count] = NULL;
+      break;
+    }
+  }
+  ssh_mutex_unlock(&kex_pool_mutex);
+
+  if (keypair == NULL) {
+    return SSH_ERROR;
+  }
+
+  crypto->x = keypair->x;
+  crypto->e = keypair->e;
+  crypto->ecdh_client_pubkey = keypair->ecdh_client_pubkey;
+#ifdef HAVE_ECDH
+  crypto->ecdh_privkey = keypair->ecdh_privkey;
+  keypair->ecdh_privkey = NULL;
+#endif
+  memcpy(crypto->curve25519_privkey, keypair->curve25519_privkey,
+      CURVE25519_PRIVKEY_SIZE);
+  keypair->x = NULL;
+  keypair->e = NULL;
+  keypair->ecdh_client_pubkey = NULL;
+  /* also wipes the copy of the private key */
+  crypto_free(keypair);
+
+  return SSH_OK;
+}
+
+/**
+ * @addtogroup libssh_session
+ *
+ * @{
+ */
+
+/**
+ * @brief Precompute ephemeral key exchange keypairs.
+ *
+ * Fills a process wide pool with up to count keypairs for the given key
+ * exchange method, so later connections skip the keypair generation and
+ * send their KEXDH_INIT right away. Each keypair is used only once.
+ *
+ * This function may take a while and is meant to be run from a background
+ * thread. In that case threading must have been set up with
+ * ssh_threads_set_callbacks() before ssh_init().
+ *
+ * @param[in]  algorithm The key exchange method, e.g.
+ *                       "curve25519-sha256@libssh.org". NULL selects the
+ *                       preferred default method.
+ *
+ * @param[in]  count     Number of keypairs to keep ready for this method.
+ *
+ * @return               The number of keypairs added, SSH_ERROR on error.
+ */
+int ssh_kex_precompute(const char *algorithm, int count) {
+  struct ssh_crypto_struct *keypair;
+  enum ssh_key_exchange_e type;
+  char **tokens;
+  int added = 0;
+  int n;
+
+  if (algorithm == NULL) {
+    tokens = tokenize(default_methods[SSH_KEX]);
+    if (tokens == NULL) {
+      return SSH_ERROR;
+    }
+    type = ssh_kex_type(tokens[0]);
+    SAFE_FREE(tokens[0]);
+    SAFE_FREE(tokens);
+  } else {
+    type = ssh_kex_type(algorithm);
+  }
+  if (type == 0) {
+    return SSH_ERROR;
+  }
+  if (count > KEX_POOL_SIZE) {
+    count = KEX_POOL_SIZE;
+  }
+
+  for (;;) {
+    ssh_mutex_lock(&kex_pool_mutex);
+    n = kex_pool_count_type(type);
+    ssh_mutex_unlock(&kex_pool_mutex);
+    if (n >= count) {
+      break;
+    }
+
+    /* generate outside of the lock, connects may take from the pool */
+    keypair = crypto_new();
+    if (keypair == NULL) {
+      return SSH_ERROR;
+    }
+    keypair->kex_type = type;
+    if (ssh_kex_keypair_generate(keypair) != SSH_OK) {
+      crypto_free(keypair);
+      return SSH_ERROR;
+    }
+
+    ssh_mutex_lock(&kex_pool_mutex);
+    if (kex_pool_count == KEX_POOL_SIZE) {
+      ssh_mutex_unlock(&kex_pool_mutex);
+      crypto_free(keypair);
+      break;
+    }
+    kex_pool[kex_pool_count++] = keypair;
+    ssh_mutex_unlock(&kex_pool_mutex);
+    added++;
+  }
+
+  return added;
+}
+
+/** @} */
+
 #ifdef WITH_SSH1
 
 /* makes a STRING contating 3 strings : ssh-rsa1,e and n */
@@ -55,6 +55,7 @@
 #include "libssh/wrapper.h"
 #include "libssh/misc.h"
 #include "libssh/keys.h"
+#include "libssh/threads.h"
 
 /*todo: remove this include */
 #include "libssh/string.h"
@@ -623,6 +624,221 @@ static int pem_get_password(char *buf, int size, int rwflag, void *userdata) {
 }
 #endif /* HAVE_LIBCRYPTO */
 
+/*
+ * Decrypted private keys, shared by the sessions of the process. An entry is
+ * used again only while the key file keeps its size, modification time and
+ * inode and, for an encrypted key, when the same passphrase is given. Keys
+ * decrypted with a passphrase prompt are not cached.
+ */
+struct keyfile_cache_entry {
+  char *filename;
+  int type;
+  struct ssh_file_stamp stamp;
+  int encrypted;
+  /* HMAC of the passphrase, keyed with a per process random salt */
+  unsigned char verifier[SHA_DIGEST_LEN];
+  ssh_private_key key;
+  struct keyfile_cache_entry *next;
+};
+
+static struct keyfile_cache_entry *keyfile_cache;
+static void *keyfile_cache_mutex;
+static unsigned char keyfile_cache_salt[16];
+static int keyfile_cache_initialized;
+
+static void keyfile_cache_verifier(const char *passphrase,
+    unsigned char *verifier) {
+  unsigned int len = SHA_DIGEST_LEN;
+  HMACCTX mac;
+
+  memset(verifier, 0, SHA_DIGEST_LEN);
+  if (passphrase == NULL) {
+    return;
+  }
+
+  mac = hmac_init(keyfile_cache_salt, sizeof(keyfile_cache_salt), HMAC_SHA1);
+  if (mac == NULL) {
+    return;
+  }
+  hmac_update(mac, passphrase, strlen(passphrase));
+  hmac_final(mac, verifier, &len);
+}
+
+/* Another reference to the key material, freed with privatekey_free() */
+static ssh_private_key privatekey_dup(ssh_private_key key) {
+  ssh_private_key copy;
+
+  copy = malloc(sizeof(struct ssh_private_key_struct));
+  if (copy == NULL) {
+    return NULL;
+  }
+  ZERO_STRUCTP(copy);
+  copy->type = key->type;
+
+#ifdef HAVE_LIBGCRYPT
+  if ((key->dsa_priv != NULL &&
+       gcry_sexp_build(&copy->dsa_priv, NULL, "%S", key->dsa_priv)) ||
+      (key->rsa_priv != NULL &&
+       gcry_sexp_build(&copy->rsa_priv, NULL, "%S", key->rsa_priv))) {
+    privatekey_free(copy);
+    return NULL;
+  }
+#elif defined HAVE_LIBCRYPTO
+  if (key->dsa_priv != NULL) {
+    DSA_up_ref(key->dsa_priv);
+    copy->dsa_priv = key->dsa_priv;
+  }
+  if (key->rsa_priv != NULL) {
+    RSA_up_ref(key->rsa_priv);
+    copy->rsa_priv = key->rsa_priv;
+  }
+#endif
+
+  return copy;
+}
+
+static void keyfile_cache_entry_free(struct keyfile_cache_entry *entry) {
+  /* the crypto libraries clear the private numbers when freeing them */
+  privatekey_free(entry->key);
+  SAFE_FREE(entry->filename);
+  memset(entry, 0, sizeof(struct keyfile_cache_entry));
+  SAFE_FREE(entry);
+}
+
+static ssh_private_key keyfile_cache_lookup(const char *filename, int type,
+    const char *passphrase, struct ssh_file_stamp *stamp) {
+  struct keyfile_cache_entry **prev;
+  struct keyfile_cache_entry *entry;
+  unsigned char verifier[SHA_DIGEST_LEN];
+  ssh_private_key key = NULL;
+  unsigned char diff = 0;
+  int i;
+
+  ssh_mutex_lock(&keyfile_cache_mutex);
+  for (prev = &keyfile_cache; *prev != NULL; prev = &(*prev)->next) {
+    entry = *prev;
+    if (strcmp(entry->filename, filename) != 0 ||
+        (type != 0 && type != entry->type)) {
+      continue;
+    }
+
+    if (!ssh_file_stamp_equal(&entry->stamp, stamp)) {
+      /* the file changed, forget the key */
+      *prev = entry->next;
+      keyfile_cache_entry_free(entry);
+      break;
+    }
+
+    if (entry->encrypted) {
+      if (passphrase == NULL) {
+        break;
+      }
+      keyfile_cache_verifier(passphrase, verifier);
+      for (i = 0; i < SHA_DIGEST_LEN; i++) {
+        diff |= verifier[i] ^ entry->verifier[i];
+      }
+      memset(verifier, 0, sizeof(verifier));
+      if (diff != 0) {
+        break;
+      }
+    }
+
+    key = privatekey_dup(entry->key);
+    break;
+  }
+  ssh_mutex_unlock(&keyfile_cache_mutex);
+
+  return key;
+}
+
+static void keyfile_cache_store(const char *filename, const char *passphrase,
+    int encrypted, struct ssh_file_stamp *stamp, ssh_private_key key) {
+  struct keyfile_cache_entry **prev;
+  struct keyfile_cache_entry *entry;
+
+  entry = malloc(sizeof(struct keyfile_cache_entry));
+  if (entry == NULL) {
+    return;
+  }
+  ZERO_STRUCTP(entry);
+  entry->filename = strdup(filename);
+  entry->key = privatekey_dup(key);
+  if (entry->filename == NULL || entry->key == NULL) {
+    keyfile_cache_entry_free(entry);
+    return;
+  }
+  entry->type = key->type;
+  entry->stamp = *stamp;
+  entry->encrypted = encrypted;
+  keyfile_cache_verifier(passphrase, entry->verifier);
+
+  ssh_mutex_lock(&keyfile_cache_mutex);
+  /* replace an older version of the same key */
+  for (prev = &keyfile_cache; *prev != NULL; prev = &(*prev)->next) {
+    if (strcmp((*prev)->filename, filename) == 0 &&
+        (*prev)->type == entry->type) {
+      struct keyfile_cache_entry *old = *prev;
+      *prev = old->next;
+      keyfile_cache_entry_free(old);
+      break;
+    }
+  }
+  entry->next = keyfile_cache;
+  keyfile_cache = entry;
+  ssh_mutex_unlock(&keyfile_cache_mutex);
+}
+
+int ssh_keyfile_cache_init(void) {
+  if (keyfile_cache_initialized) {
+    return 0;
+  }
+  if (!ssh_get_random(keyfile_cache_salt, sizeof(keyfile_cache_salt), 0)) {
+    return -1;
+  }
+  if (ssh_mutex_init(&keyfile_cache_mutex) < 0) {
+    return -1;
+  }
+  keyfile_cache_initialized = 1;
+
+  return 0;
+}
+
+void ssh_keyfile_cache_finalize(void) {
+  struct keyfile_cache_entry *entry;
+
+  ssh_mutex_lock(&keyfile_cache_mutex);
+  while (keyfile_cache != NULL) {
+    entry = keyfile_cache;
+    keyfile_cache = entry->next;
+    keyfile_cache_entry_free(entry);
+  }
+  memset(keyfile_cache_salt, 0, sizeof(keyfile_cache_salt));
+  keyfile_cache_initialized = 0;
+  ssh_mutex_unlock(&keyfile_cache_mutex);
+
+  ssh_mutex_destroy(&keyfile_cache_mutex);
+}
+
+/* Whether the PEM file has a Proc-Type: 4,ENCRYPTED header */
+static int privatekey_file_encrypted(FILE *fp) {
+  char buffer[MAXLINESIZE] = {0};
+  int encrypted = 0;
+
+  while (fgets(buffer, MAXLINESIZE, fp)) {
+    if (strncmp(buffer, "Proc-Type:", 10) == 0) {
+      encrypted = strstr(buffer, "ENCRYPTED") != NULL;
+      break;
+    }
+    /* the headers come right after the BEGIN line */
+    if (strncmp(buffer, "-----BEGIN", 10) != 0) {
+      break;
+    }
+  }
+  fseek(fp, 0, SEEK_SET);
+
+  return encrypted;
+}
+
 static int privatekey_type_from_file(FILE *fp) {
   char buffer[MAXLINESIZE] = {0};
 
@@ -667,6 +883,9 @@ ssh_private_key privatekey_from_file(ssh_session session, const char *filename,
     int type, const char *passphrase) {
   ssh_private_key privkey = NULL;
   FILE *file = NULL;
+  struct ssh_file_stamp stamp;
+  int cacheable;
+  int encrypted;
 #ifdef HAVE_LIBGCRYPT
   ssh_auth_callback auth_cb = NULL;
   void *auth_ud = NULL;
@@ -686,6 +905,15 @@ ssh_private_key privatekey_from_file(ssh_session session, const char *filename,
     return NULL;
   }
 
+  cacheable = ssh_file_stamp_get(filename, &stamp) == 0;
+  if (cacheable) {
+    privkey = keyfile_cache_lookup(filename, type, passphrase, &stamp);
+    if (privkey != NULL) {
+      ssh_log(session, SSH_LOG_RARE, "Using cached private key %s", filename);
+      return privkey;
+    }
+  }
+
   ssh_log(session, SSH_LOG_RARE, "Trying to open %s", filename);
   file = fopen(filename,"r");
   if (file == NULL) {
@@ -693,6 +921,7 @@ ssh_private_key privatekey_from_file(ssh_session session, const char *filename,
         "Error opening %s: %s", filename, strerror(errno));
     return NULL;
   }
+  encrypted = privatekey_file_encrypted(file);
 
 #ifdef HAVE_LIBCRYPTO
   bio = BIO_new_file(filename,"r");
@@ -825,6 +1054,11 @@ ssh_private_key privatekey_from_file(ssh_session session, const char *filename,
   privkey->dsa_priv = dsa;
   privkey->rsa_priv = rsa;
 
+  /* without the passphrase, the next session could not be checked */
+  if (cacheable && (!encrypted || passphrase != NULL)) {
+    keyfile_cache_store(filename, passphrase, encrypted, &stamp, privkey);
+  }
+
   return privkey;
 }
 
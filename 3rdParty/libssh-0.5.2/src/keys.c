@@ -1140,11 +1140,11 @@ ssh_string ssh_do_sign_with_agent(ssh_session session,
   }
 
   /* prepend session identifier */
-  session_id = ssh_string_new(SHA_DIGEST_LEN);
+  session_id = ssh_string_new(crypto->digest_len);
   if (session_id == NULL) {
     return NULL;
   }
-  ssh_string_fill(session_id, crypto->session_id, SHA_DIGEST_LEN);
+  ssh_string_fill(session_id, crypto->session_id, crypto->digest_len);
 
   sigbuf = ssh_buffer_new();
   if (sigbuf == NULL) {
@@ -1207,13 +1207,13 @@ ssh_buffer ssh_userauth_build_digest(ssh_session session, ssh_message msg, char
   if (buffer == NULL) {
     goto error;
   }
-  session_id = ssh_string_new(SHA_DIGEST_LEN);
+  session_id = ssh_string_new(crypto->digest_len);
   if (session_id == NULL) {
     ssh_buffer_free(buffer);
     buffer = NULL;
     goto error;
   }
-  ssh_string_fill(session_id, crypto->session_id, SHA_DIGEST_LEN);
+  ssh_string_fill(session_id, crypto->session_id, crypto->digest_len);
 
   if(buffer_add_ssh_string(buffer, session_id) < 0 ||
      buffer_add_u8(buffer, type) < 0 ||
@@ -1254,11 +1254,11 @@ ssh_string ssh_do_sign(ssh_session session, ssh_buffer sigbuf,
   gcry_sexp_t gcryhash;
 #endif
 
-  session_str = ssh_string_new(SHA_DIGEST_LEN);
+  session_str = ssh_string_new(crypto->digest_len);
   if (session_str == NULL) {
     return NULL;
   }
-  ssh_string_fill(session_str, crypto->session_id, SHA_DIGEST_LEN);
+  ssh_string_fill(session_str, crypto->session_id, crypto->digest_len);
 
   ctx = sha1_init();
   if (ctx == NULL) {
@@ -1424,7 +1424,7 @@ ssh_string ssh_sign_session_id(ssh_session session, ssh_private_key privatekey)
   if (ctx == NULL) {
     return NULL;
   }
-  sha1_update(ctx,crypto->session_id,SHA_DIGEST_LEN);
+  sha1_update(ctx,crypto->session_id,crypto->digest_len);
   sha1_final(hash + 1,ctx);
   hash[0] = 0;
 
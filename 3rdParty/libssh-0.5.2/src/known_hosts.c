@@ -27,12 +27,14 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "libssh/priv.h"
 #include "libssh/session.h"
 #include "libssh/buffer.h"
 #include "libssh/misc.h"
 #include "libssh/keys.h"
+#include "libssh/threads.h"
 
 /*todo: remove this include */
 #include "libssh/string.h"
@@ -283,73 +285,86 @@ static int check_public_key(ssh_session session, char **tokens) {
 }
 
 /**
- * @brief Check if a hostname matches a openssh-style hashed known host.
+ * @internal
  *
- * @param[in]  host     The host to check.
+ * @brief Decode the salt and the hash of an openssh-style hashed known host.
  *
- * @param[in]  hashed   The hashed value.
+ * @param[in]  sourcehash The hashed value, "|1|base64 salt|base64 hash".
  *
- * @returns             1 if it matches, 0 otherwise.
+ * @param[out] salt     A pointer to store the decoded salt.
+ *
+ * @param[out] hash     A pointer to store the decoded hash.
+ *
+ * @returns             0 on success, -1 if the value is not a valid hash.
  */
-static int match_hashed_host(ssh_session session, const char *host,
-    const char *sourcehash) {
+static int parse_hashed_host(const char *sourcehash, ssh_buffer *salt,
+    ssh_buffer *hash) {
   /* Openssh hash structure :
    * |1|base64 encoded salt|base64 encoded hash
    * hash is produced that way :
    * hash := HMAC_SHA1(key=salt,data=host)
    */
-  unsigned char buffer[256] = {0};
-  ssh_buffer salt;
-  ssh_buffer hash;
-  HMACCTX mac;
   char *source;
   char *b64hash;
-  int match;
-  unsigned int size;
-
-  enter_function();
 
   if (strncmp(sourcehash, "|1|", 3) != 0) {
-  	leave_function();
-    return 0;
+    return -1;
   }
 
   source = strdup(sourcehash + 3);
   if (source == NULL) {
-    leave_function();
-    return 0;
+    return -1;
   }
 
   b64hash = strchr(source, '|');
   if (b64hash == NULL) {
     /* Invalid hash */
     SAFE_FREE(source);
-    leave_function();
-    return 0;
+    return -1;
   }
 
   *b64hash = '\0';
   b64hash++;
 
-  salt = base64_to_bin(source);
-  if (salt == NULL) {
+  *salt = base64_to_bin(source);
+  if (*salt == NULL) {
     SAFE_FREE(source);
-    leave_function();
-    return 0;
+    return -1;
   }
 
-  hash = base64_to_bin(b64hash);
+  *hash = base64_to_bin(b64hash);
   SAFE_FREE(source);
-  if (hash == NULL) {
-    ssh_buffer_free(salt);
-    leave_function();
-    return 0;
+  if (*hash == NULL) {
+    ssh_buffer_free(*salt);
+    *salt = NULL;
+    return -1;
   }
 
+  return 0;
+}
+
+/**
+ * @brief Check if a hostname matches a openssh-style hashed known host.
+ *
+ * @param[in]  host     The host to check.
+ *
+ * @param[in]  salt     The decoded salt of the hashed value.
+ *
+ * @param[in]  hash     The decoded hash of the hashed value.
+ *
+ * @returns             1 if it matches, 0 otherwise.
+ */
+static int match_hashed_host(ssh_session session, const char *host,
+    ssh_buffer salt, ssh_buffer hash) {
+  unsigned char buffer[256] = {0};
+  HMACCTX mac;
+  int match;
+  unsigned int size;
+
+  enter_function();
+
   mac = hmac_init(buffer_get_rest(salt), buffer_get_rest_len(salt), HMAC_SHA1);
   if (mac == NULL) {
-    ssh_buffer_free(salt);
-    ssh_buffer_free(hash);
     leave_function();
     return 0;
   }
@@ -364,9 +379,6 @@ static int match_hashed_host(ssh_session session, const char *host,
     match = 0;
   }
 
-  ssh_buffer_free(salt);
-  ssh_buffer_free(hash);
-
   ssh_log(session, SSH_LOG_PACKET,
       "Matching a hashed host: %s match=%d", host, match);
 
@@ -374,6 +386,423 @@ static int match_hashed_host(ssh_session session, const char *host,
   return match;
 }
 
+/*
+ * Process wide cache of the parsed known hosts file. The file is read again
+ * only when its size, modification time or inode changes:
+ *  - plain host names are indexed in a hash table,
+ *  - hashed entries keep their decoded salt and hash, and the entries
+ *    matching a host are remembered so the HMACs run once per host,
+ *  - entries with wildcards or negations are matched linearly.
+ */
+
+/* number of buckets of the plain host names table */
+#define KNOWNHOSTS_BUCKETS 4096
+/* maximum number of hosts whose hashed matches are remembered */
+#define KNOWNHOSTS_MEMO_MAX 256
+
+struct knownhosts_entry {
+  char **tokens;
+  const char *type;
+  /* decoded salt and hash of hashed entries */
+  ssh_buffer salt;
+  ssh_buffer hash;
+};
+
+struct knownhosts_name {
+  char *name;
+  unsigned int entry;
+  struct knownhosts_name *next;
+};
+
+struct knownhosts_memo {
+  char *host;
+  unsigned int *entries;
+  unsigned int count;
+  struct knownhosts_memo *next;
+};
+
+struct knownhosts_list {
+  unsigned int *items;
+  unsigned int count;
+  unsigned int size;
+};
+
+static struct knownhosts_cache_struct {
+  char *filename;
+  struct ssh_file_stamp stamp;
+  struct knownhosts_entry *entries;
+  unsigned int count;
+  struct knownhosts_name *names[KNOWNHOSTS_BUCKETS];
+  struct knownhosts_list patterns;
+  struct knownhosts_list hashed;
+  struct knownhosts_memo *memo;
+  unsigned int memo_count;
+} knownhosts_cache;
+
+static void *knownhosts_mutex;
+
+static int knownhosts_list_add(struct knownhosts_list *list,
+    unsigned int item) {
+  unsigned int *items;
+
+  if (list->count == list->size) {
+    list->size = list->size ? list->size * 2 : 16;
+    items = realloc(list->items, list->size * sizeof(unsigned int));
+    if (items == NULL) {
+      return -1;
+    }
+    list->items = items;
+  }
+  list->items[list->count++] = item;
+
+  return 0;
+}
+
+static unsigned int knownhosts_bucket(const char *name, size_t len) {
+  /* FNV-1a */
+  unsigned int h = 2166136261U;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    h ^= (unsigned char) name[i];
+    h *= 16777619U;
+  }
+
+  return h % KNOWNHOSTS_BUCKETS;
+}
+
+static void knownhosts_memo_clear(void) {
+  struct knownhosts_memo *memo;
+
+  while (knownhosts_cache.memo != NULL) {
+    memo = knownhosts_cache.memo;
+    knownhosts_cache.memo = memo->next;
+    SAFE_FREE(memo->host);
+    SAFE_FREE(memo->entries);
+    SAFE_FREE(memo);
+  }
+  knownhosts_cache.memo_count = 0;
+}
+
+static void knownhosts_cache_clear(void) {
+  struct knownhosts_name *name;
+  unsigned int i;
+
+  for (i = 0; i < knownhosts_cache.count; i++) {
+    tokens_free(knownhosts_cache.entries[i].tokens);
+    ssh_buffer_free(knownhosts_cache.entries[i].salt);
+    ssh_buffer_free(knownhosts_cache.entries[i].hash);
+  }
+  SAFE_FREE(knownhosts_cache.entries);
+  knownhosts_cache.count = 0;
+
+  for (i = 0; i < KNOWNHOSTS_BUCKETS; i++) {
+    while (knownhosts_cache.names[i] != NULL) {
+      name = knownhosts_cache.names[i];
+      knownhosts_cache.names[i] = name->next;
+      SAFE_FREE(name->name);
+      SAFE_FREE(name);
+    }
+  }
+
+  SAFE_FREE(knownhosts_cache.patterns.items);
+  SAFE_FREE(knownhosts_cache.hashed.items);
+  ZERO_STRUCT(knownhosts_cache.patterns);
+  ZERO_STRUCT(knownhosts_cache.hashed);
+
+  knownhosts_memo_clear();
+  SAFE_FREE(knownhosts_cache.filename);
+}
+
+/*
+ * Index the comma separated host names of an entry. Returns 1 if they were
+ * indexed, 0 if the entry needs pattern matching and -1 on error.
+ */
+static int knownhosts_index_names(const char *hosts, unsigned int entry) {
+  struct knownhosts_name *name;
+  const char *p;
+  size_t len;
+  size_t i;
+
+  if (strpbrk(hosts, "*?!") != NULL) {
+    return 0;
+  }
+
+  for (p = hosts; *p != '\0'; p += len + (p[len] == ',')) {
+    len = strcspn(p, ",");
+    /* match_hostname() never matches a subpattern this long */
+    if (len >= 1023) {
+      return 0;
+    }
+  }
+
+  for (p = hosts; *p != '\0'; p += len + (p[len] == ',')) {
+    len = strcspn(p, ",");
+    if (len == 0) {
+      continue;
+    }
+
+    name = malloc(sizeof(struct knownhosts_name));
+    if (name == NULL) {
+      return -1;
+    }
+    name->name = malloc(len + 1);
+    if (name->name == NULL) {
+      SAFE_FREE(name);
+      return -1;
+    }
+    for (i = 0; i < len; i++) {
+      name->name[i] = (char) tolower((unsigned char) p[i]);
+    }
+    name->name[len] = '\0';
+    name->entry = entry;
+
+    i = knownhosts_bucket(name->name, len);
+    name->next = knownhosts_cache.names[i];
+    knownhosts_cache.names[i] = name;
+  }
+
+  return 1;
+}
+
+static int knownhosts_cache_add(char **tokens, const char *type) {
+  struct knownhosts_entry *entries;
+  struct knownhosts_entry *entry;
+  unsigned int index = knownhosts_cache.count;
+  int rc;
+
+  if ((index & (index - 1)) == 0) {
+    /* grow when the count reaches a power of two */
+    entries = realloc(knownhosts_cache.entries,
+        (index ? index * 2 : 64) * sizeof(struct knownhosts_entry));
+    if (entries == NULL) {
+      return -1;
+    }
+    knownhosts_cache.entries = entries;
+  }
+
+  entry = &knownhosts_cache.entries[index];
+  ZERO_STRUCTP(entry);
+  entry->tokens = tokens;
+  entry->type = type;
+  knownhosts_cache.count++;
+
+  if (parse_hashed_host(tokens[0], &entry->salt, &entry->hash) == 0) {
+    return knownhosts_list_add(&knownhosts_cache.hashed, index);
+  }
+
+  rc = knownhosts_index_names(tokens[0], index);
+  if (rc == 0) {
+    rc = knownhosts_list_add(&knownhosts_cache.patterns, index);
+  }
+
+  return rc < 0 ? -1 : 0;
+}
+
+/**
+ * @internal
+ *
+ * @brief Make sure the cache holds the current content of a known hosts file.
+ *
+ * A missing file leaves an empty cache. Must be called with the cache mutex.
+ *
+ * @returns             0 on success, -1 on error.
+ */
+static int knownhosts_cache_update(ssh_session session, const char *filename) {
+  FILE *file = NULL;
+  struct ssh_file_stamp stamp;
+  const char *type;
+  char **tokens;
+
+  enter_function();
+
+  ssh_file_stamp_get(filename, &stamp);
+  if (knownhosts_cache.filename != NULL &&
+      strcmp(knownhosts_cache.filename, filename) == 0 &&
+      ssh_file_stamp_equal(&knownhosts_cache.stamp, &stamp)) {
+    leave_function();
+    return 0;
+  }
+
+  knownhosts_cache_clear();
+
+  knownhosts_cache.filename = strdup(filename);
+  if (knownhosts_cache.filename == NULL) {
+    leave_function();
+    return -1;
+  }
+  knownhosts_cache.stamp = stamp;
+
+  do {
+    tokens = ssh_get_knownhost_line(session, &file, filename, &type);
+    if (tokens == NULL) {
+      break;
+    }
+    if (knownhosts_cache_add(tokens, type) < 0) {
+      if (knownhosts_cache.count == 0 ||
+          knownhosts_cache.entries[knownhosts_cache.count - 1].tokens != tokens) {
+        tokens_free(tokens);
+      }
+      if (file != NULL) {
+        fclose(file);
+      }
+      knownhosts_cache_clear();
+      leave_function();
+      return -1;
+    }
+  } while (1);
+
+  ssh_log(session, SSH_LOG_PROTOCOL,
+      "Loaded %u known hosts from %s (%u hashed, %u patterns)",
+      knownhosts_cache.count, filename, knownhosts_cache.hashed.count,
+      knownhosts_cache.patterns.count);
+
+  leave_function();
+  return 0;
+}
+
+/* The hashed entries matching a host, computed once per host */
+static struct knownhosts_memo *knownhosts_memo_get(ssh_session session,
+    const char *host) {
+  struct knownhosts_memo *memo;
+  struct knownhosts_entry *entry;
+  struct knownhosts_list list;
+  unsigned int i;
+
+  for (memo = knownhosts_cache.memo; memo != NULL; memo = memo->next) {
+    if (strcmp(memo->host, host) == 0) {
+      return memo;
+    }
+  }
+
+  ZERO_STRUCT(list);
+  for (i = 0; i < knownhosts_cache.hashed.count; i++) {
+    entry = &knownhosts_cache.entries[knownhosts_cache.hashed.items[i]];
+    if (match_hashed_host(session, host, entry->salt, entry->hash) &&
+        knownhosts_list_add(&list, knownhosts_cache.hashed.items[i]) < 0) {
+      SAFE_FREE(list.items);
+      return NULL;
+    }
+  }
+
+  if (knownhosts_cache.memo_count >= KNOWNHOSTS_MEMO_MAX) {
+    knownhosts_memo_clear();
+  }
+
+  memo = malloc(sizeof(struct knownhosts_memo));
+  if (memo == NULL) {
+    SAFE_FREE(list.items);
+    return NULL;
+  }
+  memo->host = strdup(host);
+  if (memo->host == NULL) {
+    SAFE_FREE(list.items);
+    SAFE_FREE(memo);
+    return NULL;
+  }
+  memo->entries = list.items;
+  memo->count = list.count;
+  memo->next = knownhosts_cache.memo;
+  knownhosts_cache.memo = memo;
+  knownhosts_cache.memo_count++;
+
+  return memo;
+}
+
+static int knownhosts_match_name(struct knownhosts_list *matches,
+    const char *host) {
+  struct knownhosts_name *name;
+
+  name = knownhosts_cache.names[knownhosts_bucket(host, strlen(host))];
+  for (; name != NULL; name = name->next) {
+    if (strcmp(name->name, host) == 0 &&
+        knownhosts_list_add(matches, name->entry) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int knownhosts_match_hashed(ssh_session session,
+    struct knownhosts_list *matches, const char *host) {
+  struct knownhosts_memo *memo;
+  unsigned int i;
+
+  memo = knownhosts_memo_get(session, host);
+  if (memo == NULL) {
+    return -1;
+  }
+  for (i = 0; i < memo->count; i++) {
+    if (knownhosts_list_add(matches, memo->entries[i]) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int knownhosts_cmp(const void *a, const void *b) {
+  unsigned int x = *(const unsigned int *) a;
+  unsigned int y = *(const unsigned int *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+/**
+ * @internal
+ *
+ * @brief Find the cached entries matching a host, in file order.
+ *
+ * @returns             0 on success, -1 on error.
+ */
+static int knownhosts_cache_match(ssh_session session, const char *host,
+    const char *hostport, struct knownhosts_list *matches) {
+  const char *hosts;
+  unsigned int i, j;
+
+  if (knownhosts_match_name(matches, host) < 0 ||
+      knownhosts_match_name(matches, hostport) < 0 ||
+      knownhosts_match_hashed(session, matches, host) < 0 ||
+      knownhosts_match_hashed(session, matches, hostport) < 0) {
+    return -1;
+  }
+
+  for (i = 0; i < knownhosts_cache.patterns.count; i++) {
+    hosts = knownhosts_cache.entries[knownhosts_cache.patterns.items[i]].tokens[0];
+    /* a negated match still counts as a match */
+    if ((match_hostname(hostport, hosts, strlen(hosts)) != 0 ||
+         match_hostname(host, hosts, strlen(hosts)) != 0) &&
+        knownhosts_list_add(matches, knownhosts_cache.patterns.items[i]) < 0) {
+      return -1;
+    }
+  }
+
+  if (matches->count > 1) {
+    qsort(matches->items, matches->count, sizeof(unsigned int), knownhosts_cmp);
+    for (i = 1, j = 1; i < matches->count; i++) {
+      if (matches->items[i] != matches->items[j - 1]) {
+        matches->items[j++] = matches->items[i];
+      }
+    }
+    matches->count = j;
+  }
+
+  return 0;
+}
+
+int ssh_knownhosts_cache_init(void) {
+  return ssh_mutex_init(&knownhosts_mutex);
+}
+
+void ssh_knownhosts_cache_finalize(void) {
+  ssh_mutex_lock(&knownhosts_mutex);
+  knownhosts_cache_clear();
+  ssh_mutex_unlock(&knownhosts_mutex);
+
+  ssh_mutex_destroy(&knownhosts_mutex);
+}
+
 /* How it's working :
  * 1- we open the known host file and bitch if it doesn't exist
  * 2- we need to examine each line of the file, until going on state SSH_SERVER_KNOWN_OK:
@@ -411,11 +840,11 @@ static int match_hashed_host(ssh_session session, const char *host,
  *      host table.
  */
 int ssh_is_server_known(ssh_session session) {
-  FILE *file = NULL;
-  char **tokens;
+  struct knownhosts_entry *entry;
+  struct knownhosts_list matches;
   char *host;
   char *hostport;
-  const char *type;
+  unsigned int i;
   int match;
   int ret = SSH_SERVER_NOT_KNOWN;
 
@@ -453,52 +882,46 @@ int ssh_is_server_known(ssh_session session) {
     return SSH_SERVER_ERROR;
   }
 
-  do {
-    tokens = ssh_get_knownhost_line(session, &file,
-        session->knownhosts, &type);
+  ZERO_STRUCT(matches);
+  ssh_mutex_lock(&knownhosts_mutex);
+  if (knownhosts_cache_update(session, session->knownhosts) < 0 ||
+      knownhosts_cache_match(session, host, hostport, &matches) < 0) {
+    ssh_mutex_unlock(&knownhosts_mutex);
+    ssh_set_error_oom(session);
+    SAFE_FREE(matches.items);
+    SAFE_FREE(host);
+    SAFE_FREE(hostport);
+    leave_function();
+    return SSH_SERVER_ERROR;
+  }
 
-    /* End of file, return the current state */
-    if (tokens == NULL) {
-      break;
-    }
-    match = match_hashed_host(session, host, tokens[0]);
-    if (match == 0){
-    	match = match_hostname(hostport, tokens[0], strlen(tokens[0]));
-    }
-    if (match == 0) {
-      match = match_hostname(host, tokens[0], strlen(tokens[0]));
-    }
-    if (match == 0) {
-      match = match_hashed_host(session, hostport, tokens[0]);
+  for (i = 0; i < matches.count; i++) {
+    entry = &knownhosts_cache.entries[matches.items[i]];
+
+    /* We got a match. Now check the key type */
+    if (strcmp(session->current_crypto->server_pubkey_type, entry->type) != 0) {
+      /* Different type. We don't override the known_changed error which is
+       * more important */
+      if (ret != SSH_SERVER_KNOWN_CHANGED)
+        ret = SSH_SERVER_FOUND_OTHER;
+      continue;
     }
-    if (match) {
-      /* We got a match. Now check the key type */
-      if (strcmp(session->current_crypto->server_pubkey_type, type) != 0) {
-        /* Different type. We don't override the known_changed error which is
-         * more important */
-        if (ret != SSH_SERVER_KNOWN_CHANGED)
-          ret = SSH_SERVER_FOUND_OTHER;
-        tokens_free(tokens);
-        continue;
-      }
-      /* so we know the key type is good. We may get a good key or a bad key. */
-      match = check_public_key(session, tokens);
-      tokens_free(tokens);
+    /* so we know the key type is good. We may get a good key or a bad key. */
+    match = check_public_key(session, entry->tokens);
 
-      if (match < 0) {
-        ret = SSH_SERVER_ERROR;
-        break;
-      } else if (match == 1) {
-        ret = SSH_SERVER_KNOWN_OK;
-        break;
-      } else if(match == 0) {
-        /* We override the status with the wrong key state */
-        ret = SSH_SERVER_KNOWN_CHANGED;
-      }
-    } else {
-      tokens_free(tokens);
+    if (match < 0) {
+      ret = SSH_SERVER_ERROR;
+      break;
+    } else if (match == 1) {
+      ret = SSH_SERVER_KNOWN_OK;
+      break;
+    } else if(match == 0) {
+      /* We override the status with the wrong key state */
+      ret = SSH_SERVER_KNOWN_CHANGED;
     }
-  } while (1);
+  }
+  ssh_mutex_unlock(&knownhosts_mutex);
+  SAFE_FREE(matches.items);
 
   if ( (ret == SSH_SERVER_NOT_KNOWN) && (session->StrictHostKeyChecking == 0) ) {
     ssh_write_knownhost(session);
@@ -507,9 +930,6 @@ int ssh_is_server_known(ssh_session session) {
 
   SAFE_FREE(host);
   SAFE_FREE(hostport);
-  if (file != NULL) {
-    fclose(file);
-  }
 
   /* Return the current state at end of file */
   leave_function();
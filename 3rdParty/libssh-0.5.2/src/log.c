@@ -48,8 +48,6 @@
  */
 void ssh_log(ssh_session session, int verbosity, const char *format, ...) {
   char buffer[1024];
-  char indent[256];
-  int min;
   va_list va;
 
   if (verbosity <= session->log_verbosity) {
@@ -57,23 +55,36 @@ void ssh_log(ssh_session session, int verbosity, const char *format, ...) {
     vsnprintf(buffer, sizeof(buffer), format, va);
     va_end(va);
 
-    if (session->callbacks && session->callbacks->log_function) {
-      session->callbacks->log_function(session, verbosity, buffer,
-          session->callbacks->userdata);
-    } else if (verbosity == SSH_LOG_FUNCTIONS) {
-      if (session->log_indent > 255) {
-        min = 255;
-      } else {
-        min = session->log_indent;
-      }
+    ssh_log_line(session, verbosity, buffer);
+  }
+}
 
-      memset(indent, ' ', min);
-      indent[min] = '\0';
+/**
+ * @internal
+ *
+ * @brief Write a formatted line to the log callback or to stderr, whatever
+ * the verbosity of the session.
+ */
+void ssh_log_line(ssh_session session, int verbosity, const char *line) {
+  char indent[256];
+  int min;
 
-      fprintf(stderr, "[func] %s%s\n", indent, buffer);
+  if (session->callbacks && session->callbacks->log_function) {
+    session->callbacks->log_function(session, verbosity, line,
+        session->callbacks->userdata);
+  } else if (verbosity == SSH_LOG_FUNCTIONS) {
+    if (session->log_indent > 255) {
+      min = 255;
     } else {
-      fprintf(stderr, "[%d] %s\n", verbosity, buffer);
+      min = session->log_indent;
     }
+
+    memset(indent, ' ', min);
+    indent[min] = '\0';
+
+    fprintf(stderr, "[func] %s%s\n", indent, line);
+  } else {
+    fprintf(stderr, "[%d] %s\n", verbosity, line);
   }
 }
 
@@ -882,6 +882,24 @@ int ssh_analyze_banner(ssh_session session, int server, int *ssh1, int *ssh2) {
 #define CLOCK CLOCK_REALTIME
 #endif
 
+/**
+ * @internal
+ * @brief reads the same clock as ssh_timestamp_init() with a finer unit,
+ *        for timing short operations
+ * @returns the current time in nanoseconds
+ */
+uint64_t ssh_clock_ns(void){
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec tp;
+  clock_gettime(CLOCK, &tp);
+  return (uint64_t) tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+#else
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return (uint64_t) tp.tv_sec * 1000000000ULL + tp.tv_usec * 1000ULL;
+#endif
+}
+
 /**
  * @internal
  * @brief initializes a timestamp to the current time
@@ -923,6 +941,66 @@ static int ssh_timestamp_difference(struct ssh_timestamp *old,
   return msecs;
 }
 
+/**
+ * @internal
+ * @brief gets the time elapsed since a timestamp in microseconds
+ * @param[in] ts pointer to an existing timestamp
+ * @returns elapsed time in microseconds
+ */
+long ssh_timestamp_elapsed_us(struct ssh_timestamp *ts){
+  struct ssh_timestamp now;
+  ssh_timestamp_init(&now);
+  return (now.seconds - ts->seconds) * 1000000L +
+      (now.useconds - ts->useconds);
+}
+
+/**
+ * @internal
+ * @brief gets the CPU time consumed by the calling thread
+ * @returns CPU time in microseconds. Without per-thread clocks it falls
+ *          back to the CPU time of the whole process.
+ */
+long ssh_cpu_time_us(void){
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec tp;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tp) == 0) {
+    return tp.tv_sec * 1000000L + tp.tv_nsec / 1000;
+  }
+#endif
+  return (long) ((double) clock() * 1000000.0 / CLOCKS_PER_SEC);
+}
+
+/**
+ * @internal
+ * @brief gets the modification time, size and inode of a file
+ * @param[in] filename the file to look at
+ * @param[out] stamp filled with the file attributes, zeroed on error
+ * @returns 0 on success, -1 if the file can not be accessed
+ */
+int ssh_file_stamp_get(const char *filename, struct ssh_file_stamp *stamp){
+  struct stat sb;
+
+  memset(stamp, 0, sizeof(struct ssh_file_stamp));
+  if (stat(filename, &sb) < 0) {
+    return -1;
+  }
+
+  stamp->mtime = (long) sb.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+  stamp->mtime_nsec = sb.st_mtim.tv_nsec;
+#endif
+  stamp->size = (long long) sb.st_size;
+  stamp->inode = (unsigned long) sb.st_ino;
+
+  return 0;
+}
+
+int ssh_file_stamp_equal(const struct ssh_file_stamp *a,
+    const struct ssh_file_stamp *b){
+  return a->mtime == b->mtime && a->mtime_nsec == b->mtime_nsec &&
+      a->size == b->size && a->inode == b->inode;
+}
+
 /**
  * @internal
  * @brief Checks if a timeout is elapsed, in function of a previous
@@ -339,6 +339,18 @@ int ssh_options_set_algo(ssh_session session, int algo,
  *                Set the command to be executed in order to connect to
  *                server (const char *).
  *
+ *              - SSH_OPTIONS_KEY_EXCHANGE:
+ *                Set the key exchange methods to use, in order of
+ *                preference (const char *, comma-separated list, e.g.
+ *                "curve25519-sha256@libssh.org,diffie-hellman-group1-sha1").
+ *
+ *              - SSH_OPTIONS_TRACE_SIZE:
+ *                Set the number of packet level events kept in the trace
+ *                ring of the session (int, rounded up to a power of two,
+ *                0 to disable). Recording an event is cheap enough to leave
+ *                on; the ring is written to the log by ssh_trace_dump() and
+ *                when the connection fails.
+ *
  * @param  value The value to set. This is a generic pointer and the
  *               datatype which is used should be set according to the
  *               type set.
@@ -641,6 +653,27 @@ int ssh_options_set(ssh_session session, enum ssh_options_e type,
         session->compressionlevel=*x & 0xff;
       }
       break;
+    case SSH_OPTIONS_KEY_EXCHANGE:
+      if (value == NULL) {
+        ssh_set_error_invalid(session, __FUNCTION__);
+        return -1;
+      } else {
+        if (ssh_options_set_algo(session, SSH_KEX, value) < 0)
+          return -1;
+      }
+      break;
+    case SSH_OPTIONS_TRACE_SIZE:
+      if (value == NULL) {
+        ssh_set_error_invalid(session, __FUNCTION__);
+        return -1;
+      } else {
+        int *x = (int *) value;
+        if (*x < 0 || ssh_trace_set_size(session, *x) < 0) {
+          ssh_set_error_invalid(session, __FUNCTION__);
+          return -1;
+        }
+      }
+      break;
     case SSH_OPTIONS_STRICTHOSTKEYCHECK:
       if (value == NULL) {
         ssh_set_error_invalid(session, __FUNCTION__);
@@ -45,6 +45,7 @@
 #include "libssh/pcap.h"
 #include "libssh/kex.h"
 #include "libssh/auth.h"
+#include "libssh/scheduler.h"
 
 ssh_packet_callback default_packet_handlers[]= {
   ssh_packet_disconnect_callback,          // SSH2_MSG_DISCONNECT                 1
@@ -195,8 +196,6 @@ int ssh_packet_socket_callback(const void *data, size_t receivedlen, void *user)
         packet = (unsigned char *)data + processed;
 //        ssh_socket_read(session->socket,packet,to_be_read-current_macsize);
 
-        ssh_log(session,SSH_LOG_PACKET,"Read a %d bytes packet",len);
-
         if (buffer_add_data(session->in_buffer, packet,
               to_be_read - current_macsize) < 0) {
           goto error;
@@ -233,10 +232,6 @@ int ssh_packet_socket_callback(const void *data, size_t receivedlen, void *user)
         goto error;
       }
 
-      ssh_log(session, SSH_LOG_PACKET,
-          "%hhd bytes padding, %d bytes left in buffer",
-          padding, buffer_get_rest_len(session->in_buffer));
-
       if (padding > buffer_get_rest_len(session->in_buffer)) {
         ssh_set_error(session, SSH_FATAL,
             "Invalid padding: %d (%d resting)",
@@ -251,9 +246,6 @@ int ssh_packet_socket_callback(const void *data, size_t receivedlen, void *user)
       }
       buffer_pass_bytes_end(session->in_buffer, padding);
 
-      ssh_log(session, SSH_LOG_PACKET,
-          "After padding, %d bytes left in buffer",
-          buffer_get_rest_len(session->in_buffer));
 #if defined(HAVE_LIBZ) && defined(WITH_LIBZ)
       if (session->current_crypto
           && session->current_crypto->do_compress_in
@@ -265,16 +257,19 @@ int ssh_packet_socket_callback(const void *data, size_t receivedlen, void *user)
       }
 #endif
       session->recv_seq++;
+      session->stats.packets_in++;
       /* We don't want to rewrite a new packet while still executing the packet callbacks */
       session->packet_state = PACKET_STATE_PROCESSING;
       ssh_packet_parse_type(session);
+      ssh_trace(session, SSH_TRACE_PACKET_IN, len, padding,
+          session->in_packet.type);
       /* execute callbacks */
       ssh_packet_process(session, session->in_packet.type);
       session->packet_state = PACKET_STATE_INIT;
       if(processed < receivedlen){
       	/* Handle a potential packet left in socket buffer */
-      	ssh_log(session,SSH_LOG_PACKET,"Processing %" PRIdS " bytes left in socket buffer",
-      			receivedlen-processed);
+      	ssh_trace(session, SSH_TRACE_PACKET_LEFTOVER, receivedlen - processed,
+      	    0, 0);
       	rc = ssh_packet_socket_callback((char *)data + processed,
       			receivedlen - processed,user);
       	processed += rc;
@@ -291,6 +286,7 @@ int ssh_packet_socket_callback(const void *data, size_t receivedlen, void *user)
       session->packet_state);
 
 error:
+  ssh_trace_dump(session);
   leave_function();
   return processed;
 }
@@ -298,7 +294,7 @@ error:
 void ssh_packet_register_socket_callback(ssh_session session, ssh_socket s){
 	session->socket_callbacks.data=ssh_packet_socket_callback;
 	session->socket_callbacks.connected=NULL;
-	session->socket_callbacks.controlflow=NULL;
+	session->socket_callbacks.controlflow=ssh_sched_controlflow;
 	session->socket_callbacks.exception=NULL;
 	session->socket_callbacks.userdata=session;
 	ssh_socket_set_callbacks(s,&session->socket_callbacks);
@@ -340,7 +336,6 @@ void ssh_packet_process(ssh_session session, uint8_t type){
 	int r=SSH_PACKET_NOT_USED;
 	ssh_packet_callbacks cb;
 	enter_function();
-	ssh_log(session,SSH_LOG_PACKET, "Dispatching handler for packet type %d",type);
 	if(session->packet_callbacks == NULL){
 		ssh_log(session,SSH_LOG_RARE,"Packet callback is not initialized !");
 		goto error;
@@ -411,16 +406,12 @@ int ssh_packet_parse_type(ssh_session session) {
     return SSH_ERROR;
   }
 
-  ssh_log(session, SSH_LOG_PACKET, "Final size %d",
-      buffer_get_rest_len(session->in_buffer));
-
   if(buffer_get_u8(session->in_buffer, &session->in_packet.type) == 0) {
     ssh_set_error(session, SSH_FATAL, "Packet too short to read type");
     leave_function();
     return SSH_ERROR;
   }
 
-  ssh_log(session, SSH_LOG_PACKET, "Type %hhd", session->in_packet.type);
   session->in_packet.valid = 1;
 
   leave_function();
@@ -455,9 +446,6 @@ static int packet_send2(ssh_session session) {
 
   enter_function();
 
-  ssh_log(session, SSH_LOG_PACKET,
-      "Writing on the wire a packet having %u bytes before", currentlen);
-
 #if defined(HAVE_LIBZ) && defined(WITH_LIBZ)
   if (session->current_crypto
       && session->current_crypto->do_compress_out
@@ -481,9 +469,8 @@ static int packet_send2(ssh_session session) {
   }
 
   finallen = htonl(currentlen + padding + 1);
-  ssh_log(session, SSH_LOG_PACKET,
-      "%d bytes after comp + %d padding bytes = %lu bytes packet",
-      currentlen, padding, (long unsigned int) ntohl(finallen));
+  ssh_trace(session, SSH_TRACE_PACKET_OUT, currentlen, padding,
+      ntohl(finallen));
 
   if (buffer_prepend_data(session->out_buffer, &padding, sizeof(uint8_t)) < 0) {
     goto error;
@@ -511,6 +498,7 @@ static int packet_send2(ssh_session session) {
 
   rc = ssh_packet_write(session);
   session->send_seq++;
+  session->stats.packets_out++;
 
   if (buffer_reinit(session->out_buffer) < 0) {
     rc = SSH_ERROR;
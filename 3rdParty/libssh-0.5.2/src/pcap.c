@@ -32,6 +32,11 @@
 #include <sys/socket.h>
 #endif
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "libssh/libssh.h"
 #include "libssh/pcap.h"
@@ -110,6 +115,35 @@ struct ssh_pcap_context_struct {
 	uint32_t insequence;
 };
 
+#define PCAP_HDR_LEN 24
+
+#define IPHDR_LEN 20
+#define TCPHDR_LEN 20
+#define TCPIPHDR_LEN (IPHDR_LEN + TCPHDR_LEN)
+
+/* stdio buffer of the files, so records reach the disk in large writes
+ * rather than one or two per packet */
+#define PCAP_WRITE_BUFFER (256 * 1024)
+
+#ifdef HAVE_PTHREAD
+/** @private
+ * @brief records waiting for the writer thread of an asynchronous pcap file.
+ * Each record is stored as its length followed by its bytes, and may wrap
+ * around the end of the ring.
+ */
+struct ssh_pcap_ring_struct {
+	uint8_t *data;
+	uint32_t size;
+	uint32_t head;
+	uint32_t tail;
+	uint32_t used;
+	int stopping;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread;
+};
+#endif
+
 /** @private
  * @brief a pcap file expresses the state of a pcap file which may
  * contain several streams.
@@ -117,6 +151,17 @@ struct ssh_pcap_context_struct {
 struct ssh_pcap_file_struct {
 	FILE *output;
 	uint16_t ipsequence;
+	char *filename;
+	/* bytes written to the current file, and the size at which it is
+	 * closed and the next one started. 0 never rotates */
+	uint64_t written;
+	uint64_t rotate_size;
+	int rotation;
+	/* records thrown away because the writer thread fell behind */
+	uint64_t dropped;
+#ifdef HAVE_PTHREAD
+	struct ssh_pcap_ring_struct *ring;
+#endif
 };
 
 /**
@@ -134,81 +179,380 @@ ssh_pcap_file ssh_pcap_file_new(){
     return pcap;
 }
 
+static uint8_t *pcap_put_u8(uint8_t *p, uint8_t value){
+	*p = value;
+	return p + 1;
+}
+
+static uint8_t *pcap_put_u16(uint8_t *p, uint16_t value){
+	memcpy(p, &value, sizeof(value));
+	return p + sizeof(value);
+}
+
+static uint8_t *pcap_put_u32(uint8_t *p, uint32_t value){
+	memcpy(p, &value, sizeof(value));
+	return p + sizeof(value);
+}
+
 /** @internal
- * @brief writes a packet on file
+ * @brief writes data on the current file
  */
-static int ssh_pcap_file_write(ssh_pcap_file pcap, ssh_buffer packet){
-	int err;
-	uint32_t len;
-	if(pcap == NULL || pcap->output==NULL)
+static int ssh_pcap_file_write(ssh_pcap_file pcap, const void *data, uint32_t len){
+	if(len == 0)
+		return SSH_OK;
+	if(fwrite(data,len,1,pcap->output) != 1)
 		return SSH_ERROR;
-	len=buffer_get_rest_len(packet);
-	err=fwrite(buffer_get_rest(packet),len,1,pcap->output);
-	if(err<0)
+	pcap->written += len;
+	return SSH_OK;
+}
+
+/** @internal
+ * @brief writes the header every pcap file starts with
+ */
+static int ssh_pcap_file_write_header(ssh_pcap_file pcap){
+	uint8_t header[PCAP_HDR_LEN];
+	uint8_t *p = header;
+
+	p = pcap_put_u32(p,htonl(PCAP_MAGIC));
+	p = pcap_put_u16(p,htons(PCAP_VERSION_MAJOR));
+	p = pcap_put_u16(p,htons(PCAP_VERSION_MINOR));
+	/* currently hardcode GMT to 0 */
+	p = pcap_put_u32(p,htonl(0));
+	/* accuracy */
+	p = pcap_put_u32(p,htonl(0));
+	/* size of the biggest packet */
+	p = pcap_put_u32(p,htonl(MAX_PACKET_LEN));
+	/* we will write sort-of IP */
+	pcap_put_u32(p,htonl(DLT_RAW));
+	return ssh_pcap_file_write(pcap,header,sizeof(header));
+}
+
+/** @internal
+ * @brief closes the current file and continues in the next one, named after
+ * the opened file with the rotation number appended
+ */
+static int ssh_pcap_file_rotate(ssh_pcap_file pcap){
+	char *name;
+	size_t len;
+
+	len = strlen(pcap->filename) + 12;
+	name = malloc(len);
+	if(name == NULL)
 		return SSH_ERROR;
-	else
-		return SSH_OK;
+	pcap->rotation++;
+	snprintf(name,len,"%s.%d",pcap->filename,pcap->rotation);
+
+	fclose(pcap->output);
+	pcap->output=fopen(name,"wb");
+	SAFE_FREE(name);
+	if(pcap->output == NULL)
+		return SSH_ERROR;
+	setvbuf(pcap->output,NULL,_IOFBF,PCAP_WRITE_BUFFER);
+	pcap->written=0;
+	return ssh_pcap_file_write_header(pcap);
+}
+
+/** @internal
+ * @brief starts a new file if a record of len bytes would make the current
+ * one grow past the rotation size
+ */
+static int ssh_pcap_file_make_room(ssh_pcap_file pcap, uint32_t len){
+	if(pcap->rotate_size > 0 && pcap->written > PCAP_HDR_LEN &&
+			pcap->written + len > pcap->rotate_size)
+		return ssh_pcap_file_rotate(pcap);
+	return SSH_OK;
+}
+
+/** @internal
+ * @brief writes one record on file
+ */
+static int ssh_pcap_file_write_record(ssh_pcap_file pcap, const void *header,
+		uint32_t header_len, const void *data, uint32_t len){
+	if(ssh_pcap_file_make_room(pcap,header_len + len) < 0)
+		return SSH_ERROR;
+	if(ssh_pcap_file_write(pcap,header,header_len) < 0)
+		return SSH_ERROR;
+	return ssh_pcap_file_write(pcap,data,len);
+}
+
+#ifdef HAVE_PTHREAD
+/* copies in and out of the ring, wrapping around its end */
+static void pcap_ring_put(struct ssh_pcap_ring_struct *ring, uint32_t *pos,
+		const void *data, uint32_t len){
+	uint32_t first = ring->size - *pos;
+
+	if(first > len)
+		first = len;
+	memcpy(ring->data + *pos, data, first);
+	memcpy(ring->data, (const uint8_t *) data + first, len - first);
+	*pos = (*pos + len) % ring->size;
+}
+
+static void pcap_ring_get(struct ssh_pcap_ring_struct *ring, uint32_t *pos,
+		void *data, uint32_t len){
+	uint32_t first = ring->size - *pos;
+
+	if(first > len)
+		first = len;
+	memcpy(data, ring->data + *pos, first);
+	memcpy((uint8_t *) data + first, ring->data, len - first);
+	*pos = (*pos + len) % ring->size;
+}
+
+/* writes ring bytes on file straight from the ring */
+static int pcap_ring_write(ssh_pcap_file pcap, uint32_t *pos, uint32_t len){
+	struct ssh_pcap_ring_struct *ring = pcap->ring;
+	uint32_t first = ring->size - *pos;
+	int rc = SSH_OK;
+
+	if(first > len)
+		first = len;
+	if(ssh_pcap_file_write(pcap, ring->data + *pos, first) < 0 ||
+			ssh_pcap_file_write(pcap, ring->data, len - first) < 0)
+		rc = SSH_ERROR;
+	*pos = (*pos + len) % ring->size;
+	return rc;
 }
 
 /** @internal
- * @brief prepends a packet with the pcap header and writes packet
- * on file
+ * @brief copies a record in the ring of an asynchronous pcap file. Never
+ * waits for the writer thread: a record which does not fit is dropped.
  */
-int ssh_pcap_file_write_packet(ssh_pcap_file pcap, ssh_buffer packet, uint32_t original_len){
-	ssh_buffer header=ssh_buffer_new();
+static void ssh_pcap_ring_push(ssh_pcap_file pcap, const void *header,
+		uint32_t header_len, const void *data, uint32_t len){
+	struct ssh_pcap_ring_struct *ring = pcap->ring;
+	uint32_t reclen = header_len + len;
+
+	pthread_mutex_lock(&ring->mutex);
+	if(ring->size - ring->used < sizeof(reclen) + reclen){
+		pcap->dropped++;
+		pthread_mutex_unlock(&ring->mutex);
+		return;
+	}
+	pcap_ring_put(ring,&ring->head,&reclen,sizeof(reclen));
+	pcap_ring_put(ring,&ring->head,header,header_len);
+	pcap_ring_put(ring,&ring->head,data,len);
+	if(ring->used == 0)
+		pthread_cond_signal(&ring->cond);
+	ring->used += sizeof(reclen) + reclen;
+	pthread_mutex_unlock(&ring->mutex);
+}
+
+/** @internal
+ * @brief writer thread of an asynchronous pcap file. Takes every record
+ * queued so far at once and writes them from the ring outside of the lock:
+ * producers only append past them. Flushes the file when the ring is empty. Exits once the ring is drained after
+ * ssh_pcap_file_close().
+ */
+static void *ssh_pcap_ring_writer(void *userdata){
+	ssh_pcap_file pcap = userdata;
+	struct ssh_pcap_ring_struct *ring = pcap->ring;
+	uint32_t pos, taken, avail, reclen;
+	int err = SSH_OK;
+
+	for(;;){
+		pthread_mutex_lock(&ring->mutex);
+		while(ring->used == 0 && !ring->stopping)
+			pthread_cond_wait(&ring->cond,&ring->mutex);
+		taken = ring->used;
+		pos = ring->tail;
+		pthread_mutex_unlock(&ring->mutex);
+		if(taken == 0)
+			break;
+
+		for(avail = taken; avail > 0; ){
+			pcap_ring_get(ring,&pos,&reclen,sizeof(reclen));
+			avail -= sizeof(reclen) + reclen;
+			/* after a write error, the records are only consumed */
+			if(err == SSH_OK)
+				err = ssh_pcap_file_make_room(pcap,reclen);
+			if(err == SSH_OK)
+				err = pcap_ring_write(pcap,&pos,reclen);
+			else
+				pos = (pos + reclen) % ring->size;
+		}
+
+		pthread_mutex_lock(&ring->mutex);
+		ring->tail = pos;
+		ring->used -= taken;
+		avail = ring->used;
+		pthread_mutex_unlock(&ring->mutex);
+		if(avail == 0 && err == SSH_OK)
+			fflush(pcap->output);
+	}
+	return NULL;
+}
+#endif /* HAVE_PTHREAD */
+
+/** @internal
+ * @brief prepends a packet with the pcap header and writes it on file, or
+ * hands it to the writer thread of an asynchronous file
+ * @param header headers of the packet, preceded by PCAPREC_HDR_LEN free
+ * bytes where the record header is written
+ * @param header_len length of header, including the free bytes
+ * @param data payload following the headers
+ * @param len length of data
+ * @param original_len length of the headers and the complete payload
+ */
+int ssh_pcap_file_write_packet(ssh_pcap_file pcap, uint8_t *header,
+		uint32_t header_len, const void *data, uint32_t len, uint32_t original_len){
 	struct timeval now;
-	int err;
-	if(header == NULL)
+	uint8_t *p = header;
+
+	if(pcap == NULL || pcap->output==NULL)
 		return SSH_ERROR;
 	gettimeofday(&now,NULL);
-	buffer_add_u32(header,htonl(now.tv_sec));
-	buffer_add_u32(header,htonl(now.tv_usec));
-	buffer_add_u32(header,htonl(buffer_get_rest_len(packet)));
-	buffer_add_u32(header,htonl(original_len));
-	buffer_add_buffer(header,packet);
-	err=ssh_pcap_file_write(pcap,header);
-	ssh_buffer_free(header);
-	return err;
+	p = pcap_put_u32(p,htonl(now.tv_sec));
+	p = pcap_put_u32(p,htonl(now.tv_usec));
+	p = pcap_put_u32(p,htonl(header_len - PCAPREC_HDR_LEN + len));
+	pcap_put_u32(p,htonl(original_len));
+#ifdef HAVE_PTHREAD
+	if(pcap->ring != NULL){
+		ssh_pcap_ring_push(pcap,header,header_len,data,len);
+		return SSH_OK;
+	}
+#endif
+	return ssh_pcap_file_write_record(pcap,header,header_len,data,len);
 }
 
 /**
  * @brief opens a new pcap file and create header
  */
 int ssh_pcap_file_open(ssh_pcap_file pcap, const char *filename){
-	ssh_buffer header;
-	int err;
 	if(pcap == NULL)
 		return SSH_ERROR;
 	if(pcap->output){
-		fclose(pcap->output);
-		pcap->output=NULL;
+		ssh_pcap_file_close(pcap);
 	}
+	SAFE_FREE(pcap->filename);
+	pcap->filename=strdup(filename);
+	if(pcap->filename==NULL)
+		return SSH_ERROR;
 	pcap->output=fopen(filename,"wb");
 	if(pcap->output==NULL)
 		return SSH_ERROR;
-	header=ssh_buffer_new();
-	if(header==NULL)
+	setvbuf(pcap->output,NULL,_IOFBF,PCAP_WRITE_BUFFER);
+	pcap->written=0;
+	pcap->rotation=0;
+	return ssh_pcap_file_write_header(pcap);
+}
+
+/**
+ * @brief starts a new file whenever the current one would grow past a size
+ * @param pcap pcap file
+ * @param size size in bytes at which the file is closed and the next one
+ * started, named after the opened file with .1, .2 ... appended. 0 disables
+ * rotation, which is the default.
+ * @returns SSH_OK
+ */
+int ssh_pcap_file_set_rotation(ssh_pcap_file pcap, uint64_t size){
+	if(pcap == NULL)
 		return SSH_ERROR;
-	buffer_add_u32(header,htonl(PCAP_MAGIC));
-	buffer_add_u16(header,htons(PCAP_VERSION_MAJOR));
-	buffer_add_u16(header,htons(PCAP_VERSION_MINOR));
-	/* currently hardcode GMT to 0 */
-	buffer_add_u32(header,htonl(0));
-	/* accuracy */
-	buffer_add_u32(header,htonl(0));
-	/* size of the biggest packet */
-	buffer_add_u32(header,htonl(MAX_PACKET_LEN));
-	/* we will write sort-of IP */
-	buffer_add_u32(header,htonl(DLT_RAW));
-	err=ssh_pcap_file_write(pcap,header);
-	ssh_buffer_free(header);
-	return err;
+	pcap->rotate_size=size;
+	return SSH_OK;
+}
+
+/**
+ * @brief writes the file from a background thread
+ *
+ * Packets are then copied into a ring of ring_size bytes allocated once, and
+ * a writer thread writes them on file with large buffered writes. Capturing
+ * never waits for the disk: when the ring is full, packets are dropped and
+ * counted, see ssh_pcap_file_get_dropped(). Must be called after
+ * ssh_pcap_file_open(), ssh_pcap_file_close() writes what is left in the ring
+ * and stops the thread.
+ * @param pcap open pcap file
+ * @param ring_size size of the ring in bytes. It should hold at least a few
+ * packets of the biggest size captured.
+ * @returns SSH_ERROR if the file is not open, already asynchronous, or
+ * threads are not supported, SSH_OK otherwise.
+ */
+int ssh_pcap_file_set_async(ssh_pcap_file pcap, uint32_t ring_size){
+#ifdef HAVE_PTHREAD
+	struct ssh_pcap_ring_struct *ring;
+
+	if(pcap == NULL || pcap->output == NULL || pcap->ring != NULL || ring_size == 0)
+		return SSH_ERROR;
+	ring = malloc(sizeof(struct ssh_pcap_ring_struct));
+	if(ring == NULL)
+		return SSH_ERROR;
+	ZERO_STRUCTP(ring);
+	ring->data = malloc(ring_size);
+	if(ring->data == NULL){
+		SAFE_FREE(ring);
+		return SSH_ERROR;
+	}
+	ring->size = ring_size;
+	pthread_mutex_init(&ring->mutex,NULL);
+	pthread_cond_init(&ring->cond,NULL);
+
+	pcap->ring = ring;
+	if(pthread_create(&ring->thread,NULL,ssh_pcap_ring_writer,pcap) != 0){
+		pcap->ring = NULL;
+		pthread_cond_destroy(&ring->cond);
+		pthread_mutex_destroy(&ring->mutex);
+		SAFE_FREE(ring->data);
+		SAFE_FREE(ring);
+		return SSH_ERROR;
+	}
+	return SSH_OK;
+#else
+	(void) pcap;
+	(void) ring_size;
+	return SSH_ERROR;
+#endif
 }
 
+/**
+ * @brief number of packets dropped because the writer thread of an
+ * asynchronous pcap file could not keep up
+ */
+uint64_t ssh_pcap_file_get_dropped(ssh_pcap_file pcap){
+	uint64_t dropped;
+
+	if(pcap == NULL)
+		return 0;
+#ifdef HAVE_PTHREAD
+	if(pcap->ring != NULL){
+		pthread_mutex_lock(&pcap->ring->mutex);
+		dropped = pcap->dropped;
+		pthread_mutex_unlock(&pcap->ring->mutex);
+		return dropped;
+	}
+#endif
+	dropped = pcap->dropped;
+	return dropped;
+}
+
+#ifdef HAVE_PTHREAD
+/** @internal
+ * @brief lets the writer thread drain the ring, then frees it
+ */
+static void ssh_pcap_ring_stop(ssh_pcap_file pcap){
+	struct ssh_pcap_ring_struct *ring = pcap->ring;
+
+	pthread_mutex_lock(&ring->mutex);
+	ring->stopping = 1;
+	pthread_cond_signal(&ring->cond);
+	pthread_mutex_unlock(&ring->mutex);
+	pthread_join(ring->thread,NULL);
+
+	pcap->ring = NULL;
+	pthread_cond_destroy(&ring->cond);
+	pthread_mutex_destroy(&ring->mutex);
+	SAFE_FREE(ring->data);
+	SAFE_FREE(ring);
+}
+#endif
+
 int ssh_pcap_file_close(ssh_pcap_file pcap){
 	int err;
 	if(pcap ==NULL || pcap->output==NULL)
 		return SSH_ERROR;
+#ifdef HAVE_PTHREAD
+	if(pcap->ring != NULL)
+		ssh_pcap_ring_stop(pcap);
+#endif
 	err=fclose(pcap->output);
 	pcap->output=NULL;
 	if(err != 0)
@@ -219,10 +563,11 @@ int ssh_pcap_file_close(ssh_pcap_file pcap){
 
 void ssh_pcap_file_free(ssh_pcap_file pcap){
 	ssh_pcap_file_close(pcap);
+	if(pcap != NULL)
+		SAFE_FREE(pcap->filename);
 	SAFE_FREE(pcap);
 }
 
-
 /** @internal
  * @brief allocates a new ssh_pcap_context object
  */
@@ -285,9 +630,6 @@ static int ssh_pcap_context_connect(ssh_pcap_context ctx){
 	return SSH_OK;
 }
 
-#define IPHDR_LEN 20
-#define TCPHDR_LEN 20
-#define TCPIPHDR_LEN (IPHDR_LEN + TCPHDR_LEN)
 /** @internal
  * @brief write a SSH packet as a TCP over IP in a pcap file
  * @param ctx open pcap context
@@ -301,80 +643,73 @@ static int ssh_pcap_context_connect(ssh_pcap_context ctx){
  */
 int ssh_pcap_context_write(ssh_pcap_context ctx,enum ssh_pcap_direction direction
 		, void *data, uint32_t len, uint32_t origlen){
-	ssh_buffer ip;
-	int err;
+	uint8_t header[PCAPREC_HDR_LEN + TCPIPHDR_LEN];
+	uint8_t *p = header + PCAPREC_HDR_LEN;
 	if(ctx==NULL || ctx->file ==NULL)
 		return SSH_ERROR;
 	if(ctx->connected==0)
 		if(ssh_pcap_context_connect(ctx)==SSH_ERROR)
 			return SSH_ERROR;
-	ip=ssh_buffer_new();
-	if(ip==NULL){
-		ssh_set_error_oom(ctx->session);
-		return SSH_ERROR;
-	}
 	/* build an IP packet */
 	/* V4, 20 bytes */
-	buffer_add_u8(ip,4 << 4 | 5);
+	p = pcap_put_u8(p,4 << 4 | 5);
 	/* tos */
-	buffer_add_u8(ip,0);
+	p = pcap_put_u8(p,0);
 	/* total len */
-	buffer_add_u16(ip,htons(origlen + TCPIPHDR_LEN));
+	p = pcap_put_u16(p,htons(origlen + TCPIPHDR_LEN));
 	/* IP id number */
-	buffer_add_u16(ip,htons(ctx->file->ipsequence));
+	p = pcap_put_u16(p,htons(ctx->file->ipsequence));
 	ctx->file->ipsequence++;
 	/* fragment offset */
-	buffer_add_u16(ip,htons(0));
+	p = pcap_put_u16(p,htons(0));
 	/* TTL */
-	buffer_add_u8(ip,64);
+	p = pcap_put_u8(p,64);
 	/* protocol TCP=6 */
-	buffer_add_u8(ip,6);
+	p = pcap_put_u8(p,6);
 	/* checksum */
-	buffer_add_u16(ip,0);
+	p = pcap_put_u16(p,0);
 	if(direction==SSH_PCAP_DIR_OUT){
-		buffer_add_u32(ip,ctx->ipsource);
-		buffer_add_u32(ip,ctx->ipdest);
+		p = pcap_put_u32(p,ctx->ipsource);
+		p = pcap_put_u32(p,ctx->ipdest);
 	} else {
-		buffer_add_u32(ip,ctx->ipdest);
-		buffer_add_u32(ip,ctx->ipsource);
+		p = pcap_put_u32(p,ctx->ipdest);
+		p = pcap_put_u32(p,ctx->ipsource);
 	}
 	/* TCP */
 	if(direction==SSH_PCAP_DIR_OUT){
-		buffer_add_u16(ip,ctx->portsource);
-		buffer_add_u16(ip,ctx->portdest);
+		p = pcap_put_u16(p,ctx->portsource);
+		p = pcap_put_u16(p,ctx->portdest);
 	} else {
-		buffer_add_u16(ip,ctx->portdest);
-		buffer_add_u16(ip,ctx->portsource);
+		p = pcap_put_u16(p,ctx->portdest);
+		p = pcap_put_u16(p,ctx->portsource);
 	}
 	/* sequence number */
 	if(direction==SSH_PCAP_DIR_OUT){
-		buffer_add_u32(ip,ntohl(ctx->outsequence));
+		p = pcap_put_u32(p,ntohl(ctx->outsequence));
 		ctx->outsequence+=origlen;
 	} else {
-		buffer_add_u32(ip,ntohl(ctx->insequence));
+		p = pcap_put_u32(p,ntohl(ctx->insequence));
 		ctx->insequence+=origlen;
 	}
 	/* ack number */
 	if(direction==SSH_PCAP_DIR_OUT){
-		buffer_add_u32(ip,ntohl(ctx->insequence));
+		p = pcap_put_u32(p,ntohl(ctx->insequence));
 	} else {
-		buffer_add_u32(ip,ntohl(ctx->outsequence));
+		p = pcap_put_u32(p,ntohl(ctx->outsequence));
 	}
 	/* header len = 20 = 5 * 32 bits, at offset 4*/
-	buffer_add_u8(ip,5 << 4);
+	p = pcap_put_u8(p,5 << 4);
 	/* flags */
-	buffer_add_u8(ip,TH_PUSH | TH_ACK);
+	p = pcap_put_u8(p,TH_PUSH | TH_ACK);
 	/* window */
-	buffer_add_u16(ip,htons(65535));
+	p = pcap_put_u16(p,htons(65535));
 	/* checksum */
-	buffer_add_u16(ip,htons(0));
+	p = pcap_put_u16(p,htons(0));
 	/* urgent data ptr */
-	buffer_add_u16(ip,0);
-	/* actual data */
-	buffer_add_data(ip,data,len);
-	err=ssh_pcap_file_write_packet(ctx->file,ip,origlen + TCPIPHDR_LEN);
-	ssh_buffer_free(ip);
-	return err;
+	pcap_put_u16(p,0);
+	/* actual data follows the headers */
+	return ssh_pcap_file_write_packet(ctx->file,header,sizeof(header),
+			data,len,origlen + TCPIPHDR_LEN);
 }
 
 /** @brief sets the pcap file used to trace the session
@@ -422,6 +757,23 @@ int ssh_pcap_file_open(ssh_pcap_file pcap, const char *filename){
 	return SSH_ERROR;
 }
 
+int ssh_pcap_file_set_async(ssh_pcap_file pcap, uint32_t ring_size){
+	(void) pcap;
+	(void) ring_size;
+	return SSH_ERROR;
+}
+
+int ssh_pcap_file_set_rotation(ssh_pcap_file pcap, uint64_t size){
+	(void) pcap;
+	(void) size;
+	return SSH_ERROR;
+}
+
+uint64_t ssh_pcap_file_get_dropped(ssh_pcap_file pcap){
+	(void) pcap;
+	return 0;
+}
+
 int ssh_set_pcap_file(ssh_session session, ssh_pcap_file pcapfile){
 	(void) pcapfile;
 	ssh_set_error(session,SSH_REQUEST_DENIED,"Pcap support not compiled in");
@@ -549,6 +549,7 @@ void ssh_poll_ctx_remove(ssh_poll_ctx ctx, ssh_poll_handle p) {
   if (ctx->polls_used > 0 && ctx->polls_used != i) {
     ctx->pollfds[i] = ctx->pollfds[ctx->polls_used];
     ctx->pollptrs[i] = ctx->pollptrs[ctx->polls_used];
+    ctx->pollptrs[i]->x.idx = i;
   }
 
   /* this will always leave at least chunk_size polls allocated */
@@ -633,6 +634,296 @@ ssh_poll_ctx ssh_poll_get_default_ctx(ssh_session session){
 	return session->default_poll_ctx;
 }
 
+/**
+ * @brief An event context polls any number of sessions and file descriptors
+ * at once from a single thread.
+ */
+struct ssh_event_struct {
+    ssh_poll_ctx ctx;
+};
+
+struct ssh_event_fd_wrapper {
+    ssh_event_callback cb;
+    void *userdata;
+};
+
+static int ssh_event_fd_wrapper_callback(ssh_poll_handle p, socket_t fd,
+    int revents, void *userdata) {
+    struct ssh_event_fd_wrapper *pw = (struct ssh_event_fd_wrapper *) userdata;
+
+    (void) p;
+    if (pw->cb != NULL) {
+        return pw->cb(fd, revents, pw->userdata);
+    }
+    return 0;
+}
+
+/**
+ * @brief  Create a new event context. Sessions added to it are serviced by
+ *         ssh_event_dopoll() together with any file descriptor added with
+ *         ssh_event_add_fd().
+ *
+ * @return              The ssh_event object on success, NULL on failure.
+ */
+ssh_event ssh_event_new(void) {
+    ssh_event event;
+
+    event = malloc(sizeof(struct ssh_event_struct));
+    if (event == NULL) {
+        return NULL;
+    }
+    ZERO_STRUCTP(event);
+
+    event->ctx = ssh_poll_ctx_new(2);
+    if (event->ctx == NULL) {
+        SAFE_FREE(event);
+        return NULL;
+    }
+
+    return event;
+}
+
+/**
+ * @brief  Add a file descriptor to the event context.
+ *
+ * @param  event        The ssh_event object.
+ * @param  fd           Socket that will be polled.
+ * @param  events       Poll events that will be monitored for the socket,
+ *                      i.e. POLLIN, POLLPRI, POLLOUT.
+ * @param  cb           Function to be called if any of the events are set.
+ * @param  userdata     Userdata to be passed to the callback function. NULL if
+ *                      not needed.
+ *
+ * @returns             SSH_OK on success, SSH_ERROR on failure.
+ */
+int ssh_event_add_fd(ssh_event event, socket_t fd, short events,
+    ssh_event_callback cb, void *userdata) {
+    ssh_poll_handle p;
+    struct ssh_event_fd_wrapper *pw;
+
+    if (event == NULL || event->ctx == NULL || cb == NULL ||
+        fd == SSH_INVALID_SOCKET) {
+        return SSH_ERROR;
+    }
+
+    pw = malloc(sizeof(struct ssh_event_fd_wrapper));
+    if (pw == NULL) {
+        return SSH_ERROR;
+    }
+    pw->cb = cb;
+    pw->userdata = userdata;
+
+    p = ssh_poll_new(fd, events, ssh_event_fd_wrapper_callback, pw);
+    if (p == NULL) {
+        SAFE_FREE(pw);
+        return SSH_ERROR;
+    }
+
+    if (ssh_poll_ctx_add(event->ctx, p) < 0) {
+        SAFE_FREE(pw);
+        ssh_poll_free(p);
+        return SSH_ERROR;
+    }
+
+    return SSH_OK;
+}
+
+/**
+ * @brief  Remove a file descriptor added with ssh_event_add_fd().
+ *
+ * @param  event        The ssh_event object.
+ * @param  fd           The fd to remove.
+ *
+ * @returns             SSH_OK on success, SSH_ERROR if the fd was not found.
+ */
+int ssh_event_remove_fd(ssh_event event, socket_t fd) {
+    ssh_poll_handle p;
+    size_t i;
+
+    if (event == NULL || event->ctx == NULL) {
+        return SSH_ERROR;
+    }
+
+    for (i = 0; i < event->ctx->polls_used; i++) {
+        p = event->ctx->pollptrs[i];
+        if (event->ctx->pollfds[i].fd == fd &&
+            p->cb == ssh_event_fd_wrapper_callback) {
+            SAFE_FREE(p->cb_data);
+            ssh_poll_free(p);
+            return SSH_OK;
+        }
+    }
+
+    return SSH_ERROR;
+}
+
+/**
+ * @brief  Change the events polled for a file descriptor added with
+ *         ssh_event_add_fd(). It may be called from the callbacks run by
+ *         ssh_event_dopoll().
+ *
+ * @param  event        The ssh_event object.
+ * @param  fd           The fd to change.
+ * @param  events       Poll events that will be monitored from now on, 0 to
+ *                      keep the fd without polling it.
+ *
+ * @returns             SSH_OK on success, SSH_ERROR if the fd was not found.
+ */
+int ssh_event_set_fd_events(ssh_event event, socket_t fd, short events) {
+    ssh_poll_handle p;
+    size_t i;
+
+    if (event == NULL || event->ctx == NULL) {
+        return SSH_ERROR;
+    }
+
+    for (i = 0; i < event->ctx->polls_used; i++) {
+        p = event->ctx->pollptrs[i];
+        if (event->ctx->pollfds[i].fd == fd &&
+            p->cb == ssh_event_fd_wrapper_callback) {
+            ssh_poll_set_events(p, events);
+            return SSH_OK;
+        }
+    }
+
+    return SSH_ERROR;
+}
+
+/**
+ * @brief  Move the socket of a connected session into the event context.
+ *
+ * From then on the session's incoming packets are processed, and its
+ * callbacks called, from ssh_event_dopoll(). Any call on the session that
+ * needs to wait for the network also polls the whole event context, so the
+ * session must only be used from the thread that polls it.
+ *
+ * @param  event        The ssh_event object.
+ * @param  session      The connected session to add.
+ *
+ * @returns             SSH_OK on success, SSH_ERROR on failure.
+ */
+int ssh_event_add_session(ssh_event event, ssh_session session) {
+    ssh_poll_handle p_in, p_out;
+
+    if (event == NULL || event->ctx == NULL || session == NULL ||
+        session->socket == NULL) {
+        return SSH_ERROR;
+    }
+
+    p_in = ssh_socket_get_poll_handle_in(session->socket);
+    p_out = ssh_socket_get_poll_handle_out(session->socket);
+    if (p_in == NULL || p_out == NULL) {
+        return SSH_ERROR;
+    }
+
+    if (p_in->ctx != NULL) {
+        ssh_poll_ctx_remove(p_in->ctx, p_in);
+    }
+    if (ssh_poll_ctx_add(event->ctx, p_in) < 0) {
+        return SSH_ERROR;
+    }
+
+    if (p_out != p_in) {
+        if (p_out->ctx != NULL) {
+            ssh_poll_ctx_remove(p_out->ctx, p_out);
+        }
+        if (ssh_poll_ctx_add(event->ctx, p_out) < 0) {
+            ssh_poll_ctx_remove(event->ctx, p_in);
+            return SSH_ERROR;
+        }
+    }
+
+    return SSH_OK;
+}
+
+/**
+ * @brief  Take a session back out of the event context. It goes back to its
+ *         own poll context the next time it waits for the network.
+ *
+ * @param  event        The ssh_event object.
+ * @param  session      The session to remove.
+ *
+ * @returns             SSH_OK on success, SSH_ERROR if it was not in the
+ *                      event context.
+ */
+int ssh_event_remove_session(ssh_event event, ssh_session session) {
+    ssh_poll_handle p_in, p_out;
+    int rc = SSH_ERROR;
+
+    if (event == NULL || event->ctx == NULL || session == NULL ||
+        session->socket == NULL) {
+        return SSH_ERROR;
+    }
+
+    p_in = ssh_socket_get_poll_handle_in(session->socket);
+    p_out = ssh_socket_get_poll_handle_out(session->socket);
+
+    if (p_in != NULL && p_in->ctx == event->ctx) {
+        ssh_poll_ctx_remove(event->ctx, p_in);
+        rc = SSH_OK;
+    }
+    if (p_out != NULL && p_out != p_in && p_out->ctx == event->ctx) {
+        ssh_poll_ctx_remove(event->ctx, p_out);
+        rc = SSH_OK;
+    }
+
+    return rc;
+}
+
+/**
+ * @brief  Poll all the sessions and file descriptors of the event context
+ *         and call their callbacks.
+ *
+ * @param  event        The ssh_event object.
+ * @param  timeout      Upper limit in milliseconds, negative to wait forever.
+ *
+ * @returns             SSH_OK on success, SSH_AGAIN on timeout, SSH_ERROR on
+ *                      failure.
+ */
+int ssh_event_dopoll(ssh_event event, int timeout) {
+    int rc;
+
+    if (event == NULL || event->ctx == NULL) {
+        return SSH_ERROR;
+    }
+
+    rc = ssh_poll_ctx_dopoll(event->ctx, timeout);
+    if (rc == SSH_AGAIN || rc == SSH_ERROR) {
+        return rc;
+    }
+    return SSH_OK;
+}
+
+/**
+ * @brief  Free an event context. File descriptors added with
+ *         ssh_event_add_fd() are released; sessions still in it go back to
+ *         their own poll context.
+ *
+ * @param  event        The ssh_event object to free.
+ */
+void ssh_event_free(ssh_event event) {
+    ssh_poll_handle p;
+
+    if (event == NULL) {
+        return;
+    }
+
+    if (event->ctx != NULL) {
+        while (event->ctx->polls_used > 0) {
+            p = event->ctx->pollptrs[0];
+            if (p->cb == ssh_event_fd_wrapper_callback) {
+                SAFE_FREE(p->cb_data);
+                ssh_poll_free(p);
+            } else {
+                ssh_poll_ctx_remove(event->ctx, p);
+            }
+        }
+        ssh_poll_ctx_free(event->ctx);
+    }
+
+    SAFE_FREE(event);
+}
+
 /** @} */
 
 /* vim: set ts=4 sw=4 et cindent: */
@@ -0,0 +1,259 @@
+/*
+ * scheduler.c - outgoing channel data scheduling
+ *
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+/*
+ * Packets are numbered and encrypted as they are handed to the socket, so
+ * they can only be reordered before that. Every channel keeps its bulk data
+ * messages in a queue of its own, and the queues are drained into the socket
+ * with deficit round robin, only while little is buffered there. Keystrokes,
+ * window adjusts and other small packets are sent right away and so only
+ * wait behind that little, not behind a whole upload.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
+
+#include "libssh/priv.h"
+#include "libssh/buffer.h"
+#include "libssh/callbacks.h"
+#include "libssh/channels.h"
+#include "libssh/misc.h"
+#include "libssh/packet.h"
+#include "libssh/session.h"
+#include "libssh/socket.h"
+#include "libssh/scheduler.h"
+
+/* length of the message at the head of a queue, 0 if it is empty */
+static uint32_t queue_head(ssh_buffer queue) {
+  uint32_t len;
+
+  if (queue == NULL || buffer_get_rest_len(queue) < sizeof(uint32_t)) {
+    return 0;
+  }
+  memcpy(&len, buffer_get_rest(queue), sizeof(uint32_t));
+  return ntohl(len);
+}
+
+/* sends the message at the head of the queue of a channel */
+static int send_head(ssh_channel channel, uint32_t len) {
+  ssh_session session = channel->session;
+  ssh_buffer queue = channel->send_queue;
+  int full = buffer_get_rest_len(queue) >= SSH_SCHED_QUEUE_MAX;
+  int rc;
+
+  buffer_pass_bytes(queue, sizeof(uint32_t));
+  if (buffer_add_data(session->out_buffer, buffer_get_rest(queue), len) < 0) {
+    ssh_set_error_oom(session);
+    return SSH_ERROR;
+  }
+  buffer_pass_bytes(queue, len);
+  session->sched_queued -= len;
+  if (buffer_get_rest_len(queue) == 0) {
+    buffer_reinit(queue);
+  }
+
+  rc = packet_send(session);
+  if (rc == SSH_ERROR) {
+    return SSH_ERROR;
+  }
+  /* nonblocking writes stopped at the limit */
+  if (full && buffer_get_rest_len(queue) < SSH_SCHED_QUEUE_MAX) {
+    ssh_channel_write_wontblock(channel);
+  }
+  return SSH_OK;
+}
+
+/* the channel after the last one served with data queued, round robin */
+static ssh_channel next_channel(ssh_session session) {
+  struct ssh_iterator *start = NULL;
+  struct ssh_iterator *it;
+  ssh_channel channel;
+
+  if (session->sched_last != NULL) {
+    start = ssh_list_find(session->channels, session->sched_last);
+    if (start != NULL) {
+      start = start->next;
+    }
+  }
+  if (start == NULL) {
+    start = ssh_list_get_iterator(session->channels);
+  }
+
+  it = start;
+  while (it != NULL) {
+    channel = ssh_iterator_value(ssh_channel, it);
+    if (queue_head(channel->send_queue) > 0) {
+      return channel;
+    }
+    it = it->next;
+    if (it == NULL) {
+      it = ssh_list_get_iterator(session->channels);
+    }
+    if (it == start) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+/** @internal
+ * @brief Sends or queues the channel data message in the output buffer.
+ *
+ * @param[in]  channel  The channel the message is for.
+ *
+ * @param[in]  len      The payload bytes the message carries.
+ *
+ * @returns             SSH_OK or SSH_ERROR.
+ */
+int ssh_sched_send(ssh_channel channel, uint32_t len) {
+  ssh_session session = channel->session;
+  uint32_t size;
+
+  /* small writes overtake bulk data unless their own channel has some queued */
+  if (len <= SSH_SCHED_INTERACTIVE && queue_head(channel->send_queue) == 0) {
+    return packet_send(session) == SSH_ERROR ? SSH_ERROR : SSH_OK;
+  }
+
+  if (channel->send_queue == NULL) {
+    channel->send_queue = ssh_buffer_new();
+    if (channel->send_queue == NULL) {
+      ssh_set_error_oom(session);
+      return SSH_ERROR;
+    }
+  }
+
+  size = buffer_get_rest_len(session->out_buffer);
+  if (buffer_add_u32(channel->send_queue, htonl(size)) < 0 ||
+      buffer_add_data(channel->send_queue,
+        buffer_get_rest(session->out_buffer), size) < 0) {
+    ssh_set_error_oom(session);
+    return SSH_ERROR;
+  }
+  session->sched_queued += size;
+  buffer_reinit(session->out_buffer);
+
+  return ssh_sched_pump(session);
+}
+
+/** @internal
+ * @brief Moves queued data to the socket while it has room for it.
+ *
+ * Each channel with data queued in turn may send a quantum of bytes, plus
+ * what it could not send the last time because its next message was bigger
+ * than that.
+ *
+ * @returns             SSH_OK or SSH_ERROR.
+ */
+int ssh_sched_pump(ssh_session session) {
+  ssh_channel channel;
+  uint32_t len;
+
+  while (session->sched_queued > 0 &&
+      ssh_socket_buffered_write_bytes(session->socket) < SSH_SCHED_LOW_WATER) {
+    channel = next_channel(session);
+    if (channel == NULL) {
+      break;
+    }
+
+    channel->send_deficit += SSH_SCHED_QUANTUM;
+    for (len = queue_head(channel->send_queue);
+        len > 0 && len <= channel->send_deficit;
+        len = queue_head(channel->send_queue)) {
+      if (send_head(channel, len) == SSH_ERROR) {
+        return SSH_ERROR;
+      }
+      channel->send_deficit -= len;
+    }
+    /* an idle channel saves no credit for later */
+    if (len == 0) {
+      channel->send_deficit = 0;
+    }
+    session->sched_last = channel;
+  }
+
+  return SSH_OK;
+}
+
+/** @internal
+ * @brief Sends everything queued on a channel, so that a message the channel
+ * sends next goes after its data.
+ *
+ * @returns             SSH_OK or SSH_ERROR.
+ */
+int ssh_sched_flush_channel(ssh_channel channel) {
+  uint32_t len;
+
+  for (len = queue_head(channel->send_queue); len > 0;
+      len = queue_head(channel->send_queue)) {
+    if (send_head(channel, len) == SSH_ERROR) {
+      return SSH_ERROR;
+    }
+  }
+  channel->send_deficit = 0;
+
+  return SSH_OK;
+}
+
+/** @internal
+ * @brief Returns the bytes queued on a channel.
+ */
+uint32_t ssh_sched_queued(ssh_channel channel) {
+  if (channel->send_queue == NULL) {
+    return 0;
+  }
+  return buffer_get_rest_len(channel->send_queue);
+}
+
+/** @internal
+ * @brief Drops the queue of a channel that is being freed.
+ */
+void ssh_sched_channel_free(ssh_channel channel) {
+  ssh_session session = channel->session;
+  uint32_t len;
+
+  for (len = queue_head(channel->send_queue); len > 0;
+      len = queue_head(channel->send_queue)) {
+    buffer_pass_bytes(channel->send_queue, sizeof(uint32_t) + len);
+    session->sched_queued -= len;
+  }
+  ssh_buffer_free(channel->send_queue);
+  channel->send_queue = NULL;
+
+  if (session->sched_last == channel) {
+    session->sched_last = NULL;
+  }
+}
+
+/** @internal
+ * @brief Socket callback refilling the socket once it has written data.
+ */
+void ssh_sched_controlflow(int code, void *userdata) {
+  ssh_session session = (ssh_session) userdata;
+
+  if (code == SSH_SOCKET_FLOW_WRITEWONTBLOCK) {
+    ssh_sched_pump(session);
+  }
+}
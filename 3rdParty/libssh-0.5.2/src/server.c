@@ -57,6 +57,7 @@
 #include "libssh/keys.h"
 #include "libssh/dh.h"
 #include "libssh/messages.h"
+#include "libssh/scheduler.h"
 
 #define set_status(session, status) do {\
         if (session->callbacks && session->callbacks->connect_status_function) \
@@ -85,7 +86,7 @@ extern char *supported_methods[];
 static int server_set_kex(ssh_session session) {
   KEX *server = &session->server_kex;
   int i, j;
-  char *wanted;
+  const char *wanted;
 
   ZERO_STRUCTP(server);
   ssh_get_random(server->cookie, 16, 0);
@@ -112,6 +113,10 @@ static int server_set_kex(ssh_session session) {
   for (i = 0; i < 10; i++) {
     if ((wanted = session->wanted_methods[i]) == NULL) {
       wanted = supported_methods[i];
+      /* the ECDH methods are only implemented on the client side */
+      if (i == SSH_KEX) {
+        wanted = "diffie-hellman-group1-sha1";
+      }
     }
     server->methods[i] = strdup(wanted);
     if (server->methods[i] == NULL) {
@@ -465,6 +470,7 @@ int ssh_handle_key_exchange(ssh_session session) {
     ssh_socket_set_callbacks(session->socket,&session->socket_callbacks);
     session->socket_callbacks.data=callback_receive_banner;
     session->socket_callbacks.exception=ssh_socket_exception_callback;
+    session->socket_callbacks.controlflow=ssh_sched_controlflow;
     session->socket_callbacks.userdata=session;
 
     rc = server_set_kex(session);
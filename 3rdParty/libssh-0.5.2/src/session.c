@@ -35,6 +35,7 @@
 #include "libssh/misc.h"
 #include "libssh/buffer.h"
 #include "libssh/poll.h"
+#include "libssh/kex.h"
 
 #define FIRST_CHANNEL 42 // why not ? it helps to find bugs.
 
@@ -173,6 +174,7 @@ void ssh_free(ssh_session session) {
   	session->pcap_ctx=NULL;
   }
 #endif
+  ssh_trace_free(session);
   ssh_buffer_free(session->in_buffer);
   ssh_buffer_free(session->out_buffer);
   if(session->in_hashbuf != NULL)
@@ -321,7 +323,8 @@ int ssh_blocking_flush(ssh_session session, int timeout){
 	enter_function();
 	s=session->socket;
 	ssh_timestamp_init(&ts);
-	while (ssh_socket_buffered_write_bytes(s) > 0 && session->alive) {
+	while ((ssh_socket_buffered_write_bytes(s) > 0 || session->sched_queued > 0)
+	    && session->alive) {
 		rc=ssh_handle_packets(session, timeout);
 		if(ssh_timeout_elapsed(&ts,timeout)){
 		  rc=SSH_AGAIN;
@@ -540,6 +543,179 @@ int ssh_get_status(ssh_session session) {
   return r;
 }
 
+/**
+ * @brief Get the time spent in the connection phases of the last connect.
+ *
+ * @param[in]  session  The ssh session to use.
+ *
+ * @param[out] dns_usec Time spent resolving the host name, in microseconds.
+ *                      May be NULL.
+ *
+ * @param[out] tcp_usec Time spent until the TCP connection was established,
+ *                      in microseconds. May be NULL.
+ *
+ * @return              The number of connection attempts made, < 0 on error.
+ */
+int ssh_get_connect_timing(ssh_session session, long *dns_usec,
+    long *tcp_usec) {
+  if (session == NULL) {
+    return SSH_ERROR;
+  }
+
+  if (dns_usec != NULL) {
+    *dns_usec = session->connect_timing.dns;
+  }
+  if (tcp_usec != NULL) {
+    *tcp_usec = session->connect_timing.tcp;
+  }
+
+  return session->connect_timing.attempts;
+}
+
+/**
+ * @brief Get the time spent in the SSH handshake of the last connect.
+ *
+ * These are wall clock times and follow the phases reported by
+ * ssh_get_connect_timing().
+ *
+ * @param[in]  session  The ssh session to use.
+ *
+ * @param[out] banner_usec Time from the socket connection until the server
+ *                      banner was received, in microseconds. May be NULL.
+ *
+ * @param[out] kex_usec Time from the server banner until the first key
+ *                      exchange completed, in microseconds. This includes
+ *                      the round trips as well as the CPU time returned by
+ *                      ssh_get_kex_cpu_time(). May be NULL.
+ *
+ * @return              SSH_OK on success, SSH_ERROR on error.
+ */
+int ssh_get_handshake_timing(ssh_session session, long *banner_usec,
+    long *kex_usec) {
+  if (session == NULL) {
+    return SSH_ERROR;
+  }
+
+  if (banner_usec != NULL) {
+    *banner_usec = session->connect_timing.banner;
+  }
+  if (kex_usec != NULL) {
+    *kex_usec = session->connect_timing.kex;
+  }
+
+  return SSH_OK;
+}
+
+/**
+ * @brief Get the CPU time spent in the key exchange of the last connect.
+ *
+ * This covers the ephemeral keypair generation (unless it was taken from
+ * the pool filled by ssh_kex_precompute()), the shared secret, the key
+ * derivation and the verification of the server signature.
+ *
+ * @param[in]  session  The ssh session to use.
+ *
+ * @param[out] algorithm Set to the name of the key exchange method used, or
+ *                      NULL if none was negotiated. May be NULL.
+ *
+ * @return              The CPU time in microseconds, < 0 on error.
+ */
+long ssh_get_kex_cpu_time(ssh_session session, const char **algorithm) {
+  if (session == NULL) {
+    return SSH_ERROR;
+  }
+
+  if (algorithm != NULL) {
+    *algorithm = ssh_kex_type_name(session->connect_timing.kex_type);
+  }
+
+  return session->connect_timing.kex_cpu;
+}
+
+/**
+ * @internal
+ *
+ * @brief Fold a round trip time measurement into the smoothed RTT, as TCP
+ * does (RFC 6298).
+ */
+void ssh_stats_rtt_sample(ssh_session session, long usec) {
+  if (usec <= 0) {
+    return;
+  }
+
+  if (session->stats.rtt_samples == 0) {
+    session->stats.srtt_us = usec;
+  } else {
+    session->stats.srtt_us += (usec - session->stats.srtt_us) / 8;
+  }
+  session->stats.rtt_samples++;
+}
+
+/**
+ * @internal
+ *
+ * @brief Note that a packet the server answers right away was just sent.
+ * Only the first of several outstanding requests is timed.
+ */
+void ssh_stats_rtt_start(ssh_session session) {
+  if (session->rtt_probe_ns == 0) {
+    session->rtt_probe_ns = ssh_clock_ns();
+  }
+}
+
+/**
+ * @internal
+ *
+ * @brief Note that the answer to the timed request arrived.
+ */
+void ssh_stats_rtt_end(ssh_session session) {
+  if (session->rtt_probe_ns != 0) {
+    ssh_stats_rtt_sample(session,
+        (long) ((ssh_clock_ns() - session->rtt_probe_ns) / 1000));
+    session->rtt_probe_ns = 0;
+  }
+}
+
+/**
+ * @brief Get the counters of a session.
+ *
+ * The counters are updated by the thread using the session without any
+ * locking and are reset by ssh_connect(). Call this from the thread using
+ * the session to get a consistent snapshot.
+ *
+ * @param[in]  session  The ssh session to use.
+ *
+ * @param[out] stats    Filled with the counters.
+ *
+ * @return              SSH_OK on success, SSH_ERROR on error.
+ */
+int ssh_get_session_stats(ssh_session session, struct ssh_session_stats *stats) {
+  uint32_t in_bytes = 0;
+  uint32_t out_bytes = 0;
+  uint32_t reallocs = 0;
+
+  if (session == NULL || stats == NULL) {
+    return SSH_ERROR;
+  }
+
+  *stats = session->stats;
+  if (session->socket != NULL) {
+    ssh_socket_get_buffer_stats(session->socket, &in_bytes, &out_bytes,
+        &reallocs);
+  }
+  stats->in_queue = in_bytes;
+  stats->out_queue = out_bytes;
+  stats->buffer_reallocs = reallocs;
+  if (session->in_buffer != NULL) {
+    stats->buffer_reallocs += session->in_buffer->reallocs;
+  }
+  if (session->out_buffer != NULL) {
+    stats->buffer_reallocs += session->out_buffer->reallocs;
+  }
+
+  return SSH_OK;
+}
+
 /**
  * @brief Get the disconnect message from the server.
  *
@@ -643,6 +819,7 @@ void ssh_socket_exception_callback(int code, int errno_code, void *user){
     ssh_log(session,SSH_LOG_RARE,"Socket exception callback: %d (%d)",code, errno_code);
     session->session_state=SSH_SESSION_STATE_ERROR;
     ssh_set_error(session,SSH_FATAL,"Socket error: %s",strerror(errno_code));
+    ssh_trace_dump(session);
     session->ssh_connection_callback(session);
     leave_function();
 }
@@ -44,6 +44,8 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #endif /* _WIN32 */
 
 #include "libssh/priv.h"
@@ -52,6 +54,7 @@
 #include "libssh/buffer.h"
 #include "libssh/poll.h"
 #include "libssh/session.h"
+#include "libssh/scheduler.h"
 
 /**
  * @internal
@@ -314,8 +317,9 @@ int ssh_socket_pollcallback(struct ssh_poll_handle_struct *p, socket_t fd, int r
 		/* If buffered data is pending, write it */
 		if(buffer_get_rest_len(s->out_buffer) > 0){
 		  ssh_socket_nonblocking_flush(s);
-		} else if(s->callbacks && s->callbacks->controlflow){
-			/* Otherwise advertise the upper level that write can be done */
+		}
+		/* Then advertise the upper level that it may write more */
+		if(ssh_socket_is_open(s) && s->callbacks && s->callbacks->controlflow){
 			s->callbacks->controlflow(SSH_SOCKET_FLOW_WRITEWONTBLOCK,s->callbacks->userdata);
 		}
 			/* TODO: Find a way to put back POLLOUT when buffering occurs */
@@ -496,6 +500,10 @@ static int ssh_socket_unbuffered_read(ssh_socket s, void *buffer, uint32_t len)
     rc = recv(s->fd_in,buffer, len, 0);
   else
     rc = read(s->fd_in,buffer, len);
+  s->session->stats.read_calls++;
+  if (rc > 0) {
+    s->session->stats.bytes_in += rc;
+  }
 #ifdef _WIN32
   s->last_errno = WSAGetLastError();
 #else
@@ -524,6 +532,10 @@ static int ssh_socket_unbuffered_write(ssh_socket s, const void *buffer,
     w = send(s->fd_out,buffer, len, 0);
   else
     w = write(s->fd_out, buffer, len);
+  s->session->stats.write_calls++;
+  if (w > 0) {
+    s->session->stats.bytes_out += w;
+  }
 #ifdef _WIN32
   s->last_errno = WSAGetLastError();
 #else
@@ -532,7 +544,8 @@ static int ssh_socket_unbuffered_write(ssh_socket s, const void *buffer,
   s->write_wontblock = 0;
   /* Reactive the POLLOUT detector in the poll multiplexer system */
   if(s->poll_out){
-  	ssh_log(s->session, SSH_LOG_PACKET, "Enabling POLLOUT for socket");
+  	ssh_trace(s->session, SSH_TRACE_SOCKET_POLLOUT,
+  	    buffer_get_rest_len(s->out_buffer), 0, 0);
   	ssh_poll_set_events(s->poll_out,ssh_poll_get_events(s->poll_out) | POLLOUT);
   }
   if (w < 0) {
@@ -687,6 +700,17 @@ int ssh_socket_buffered_write_bytes(ssh_socket s){
 }
 
 
+/** \internal
+ * \brief reports the bytes held in the socket buffers and how often the
+ * buffers grew
+ */
+void ssh_socket_get_buffer_stats(ssh_socket s, uint32_t *in_bytes,
+    uint32_t *out_bytes, uint32_t *reallocs) {
+  *in_bytes = buffer_get_rest_len(s->in_buffer);
+  *out_bytes = buffer_get_rest_len(s->out_buffer);
+  *reallocs = s->in_buffer->reallocs + s->out_buffer->reallocs;
+}
+
 int ssh_socket_get_status(ssh_socket s) {
   int r = 0;
 
@@ -710,25 +734,50 @@ int ssh_socket_get_status(ssh_socket s) {
  * @param host hostname or ip address to connect to.
  * @param port port number to connect to.
  * @param bind_addr address to bind to, or NULL for default.
+ * In blocking mode every address of the host is raced (see
+ * ssh_connect_ai_race()) and the call returns once one of them connected.
  * @returns SSH_OK socket is being connected.
  * @returns SSH_ERROR error while connecting to remote host.
- * @bug It only tries connecting to one of the available AI's
- * which is problematic for hosts having DNS fail-over.
+ * @bug In nonblocking mode it only tries connecting to one of the
+ * available AI's which is problematic for hosts having DNS fail-over.
  */
 
 int ssh_socket_connect(ssh_socket s, const char *host, int port, const char *bind_addr){
 	socket_t fd;
 	ssh_session session=s->session;
+	int nodelay;
+#ifdef TCP_NOTSENT_LOWAT
+	int lowat;
+#endif
 	enter_function();
 	if(s->state != SSH_SOCKET_NONE) {
 		ssh_set_error(s->session, SSH_FATAL,
 				"ssh_socket_connect called on socket not unconnected");
 		return SSH_ERROR;
 	}
-	fd=ssh_connect_host_nonblocking(s->session,host,bind_addr,port);
+	if(ssh_is_blocking(session)){
+		long timeout = session->timeout;
+		if (session->timeout == 0 && session->timeout_usec == 0)
+			timeout = 10; /* same default as ssh_connect() */
+		fd=ssh_connect_host(session,host,bind_addr,port,timeout,
+				session->timeout_usec);
+	} else {
+		fd=ssh_connect_host_nonblocking(s->session,host,bind_addr,port);
+	}
 	ssh_log(session,SSH_LOG_PROTOCOL,"Nonblocking connection socket: %d",fd);
 	if(fd == SSH_INVALID_SOCKET)
 		return SSH_ERROR;
+	/* keystrokes leave at once instead of waiting for the ACK of bulk data */
+	nodelay = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &nodelay,
+	    sizeof(nodelay));
+#ifdef TCP_NOTSENT_LOWAT
+	/* POLLOUT only once the kernel has sent most of what it holds, so that
+	 * the packets the scheduler lets overtake do not queue behind it there */
+	lowat = SSH_SCHED_LOW_WATER;
+	setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (void *) &lowat,
+	    sizeof(lowat));
+#endif
 	ssh_socket_set_fd(s,fd);
 	s->state=SSH_SOCKET_CONNECTING;
 	/* POLLOUT is the event to wait for in a nonblocking connect */
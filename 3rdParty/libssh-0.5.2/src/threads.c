@@ -157,6 +157,30 @@ void ssh_threads_finalize(void){
 #endif
 }
 
+/** @internal
+ * @brief mutex helpers for libssh's own global state. They go through the
+ * user callbacks, so they only lock once threading has been set up with
+ * ssh_threads_set_callbacks() before ssh_init(). ssh_init() may run more
+ * than once, so an already created mutex is kept.
+ */
+int ssh_mutex_init(void **lock){
+	if(*lock != NULL)
+		return 0;
+	return user_callbacks->mutex_init(lock);
+}
+
+int ssh_mutex_destroy(void **lock){
+	return user_callbacks->mutex_destroy(lock);
+}
+
+int ssh_mutex_lock(void **lock){
+	return user_callbacks->mutex_lock(lock);
+}
+
+int ssh_mutex_unlock(void **lock){
+	return user_callbacks->mutex_unlock(lock);
+}
+
 int ssh_threads_set_callbacks(struct ssh_threads_callbacks_struct *cb){
   user_callbacks=cb;
   return SSH_OK;
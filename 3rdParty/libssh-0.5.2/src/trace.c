@@ -0,0 +1,195 @@
+/*
+ * trace.c - binary event tracing
+ *
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libssh/priv.h"
+#include "libssh/session.h"
+#include "libssh/misc.h"
+#include "libssh/trace.h"
+
+/* largest ring ssh_trace_set_size() accepts, in events */
+#define SSH_TRACE_MAX_SIZE (1 << 20)
+
+/* log messages of the events, in the order of enum ssh_trace_event_e */
+static const char *ssh_trace_formats[SSH_TRACE_MAX] = {
+  "None",
+  "Read a %u bytes packet, %u bytes padding, type %u",
+  "Processing %u bytes left in socket buffer",
+  "Wrote a %u bytes payload + %u padding bytes = %u bytes packet",
+  "Enabling POLLOUT for socket, %u bytes pending",
+  "Channel %u receiving %u bytes data in %u",
+  "Channel %u windows are now (local win=%u remote win=%u)",
+  "Channel %u remote window grew by %u bytes to %u",
+  "Growing window of channel %u to %u bytes",
+  "Channel %u writing %u bytes (remote win=%u)",
+  "Channel %u waiting for a growing window (remote win=%u)",
+  "Channel %u read (%u) buffered : %u bytes"
+};
+
+/**
+ * @internal
+ *
+ * @brief Allocate the trace ring of a session, or free it.
+ *
+ * @param[in]  session  The session to trace.
+ *
+ * @param[in]  size     The number of events to keep, rounded up to a power
+ *                      of two. 0 disables tracing.
+ *
+ * @return              0 on success, < 0 on error.
+ */
+int ssh_trace_set_size(ssh_session session, uint32_t size) {
+  struct ssh_trace_event *events;
+  uint32_t n = 1;
+
+  ssh_trace_free(session);
+  if (size == 0) {
+    return 0;
+  }
+  if (size > SSH_TRACE_MAX_SIZE) {
+    return -1;
+  }
+
+  while (n < size) {
+    n <<= 1;
+  }
+  events = calloc(n, sizeof(struct ssh_trace_event));
+  if (events == NULL) {
+    return -1;
+  }
+
+  session->trace.events = events;
+  session->trace.mask = n - 1;
+  session->trace.head = 0;
+  return 0;
+}
+
+void ssh_trace_free(ssh_session session) {
+  SAFE_FREE(session->trace.events);
+  session->trace.mask = 0;
+  session->trace.head = 0;
+}
+
+static void ssh_trace_format(char *buffer, size_t len, uint32_t id,
+    const uint32_t *args) {
+  if (id >= SSH_TRACE_MAX) {
+    snprintf(buffer, len, "Unknown event %u (%u, %u, %u)",
+        id, args[0], args[1], args[2]);
+    return;
+  }
+  snprintf(buffer, len, ssh_trace_formats[id], args[0], args[1], args[2]);
+}
+
+/**
+ * @internal
+ *
+ * @brief Record an event in the trace ring of the session.
+ *
+ * Recording costs a clock read and a few stores. The event is also written to
+ * the log when the session verbosity is SSH_LOG_PACKET or higher; use the
+ * ssh_trace() macro so the arguments are not computed when neither is on.
+ */
+void ssh_trace_event(ssh_session session, int id, uint32_t a, uint32_t b,
+    uint32_t c) {
+  struct ssh_trace_event *ev;
+
+  if (session->trace.events != NULL) {
+    ev = &session->trace.events[session->trace.head & session->trace.mask];
+    ev->ns = ssh_clock_ns();
+    ev->id = id;
+    ev->args[0] = a;
+    ev->args[1] = b;
+    ev->args[2] = c;
+    session->trace.head++;
+  }
+
+  if (session->log_verbosity >= SSH_LOG_PACKET) {
+    char buffer[128];
+    uint32_t args[3];
+
+    args[0] = a;
+    args[1] = b;
+    args[2] = c;
+    ssh_trace_format(buffer, sizeof(buffer), id, args);
+    ssh_log_line(session, SSH_LOG_PACKET, buffer);
+  }
+}
+
+/**
+ * @addtogroup libssh_log
+ *
+ * @{
+ */
+
+/**
+ * @brief Write the events recorded in the trace ring to the log.
+ *
+ * The events are written oldest first with the time elapsed since the first
+ * one, at the SSH_LOG_RARE priority whatever the log verbosity of the
+ * session, and the ring is emptied.
+ * libssh dumps the ring itself when the connection fails.
+ *
+ * Call it from the thread using the session.
+ *
+ * @param[in]  session  The SSH session, whose ring was enabled with the
+ *                      SSH_OPTIONS_TRACE_SIZE option.
+ *
+ * @see ssh_options_set()
+ */
+void ssh_trace_dump(ssh_session session) {
+  struct ssh_trace_event *ev;
+  uint32_t size;
+  uint32_t first;
+  uint32_t i;
+  uint64_t start;
+  char event[128];
+  char buffer[160];
+
+  if (session == NULL || session->trace.events == NULL ||
+      session->trace.head == 0) {
+    return;
+  }
+
+  size = session->trace.mask + 1;
+  first = session->trace.head > size ? session->trace.head - size : 0;
+  start = session->trace.events[first & session->trace.mask].ns;
+
+  snprintf(buffer, sizeof(buffer), "Trace of %u event(s), %u overwritten",
+      session->trace.head - first, first);
+  ssh_log_line(session, SSH_LOG_RARE, buffer);
+
+  for (i = first; i != session->trace.head; i++) {
+    ev = &session->trace.events[i & session->trace.mask];
+    ssh_trace_format(event, sizeof(event), ev->id, ev->args);
+    snprintf(buffer, sizeof(buffer), "[trace] +%lu us %s",
+        (unsigned long) ((ev->ns - start) / 1000), event);
+    ssh_log_line(session, SSH_LOG_RARE, buffer);
+  }
+
+  session->trace.head = 0;
+}
+
+/** @} */
+
+/* vim: set ts=4 sw=4 et cindent: */
@@ -93,6 +93,9 @@ struct ssh_crypto_struct *crypto_new(void) {
     return NULL;
   }
   ZERO_STRUCTP(crypto);
+  /* until a key exchange method has been negotiated */
+  crypto->kex_type = SSH_KEX_DH_GROUP1_SHA1;
+  crypto->digest_len = SHA_DIGEST_LEN;
   return crypto;
 }
 
@@ -111,6 +114,13 @@ void crypto_free(struct ssh_crypto_struct *crypto){
   bignum_free(crypto->x);
   bignum_free(crypto->y);
   bignum_free(crypto->k);
+#ifdef HAVE_ECDH
+  if (crypto->ecdh_privkey != NULL) {
+    EC_KEY_free(crypto->ecdh_privkey);
+  }
+#endif
+  ssh_string_free(crypto->ecdh_client_pubkey);
+  ssh_string_free(crypto->ecdh_server_pubkey);
   /* lot of other things */
 
 #ifdef WITH_LIBZ
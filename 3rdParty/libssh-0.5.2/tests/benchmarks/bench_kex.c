@@ -0,0 +1,65 @@
+/*
+ * This file is part of the SSH Library
+ *
+ * The SSH Library is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at your
+ * option) any later version.
+ *
+ * The SSH Library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the SSH Library; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+ * MA 02111-1307, USA.
+ */
+
+#include "benchmarks.h"
+#include <stdio.h>
+
+static const char *kex_methods[] = {
+  "curve25519-sha256@libssh.org",
+  "ecdh-sha2-nistp256",
+  "diffie-hellman-group1-sha1",
+  NULL
+};
+
+/** @internal
+ * @brief Connects once with each key exchange method and prints the CPU
+ * time the client spent in the handshake. Methods the server or this
+ * build do not support are skipped.
+ * @param[in] host host to connect to
+ * @param[in] args benchmark arguments
+ * @returns 0 if at least one method succeeded, -1 otherwise
+ */
+int benchmarks_kex (const char *host, struct argument_s *args){
+  ssh_session session;
+  const char *algorithm;
+  long cpu;
+  int i;
+  int ok=0;
+
+  for(i=0; kex_methods[i] != NULL; ++i){
+    session=ssh_new();
+    if(session == NULL)
+      return -1;
+    ssh_options_set(session, SSH_OPTIONS_HOST, host);
+    ssh_options_set(session, SSH_OPTIONS_LOG_VERBOSITY, &args->verbose);
+    if(ssh_options_set(session, SSH_OPTIONS_KEY_EXCHANGE, kex_methods[i]) < 0 ||
+        ssh_connect(session) == SSH_ERROR){
+      if(args->verbose > 0)
+        fprintf(stderr,"%s : %s\n", kex_methods[i], ssh_get_error(session));
+      ssh_free(session);
+      continue;
+    }
+    cpu=ssh_get_kex_cpu_time(session, &algorithm);
+    fprintf(stdout, "%s : %s : %ld us CPU\n", host, algorithm, cpu);
+    ssh_disconnect(session);
+    ssh_free(session);
+    ok=1;
+  }
+  return ok ? 0 : -1;
+}
@@ -29,7 +29,8 @@
 
 const char *libssh_benchmarks_names[]={
     "null",
-    "benchmark_raw_upload"
+    "benchmark_raw_upload",
+    "benchmark_kex"
 };
 
 #ifdef HAVE_ARGP_H
@@ -62,6 +63,14 @@ static struct argp_option options[] = {
     .doc   = "Upload raw data using channel",
     .group = 0
   },
+  {
+    .name  = "kex",
+    .key   = '2',
+    .arg   = NULL,
+    .flags = 0,
+    .doc   = "CPU time of the handshake for each key exchange method",
+    .group = 0
+  },
   {
     .name  = "host",
     .key   = 'h',
@@ -85,6 +94,7 @@ static error_t parse_opt (int key, char *arg, struct argp_state *state) {
 
   switch (key) {
     case '1':
+    case '2':
       arguments->benchmarks[key - '1' + 1] = 1;
       arguments->ntests ++;
       break;
@@ -192,6 +202,9 @@ static void do_benchmarks(ssh_session session, struct argument_s *arguments,
           libssh_benchmarks_names[BENCHMARK_RAW_UPLOAD], network_speed(bps));
     }
   }
+  if(arguments->benchmarks[BENCHMARK_KEX-1]){
+    benchmarks_kex(hostname,arguments);
+  }
 }
 
 int main(int argc, char **argv){
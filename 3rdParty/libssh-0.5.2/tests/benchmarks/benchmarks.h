@@ -31,6 +31,7 @@
 
 enum libssh_benchmarks {
     BENCHMARK_RAW_UPLOAD=1,
+    BENCHMARK_KEX,
     BENCHMARK_NUMBER
 };
 
@@ -59,4 +60,8 @@ float elapsed_time(struct timestamp_struct *ts);
 int benchmarks_raw_up (ssh_session session, struct argument_s *args,
     float *bps);
 
+/* bench_kex.c */
+
+int benchmarks_kex (const char *host, struct argument_s *args);
+
 #endif /* BENCHMARKS_H_ */
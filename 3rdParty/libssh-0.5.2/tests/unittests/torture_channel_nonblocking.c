@@ -0,0 +1,214 @@
+#define LIBSSH_STATIC
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "torture.h"
+#include "libssh/priv.h"
+#include "libssh/buffer.h"
+#include "libssh/callbacks.h"
+#include "libssh/channels.h"
+#include "libssh/packet.h"
+#include "libssh/session.h"
+#include "libssh/socket.h"
+#include "libssh/ssh2.h"
+
+/*
+ * A blocking session without encryption writing into one end of a socket
+ * pair, with a nonblocking channel on it. Nothing ever answers, the replies
+ * of the server are handed to the packet callbacks directly.
+ */
+struct nb_fixture {
+    ssh_session session;
+    ssh_channel channel;
+    struct ssh_channel_callbacks_struct callbacks;
+    int peer;
+    int wontblock;
+    uint32_t window;
+    int closed;
+};
+
+static void on_wontblock(ssh_session session, ssh_channel channel,
+        uint32_t bytes, void *userdata) {
+    struct nb_fixture *f = userdata;
+
+    (void) session;
+    (void) channel;
+    f->wontblock++;
+    f->window = bytes;
+}
+
+static void on_close(ssh_session session, ssh_channel channel,
+        void *userdata) {
+    struct nb_fixture *f = userdata;
+
+    (void) session;
+    (void) channel;
+    f->closed++;
+}
+
+static void setup(void **state) {
+    struct nb_fixture *f = malloc(sizeof(struct nb_fixture));
+    int sv[2];
+
+    assert_true(f != NULL);
+    memset(f, 0, sizeof(struct nb_fixture));
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    fcntl(sv[1], F_SETFL, O_NONBLOCK);
+
+    f->session = ssh_new();
+    assert_true(f->session != NULL);
+    ssh_socket_set_fd(f->session->socket, sv[0]);
+    ssh_packet_register_socket_callback(f->session, f->session->socket);
+    ssh_socket_get_poll_handle_in(f->session->socket);
+    f->session->alive = 1;
+
+    f->channel = ssh_channel_new(f->session);
+    assert_true(f->channel != NULL);
+    ssh_channel_set_blocking(f->channel, 0);
+
+    f->callbacks.userdata = f;
+    f->callbacks.channel_write_wontblock_function = on_wontblock;
+    f->callbacks.channel_close_function = on_close;
+    ssh_callbacks_init(&f->callbacks);
+    ssh_set_channel_callbacks(f->channel, &f->callbacks);
+
+    f->peer = sv[1];
+    *state = f;
+}
+
+static void teardown(void **state) {
+    struct nb_fixture *f = *state;
+
+    f->session->alive = 0;
+    ssh_free(f->session);
+    close(f->peer);
+    free(f);
+}
+
+/* lets the session write what it has, then counts the packets of a type
+ * that have arrived at the peer */
+static int count_packets(struct nb_fixture *f, uint8_t type) {
+    uint8_t wire[65536];
+    ssize_t size;
+    ssize_t pos = 0;
+    uint32_t len;
+    int count = 0;
+
+    while (ssh_socket_buffered_write_bytes(f->session->socket) > 0) {
+        assert_true(ssh_handle_packets(f->session, 1000) != SSH_ERROR);
+    }
+    size = read(f->peer, wire, sizeof(wire));
+    while (pos + 6 <= size) {
+        memcpy(&len, wire + pos, 4);
+        if (wire[pos + 5] == type) {
+            count++;
+        }
+        pos += ntohl(len) + 4;
+    }
+    return count;
+}
+
+/* an answer to the open, as the server would send it */
+static void reply(struct nb_fixture *f, uint8_t type, uint32_t a, uint32_t b,
+        uint32_t c) {
+    ssh_buffer packet = ssh_buffer_new();
+
+    assert_true(packet != NULL);
+    buffer_add_u32(packet, htonl(f->channel->local_channel));
+    buffer_add_u32(packet, htonl(a));
+    buffer_add_u32(packet, htonl(b));
+    buffer_add_u32(packet, htonl(c));
+    if (type == SSH2_MSG_CHANNEL_OPEN_CONFIRMATION) {
+        ssh_packet_channel_open_conf(f->session, type, packet, NULL);
+    } else {
+        ssh_packet_channel_open_fail(f->session, type, packet, NULL);
+    }
+    ssh_buffer_free(packet);
+}
+
+static void adjust(struct nb_fixture *f, uint32_t bytes) {
+    ssh_buffer packet = ssh_buffer_new();
+
+    assert_true(packet != NULL);
+    buffer_add_u32(packet, htonl(f->channel->local_channel));
+    buffer_add_u32(packet, htonl(bytes));
+    channel_rcv_change_window(f->session, SSH2_MSG_CHANNEL_WINDOW_ADJUST,
+            packet, NULL);
+    ssh_buffer_free(packet);
+}
+
+static void torture_channel_open_nonblocking(void **state) {
+    struct nb_fixture *f = *state;
+
+    assert_int_equal(ssh_channel_open_forward(f->channel, "localhost", 80,
+                "127.0.0.1", 5000), SSH_AGAIN);
+    assert_int_equal(count_packets(f, SSH2_MSG_CHANNEL_OPEN), 1);
+
+    /* asking again does not send another open */
+    assert_int_equal(ssh_channel_open_forward(f->channel, "localhost", 80,
+                "127.0.0.1", 5000), SSH_AGAIN);
+    assert_int_equal(count_packets(f, SSH2_MSG_CHANNEL_OPEN), 0);
+    assert_int_equal(f->wontblock, 0);
+
+    reply(f, SSH2_MSG_CHANNEL_OPEN_CONFIRMATION, 7, 1000, 32768);
+    assert_int_equal(f->wontblock, 1);
+    assert_int_equal(f->window, 1000);
+    assert_int_equal(ssh_channel_open_forward(f->channel, "localhost", 80,
+                "127.0.0.1", 5000), SSH_OK);
+    assert_true(ssh_channel_is_open(f->channel));
+}
+
+static void torture_channel_open_denied(void **state) {
+    struct nb_fixture *f = *state;
+
+    assert_int_equal(ssh_channel_open_forward(f->channel, "localhost", 80,
+                "127.0.0.1", 5000), SSH_AGAIN);
+
+    /* reason code, then an empty description and language */
+    reply(f, SSH2_MSG_CHANNEL_OPEN_FAILURE, 2, 0, 0);
+    assert_int_equal(f->closed, 1);
+    assert_int_equal(ssh_channel_open_forward(f->channel, "localhost", 80,
+                "127.0.0.1", 5000), SSH_ERROR);
+}
+
+static void torture_channel_write_window(void **state) {
+    struct nb_fixture *f = *state;
+    char data[3000];
+
+    memset(data, 'x', sizeof(data));
+    assert_int_equal(ssh_channel_open_forward(f->channel, "localhost", 80,
+                "127.0.0.1", 5000), SSH_AGAIN);
+    reply(f, SSH2_MSG_CHANNEL_OPEN_CONFIRMATION, 7, 1000, 32768);
+    f->wontblock = 0;
+
+    /* only what the window takes, and no waiting for more */
+    assert_int_equal(ssh_channel_write(f->channel, data, sizeof(data)), 1000);
+    assert_int_equal(ssh_channel_window_size(f->channel), 0);
+    assert_int_equal(ssh_channel_write(f->channel, data, sizeof(data)), 0);
+
+    adjust(f, 5000);
+    assert_int_equal(f->wontblock, 1);
+    assert_int_equal(f->window, 5000);
+    assert_int_equal(ssh_channel_write(f->channel, data, sizeof(data)),
+            sizeof(data));
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_channel_open_nonblocking, setup,
+                teardown),
+        unit_test_setup_teardown(torture_channel_open_denied, setup, teardown),
+        unit_test_setup_teardown(torture_channel_write_window, setup,
+                teardown),
+    };
+
+    ssh_init();
+    rc=run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
@@ -0,0 +1,100 @@
+#define LIBSSH_STATIC
+
+#include "torture.h"
+#include "libssh/session.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#define LIBSSH_TESTCONFIG "libssh_testconfig"
+
+static void torture_write_config(const char *content) {
+    FILE *file;
+
+    /* a new file, so the cached copy is always stale */
+    unlink(LIBSSH_TESTCONFIG);
+    file = fopen(LIBSSH_TESTCONFIG, "w");
+    assert_true(file != NULL);
+    fputs(content, file);
+    fclose(file);
+}
+
+static void setup(void **state) {
+    ssh_session session = ssh_new();
+
+    torture_write_config("# test configuration\n"
+                         "Host other\n"
+                         "  User nobody\n"
+                         "Host example\n"
+                         "  HostName example.com\n"
+                         "  Port 2222\n"
+                         "  User alice\n"
+                         "  StrictHostKeyChecking no\n"
+                         "  Unknown value\n"
+                         "Host example.com\n"
+                         "  ConnectTimeout 30\n");
+
+    ssh_options_set(session, SSH_OPTIONS_HOST, "example");
+    *state = session;
+}
+
+static void teardown(void **state) {
+    ssh_free(*state);
+    unlink(LIBSSH_TESTCONFIG);
+}
+
+static void torture_config_check(ssh_session session) {
+    assert_string_equal(session->host, "example.com");
+    assert_int_equal(session->port, 2222);
+    assert_string_equal(session->username, "alice");
+    assert_int_equal(session->StrictHostKeyChecking, 0);
+    /* the Host blocks after HostName match the new host name */
+    assert_int_equal(session->timeout, 30);
+}
+
+static void torture_config_parse(void **state) {
+    ssh_session session = *state;
+    ssh_session other;
+
+    assert_int_equal(ssh_options_parse_config(session, LIBSSH_TESTCONFIG), 0);
+    torture_config_check(session);
+
+    /* a second session replays the cached file */
+    other = ssh_new();
+    ssh_options_set(other, SSH_OPTIONS_HOST, "example");
+    assert_int_equal(ssh_options_parse_config(other, LIBSSH_TESTCONFIG), 0);
+    torture_config_check(other);
+    ssh_free(other);
+}
+
+static void torture_config_reload(void **state) {
+    ssh_session session = *state;
+
+    assert_int_equal(ssh_options_parse_config(session, LIBSSH_TESTCONFIG), 0);
+    assert_string_equal(session->username, "alice");
+
+    torture_write_config("Host example\n"
+                         "  User bob\n");
+    ssh_free(session);
+    session = *state = ssh_new();
+    ssh_options_set(session, SSH_OPTIONS_HOST, "example");
+    assert_int_equal(ssh_options_parse_config(session, LIBSSH_TESTCONFIG), 0);
+    assert_string_equal(session->host, "example");
+    assert_string_equal(session->username, "bob");
+
+    unlink(LIBSSH_TESTCONFIG);
+    assert_int_equal(ssh_options_parse_config(session, LIBSSH_TESTCONFIG), 0);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_config_parse, setup, teardown),
+        unit_test_setup_teardown(torture_config_reload, setup, teardown),
+    };
+
+    ssh_init();
+    rc = run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
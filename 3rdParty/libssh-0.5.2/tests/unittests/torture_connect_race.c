@@ -0,0 +1,249 @@
+#define LIBSSH_STATIC
+
+#include "torture.h"
+#include "libssh/session.h"
+#include "libssh/misc.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/*
+ * A listener with a zero backlog whose accept queue has been filled:
+ * the kernel drops every further SYN, just like a blackholed route.
+ */
+struct dead_listener {
+    socket_t listener;
+    socket_t fillers[4];
+    struct sockaddr_in addr;
+};
+
+static socket_t torture_listen(struct sockaddr_in *addr, int backlog) {
+    socklen_t len = sizeof(*addr);
+    socket_t s;
+
+    s = socket(AF_INET, SOCK_STREAM, 0);
+    assert_true(s >= 0);
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr->sin_port = 0;
+
+    assert_int_equal(bind(s, (struct sockaddr *) addr, sizeof(*addr)), 0);
+    assert_int_equal(listen(s, backlog), 0);
+    assert_int_equal(getsockname(s, (struct sockaddr *) addr, &len), 0);
+
+    return s;
+}
+
+static void torture_dead_listener(struct dead_listener *dead) {
+    int i;
+
+    dead->listener = torture_listen(&dead->addr, 0);
+    for (i = 0; i < 4; i++) {
+        dead->fillers[i] = socket(AF_INET, SOCK_STREAM, 0);
+        assert_true(dead->fillers[i] >= 0);
+        ssh_sock_set_nonblocking(dead->fillers[i]);
+        connect(dead->fillers[i], (struct sockaddr *) &dead->addr,
+                sizeof(dead->addr));
+    }
+    /* let the handshakes of the fillers settle */
+    usleep(100 * 1000);
+}
+
+static void torture_dead_listener_close(struct dead_listener *dead) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        close(dead->fillers[i]);
+    }
+    close(dead->listener);
+}
+
+/* A port nobody listens on: connect() is refused right away */
+static void torture_refused_addr(struct sockaddr_in *addr) {
+    socket_t s = torture_listen(addr, 1);
+    close(s);
+}
+
+static void torture_ai(struct addrinfo *ai, struct sockaddr_in *addr,
+                       struct addrinfo *next) {
+    memset(ai, 0, sizeof(*ai));
+    ai->ai_family = AF_INET;
+    ai->ai_socktype = SOCK_STREAM;
+    ai->ai_protocol = IPPROTO_TCP;
+    ai->ai_addr = (struct sockaddr *) addr;
+    ai->ai_addrlen = sizeof(*addr);
+    ai->ai_next = next;
+}
+
+static int torture_peer_port(socket_t s) {
+    struct sockaddr_in peer;
+    socklen_t len = sizeof(peer);
+
+    assert_int_equal(getpeername(s, (struct sockaddr *) &peer, &len), 0);
+    return ntohs(peer.sin_port);
+}
+
+static void setup(void **state) {
+    ssh_session session = ssh_new();
+    *state = session;
+}
+
+static void teardown(void **state) {
+    ssh_free(*state);
+}
+
+/*
+ * The first address never answers: the second one must be tried after the
+ * attempt delay instead of after the whole TCP timeout.
+ */
+static void torture_connect_race_dead_first(void **state) {
+    ssh_session session = *state;
+    struct dead_listener dead;
+    struct sockaddr_in live_addr;
+    struct addrinfo ai[2];
+    struct ssh_timestamp ts;
+    socket_t live;
+    socket_t s;
+    long elapsed;
+
+    torture_dead_listener(&dead);
+    live = torture_listen(&live_addr, 8);
+
+    torture_ai(&ai[1], &live_addr, NULL);
+    torture_ai(&ai[0], &dead.addr, &ai[1]);
+
+    ssh_timestamp_init(&ts);
+    s = ssh_connect_ai_race(session, ai, NULL, 5000);
+    elapsed = ssh_timestamp_elapsed_us(&ts) / 1000;
+
+    assert_true(s != SSH_INVALID_SOCKET);
+    assert_int_equal(torture_peer_port(s), ntohs(live_addr.sin_port));
+    assert_int_equal(session->connect_timing.attempts, 2);
+    assert_true(elapsed < 1000);
+
+    close(s);
+    close(live);
+    torture_dead_listener_close(&dead);
+}
+
+/* A refused attempt starts the next one without waiting for the delay */
+static void torture_connect_race_refused_first(void **state) {
+    ssh_session session = *state;
+    struct sockaddr_in refused_addr;
+    struct sockaddr_in live_addr;
+    struct addrinfo ai[2];
+    struct ssh_timestamp ts;
+    socket_t live;
+    socket_t s;
+    long elapsed;
+
+    torture_refused_addr(&refused_addr);
+    live = torture_listen(&live_addr, 8);
+
+    torture_ai(&ai[1], &live_addr, NULL);
+    torture_ai(&ai[0], &refused_addr, &ai[1]);
+
+    ssh_timestamp_init(&ts);
+    s = ssh_connect_ai_race(session, ai, NULL, 5000);
+    elapsed = ssh_timestamp_elapsed_us(&ts) / 1000;
+
+    assert_true(s != SSH_INVALID_SOCKET);
+    assert_int_equal(torture_peer_port(s), ntohs(live_addr.sin_port));
+    assert_true(elapsed < 200);
+
+    close(s);
+    close(live);
+}
+
+/* Only dead addresses: the overall timeout is honoured */
+static void torture_connect_race_all_dead(void **state) {
+    ssh_session session = *state;
+    struct dead_listener dead;
+    struct sockaddr_in refused_addr;
+    struct addrinfo ai[2];
+    struct ssh_timestamp ts;
+    socket_t s;
+    long elapsed;
+
+    torture_dead_listener(&dead);
+    torture_refused_addr(&refused_addr);
+
+    torture_ai(&ai[1], &refused_addr, NULL);
+    torture_ai(&ai[0], &dead.addr, &ai[1]);
+
+    ssh_timestamp_init(&ts);
+    s = ssh_connect_ai_race(session, ai, NULL, 500);
+    elapsed = ssh_timestamp_elapsed_us(&ts) / 1000;
+
+    assert_true(s == SSH_INVALID_SOCKET);
+    assert_true(elapsed >= 500);
+    assert_true(elapsed < 1500);
+
+    torture_dead_listener_close(&dead);
+}
+
+/* The banner phase lasts until the server speaks; no key exchange follows */
+static void torture_connect_banner_timing(void **state) {
+    ssh_session session = *state;
+    struct sockaddr_in addr;
+    socket_t listener;
+    long banner = -1;
+    long kex = -1;
+    pid_t pid;
+    int port;
+
+    listener = torture_listen(&addr, 1);
+    port = ntohs(addr.sin_port);
+
+    pid = fork();
+    assert_true(pid >= 0);
+    if (pid == 0) {
+        socket_t s = accept(listener, NULL, NULL);
+        const char *banner_str = "SSH-1.0-torture\r\n";
+        char c;
+
+        usleep(50 * 1000);
+        if (write(s, banner_str, strlen(banner_str)) < 0) {
+            _exit(1);
+        }
+        /* wait for the client to give up on the protocol version */
+        while (read(s, &c, 1) > 0);
+        _exit(0);
+    }
+    close(listener);
+
+    ssh_options_set(session, SSH_OPTIONS_HOST, "127.0.0.1");
+    ssh_options_set(session, SSH_OPTIONS_PORT, &port);
+    assert_true(ssh_connect(session) == SSH_ERROR);
+
+    assert_true(ssh_get_handshake_timing(session, &banner, &kex) == SSH_OK);
+    assert_true(banner >= 40 * 1000);
+    assert_true(banner < 1000 * 1000);
+    assert_int_equal(kex, 0);
+
+    ssh_disconnect(session);
+    waitpid(pid, NULL, 0);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_connect_race_dead_first, setup, teardown),
+        unit_test_setup_teardown(torture_connect_race_refused_first, setup, teardown),
+        unit_test_setup_teardown(torture_connect_race_all_dead, setup, teardown),
+        unit_test_setup_teardown(torture_connect_banner_timing, setup, teardown),
+    };
+
+    ssh_init();
+    rc = run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
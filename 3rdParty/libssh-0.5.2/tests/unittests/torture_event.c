@@ -0,0 +1,172 @@
+#define LIBSSH_STATIC
+
+#include <unistd.h>
+#include <poll.h>
+
+#include "torture.h"
+#include "libssh/priv.h"
+
+struct event_pipe {
+    int fds[2];
+    int calls;
+};
+
+static int event_pipe_callback(socket_t fd, int revents, void *userdata) {
+    struct event_pipe *pipe = (struct event_pipe *) userdata;
+    char c;
+
+    (void) revents;
+    if (read(fd, &c, 1) == 1) {
+        pipe->calls++;
+    }
+    return 0;
+}
+
+static void event_pipe_signal(struct event_pipe *pipe) {
+    assert_true(write(pipe->fds[1], "x", 1) == 1);
+}
+
+static void torture_event_fd(void **state) {
+    struct event_pipe p;
+    ssh_event event;
+    int rc;
+
+    (void) state;
+
+    assert_true(pipe(p.fds) == 0);
+    p.calls = 0;
+
+    event = ssh_event_new();
+    assert_true(event != NULL);
+
+    rc = ssh_event_add_fd(event, p.fds[0], POLLIN, event_pipe_callback, &p);
+    assert_true(rc == SSH_OK);
+
+    /* nothing to read yet */
+    rc = ssh_event_dopoll(event, 0);
+    assert_true(rc == SSH_AGAIN);
+    assert_true(p.calls == 0);
+
+    event_pipe_signal(&p);
+    rc = ssh_event_dopoll(event, 1000);
+    assert_true(rc == SSH_OK);
+    assert_true(p.calls == 1);
+
+    rc = ssh_event_remove_fd(event, p.fds[0]);
+    assert_true(rc == SSH_OK);
+    rc = ssh_event_remove_fd(event, p.fds[0]);
+    assert_true(rc == SSH_ERROR);
+
+    event_pipe_signal(&p);
+    ssh_event_dopoll(event, 0);
+    assert_true(p.calls == 1);
+
+    ssh_event_free(event);
+    close(p.fds[0]);
+    close(p.fds[1]);
+}
+
+static void torture_event_remove_reorders(void **state) {
+    struct event_pipe p[3];
+    ssh_event event;
+    int i;
+    int rc;
+
+    (void) state;
+
+    event = ssh_event_new();
+    assert_true(event != NULL);
+
+    for (i = 0; i < 3; i++) {
+        assert_true(pipe(p[i].fds) == 0);
+        p[i].calls = 0;
+        rc = ssh_event_add_fd(event, p[i].fds[0], POLLIN, event_pipe_callback, &p[i]);
+        assert_true(rc == SSH_OK);
+    }
+
+    /* the last handle takes the first slot, then it is removed in turn */
+    rc = ssh_event_remove_fd(event, p[0].fds[0]);
+    assert_true(rc == SSH_OK);
+    rc = ssh_event_remove_fd(event, p[2].fds[0]);
+    assert_true(rc == SSH_OK);
+
+    event_pipe_signal(&p[1]);
+    event_pipe_signal(&p[2]);
+    rc = ssh_event_dopoll(event, 1000);
+    assert_true(rc == SSH_OK);
+    assert_true(p[1].calls == 1);
+    assert_true(p[2].calls == 0);
+
+    ssh_event_free(event);
+    for (i = 0; i < 3; i++) {
+        close(p[i].fds[0]);
+        close(p[i].fds[1]);
+    }
+}
+
+static void torture_event_set_events(void **state) {
+    struct event_pipe p;
+    ssh_event event;
+    int rc;
+
+    (void) state;
+
+    assert_true(pipe(p.fds) == 0);
+    p.calls = 0;
+
+    event = ssh_event_new();
+    assert_true(event != NULL);
+    rc = ssh_event_add_fd(event, p.fds[0], POLLIN, event_pipe_callback, &p);
+    assert_true(rc == SSH_OK);
+
+    /* kept, but not polled */
+    rc = ssh_event_set_fd_events(event, p.fds[0], 0);
+    assert_true(rc == SSH_OK);
+    event_pipe_signal(&p);
+    ssh_event_dopoll(event, 0);
+    assert_true(p.calls == 0);
+
+    rc = ssh_event_set_fd_events(event, p.fds[0], POLLIN);
+    assert_true(rc == SSH_OK);
+    rc = ssh_event_dopoll(event, 1000);
+    assert_true(rc == SSH_OK);
+    assert_true(p.calls == 1);
+
+    assert_true(ssh_event_set_fd_events(event, p.fds[1], POLLIN) == SSH_ERROR);
+
+    ssh_event_free(event);
+    close(p.fds[0]);
+    close(p.fds[1]);
+}
+
+static void torture_event_invalid(void **state) {
+    ssh_event event;
+
+    (void) state;
+
+    assert_true(ssh_event_dopoll(NULL, 0) == SSH_ERROR);
+    assert_true(ssh_event_add_session(NULL, NULL) == SSH_ERROR);
+
+    event = ssh_event_new();
+    assert_true(event != NULL);
+    assert_true(ssh_event_add_fd(event, SSH_INVALID_SOCKET, POLLIN,
+                                 event_pipe_callback, NULL) == SSH_ERROR);
+    assert_true(ssh_event_add_session(event, NULL) == SSH_ERROR);
+    assert_true(ssh_event_remove_session(event, NULL) == SSH_ERROR);
+    ssh_event_free(event);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test(torture_event_fd),
+        unit_test(torture_event_remove_reorders),
+        unit_test(torture_event_set_events),
+        unit_test(torture_event_invalid),
+    };
+
+    ssh_init();
+    rc=run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
@@ -0,0 +1,192 @@
+#define LIBSSH_STATIC
+
+#include "torture.h"
+#include "libssh/session.h"
+#include "libssh/crypto.h"
+#include "libssh/curve25519.h"
+#include "libssh/ecdh.h"
+#include "libssh/kex.h"
+#include "libssh/dh.h"
+
+#include <string.h>
+
+/* RFC 7748, section 6.1 */
+static const unsigned char alice_private[32] = {
+    0x77, 0x07, 0x6d, 0x0a, 0x73, 0x18, 0xa5, 0x7d, 0x3c, 0x16, 0xc1, 0x72,
+    0x51, 0xb2, 0x66, 0x45, 0xdf, 0x4c, 0x2f, 0x87, 0xeb, 0xc0, 0x99, 0x2a,
+    0xb1, 0x77, 0xfb, 0xa5, 0x1d, 0xb9, 0x2c, 0x2a
+};
+static const unsigned char alice_public[32] = {
+    0x85, 0x20, 0xf0, 0x09, 0x89, 0x30, 0xa7, 0x54, 0x74, 0x8b, 0x7d, 0xdc,
+    0xb4, 0x3e, 0xf7, 0x5a, 0x0d, 0xbf, 0x3a, 0x0d, 0x26, 0x38, 0x1a, 0xf4,
+    0xeb, 0xa4, 0xa9, 0x8e, 0xaa, 0x9b, 0x4e, 0x6a
+};
+static const unsigned char bob_private[32] = {
+    0x5d, 0xab, 0x08, 0x7e, 0x62, 0x4a, 0x8a, 0x4b, 0x79, 0xe1, 0x7f, 0x8b,
+    0x83, 0x80, 0x0e, 0xe6, 0x6f, 0x3b, 0xb1, 0x29, 0x26, 0x18, 0xb6, 0xfd,
+    0x1c, 0x2f, 0x8b, 0x27, 0xff, 0x88, 0xe0, 0xeb
+};
+static const unsigned char bob_public[32] = {
+    0xde, 0x9e, 0xdb, 0x7d, 0x7b, 0x7d, 0xc1, 0xb4, 0xd3, 0x5b, 0x61, 0xc2,
+    0xec, 0xe4, 0x35, 0x37, 0x3f, 0x83, 0x43, 0xc8, 0x5b, 0x78, 0x67, 0x4d,
+    0xad, 0xfc, 0x7e, 0x14, 0x6f, 0x88, 0x2b, 0x4f
+};
+static const unsigned char shared_secret[32] = {
+    0x4a, 0x5d, 0x9d, 0x5b, 0xa4, 0xce, 0x2d, 0xe1, 0x72, 0x8e, 0x3b, 0xf4,
+    0x80, 0x35, 0x0f, 0x25, 0xe0, 0x7e, 0x21, 0xc9, 0x47, 0xd1, 0x9e, 0x33,
+    0x76, 0xf0, 0x9b, 0x3c, 0x1e, 0x16, 0x17, 0x42
+};
+
+static void setup(void **state) {
+    ssh_session session = ssh_new();
+    *state = session;
+}
+
+static void teardown(void **state) {
+    ssh_free(*state);
+}
+
+static void torture_curve25519_rfc7748(void **state) {
+    unsigned char out[32];
+
+    (void) state;
+
+    ssh_curve25519_scalarmult_base(out, alice_private);
+    assert_memory_equal(out, alice_public, 32);
+    ssh_curve25519_scalarmult_base(out, bob_private);
+    assert_memory_equal(out, bob_public, 32);
+
+    ssh_curve25519_scalarmult(out, alice_private, bob_public);
+    assert_memory_equal(out, shared_secret, 32);
+    ssh_curve25519_scalarmult(out, bob_private, alice_public);
+    assert_memory_equal(out, shared_secret, 32);
+}
+
+/*
+ * Runs both halves of a key exchange on two sessions, each one taking the
+ * other's Q_C as its Q_S, and checks they agree on K.
+ */
+static void torture_kex_agree(ssh_session a, ssh_session b,
+                              enum ssh_key_exchange_e type) {
+    struct ssh_crypto_struct *ca = a->next_crypto;
+    struct ssh_crypto_struct *cb = b->next_crypto;
+    ssh_string ka, kb;
+
+    ca->kex_type = cb->kex_type = type;
+    assert_int_equal(ssh_kex_keypair_generate(ca), SSH_OK);
+    assert_int_equal(ssh_kex_keypair_generate(cb), SSH_OK);
+
+    ca->ecdh_server_pubkey = ssh_string_copy(cb->ecdh_client_pubkey);
+    cb->ecdh_server_pubkey = ssh_string_copy(ca->ecdh_client_pubkey);
+
+    if (type == SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG) {
+        assert_int_equal(ssh_curve25519_build_k(a), SSH_OK);
+        assert_int_equal(ssh_curve25519_build_k(b), SSH_OK);
+#ifdef HAVE_ECDH
+    } else {
+        assert_int_equal(ssh_ecdh_build_k(a), SSH_OK);
+        assert_int_equal(ssh_ecdh_build_k(b), SSH_OK);
+#endif
+    }
+
+    ka = make_bignum_string(ca->k);
+    kb = make_bignum_string(cb->k);
+    assert_true(ka != NULL && kb != NULL);
+    assert_int_equal(ssh_string_len(ka), ssh_string_len(kb));
+    assert_memory_equal(ssh_string_data(ka), ssh_string_data(kb),
+                        ssh_string_len(ka));
+
+    ssh_string_free(ka);
+    ssh_string_free(kb);
+}
+
+static void torture_kex_curve25519_agree(void **state) {
+    ssh_session other = ssh_new();
+
+    torture_kex_agree(*state, other, SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG);
+    ssh_free(other);
+}
+
+#ifdef HAVE_ECDH
+static void torture_kex_ecdh_agree(void **state) {
+    ssh_session other = ssh_new();
+
+    torture_kex_agree(*state, other, SSH_KEX_ECDH_SHA2_NISTP256);
+    ssh_free(other);
+}
+#endif
+
+/* A low order point must not give an all zero shared secret */
+static void torture_kex_curve25519_low_order(void **state) {
+    ssh_session session = *state;
+    struct ssh_crypto_struct *crypto = session->next_crypto;
+    unsigned char zero[32] = {0};
+
+    crypto->kex_type = SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG;
+    assert_int_equal(ssh_kex_keypair_generate(crypto), SSH_OK);
+    crypto->ecdh_server_pubkey = ssh_string_new(32);
+    ssh_string_fill(crypto->ecdh_server_pubkey, zero, 32);
+
+    assert_int_equal(ssh_curve25519_build_k(session), SSH_ERROR);
+}
+
+static void torture_kex_names(void **state) {
+    (void) state;
+
+    assert_int_equal(ssh_kex_type("curve25519-sha256@libssh.org"),
+                     SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG);
+    assert_int_equal(ssh_kex_type("diffie-hellman-group1-sha1"),
+                     SSH_KEX_DH_GROUP1_SHA1);
+    assert_int_equal(ssh_kex_type("diffie-hellman-group14-sha1"), 0);
+    assert_int_equal(ssh_kex_digest_len(SSH_KEX_DH_GROUP1_SHA1), 20);
+    assert_int_equal(ssh_kex_digest_len(SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG), 32);
+}
+
+static void torture_kex_precompute(void **state) {
+    ssh_session session = *state;
+    struct ssh_crypto_struct *crypto = session->next_crypto;
+    unsigned char pubkey[32];
+
+    assert_int_equal(ssh_kex_precompute("curve25519-sha256@libssh.org", 2), 2);
+    /* the pool is already full for that method */
+    assert_int_equal(ssh_kex_precompute("curve25519-sha256@libssh.org", 2), 0);
+    assert_int_equal(ssh_kex_precompute("diffie-hellman-group14-sha1", 2),
+                     SSH_ERROR);
+
+    /* no precomputed keypair for another method */
+    crypto->kex_type = SSH_KEX_DH_GROUP1_SHA1;
+    assert_int_equal(ssh_kex_pool_take(crypto), SSH_ERROR);
+
+    crypto->kex_type = SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG;
+    assert_int_equal(ssh_kex_pool_take(crypto), SSH_OK);
+    assert_int_equal(ssh_string_len(crypto->ecdh_client_pubkey), 32);
+    ssh_curve25519_scalarmult_base(pubkey, crypto->curve25519_privkey);
+    assert_memory_equal(ssh_string_data(crypto->ecdh_client_pubkey), pubkey, 32);
+
+    /* one left, then the pool is empty */
+    assert_int_equal(ssh_kex_precompute(NULL, 1), 0);
+    crypto_free(session->next_crypto);
+    session->next_crypto = crypto_new();
+    session->next_crypto->kex_type = SSH_KEX_CURVE25519_SHA256_LIBSSH_ORG;
+    assert_int_equal(ssh_kex_pool_take(session->next_crypto), SSH_OK);
+    assert_int_equal(ssh_kex_pool_take(session->next_crypto), SSH_ERROR);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test(torture_curve25519_rfc7748),
+        unit_test_setup_teardown(torture_kex_curve25519_agree, setup, teardown),
+#ifdef HAVE_ECDH
+        unit_test_setup_teardown(torture_kex_ecdh_agree, setup, teardown),
+#endif
+        unit_test_setup_teardown(torture_kex_curve25519_low_order, setup, teardown),
+        unit_test(torture_kex_names),
+        unit_test_setup_teardown(torture_kex_precompute, setup, teardown),
+    };
+
+    ssh_init();
+    rc = run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
@@ -3,6 +3,8 @@
 #include "torture.h"
 #include "keyfiles.c"
 
+#include <utime.h>
+
 #define LIBSSH_RSA_TESTKEY "libssh_testkey.id_rsa"
 #define LIBSSH_DSA_TESTKEY "libssh_testkey.id_dsa"
 #define LIBSSH_PASSPHRASE "libssh-rocks"
@@ -238,6 +240,88 @@ static void torture_privatekey_from_file_passphrase(void **state) {
     }
 }
 
+static ssh_string torture_privkey_to_pubkey(ssh_private_key privkey) {
+    ssh_public_key pubkey;
+    ssh_string blob;
+
+    pubkey = publickey_from_privatekey(privkey);
+    assert_true(pubkey != NULL);
+    blob = publickey_to_string(pubkey);
+    publickey_free(pubkey);
+    assert_true(blob != NULL);
+
+    return blob;
+}
+
+/**
+ * @brief tests that decrypted keys are shared until the file changes
+ */
+static void torture_privatekey_cache(void **state) {
+    ssh_session session = *state;
+    ssh_private_key key1 = NULL;
+    ssh_private_key key2 = NULL;
+    ssh_string pubkey1, pubkey2;
+    struct utimbuf times;
+    int rc;
+
+    key1 = privatekey_from_file(session, LIBSSH_RSA_TESTKEY, 0, NULL);
+    assert_true(key1 != NULL);
+    key2 = privatekey_from_file(session, LIBSSH_RSA_TESTKEY, SSH_KEYTYPE_RSA, NULL);
+    assert_true(key2 != NULL);
+#ifdef HAVE_LIBCRYPTO
+    /* the key material is shared, not read again */
+    assert_true(key1->rsa_priv == key2->rsa_priv);
+#endif
+
+    pubkey1 = torture_privkey_to_pubkey(key1);
+    privatekey_free(key1);
+    privatekey_free(key2);
+
+    /* a new key in place of the old one */
+    unlink(LIBSSH_RSA_TESTKEY);
+    unlink(LIBSSH_RSA_TESTKEY ".pub");
+    rc = system("ssh-keygen -t rsa -q -N \"\" -f " LIBSSH_RSA_TESTKEY);
+    assert_true(rc == 0);
+    times.actime = times.modtime = time(NULL) + 60;
+    utime(LIBSSH_RSA_TESTKEY, &times);
+
+    key2 = privatekey_from_file(session, LIBSSH_RSA_TESTKEY, 0, NULL);
+    assert_true(key2 != NULL);
+    pubkey2 = torture_privkey_to_pubkey(key2);
+    privatekey_free(key2);
+
+    assert_true(ssh_string_len(pubkey1) != ssh_string_len(pubkey2) ||
+                memcmp(ssh_string_data(pubkey1), ssh_string_data(pubkey2),
+                       ssh_string_len(pubkey1)) != 0);
+
+    ssh_string_free(pubkey1);
+    ssh_string_free(pubkey2);
+}
+
+/**
+ * @brief tests that a cached encrypted key still needs its passphrase
+ */
+static void torture_privatekey_cache_passphrase(void **state) {
+    ssh_session session = *state;
+    ssh_private_key key1 = NULL;
+    ssh_private_key key2 = NULL;
+
+    key1 = privatekey_from_file(session, LIBSSH_RSA_TESTKEY, 0, LIBSSH_PASSPHRASE);
+    assert_true(key1 != NULL);
+
+    key2 = privatekey_from_file(session, LIBSSH_RSA_TESTKEY, 0, "not-" LIBSSH_PASSPHRASE);
+    assert_true(key2 == NULL);
+
+    key2 = privatekey_from_file(session, LIBSSH_RSA_TESTKEY, 0, LIBSSH_PASSPHRASE);
+    assert_true(key2 != NULL);
+#ifdef HAVE_LIBCRYPTO
+    assert_true(key1->rsa_priv == key2->rsa_priv);
+#endif
+
+    privatekey_free(key1);
+    privatekey_free(key2);
+}
+
 int torture_run_tests(void) {
     int rc;
     const UnitTest tests[] = {
@@ -251,6 +335,10 @@ int torture_run_tests(void) {
                                  teardown),
         unit_test_setup_teardown(torture_privatekey_from_file_passphrase,
                                  setup_both_keys_passphrase, teardown),
+        unit_test_setup_teardown(torture_privatekey_cache,
+                                 setup_rsa_key, teardown),
+        unit_test_setup_teardown(torture_privatekey_cache_passphrase,
+                                 setup_both_keys_passphrase, teardown),
     };
 
 
@@ -0,0 +1,186 @@
+#define LIBSSH_STATIC
+
+#include "torture.h"
+#include "libssh/session.h"
+#include "libssh/crypto.h"
+#include "libssh/wrapper.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define KNOWNHOSTS "/tmp/libssh_torture_known_hosts"
+
+/* unrelated entries written around the tested ones */
+#define FILLER_ENTRIES 2000
+
+static char pubkey_type[] = "ssh-rsa";
+static const unsigned char server_key[] = "server public key blob";
+static const unsigned char other_key[] = "some other public key blob";
+
+static void setup(void **state) {
+    ssh_session session = ssh_new();
+
+    ssh_options_set(session, SSH_OPTIONS_KNOWNHOSTS, KNOWNHOSTS);
+    ssh_options_set(session, SSH_OPTIONS_HOST, "Example.com");
+
+    session->current_crypto = crypto_new();
+    session->current_crypto->server_pubkey = ssh_string_new(sizeof(server_key));
+    ssh_string_fill(session->current_crypto->server_pubkey, server_key,
+                    sizeof(server_key));
+    session->current_crypto->server_pubkey_type = pubkey_type;
+
+    *state = session;
+}
+
+static void teardown(void **state) {
+    ssh_free(*state);
+    unlink(KNOWNHOSTS);
+}
+
+static void torture_write_key(FILE *file, const char *hosts, const char *type,
+                              const unsigned char *key, int len) {
+    unsigned char *b64 = bin_to_base64(key, len);
+
+    assert_true(b64 != NULL);
+    fprintf(file, "%s %s %s\n", hosts, type, b64);
+    free(b64);
+}
+
+/* Writes a |1|salt|hash entry, as OpenSSH does with HashKnownHosts */
+static void torture_write_hashed(FILE *file, const char *host,
+                                 const unsigned char *key, int len) {
+    unsigned char salt[20];
+    unsigned char hash[20];
+    unsigned int size = sizeof(hash);
+    unsigned char *b64salt;
+    unsigned char *b64hash;
+    char hashed[128];
+    HMACCTX mac;
+
+    assert_true(ssh_get_random(salt, sizeof(salt), 0));
+    mac = hmac_init(salt, sizeof(salt), HMAC_SHA1);
+    hmac_update(mac, host, strlen(host));
+    hmac_final(mac, hash, &size);
+
+    b64salt = bin_to_base64(salt, sizeof(salt));
+    b64hash = bin_to_base64(hash, size);
+    snprintf(hashed, sizeof(hashed), "|1|%s|%s", b64salt, b64hash);
+    free(b64salt);
+    free(b64hash);
+
+    torture_write_key(file, hashed, "ssh-rsa", key, len);
+}
+
+static FILE *torture_knownhosts_open(void) {
+    char host[64];
+    FILE *file;
+    int i;
+
+    file = fopen(KNOWNHOSTS, "w");
+    assert_true(file != NULL);
+    for (i = 0; i < FILLER_ENTRIES; i++) {
+        snprintf(host, sizeof(host), "host%d.example.net", i);
+        if (i % 2) {
+            torture_write_hashed(file, host, other_key, sizeof(other_key));
+        } else {
+            torture_write_key(file, host, "ssh-rsa", other_key,
+                              sizeof(other_key));
+        }
+    }
+
+    return file;
+}
+
+static void torture_knownhosts_plain(void **state) {
+    ssh_session session = *state;
+    FILE *file = torture_knownhosts_open();
+
+    torture_write_key(file, "other.com,example.com", "ssh-rsa",
+                      server_key, sizeof(server_key));
+    fclose(file);
+
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_KNOWN_OK);
+    /* answered from the cache */
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_KNOWN_OK);
+}
+
+static void torture_knownhosts_hashed(void **state) {
+    ssh_session session = *state;
+    FILE *file = torture_knownhosts_open();
+
+    torture_write_hashed(file, "example.com", server_key, sizeof(server_key));
+    fclose(file);
+
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_KNOWN_OK);
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_KNOWN_OK);
+}
+
+static void torture_knownhosts_pattern(void **state) {
+    ssh_session session = *state;
+    FILE *file = torture_knownhosts_open();
+
+    torture_write_key(file, "*.com", "ssh-rsa",
+                      server_key, sizeof(server_key));
+    fclose(file);
+
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_KNOWN_OK);
+    ssh_options_set(session, SSH_OPTIONS_HOST, "example.org");
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_NOT_KNOWN);
+}
+
+/* Entries are still considered in file order */
+static void torture_knownhosts_changed(void **state) {
+    ssh_session session = *state;
+    FILE *file = torture_knownhosts_open();
+
+    torture_write_key(file, "example.com", "ssh-dss",
+                      other_key, sizeof(other_key));
+    torture_write_hashed(file, "example.com", other_key, sizeof(other_key));
+    fclose(file);
+
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_KNOWN_CHANGED);
+
+    file = fopen(KNOWNHOSTS, "a");
+    assert_true(file != NULL);
+    torture_write_key(file, "[example.com]:22", "ssh-rsa",
+                      server_key, sizeof(server_key));
+    fclose(file);
+
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_KNOWN_OK);
+}
+
+static void torture_knownhosts_reload(void **state) {
+    ssh_session session = *state;
+    FILE *file = torture_knownhosts_open();
+
+    fclose(file);
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_NOT_KNOWN);
+
+    /* an appended entry is seen without restarting */
+    file = fopen(KNOWNHOSTS, "a");
+    assert_true(file != NULL);
+    torture_write_key(file, "example.com", "ssh-dss",
+                      server_key, sizeof(server_key));
+    fclose(file);
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_FOUND_OTHER);
+
+    unlink(KNOWNHOSTS);
+    assert_int_equal(ssh_is_server_known(session), SSH_SERVER_NOT_KNOWN);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_knownhosts_plain, setup, teardown),
+        unit_test_setup_teardown(torture_knownhosts_hashed, setup, teardown),
+        unit_test_setup_teardown(torture_knownhosts_pattern, setup, teardown),
+        unit_test_setup_teardown(torture_knownhosts_changed, setup, teardown),
+        unit_test_setup_teardown(torture_knownhosts_reload, setup, teardown),
+    };
+
+    ssh_init();
+    rc = run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
@@ -0,0 +1,119 @@
+#define LIBSSH_STATIC
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "torture.h"
+#include "libssh/priv.h"
+#include "libssh/pcap.h"
+
+#define PCAP_FILE "torture_pcap.pcap"
+#define PCAP_HDR_LEN 24
+#define RECORD_HDR_LEN (PCAPREC_HDR_LEN + 40)
+
+static void setup(void **state) {
+    ssh_pcap_file pcap = ssh_pcap_file_new();
+
+    assert_true(pcap != NULL);
+    assert_true(ssh_pcap_file_open(pcap, PCAP_FILE) == SSH_OK);
+    *state = pcap;
+}
+
+static void teardown(void **state) {
+    ssh_pcap_file_free(*state);
+    unlink(PCAP_FILE);
+    unlink(PCAP_FILE ".1");
+    unlink(PCAP_FILE ".2");
+}
+
+static long file_size(const char *filename) {
+    struct stat sb;
+
+    if (stat(filename, &sb) < 0) {
+        return -1;
+    }
+    return (long) sb.st_size;
+}
+
+static int write_packets(ssh_pcap_file pcap, int count, uint32_t len) {
+    uint8_t header[RECORD_HDR_LEN];
+    char data[512];
+    int i;
+
+    memset(header, 0, sizeof(header));
+    memset(data, 'x', sizeof(data));
+    for (i = 0; i < count; i++) {
+        if (ssh_pcap_file_write_packet(pcap, header, sizeof(header), data, len,
+                    len + 40) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void torture_pcap_sync(void **state) {
+    ssh_pcap_file pcap = *state;
+
+    assert_true(write_packets(pcap, 3, 100) == 0);
+    assert_true(ssh_pcap_file_close(pcap) == SSH_OK);
+    assert_int_equal(file_size(PCAP_FILE),
+            PCAP_HDR_LEN + 3 * (RECORD_HDR_LEN + 100));
+}
+
+static void torture_pcap_async(void **state) {
+    ssh_pcap_file pcap = *state;
+
+    assert_true(ssh_pcap_file_set_async(pcap, 64 * 1024) == SSH_OK);
+    /* only once */
+    assert_true(ssh_pcap_file_set_async(pcap, 64 * 1024) == SSH_ERROR);
+
+    assert_true(write_packets(pcap, 500, 100) == 0);
+    assert_true(ssh_pcap_file_close(pcap) == SSH_OK);
+
+    /* everything queued is written before close returns */
+    assert_int_equal(ssh_pcap_file_get_dropped(pcap)
+            + (file_size(PCAP_FILE) - PCAP_HDR_LEN) / (RECORD_HDR_LEN + 100),
+            500);
+}
+
+static void torture_pcap_async_drops(void **state) {
+    ssh_pcap_file pcap = *state;
+
+    /* no packet fits in the ring */
+    assert_true(ssh_pcap_file_set_async(pcap, 128) == SSH_OK);
+    assert_true(write_packets(pcap, 10, 200) == 0);
+    assert_true(ssh_pcap_file_get_dropped(pcap) == 10);
+
+    assert_true(ssh_pcap_file_close(pcap) == SSH_OK);
+    assert_int_equal(file_size(PCAP_FILE), PCAP_HDR_LEN);
+}
+
+static void torture_pcap_rotation(void **state) {
+    ssh_pcap_file pcap = *state;
+    long record = RECORD_HDR_LEN + 100;
+
+    /* room for two records per file */
+    assert_true(ssh_pcap_file_set_rotation(pcap,
+                PCAP_HDR_LEN + 2 * record) == SSH_OK);
+    assert_true(write_packets(pcap, 5, 100) == 0);
+    assert_true(ssh_pcap_file_close(pcap) == SSH_OK);
+
+    assert_int_equal(file_size(PCAP_FILE), PCAP_HDR_LEN + 2 * record);
+    assert_int_equal(file_size(PCAP_FILE ".1"), PCAP_HDR_LEN + 2 * record);
+    assert_int_equal(file_size(PCAP_FILE ".2"), PCAP_HDR_LEN + record);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_pcap_sync, setup, teardown),
+        unit_test_setup_teardown(torture_pcap_async, setup, teardown),
+        unit_test_setup_teardown(torture_pcap_async_drops, setup, teardown),
+        unit_test_setup_teardown(torture_pcap_rotation, setup, teardown),
+    };
+
+    ssh_init();
+    rc=run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
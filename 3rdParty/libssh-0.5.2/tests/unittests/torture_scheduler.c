@@ -0,0 +1,251 @@
+#define LIBSSH_STATIC
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "torture.h"
+#include "libssh/priv.h"
+#include "libssh/buffer.h"
+#include "libssh/channels.h"
+#include "libssh/packet.h"
+#include "libssh/session.h"
+#include "libssh/socket.h"
+#include "libssh/ssh2.h"
+#include "libssh/scheduler.h"
+
+#define BULK_LEN (256 * 1024)
+/* each of two channels, so that neither queue reaches its limit */
+#define SHARE_LEN (128 * 1024)
+#define PAYLOAD_MAX 32758
+
+/*
+ * A session without encryption writing into one end of a socket pair, and
+ * two open channels on it. A thread reads what arrives at the other end.
+ */
+struct sched_fixture {
+    ssh_session session;
+    ssh_channel channels[2];
+    int fd;
+    int peer;
+    pthread_t reader;
+    ssh_buffer wire;
+};
+
+/* one packet seen on the wire */
+struct wire_packet {
+    uint8_t type;
+    uint32_t channel;
+    uint32_t len;
+};
+
+static void *read_wire(void *arg) {
+    struct sched_fixture *f = arg;
+    char buffer[16384];
+    ssize_t r;
+
+    while ((r = read(f->peer, buffer, sizeof(buffer))) > 0) {
+        buffer_add_data(f->wire, buffer, r);
+    }
+    return NULL;
+}
+
+static void setup(void **state) {
+    struct sched_fixture *f = malloc(sizeof(struct sched_fixture));
+    int sv[2];
+    int i;
+
+    assert_true(f != NULL);
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+
+    f->session = ssh_new();
+    assert_true(f->session != NULL);
+    ssh_socket_set_fd(f->session->socket, sv[0]);
+    ssh_packet_register_socket_callback(f->session, f->session->socket);
+    /* a connected session has its poll handles already */
+    ssh_socket_get_poll_handle_in(f->session->socket);
+    ssh_set_blocking(f->session, 0);
+    f->session->alive = 1;
+
+    for (i = 0; i < 2; i++) {
+        f->channels[i] = ssh_channel_new(f->session);
+        assert_true(f->channels[i] != NULL);
+        f->channels[i]->local_channel = i;
+        f->channels[i]->remote_channel = i;
+        f->channels[i]->remote_window = 64 * 1024 * 1024;
+        f->channels[i]->remote_maxpacket = PAYLOAD_MAX + 10;
+        f->channels[i]->state = SSH_CHANNEL_STATE_OPEN;
+    }
+
+    f->fd = sv[0];
+    f->peer = sv[1];
+    f->wire = ssh_buffer_new();
+    assert_true(f->wire != NULL);
+    assert_int_equal(pthread_create(&f->reader, NULL, read_wire, f), 0);
+    *state = f;
+}
+
+static void teardown(void **state) {
+    struct sched_fixture *f = *state;
+
+    /* finish() has stopped the reader, nothing can be sent anymore */
+    f->session->alive = 0;
+    ssh_free(f->session);
+    close(f->peer);
+    ssh_buffer_free(f->wire);
+    free(f);
+}
+
+/* lets the session write everything, then waits for the reader */
+static void finish(struct sched_fixture *f) {
+    while (f->session->sched_queued > 0 ||
+            ssh_socket_buffered_write_bytes(f->session->socket) > 0) {
+        assert_true(ssh_handle_packets(f->session, 1000) != SSH_ERROR);
+    }
+    shutdown(f->fd, SHUT_WR);
+    assert_int_equal(pthread_join(f->reader, NULL), 0);
+}
+
+/* parses the next packet off the wire, 0 at the end */
+static int next_packet(struct sched_fixture *f, struct wire_packet *packet) {
+    const uint8_t *p = buffer_get_rest(f->wire);
+    uint32_t len;
+    uint32_t value;
+
+    if (buffer_get_rest_len(f->wire) < 5) {
+        return 0;
+    }
+    memcpy(&len, p, 4);
+    len = ntohl(len);
+    assert_true(buffer_get_rest_len(f->wire) >= len + 4);
+
+    memset(packet, 0, sizeof(*packet));
+    packet->type = p[5];
+    if (packet->type == SSH2_MSG_CHANNEL_DATA ||
+        packet->type == SSH2_MSG_CHANNEL_EOF) {
+        memcpy(&value, p + 6, 4);
+        packet->channel = ntohl(value);
+    }
+    if (packet->type == SSH2_MSG_CHANNEL_DATA) {
+        memcpy(&value, p + 10, 4);
+        packet->len = ntohl(value);
+    }
+
+    buffer_pass_bytes(f->wire, len + 4);
+    return 1;
+}
+
+static int write_all(ssh_channel channel, uint32_t len) {
+    static char data[BULK_LEN];
+    int rc;
+
+    memset(data, 'x', sizeof(data));
+    rc = ssh_channel_write(channel, data, len);
+    return rc;
+}
+
+static void torture_sched_keystroke(void **state) {
+    struct sched_fixture *f = *state;
+    struct wire_packet packet;
+    uint32_t bulk = 0;
+    int seen = 0;
+
+    assert_int_equal(write_all(f->channels[0], BULK_LEN), BULK_LEN);
+    assert_true(ssh_sched_queued(f->channels[0]) > 0);
+    assert_int_equal(write_all(f->channels[1], 1), 1);
+    finish(f);
+
+    while (next_packet(f, &packet)) {
+        assert_int_equal(packet.type, SSH2_MSG_CHANNEL_DATA);
+        if (packet.channel == 1) {
+            seen = 1;
+            /* only waited behind what the socket held already */
+            assert_true(bulk <= 2 * (SSH_SCHED_LOW_WATER + PAYLOAD_MAX));
+            assert_true(bulk < BULK_LEN);
+        } else {
+            bulk += packet.len;
+        }
+    }
+    assert_true(seen);
+    assert_int_equal(bulk, BULK_LEN);
+}
+
+static void torture_sched_round_robin(void **state) {
+    struct sched_fixture *f = *state;
+    struct wire_packet packet;
+    uint32_t total[2] = {0, 0};
+    uint32_t run = 0;
+    uint32_t last = 0;
+
+    assert_int_equal(write_all(f->channels[0], SHARE_LEN), SHARE_LEN);
+    assert_int_equal(write_all(f->channels[1], SHARE_LEN), SHARE_LEN);
+    finish(f);
+
+    while (next_packet(f, &packet)) {
+        assert_int_equal(packet.type, SSH2_MSG_CHANNEL_DATA);
+        total[packet.channel] += packet.len;
+        run = packet.channel == last ? run + packet.len : packet.len;
+        last = packet.channel;
+        /* once both have data queued they take turns */
+        if (total[1] > 0 && total[0] < SHARE_LEN && total[1] < SHARE_LEN) {
+            assert_true(run <= SSH_SCHED_QUANTUM + PAYLOAD_MAX);
+        }
+    }
+    assert_int_equal(total[0], SHARE_LEN);
+    assert_int_equal(total[1], SHARE_LEN);
+}
+
+static void torture_sched_eof_after_data(void **state) {
+    struct sched_fixture *f = *state;
+    struct wire_packet packet;
+    uint32_t bulk = 0;
+    int eof = 0;
+
+    assert_int_equal(write_all(f->channels[0], BULK_LEN), BULK_LEN);
+    assert_true(ssh_sched_queued(f->channels[0]) > 0);
+    assert_true(ssh_channel_send_eof(f->channels[0]) != SSH_ERROR);
+    assert_int_equal(ssh_sched_queued(f->channels[0]), 0);
+    finish(f);
+
+    while (next_packet(f, &packet)) {
+        if (packet.type == SSH2_MSG_CHANNEL_EOF) {
+            assert_int_equal(bulk, BULK_LEN);
+            eof = 1;
+        } else {
+            bulk += packet.len;
+        }
+    }
+    assert_true(eof);
+}
+
+static void torture_sched_queue_limit(void **state) {
+    struct sched_fixture *f = *state;
+    int written = 0;
+    int i;
+
+    /* each write queues more than a poll round moves to the socket */
+    for (i = 0; i < 8; i++) {
+        written += write_all(f->channels[0], BULK_LEN);
+    }
+    assert_true(written < 8 * BULK_LEN);
+    assert_true(ssh_sched_queued(f->channels[0]) <
+            SSH_SCHED_QUEUE_MAX + 2 * PAYLOAD_MAX);
+    finish(f);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_sched_keystroke, setup, teardown),
+        unit_test_setup_teardown(torture_sched_round_robin, setup, teardown),
+        unit_test_setup_teardown(torture_sched_eof_after_data, setup, teardown),
+        unit_test_setup_teardown(torture_sched_queue_limit, setup, teardown),
+    };
+
+    ssh_init();
+    rc=run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
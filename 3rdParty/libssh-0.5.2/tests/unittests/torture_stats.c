@@ -0,0 +1,126 @@
+#define LIBSSH_STATIC
+
+#include "torture.h"
+#include "libssh/priv.h"
+#include "libssh/session.h"
+#include "libssh/buffer.h"
+#include "libssh/channels.h"
+#include "libssh/misc.h"
+#include "libssh/ssh2.h"
+
+static void setup(void **state) {
+    ssh_session session = ssh_new();
+    *state = session;
+}
+
+static void teardown(void **state) {
+    ssh_free(*state);
+}
+
+static void torture_stats_rtt(void **state) {
+    ssh_session session = *state;
+    struct ssh_session_stats stats;
+
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    assert_true(stats.rtt_samples == 0);
+    assert_true(stats.srtt_us == 0);
+
+    /* the first sample is taken as is, later ones move it by an eighth */
+    ssh_stats_rtt_sample(session, 1000);
+    ssh_stats_rtt_sample(session, 1800);
+    ssh_stats_rtt_sample(session, 0);
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    assert_true(stats.rtt_samples == 2);
+    assert_true(stats.srtt_us == 1100);
+
+    /* replies without a timed request are ignored */
+    ssh_stats_rtt_end(session);
+    ssh_stats_rtt_start(session);
+    ssh_stats_rtt_start(session);
+    /* pretend the request went out two milliseconds ago */
+    session->rtt_probe_ns -= 2000000;
+    ssh_stats_rtt_end(session);
+    ssh_stats_rtt_end(session);
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    assert_true(stats.rtt_samples == 3);
+    assert_true(stats.srtt_us > 1100);
+}
+
+static void torture_stats_buffer_reallocs(void **state) {
+    ssh_session session = *state;
+    struct ssh_session_stats stats;
+    uint32_t before;
+    char data[1000];
+    int i;
+
+    memset(data, 'A', sizeof(data));
+
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    before = stats.buffer_reallocs;
+
+    /* sizes double, so ten kilobytes take a handful of reallocs */
+    for (i = 0; i < 10; i++) {
+        assert_true(buffer_add_data(session->out_buffer, data, sizeof(data)) == 0);
+    }
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    assert_true(stats.buffer_reallocs > before);
+    assert_true(stats.buffer_reallocs - before <= 5);
+    assert_true(stats.out_queue == 0);
+}
+
+static void torture_stats_keepalive(void **state) {
+    ssh_session session = *state;
+    struct ssh_session_stats stats;
+    uint64_t now = ssh_clock_ns();
+
+    /* not connected */
+    assert_true(ssh_send_keepalive(session) == SSH_ERROR);
+
+    /* pretend two keepalives went out three and one milliseconds ago */
+    session->keepalive_sent_ns[0] = now - 3000000;
+    session->keepalive_sent_ns[1] = now - 1000000;
+    session->keepalive_pending = 2;
+
+    /* refused is as good as accepted */
+    ssh_request_denied(session, SSH2_MSG_REQUEST_FAILURE, NULL, NULL);
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    assert_true(stats.keepalives_answered == 1);
+    assert_true(stats.keepalive_rtt_us >= 3000);
+    assert_true(stats.rtt_samples == 1);
+
+    ssh_request_success(session, SSH2_MSG_REQUEST_SUCCESS, NULL, NULL);
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    assert_true(stats.keepalives_answered == 2);
+    assert_true(stats.keepalive_rtt_us >= 1000);
+    assert_true(stats.keepalive_rtt_us < 3000);
+    assert_true(session->keepalive_pending == 0);
+
+    /* a reply nothing waits for is not taken for a keepalive */
+    ssh_request_success(session, SSH2_MSG_REQUEST_SUCCESS, NULL, NULL);
+    assert_true(ssh_get_session_stats(session, &stats) == SSH_OK);
+    assert_true(stats.keepalives_answered == 2);
+}
+
+static void torture_stats_invalid(void **state) {
+    struct ssh_session_stats stats;
+    struct ssh_channel_stats channel_stats;
+
+    assert_true(ssh_get_session_stats(NULL, &stats) == SSH_ERROR);
+    assert_true(ssh_get_session_stats(*state, NULL) == SSH_ERROR);
+    assert_true(ssh_channel_get_stats(NULL, &channel_stats) == SSH_ERROR);
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_stats_rtt, setup, teardown),
+        unit_test_setup_teardown(torture_stats_buffer_reallocs, setup, teardown),
+        unit_test_setup_teardown(torture_stats_keepalive, setup, teardown),
+        unit_test_setup_teardown(torture_stats_invalid, setup, teardown),
+    };
+
+    ssh_init();
+    rc=run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
@@ -0,0 +1,113 @@
+#define LIBSSH_STATIC
+
+#include "torture.h"
+#include "libssh/priv.h"
+#include "libssh/callbacks.h"
+#include "libssh/session.h"
+#include "libssh/trace.h"
+
+struct log_capture {
+    int lines;
+    char first[160];
+    char last[160];
+};
+
+static void log_capture_callback(ssh_session session, int priority,
+                                 const char *message, void *userdata) {
+    struct log_capture *capture = (struct log_capture *) userdata;
+
+    (void) session;
+    (void) priority;
+    if (capture->lines == 0) {
+        snprintf(capture->first, sizeof(capture->first), "%s", message);
+    }
+    snprintf(capture->last, sizeof(capture->last), "%s", message);
+    capture->lines++;
+}
+
+static struct log_capture capture;
+static struct ssh_callbacks_struct callbacks;
+
+static void setup(void **state) {
+    ssh_session session = ssh_new();
+
+    memset(&capture, 0, sizeof(capture));
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.userdata = &capture;
+    callbacks.log_function = log_capture_callback;
+    ssh_callbacks_init(&callbacks);
+    ssh_set_callbacks(session, &callbacks);
+
+    *state = session;
+}
+
+static void teardown(void **state) {
+    ssh_free(*state);
+}
+
+static void torture_trace_ring_wraps(void **state) {
+    ssh_session session = *state;
+    int size = 5;
+    int i;
+
+    assert_true(ssh_options_set(session, SSH_OPTIONS_TRACE_SIZE, &size) == 0);
+    /* rounded up to a power of two */
+    assert_int_equal(session->trace.mask, 7);
+
+    for (i = 0; i < 10; i++) {
+        ssh_trace(session, SSH_TRACE_PACKET_LEFTOVER, i, 0, 0);
+    }
+    assert_int_equal(session->trace.head, 10);
+    /* recording alone writes nothing to the log */
+    assert_int_equal(capture.lines, 0);
+
+    ssh_trace_dump(session);
+    assert_int_equal(capture.lines, 9);
+    assert_string_equal(capture.first, "Trace of 8 event(s), 2 overwritten");
+    assert_true(strstr(capture.last,
+                "Processing 9 bytes left in socket buffer") != NULL);
+
+    /* the ring is emptied by a dump */
+    assert_int_equal(session->trace.head, 0);
+    ssh_trace_dump(session);
+    assert_int_equal(capture.lines, 9);
+}
+
+static void torture_trace_disabled(void **state) {
+    ssh_session session = *state;
+    int size = 0;
+
+    ssh_trace(session, SSH_TRACE_CHANNEL_DATA, 1, 2, 0);
+    ssh_trace_dump(session);
+    assert_int_equal(capture.lines, 0);
+
+    assert_true(ssh_options_set(session, SSH_OPTIONS_TRACE_SIZE, &size) == 0);
+    assert_true(session->trace.events == NULL);
+    size = -1;
+    assert_true(ssh_options_set(session, SSH_OPTIONS_TRACE_SIZE, &size) < 0);
+}
+
+static void torture_trace_verbose_log(void **state) {
+    ssh_session session = *state;
+    int verbosity = SSH_LOG_PACKET;
+
+    /* with packet verbosity the events still reach the log as text */
+    ssh_options_set(session, SSH_OPTIONS_LOG_VERBOSITY, &verbosity);
+    ssh_trace(session, SSH_TRACE_CHANNEL_DATA, 1, 42, 0);
+    assert_int_equal(capture.lines, 1);
+    assert_string_equal(capture.first, "Channel 1 receiving 42 bytes data in 0");
+}
+
+int torture_run_tests(void) {
+    int rc;
+    const UnitTest tests[] = {
+        unit_test_setup_teardown(torture_trace_ring_wraps, setup, teardown),
+        unit_test_setup_teardown(torture_trace_disabled, setup, teardown),
+        unit_test_setup_teardown(torture_trace_verbose_log, setup, teardown),
+    };
+
+    ssh_init();
+    rc=run_tests(tests);
+    ssh_finalize();
+    return rc;
+}
@@ -13,9 +13,8 @@ _OPENSSL_HOST = "http://www.openssl.org/source/"
 _OPENSSL_FILE = "openssl-1.0.0e.tar.gz"
 _OPENSSL_DIR = "openssl-1.0.0e"
 
-_LIBSSH_HOST = "http://www.libssh.org/files/0.5/"
-_LIBSSH_FILE = "libssh-0.5.2.tar.gz"
-_LIBSSH_DIR = "libssh-0.5.2"
+# libssh is not fetched: 3rdParty/libssh-0.5.2 carries changes of our own,
+# and the plugin build compiles it from there
 
 def exe(command):
 	result = os.system(command)
@@ -52,35 +51,6 @@ def buildSSL():
 	
 	os.chdir(rootPath)
 	
-def buildSSH():
-	rootPath = os.getcwd()
-	os.chdir("3rdParty")
-	thirdPartyPath = os.getcwd() + "/"
-	
-	if not os.path.exists(_LIBSSH_FILE):
-		exe("wget " + _LIBSSH_HOST + _LIBSSH_FILE)
-
-	exe("tar xvzf " + _LIBSSH_FILE)
-
-	os.chdir(_LIBSSH_DIR)
-	if not os.path.isdir("build"):
-		exe("mkdir build")
-	os.chdir("build")
-	
-	exe("cmake -DCMAKE_C_COMPILER=" + CC + " -DCMAKE_CXX_COMPILER=" + CXX + " -DCMAKE_VERBOSE_MAKEFILE=1 -DWITH_LIBZ=OFF -DCMAKE_C_FLAGS=" + "-I" + thirdPartyPath + _OPENSSL_DIR + "/include" + " -DCMAKE_MODULE_LINKER_FLAGS=-L" + thirdPartyPath + _OPENSSL_DIR + " -DCMAKE_SHARED_LINKER_FLAGS=-L" + thirdPartyPath + _OPENSSL_DIR + " -DWITH_STATIC_LIB=ON -DOPENSSL_CRYPTO_LIBRARIES=" + thirdPartyPath + _OPENSSL_DIR + "/libcrypto.so" + " -DOPENSSL_SSL_LIBRARIES=" + thirdPartyPath + _OPENSSL_DIR + "/libssl.so" + " ..")
-	
-	exe("make clean")
-	exe("make")	
-
-	os.chdir(thirdPartyPath)
-	libPath = "lib" + sys.argv[1]
-	if not os.path.isdir(libPath):
-		exe("mkdir " + libPath)
-	exe("find " + _LIBSSH_DIR + " -name *.a -exec cp -rvf {} " + libPath + " \;")
-	#exe("find " + _LIBSSH_DIR + " -name *.so* -exec cp -rvf {} " + libPath + " \;")
-		
-	os.chdir(rootPath)
-	
 if __name__ == '__main__':
 	if len(sys.argv) != 2:
 		print "[usage] ./beagleTerm3rdPartyBuilder.py 32 or 64"
@@ -99,7 +69,6 @@ if __name__ == '__main__':
 		os.system("mkdir 3rdParty")
 	
 	buildSSL()
-	buildSSH()
 	
 	exit("Build completed")
 	
@@ -3,6 +3,11 @@
  */
 var VT100 = {};
 
+/**
+ * Lines of scrollback kept before the oldest are dropped.
+ */
+VT100.MAX_LINES = 1000000;
+
 /**
  * Class implementing an VT100 style console.
  * @param {string} $container jquery object of console html element.
@@ -12,9 +17,14 @@ VT100.init = function($container, beaglePluginId) {
 	console.log('VT100.init');
 	this.$container = $container;
 	this.beagleTerm = document.getElementById(beaglePluginId);
+	this.scrollback = new VT100.Scrollback(VT100.MAX_LINES);
+	this.parser = new VT100.Parser(this.scrollback);
 	this.style();
+	this.measureCell();
 	this.bindKeyEvent();	
 	this.bindResizeEvent();
+	this.bindScrollEvent();
+	this.resize(window.innerWidth, window.innerHeight);
 	
 };
 
@@ -24,7 +34,9 @@ VT100.init = function($container, beaglePluginId) {
 VT100.style = function() {
 	this.$container.css('color', 'white')
 						.css('background-color', 'black')
-						.css('font-family', 'sans-serif')
+						.css('font-family', 'monospace')
+						.css('white-space', 'pre')
+						.css('overflow', 'hidden')
 						.css('width', window.innerWidth + 'px')
 						.css('height', window.innerHeight + 'px');
 }	
@@ -48,6 +60,16 @@ VT100.bindKeyEvent = function() {
 }
 
 
+/**
+ * Measure the size of a character cell in the font of the console.
+ */
+VT100.measureCell = function() {
+	var $cell = $('<span>M</span>').appendTo(this.$container);
+	this.cellWidth = $cell.width() || 8;
+	this.cellHeight = $cell.height() || 16;
+	$cell.remove();
+};
+
 /**
  * Bind an event handler to the 'resize' Javascript event of root window.
  */
@@ -66,6 +88,38 @@ VT100.bindResizeEvent = function() {
 VT100.resize = function(width, height) {
 	this.$container.css('width', width + 'px')
 						.css('height', height + 'px');		
+
+	var columns = Math.max(1, Math.floor(width / this.cellWidth));
+	var rows = Math.max(1, Math.floor(height / this.cellHeight));
+	if (columns == this.columns && rows == this.rows)
+		return;
+
+	// The screen follows the drag; the plugin tells the server once it settles
+	this.columns = columns;
+	this.rows = rows;
+	this.render();
+
+	if (this.beagleTerm && this.beagleTerm.resize)
+		this.beagleTerm.resize(columns, rows);
+};
+
+/**
+ * Bind an event handler to the 'mousewheel' Javascript event of the console.
+ */
+VT100.bindScrollEvent = function() {
+	this.$container.bind('mousewheel', function(event) {
+		var rows = event.originalEvent.wheelDelta > 0 ? -3 : 3;
+		VT100.scrollback.scroll(rows, VT100.columns, VT100.rows);
+		VT100.render();
+		return false;
+	});
+};
+
+/**
+ * Draw the rows of the scrollback in the viewport.
+ */
+VT100.render = function() {
+	this.$container.text(this.scrollback.view(this.columns, this.rows).join('\n'));
 };
 
 /**
@@ -76,6 +130,8 @@ VT100.write = function(str) {
 	for (var i = 0; i < str.length; i++) {
 		this.writeChar(str.charAt(i));
 	}
+	this.parser.write(str);
+	this.render();
 };
 
 /**
@@ -94,6 +150,423 @@ VT100.sendKey = function(keyCode) {
 	this.beagleTerm.write(keyCode)
 };
 
+/**
+ * Class keeping the scrollback as logical lines, wrapped only as they are
+ * shown. The rows each line wraps into are cached per width, so a resize
+ * costs the rows in the viewport rather than the whole history.
+ * @param {number} maxLines Lines kept before the oldest are dropped.
+ * @constructor
+ */
+VT100.Scrollback = function(maxLines) {
+	this.lines_ = [''];
+	// Cursor in the last line
+	this.column_ = 0;
+	this.maxLines_ = maxLines;
+	this.wraps_ = {};
+	this.widths_ = [];
+	// Top of the viewport as a line and a character offset in it, so the
+	// same text stays on top across resizes; null follows the output
+	this.top_ = null;
+};
+
+/**
+ * Widths whose wrap index is kept, most recently used last.
+ */
+VT100.Scrollback.WRAP_WIDTHS = 4;
+
+/**
+ * Write output at the cursor in the last line, and the lines after it.
+ * @param {string} str Text with no escape sequences; of the control
+ *     characters, only CR, LF, BS and TAB.
+ */
+VT100.Scrollback.prototype.append = function(str) {
+	var last = this.lines_.length - 1;
+	var line = this.lines_[last];
+	var column = this.column_;
+	var start = 0;
+
+	for (var i = 0; i <= str.length; i++) {
+		var ch = str.charAt(i);
+		if (i < str.length && ch != '\r' && ch != '\n' && ch != '\b' && ch != '\t')
+			continue;
 
+		if (i > start) {
+			line = this.overwrite_(line, column, str.substring(start, i));
+			column += i - start;
+		}
+		start = i + 1;
 
+		if (ch == '\r') {
+			column = 0;
+		} else if (ch == '\b') {
+			column = Math.max(0, column - 1);
+		} else if (ch == '\t') {
+			column = (Math.floor(column / 8) + 1) * 8;
+		} else if (ch == '\n') {
+			this.lines_[last] = line;
+			this.invalidate_(last);
+			this.lines_.push('');
+			last++;
+			line = '';
+			column = 0;
+		}
+	}
+	this.lines_[last] = line;
+	this.invalidate_(last);
+	this.column_ = column;
 
+	// Dropped in batches, as every drop shifts the whole history
+	var drop = this.lines_.length - this.maxLines_;
+	if (drop > this.maxLines_ / 10) {
+		this.lines_.splice(0, drop);
+		for (var w = 0; w < this.widths_.length; w++)
+			this.wraps_[this.widths_[w]].splice(0, drop);
+		if (this.top_)
+			this.top_ = this.top_.line < drop ? { line: 0, offset: 0 } : { line: this.top_.line - drop, offset: this.top_.offset };
+	}
+};
+
+/**
+ * Rows of the viewport, wrapped to width.
+ * @param {number} width Columns of the viewport.
+ * @param {number} height Rows of the viewport.
+ * @return {Array.<string>} Up to height rows.
+ */
+VT100.Scrollback.prototype.view = function(width, height) {
+	var pos = this.top_ ? this.fromOffset_(this.top_, width) : this.bottomTop_(width, height);
+	var rows = [];
+
+	while (rows.length < height && pos.line < this.lines_.length) {
+		rows.push(this.lines_[pos.line].substr(pos.row * width, width));
+		if (++pos.row >= this.rows_(pos.line, width)) {
+			pos.line++;
+			pos.row = 0;
+		}
+	}
+	return rows;
+};
+
+/**
+ * Move the viewport.
+ * @param {number} delta Rows to move, negative towards older output.
+ * @param {number} width Columns of the viewport.
+ * @param {number} height Rows of the viewport.
+ */
+VT100.Scrollback.prototype.scroll = function(delta, width, height) {
+	var bottom = this.bottomTop_(width, height);
+	var pos = this.top_ ? this.fromOffset_(this.top_, width) : bottom;
+
+	if (delta < 0)
+		this.up_(pos, -delta, width);
+	else
+		this.down_(pos, delta, width);
+
+	// Back at the bottom, the viewport follows the output again
+	if (pos.line > bottom.line || (pos.line == bottom.line && pos.row >= bottom.row))
+		this.top_ = null;
+	else
+		this.top_ = { line: pos.line, offset: pos.row * width };
+};
+
+/**
+ * Move the cursor along the last line.
+ * @param {number} delta Columns to move, negative to the left.
+ */
+VT100.Scrollback.prototype.moveCursor = function(delta) {
+	this.column_ = Math.max(0, this.column_ + delta);
+};
+
+/**
+ * Put the cursor at a column of the last line.
+ * @param {number} column Column, from 0.
+ */
+VT100.Scrollback.prototype.setColumn = function(column) {
+	this.column_ = Math.max(0, column);
+};
+
+/**
+ * Edit the last line at the cursor.
+ * @param {string} op 'erase' to the end (0), from the start (1) or the whole
+ *     line (2), 'delete', 'insert' or 'blank' count characters.
+ * @param {number} count Mode for 'erase', characters for the others.
+ */
+VT100.Scrollback.prototype.edit = function(op, count) {
+	var last = this.lines_.length - 1;
+	var line = this.lines_[last];
+	var column = this.column_;
+
+	if (op == 'erase') {
+		if (count == 0)
+			line = line.substring(0, column);
+		else if (count == 1)
+			line = this.overwrite_(line, 0, VT100.Scrollback.spaces_(Math.min(column + 1, line.length)));
+		else if (count == 2)
+			line = '';
+	} else if (op == 'delete') {
+		line = line.substring(0, column) + line.substring(column + count);
+	} else if (op == 'insert') {
+		if (column < line.length)
+			line = line.substring(0, column) + VT100.Scrollback.spaces_(count) + line.substring(column);
+	} else if (op == 'blank') {
+		if (column < line.length)
+			line = this.overwrite_(line, column, VT100.Scrollback.spaces_(Math.min(count, line.length - column)));
+	}
+	this.lines_[last] = line;
+	this.invalidate_(last);
+};
+
+/**
+ * Write text over a line from a column, padding the line with blanks up to it.
+ * @param {string} line Line of output.
+ * @param {number} column Column to write from.
+ * @param {string} text Text to write.
+ * @return {string} Line as shown.
+ */
+VT100.Scrollback.prototype.overwrite_ = function(line, column, text) {
+	if (line.length < column)
+		line += VT100.Scrollback.spaces_(column - line.length);
+	return line.substring(0, column) + text + line.substring(column + text.length);
+};
+
+/**
+ * A run of blanks.
+ * @param {number} n Length.
+ * @return {string} n spaces.
+ */
+VT100.Scrollback.spaces_ = function(n) {
+	return n > 0 ? new Array(n + 1).join(' ') : '';
+};
+
+/**
+ * Rows a line wraps into at width, computed once per width.
+ * @param {number} index Index of the line.
+ * @param {number} width Columns to wrap at.
+ * @return {number} Rows, at least one.
+ */
+VT100.Scrollback.prototype.rows_ = function(index, width) {
+	var wraps = this.wrapIndex_(width);
+	var rows = wraps[index];
+	if (rows === undefined) {
+		rows = Math.max(1, Math.ceil(this.lines_[index].length / width));
+		wraps[index] = rows;
+	}
+	return rows;
+};
+
+/**
+ * The wrap index of a width, made room for among the widths cached.
+ * @param {number} width Columns to wrap at.
+ * @return {Array.<number>} Rows of each line, undefined where not computed.
+ */
+VT100.Scrollback.prototype.wrapIndex_ = function(width) {
+	var last = this.widths_.length - 1;
+	if (this.widths_[last] == width)
+		return this.wraps_[width];
+
+	var i = this.widths_.indexOf(width);
+	if (i >= 0) {
+		this.widths_.splice(i, 1);
+	} else {
+		this.wraps_[width] = [];
+		if (this.widths_.length >= VT100.Scrollback.WRAP_WIDTHS)
+			delete this.wraps_[this.widths_.shift()];
+	}
+	this.widths_.push(width);
+	return this.wraps_[width];
+};
+
+/**
+ * Forget the rows of a line that changed, at every width.
+ * @param {number} index Index of the line.
+ */
+VT100.Scrollback.prototype.invalidate_ = function(index) {
+	for (var i = 0; i < this.widths_.length; i++)
+		this.wraps_[this.widths_[i]][index] = undefined;
+};
+
+/**
+ * Row position of a line and character offset at width.
+ */
+VT100.Scrollback.prototype.fromOffset_ = function(top, width) {
+	var line = Math.min(top.line, this.lines_.length - 1);
+	var row = Math.min(Math.floor(top.offset / width), this.rows_(line, width) - 1);
+	return { line: line, row: row };
+};
+
+/**
+ * Top row of the viewport when it shows the latest output.
+ */
+VT100.Scrollback.prototype.bottomTop_ = function(width, height) {
+	var last = this.lines_.length - 1;
+	var pos = { line: last, row: this.rows_(last, width) - 1 };
+	this.up_(pos, height - 1, width);
+	return pos;
+};
+
+/**
+ * Move a row position towards older output, stopping at the first row.
+ */
+VT100.Scrollback.prototype.up_ = function(pos, n, width) {
+	while (n > 0) {
+		if (pos.row >= n) {
+			pos.row -= n;
+			return;
+		}
+		if (pos.line == 0) {
+			pos.row = 0;
+			return;
+		}
+		n -= pos.row + 1;
+		pos.line--;
+		pos.row = this.rows_(pos.line, width) - 1;
+	}
+};
+
+/**
+ * Move a row position towards newer output, stopping at the last row.
+ */
+VT100.Scrollback.prototype.down_ = function(pos, n, width) {
+	while (n > 0) {
+		var rows = this.rows_(pos.line, width);
+		if (pos.row + n < rows) {
+			pos.row += n;
+			return;
+		}
+		if (pos.line == this.lines_.length - 1) {
+			pos.row = rows - 1;
+			return;
+		}
+		n -= rows - pos.row;
+		pos.line++;
+		pos.row = 0;
+	}
+};
+
+/**
+ * Class taking the escape sequences out of the server output before it
+ * reaches the scrollback. Sequences that edit the current line are applied
+ * to it; colours, modes and everything that moves to other lines are
+ * dropped. A sequence cut by the end of one output is finished in the next.
+ * @param {VT100.Scrollback} scrollback Scrollback the text goes to.
+ * @constructor
+ */
+VT100.Parser = function(scrollback) {
+	this.scrollback_ = scrollback;
+	this.state_ = VT100.Parser.GROUND;
+	this.sequence_ = '';
+};
+
+/**
+ * States of the parser.
+ */
+VT100.Parser.GROUND = 0;
+VT100.Parser.ESCAPE = 1;
+VT100.Parser.CSI = 2;
+VT100.Parser.STRING = 3;
+VT100.Parser.STRING_ESCAPE = 4;
+
+/**
+ * Longest control sequence kept.
+ */
+VT100.Parser.MAX_SEQUENCE = 32;
+
+/**
+ * Parse server output.
+ * @param {string} str Output as read from the plugin.
+ */
+VT100.Parser.prototype.write = function(str) {
+	var text = '';
+
+	for (var i = 0; i < str.length; i++) {
+		var ch = str.charAt(i);
+		var code = str.charCodeAt(i);
+
+		switch (this.state_) {
+		case VT100.Parser.GROUND:
+			if (ch == '\x1b') {
+				this.scrollback_.append(text);
+				text = '';
+				this.sequence_ = '';
+				this.state_ = VT100.Parser.ESCAPE;
+			} else if (code >= 0x20 || ch == '\r' || ch == '\n' || ch == '\b' || ch == '\t') {
+				text += ch;
+			}
+			break;
+		case VT100.Parser.ESCAPE:
+			if (ch == '[') {
+				this.state_ = VT100.Parser.CSI;
+			} else if (ch == ']' || ch == 'P' || ch == 'X' || ch == '^' || ch == '_') {
+				// OSC, DCS and the like, as the window title
+				this.state_ = VT100.Parser.STRING;
+			} else if (code == 0x1b) {
+				this.sequence_ = '';
+			} else if (code < 0x20 || code >= 0x30) {
+				this.state_ = VT100.Parser.GROUND;
+			}
+			break;
+		case VT100.Parser.CSI:
+			if (code >= 0x40 && code < 0x7f) {
+				this.control_(ch);
+				this.state_ = VT100.Parser.GROUND;
+			} else if (code >= 0x20) {
+				if (this.sequence_.length < VT100.Parser.MAX_SEQUENCE)
+					this.sequence_ += ch;
+			} else if (ch == '\x1b') {
+				this.sequence_ = '';
+				this.state_ = VT100.Parser.ESCAPE;
+			} else if (code == 0x18 || code == 0x1a) {
+				this.state_ = VT100.Parser.GROUND;
+			}
+			break;
+		case VT100.Parser.STRING:
+			if (code == 0x07 || code == 0x18 || code == 0x1a)
+				this.state_ = VT100.Parser.GROUND;
+			else if (ch == '\x1b')
+				this.state_ = VT100.Parser.STRING_ESCAPE;
+			break;
+		case VT100.Parser.STRING_ESCAPE:
+			this.sequence_ = '';
+			this.state_ = ch == '\\' ? VT100.Parser.GROUND : VT100.Parser.ESCAPE;
+			if (this.state_ == VT100.Parser.ESCAPE)
+				i--;
+			break;
+		}
+	}
+	this.scrollback_.append(text);
+};
+
+/**
+ * Apply a control sequence that edits the current line.
+ * @param {string} final Final character of the sequence.
+ */
+VT100.Parser.prototype.control_ = function(final) {
+	// Private sequences, as ESC [ ? 1049 h, change modes only
+	if (/^[<=>?]/.test(this.sequence_))
+		return;
+
+	var n = parseInt(this.sequence_, 10) || 0;
+	var count = Math.max(1, n);
+	switch (final) {
+	case 'C':
+		this.scrollback_.moveCursor(count);
+		break;
+	case 'D':
+		this.scrollback_.moveCursor(-count);
+		break;
+	case 'G':
+		this.scrollback_.setColumn(count - 1);
+		break;
+	case 'K':
+		this.scrollback_.edit('erase', n);
+		break;
+	case 'P':
+		this.scrollback_.edit('delete', count);
+		break;
+	case '@':
+		this.scrollback_.edit('insert', count);
+		break;
+	case 'X':
+		this.scrollback_.edit('blank', count);
+		break;
+	}
+};
@@ -36,6 +36,8 @@ set (FB_SCRIPTINGCORE_SOURCE_DIR "${FB_SOURCE_DIR}/ScriptingCore")
 set (FB_SCRIPTINGCORE_BUILD_DIR "${FB_BUILD_DIR}/ScriptingCore")
 set (FB_SCRIPTINGCORETEST_SOURCE_DIR "${FB_TEST_DIR}/ScriptingCoreTest")
 set (FB_SCRIPTINGCORETEST_BUILD_DIR "${FB_BUILD_DIR}/ScriptingCoreTest")
+set (FB_SCRIPTINGCOREBENCH_SOURCE_DIR "${FB_TEST_DIR}/ScriptingCoreBench")
+set (FB_SCRIPTINGCOREBENCH_BUILD_DIR "${FB_BUILD_DIR}/ScriptingCoreBench")
 
 set (FB_PLUGINCORE_SOURCE_DIR "${FB_SOURCE_DIR}/PluginCore")
 set (FB_PLUGINCORE_BUILD_DIR "${FB_BUILD_DIR}/PluginCore")
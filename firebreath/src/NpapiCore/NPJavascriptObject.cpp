@@ -20,6 +20,94 @@ Copyright 2009 Richard Bateman, Firebreath development team
 
 using namespace FB::Npapi;
 
+namespace {
+    // Takes the shared argument list for the duration of a call and empties it afterwards
+    struct ArgumentsLock
+    {
+        ArgumentsLock(std::vector<FB::variant>& args, bool& inUse)
+            : args(args), inUse(inUse), owner(!inUse)
+        {
+            inUse = true;
+        }
+        ~ArgumentsLock()
+        {
+            args.clear();
+            if (owner)
+                inUse = false;
+        }
+
+        std::vector<FB::variant>& args;
+        bool& inUse;
+        bool owner;
+    };
+
+    // Hands the NPVariants of a call to a FB::TypedMethod without converting them to FB::variant
+    class NPVariantArguments : public FB::TypedArguments
+    {
+    public:
+        NPVariantArguments(const NPVariant *args, uint32_t argCount)
+            : m_args(args), m_argCount(argCount) {}
+
+        size_t size() const { return m_argCount; }
+        bool get(size_t index, int& value) const
+        {
+            if (!NPVARIANT_IS_INT32(m_args[index]))
+                return false;
+            value = NPVARIANT_TO_INT32(m_args[index]);
+            return true;
+        }
+        bool get(size_t index, double& value) const
+        {
+            if (!NPVARIANT_IS_DOUBLE(m_args[index]))
+                return false;
+            value = NPVARIANT_TO_DOUBLE(m_args[index]);
+            return true;
+        }
+        bool get(size_t index, bool& value) const
+        {
+            if (!NPVARIANT_IS_BOOLEAN(m_args[index]))
+                return false;
+            value = NPVARIANT_TO_BOOLEAN(m_args[index]);
+            return true;
+        }
+        bool get(size_t index, std::string& value) const
+        {
+            if (!NPVARIANT_IS_STRING(m_args[index]))
+                return false;
+            const NPString& str(NPVARIANT_TO_STRING(m_args[index]));
+            value.assign(str.UTF8Characters, str.UTF8Length);
+            return true;
+        }
+
+    private:
+        const NPVariant *m_args;
+        uint32_t m_argCount;
+    };
+
+    // Writes the return value of a FB::TypedMethod the same way NpapiBrowserHost::getNPVariant would
+    class NPVariantResult : public FB::TypedResult
+    {
+    public:
+        NPVariantResult(const NpapiBrowserHostPtr& host, NPVariant *result)
+            : m_host(host), m_result(result) {}
+
+        void setVoid() { VOID_TO_NPVARIANT(*m_result); }
+        void set(int value) { INT32_TO_NPVARIANT(value, *m_result); }
+        void set(double value) { DOUBLE_TO_NPVARIANT(value, *m_result); }
+        void set(bool value) { BOOLEAN_TO_NPVARIANT(value, *m_result); }
+        void set(const std::string& value)
+        {
+            char *outStr = (char*)m_host->MemAlloc(value.size() + 1);
+            memcpy(outStr, value.c_str(), value.size() + 1);
+            STRINGN_TO_NPVARIANT(outStr, value.size(), *m_result);
+        }
+
+    private:
+        const NpapiBrowserHostPtr& m_host;
+        NPVariant *m_result;
+    };
+}
+
 NPJavascriptObject *NPJavascriptObject::NewObject(const NpapiBrowserHostPtr& host, const FB::JSAPIWeakPtr& api, bool auto_release/* = false*/)
 {
     NPJavascriptObject *obj = static_cast<NPJavascriptObject *>(host->CreateObject(&NPJavascriptObjectClass));
@@ -38,7 +126,7 @@ bool NPJavascriptObject::isNPJavaScriptObject(const NPObject* const npo)
 }
 
 NPJavascriptObject::NPJavascriptObject(NPP npp)
-    : m_valid(true), m_autoRelease(false), m_addEventFunc(boost::make_shared<NPO_addEventListener>(this)),
+    : m_valid(true), m_autoRelease(false), m_argsInUse(false), m_addEventFunc(boost::make_shared<NPO_addEventListener>(this)),
     m_removeEventFunc(boost::make_shared<NPO_removeEventListener>(this))
 {
     m_sharedRef = boost::make_shared<FB::ShareableReference<NPJavascriptObject> >(this);
@@ -57,6 +145,14 @@ void NPJavascriptObject::setAPI(const FB::JSAPIWeakPtr& api, const NpapiBrowserH
 {
     m_api = api;
     m_browser = host;
+    clearMethodCache();
+}
+
+void NPJavascriptObject::clearMethodCache()
+{
+    for (int i = 0; i < METHOD_CACHE_SIZE; i++) {
+        m_methodCache[i] = MethodCacheEntry();
+    }
 }
 
 void NPJavascriptObject::Invalidate()
@@ -120,18 +216,43 @@ bool NPJavascriptObject::Invoke(NPIdentifier name, const NPVariant *args, uint32
     VOID_TO_NPVARIANT(*result);
     if (!isValid()) return false;
     try {
-        std::string mName;
         NpapiBrowserHostPtr browser(getHost());
+        FB::JSAPIPtr api(getAPI());
+
         if (name != NULL) {
-            mName = browser->StringFromIdentifier(name);
+            // Plain int, double, bool and string signatures skip the variant list altogether
+            MethodCacheEntry& entry(m_methodCache[methodCacheSlot(name)]);
+            if (entry.id == name && entry.method.typed) {
+                NPVariantArguments typedArgs(args, argCount);
+                NPVariantResult typedResult(browser, result);
+                if (api->InvokeResolved(entry.method, typedArgs, typedResult))
+                    return true;
+            }
         }
-        std::vector<FB::variant> vArgs;
+
+        // A call made from inside another one gets its own list
+        std::vector<FB::variant> nestedArgs;
+        ArgumentsLock argsLock(m_argsInUse ? nestedArgs : m_args, m_argsInUse);
+        std::vector<FB::variant>& vArgs(argsLock.args);
+        vArgs.reserve(argCount);
         for (unsigned int i = 0; i < argCount; i++) {
             vArgs.push_back(browser->getVariant(&args[i]));
         }
 
-        // Default method call
-        FB::variant ret = getAPI()->Invoke(mName, vArgs);
+        FB::variant ret;
+        if (name == NULL) {
+            // Default method call
+            ret = api->Invoke("", vArgs);
+        } else {
+            MethodCacheEntry& entry(m_methodCache[methodCacheSlot(name)]);
+            if (entry.id != name || !api->InvokeResolved(entry.method, vArgs, ret)) {
+                // Not resolved yet, or the method changed since
+                std::string mName(browser->StringFromIdentifier(name));
+                entry.id = api->ResolveMethod(mName, entry.method) ? name : NULL;
+                if (entry.id == NULL || !api->InvokeResolved(entry.method, vArgs, ret))
+                    ret = api->Invoke(mName, vArgs);
+            }
+        }
         browser->getNPVariant(result, ret);
         return true;
     } catch (const std::bad_cast&) {
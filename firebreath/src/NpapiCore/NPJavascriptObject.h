@@ -66,6 +66,25 @@ namespace FB { namespace Npapi {
     private:
         NPJavascriptObject(NPP npp);
 
+        // Methods already resolved by identifier, so hot calls skip the name conversion and lookups
+        struct MethodCacheEntry
+        {
+            MethodCacheEntry() : id(NULL) {}
+            NPIdentifier id;
+            FB::MethodHandle method;
+        };
+        enum { METHOD_CACHE_SIZE = 32 };
+        static size_t methodCacheSlot(NPIdentifier name)
+        {
+            return (reinterpret_cast<size_t>(name) >> 3) % METHOD_CACHE_SIZE;
+        }
+        void clearMethodCache();
+
+        MethodCacheEntry m_methodCache[METHOD_CACHE_SIZE];
+        // Reused for the arguments of each call, unless a call is already using it
+        std::vector<FB::variant> m_args;
+        bool m_argsInUse;
+
     protected:
         void Invalidate();
         bool HasMethod(NPIdentifier name);
@@ -0,0 +1,132 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <boost/scoped_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+#include "FactoryBase.h"
+#include "logging.h"
+#include "AsyncLog.h"
+
+#include "precompiled_headers.h" // On windows, everything above this line in PCH
+
+#ifdef FB_WIN
+#include <windows.h>
+#endif
+
+namespace
+{
+    boost::scoped_ptr<FB::Log::AsyncLogWriter> writer;
+
+#ifdef FB_WIN
+    class DebugOutputLogSink : public FB::Log::LogSink
+    {
+    public:
+        void write(const std::string& line)
+        {
+            OutputDebugStringA((line + "\n").c_str());
+        }
+    };
+#endif
+
+    class FileLogSink : public FB::Log::LogSink
+    {
+    public:
+        explicit FileLogSink(const std::string& filename) : m_file(filename.c_str(), std::ios::out | std::ios::app) {}
+        bool isOpen() const { return m_file.is_open(); }
+        void write(const std::string& line) { m_file << line << '\n'; }
+        void flush() { m_file.flush(); }
+
+    private:
+        std::ofstream m_file;
+    };
+
+    void log(FB::Log::LogLevel level, const std::string& msg, const char *file, int line, const char *fn)
+    {
+        if (writer)
+            writer->log(level, msg, file, line, fn);
+    }
+}
+
+void FB::Log::initLogging()
+{
+    if (writer)
+        return;
+
+    FB::Log::LogMethodList mlist;
+    getFactoryInstance()->getLoggingMethods(mlist);
+
+    boost::scoped_ptr<FB::Log::AsyncLogWriter> newWriter(new FB::Log::AsyncLogWriter());
+    bool addedSink = false;
+    for (FB::Log::LogMethodList::const_iterator it = mlist.begin(); it != mlist.end(); ++it) {
+        switch( it->first ) {
+        case FB::Log::LogMethod_Console: {
+#ifdef FB_WIN
+            newWriter->addSink(boost::make_shared<DebugOutputLogSink>());
+#else
+            newWriter->addSink(FB::Log::LogSinkPtr(new FB::Log::OstreamLogSink(std::cout)));
+#endif
+            addedSink = true;
+            } break;
+        case FB::Log::LogMethod_File: {
+            boost::shared_ptr<FileLogSink> fileSink(boost::make_shared<FileLogSink>(it->second));
+            if (fileSink->isOpen()) {
+                newWriter->addSink(fileSink);
+                addedSink = true;
+            }
+          }
+        }
+    }
+
+    // Without anywhere to write to, don't start a thread just to discard messages
+    if (!addedSink)
+        return;
+
+    newWriter->setLevel(getFactoryInstance()->getLogLevel());
+    newWriter->start();
+    writer.swap(newWriter);
+}
+
+void FB::Log::stopLogging()
+{
+    writer.reset();
+}
+
+void FB::Log::trace(const std::string&, const std::string& msg, const char *file, int line, const char *fn)
+{
+    log(FB::Log::LogLevel_Trace, msg, file, line, fn);
+}
+void FB::Log::debug(const std::string&, const std::string& msg, const char *file, int line, const char *fn)
+{
+    log(FB::Log::LogLevel_Debug, msg, file, line, fn);
+}
+void FB::Log::info(const std::string&, const std::string& msg, const char *file, int line, const char *fn)
+{
+    log(FB::Log::LogLevel_Info, msg, file, line, fn);
+}
+void FB::Log::warn(const std::string&, const std::string& msg, const char *file, int line, const char *fn)
+{
+    log(FB::Log::LogLevel_Warn, msg, file, line, fn);
+}
+void FB::Log::error(const std::string&, const std::string& msg, const char *file, int line, const char *fn)
+{
+    log(FB::Log::LogLevel_Error, msg, file, line, fn);
+}
+void FB::Log::fatal(const std::string&, const std::string& msg, const char *file, int line, const char *fn)
+{
+    log(FB::Log::LogLevel_Error, msg, file, line, fn);
+}
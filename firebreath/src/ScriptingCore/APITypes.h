@@ -238,6 +238,9 @@ namespace FB
     // JSAPI methods
 
     class JSAPI;
+    class TypedMethod;
+    class TypedArguments;
+    class TypedResult;
     /// @brief  Defines an alias representing a function ptr for a method on a FB::JSAPISimple object
     typedef variant (JSAPI::*CallMethodPtr)(const std::vector<variant>&);
     /// @brief Used by FB::JSAPISimple to store information about a method
@@ -300,6 +303,18 @@ namespace FB
     /// @brief  Defines an alias representing a map of method functors used by FB::JSAPIAuto
     typedef std::map<std::string, MethodFunctors> MethodFunctorMap;
 
+    /// @brief  A method resolved once by FB::JSAPI::ResolveMethod so later calls can skip the lookup
+    ///         by name; only valid while generation matches the one of the object that resolved it
+    struct MethodHandle
+    {
+        const CallMethodFunctor* call;
+        /// Set if the method also takes the FB::TypedArguments shortcut
+        const TypedMethod* typed;
+        SecurityZone zone;
+        unsigned int generation;
+        MethodHandle() : call(NULL), typed(NULL), zone(SecurityScope_Public), generation(0) {}
+    };
+
     // new style JSAPI properties
 
     /// @brief  Defines an alias representing a property getter functor used by FB::JSAPIAuto
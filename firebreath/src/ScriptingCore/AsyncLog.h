@@ -0,0 +1,270 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#ifndef H_FB_AsyncLog
+#define H_FB_AsyncLog
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <ostream>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "logging.h"
+#include "LockFreeQueue.h"
+
+namespace FB { namespace Log {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  LogSink
+    ///
+    /// @brief  Destination for the lines written by FB::Log::AsyncLogWriter. Only ever called from the
+    ///         writer thread.
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class LogSink
+    {
+    public:
+        virtual ~LogSink() {}
+        virtual void write(const std::string& line) = 0;
+        // Called once the writer has caught up with the queue
+        virtual void flush() {}
+    };
+    typedef boost::shared_ptr<LogSink> LogSinkPtr;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  OstreamLogSink
+    ///
+    /// @brief  Writes log lines to a std::ostream, flushing it only when the writer runs out of lines
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class OstreamLogSink : public LogSink
+    {
+    public:
+        explicit OstreamLogSink(std::ostream& os) : m_os(os) {}
+        void write(const std::string& line) { m_os << line << '\n'; }
+        void flush() { m_os.flush(); }
+
+    private:
+        std::ostream& m_os;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  AsyncLogWriter
+    ///
+    /// @brief  Hands log messages over to a writer thread through a FB::LockFreeQueue
+    ///
+    /// log() filters on the level, copies the message into a record and pushes it onto the ring; it
+    /// never does I/O or waits on the writer thread. When the ring is full the message is dropped and
+    /// counted, and the writer reports how many were lost with the next line it writes.
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class AsyncLogWriter : boost::noncopyable
+    {
+    private:
+        struct Record
+        {
+            LogLevel level;
+            boost::posix_time::ptime time;
+            std::string msg;
+            const char* file;
+            int line;
+            const char* fn;
+        };
+
+    public:
+        explicit AsyncLogWriter(size_t capacity = 4096)
+            : m_queue(capacity), m_level(LogLevel_Trace), m_running(false), m_dropped(0)
+        {
+        }
+
+        ~AsyncLogWriter()
+        {
+            stop();
+
+            Record* rec;
+            while (m_queue.try_pop(rec))
+                delete rec;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void AsyncLogWriter::addSink(const LogSinkPtr& sink)
+        ///
+        /// @brief  Adds a destination for log lines. Must be called before start().
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void addSink(const LogSinkPtr& sink)
+        {
+            m_sinks.push_back(sink);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void AsyncLogWriter::setLevel(LogLevel level)
+        ///
+        /// @brief  Messages below this level are discarded by log() before they are copied.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void setLevel(LogLevel level)
+        {
+            m_level = level;
+        }
+
+        bool enabled(LogLevel level) const
+        {
+            return level >= m_level;
+        }
+
+        void start()
+        {
+            if (m_running)
+                return;
+
+            m_running = true;
+            m_thread = boost::thread(&AsyncLogWriter::run, this);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void AsyncLogWriter::stop()
+        ///
+        /// @brief  Writes out everything logged so far and stops the writer thread.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void stop()
+        {
+            if (!m_running)
+                return;
+
+            m_running = false;
+            // A null record tells the writer to finish
+            m_queue.push(NULL);
+            m_thread.join();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void AsyncLogWriter::log(LogLevel level, const std::string& msg, const char* file, int line, const char* fn)
+        ///
+        /// @brief  Queues a message for the writer thread. Safe to call from any thread.
+        ///
+        /// @return false if the message was filtered out or dropped
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool log(LogLevel level, const std::string& msg, const char* file, int line, const char* fn)
+        {
+            if (!m_running || !enabled(level))
+                return false;
+
+            Record* rec = new Record;
+            rec->level = level;
+            rec->time = boost::posix_time::microsec_clock::local_time();
+            rec->msg = msg;
+            rec->file = file;
+            rec->line = line;
+            rec->fn = fn;
+
+            if (!m_queue.try_push(rec)) {
+                delete rec;
+                using namespace FB::detail::lockfree;
+                atomic_t dropped;
+                do {
+                    dropped = load(&m_dropped);
+                } while (!cas(&m_dropped, dropped, dropped + 1));
+                return false;
+            }
+            return true;
+        }
+
+        static const char* levelName(LogLevel level)
+        {
+            switch (level) {
+            case LogLevel_Trace: return "TRACE";
+            case LogLevel_Debug: return "DEBUG";
+            case LogLevel_Info:  return "INFO ";
+            case LogLevel_Warn:  return "WARN ";
+            default:             return "ERROR";
+            }
+        }
+
+    private:
+        void run()
+        {
+            Record* rec;
+            bool stopping = false;
+            while (!stopping) {
+                m_queue.wait_and_pop(rec);
+                do {
+                    if (!rec) {
+                        stopping = true;
+                        break;
+                    }
+                    write(*rec);
+                    delete rec;
+                } while (m_queue.try_pop(rec));
+
+                for (size_t i = 0; i < m_sinks.size(); i++)
+                    m_sinks[i]->flush();
+            }
+        }
+
+        void write(const Record& rec)
+        {
+            using namespace FB::detail::lockfree;
+            atomic_t dropped = load(&m_dropped);
+            if (dropped && cas(&m_dropped, dropped, 0)) {
+                std::ostringstream os;
+                os << dropped << " log message(s) dropped, the log queue was full";
+                writeLine(format(LogLevel_Warn, rec.time, os.str(), __FILE__, __LINE__, "FB::Log::AsyncLogWriter"));
+            }
+            writeLine(format(rec.level, rec.time, rec.msg, rec.file, rec.line, rec.fn));
+        }
+
+        void writeLine(const std::string& line)
+        {
+            for (size_t i = 0; i < m_sinks.size(); i++)
+                m_sinks[i]->write(line);
+        }
+
+        static std::string format(LogLevel level, const boost::posix_time::ptime& time,
+            const std::string& msg, const char* file, int line, const char* fn)
+        {
+            boost::gregorian::date date(time.date());
+            boost::posix_time::time_duration tod(time.time_of_day());
+
+            std::ostringstream os;
+            os << std::setfill('0')
+               << std::setw(4) << date.year() << '-'
+               << std::setw(2) << date.month().as_number() << '-'
+               << std::setw(2) << date.day() << ' '
+               << std::setw(2) << tod.hours() << ':'
+               << std::setw(2) << tod.minutes() << ':'
+               << std::setw(2) << tod.seconds() << '.'
+               << std::setw(3) << tod.total_milliseconds() % 1000 << ' '
+               << levelName(level) << ' '
+               << file << ":" << line << " - " << fn << " - " << msg;
+            return os.str();
+        }
+
+    private:
+        FB::LockFreeQueue<Record*> m_queue;
+        std::vector<LogSinkPtr> m_sinks;
+        LogLevel m_level;
+        bool m_running;
+        volatile FB::detail::lockfree::atomic_t m_dropped;
+        boost::thread m_thread;
+    };
+
+}; };
+
+#endif // H_FB_AsyncLog
@@ -16,6 +16,7 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include <cstdio>
 #include <cassert>
 #include <algorithm>
+#include <deque>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/construct.hpp>
@@ -53,7 +54,7 @@ namespace FB {
     class AsyncCallManager : public boost::enable_shared_from_this<AsyncCallManager>, boost::noncopyable {
     public:
         int lastId;
-        AsyncCallManager() : lastId(1) {}
+        AsyncCallManager() : lastId(1), wakeupScheduled(false) {}
         ~AsyncCallManager();
 
         boost::recursive_mutex m_mutex;
@@ -63,8 +64,16 @@ namespace FB {
         void call( _asyncCallData* data );
         void remove( _asyncCallData* data );
 
+        static void drain(void* mgr);
+
         std::set<_asyncCallData*> DataList;
         std::set<_asyncCallData*> canceledDataList;
+
+        // Calls waiting for the next main thread wakeup; there is at most one wakeup scheduled with
+        // the browser at any time, and it runs everything queued up to that point
+        std::deque<_asyncCallData*> pendingCalls;
+        bool wakeupScheduled;
+        AsyncCallStats stats;
     };
 }
 
@@ -298,6 +307,26 @@ void FB::AsyncCallManager::remove(_asyncCallData* data)
     DataList.erase(data);
 }
 
+void FB::AsyncCallManager::drain(void* mgr)
+{
+    AsyncCallManager* self(static_cast<AsyncCallManager*>(mgr));
+    std::deque<_asyncCallData*> calls;
+    {
+        boost::recursive_mutex::scoped_lock _l(self->m_mutex);
+        calls.swap(self->pendingCalls);
+        // Anything scheduled by the calls below needs a wakeup of its own
+        self->wakeupScheduled = false;
+
+        ++self->stats.wakeups;
+        self->stats.calls += calls.size();
+        self->stats.largestBatch = (std::max)(self->stats.largestBatch, calls.size());
+    }
+
+    for (std::deque<_asyncCallData*>::iterator it = calls.begin(); it != calls.end(); ++it) {
+        self->call(*it);
+    }
+}
+
 void FB::AsyncCallManager::shutdown()
 {
     boost::recursive_mutex::scoped_lock _l(m_mutex);
@@ -305,6 +334,13 @@ void FB::AsyncCallManager::shutdown()
     // point it's no longer possible for the browser to finish the async calls
     canceledDataList.insert(DataList.begin(), DataList.end());
 
+    // Queued calls run first, in the order they were made; everything else in DataList has no
+    // order of its own, and calling a _asyncCallData a second time does nothing
+    std::deque<_asyncCallData*> calls;
+    calls.swap(pendingCalls);
+    wakeupScheduled = false;
+    std::for_each(calls.begin(), calls.end(), boost::lambda::bind(&_asyncCallData::call, boost::lambda::_1));
+
     std::for_each(DataList.begin(), DataList.end(), boost::lambda::bind(&_asyncCallData::call, boost::lambda::_1));
     DataList.clear();
 }
@@ -330,15 +366,59 @@ bool FB::BrowserHost::ScheduleAsyncCall( void (*func)(void *), void *userData )
     if (isShutDown()) {
         return false;
     } else {
-        _asyncCallData* data = _asyncManager->makeCallback(func, userData);
-        bool result = _scheduleAsyncCall(&asyncCallWrapper, data);
+        _asyncCallData* data;
+        _asyncCallData* wakeup;
+        {
+            boost::recursive_mutex::scoped_lock _l(_asyncManager->m_mutex);
+            data = _asyncManager->makeCallback(func, userData);
+            _asyncManager->pendingCalls.push_back(data);
+            if (_asyncManager->wakeupScheduled)
+                return true;
+
+            // Set before scheduling; some browsers run the wakeup before returning
+            _asyncManager->wakeupScheduled = true;
+            wakeup = _asyncManager->makeCallback(&AsyncCallManager::drain, _asyncManager.get());
+        }
+
+        bool result = _scheduleAsyncCall(&asyncCallWrapper, wakeup);
         if (!result) {
-            _asyncManager->remove(data);
+            {
+                boost::recursive_mutex::scoped_lock _l(_asyncManager->m_mutex);
+                _asyncManager->remove(wakeup);
+                delete wakeup;
+                _asyncManager->remove(data);
+                _asyncManager->pendingCalls.erase(std::remove(_asyncManager->pendingCalls.begin(),
+                    _asyncManager->pendingCalls.end(), data), _asyncManager->pendingCalls.end());
+                delete data;
+
+                // Other threads may have queued calls behind this one while the browser was being
+                // asked; they were told their calls would run, so they get a wakeup of their own
+                if (_asyncManager->pendingCalls.empty()) {
+                    _asyncManager->wakeupScheduled = false;
+                    return false;
+                }
+                wakeup = _asyncManager->makeCallback(&AsyncCallManager::drain, _asyncManager.get());
+            }
+
+            if (!_scheduleAsyncCall(&asyncCallWrapper, wakeup)) {
+                // The browser will not wake us up at all; the queued calls wait for the next call
+                // that gets a wakeup through, or are run by shutdown()
+                boost::recursive_mutex::scoped_lock _l(_asyncManager->m_mutex);
+                _asyncManager->remove(wakeup);
+                delete wakeup;
+                _asyncManager->wakeupScheduled = false;
+            }
         }
         return result;
     }
 }
 
+FB::AsyncCallStats FB::BrowserHost::getAsyncCallStats() const
+{
+    boost::recursive_mutex::scoped_lock _l(_asyncManager->m_mutex);
+    return _asyncManager->stats;
+}
+
 FB::BrowserStreamPtr FB::BrowserHost::createStream( const std::string& url,
     const PluginEventSinkPtr& callback, bool cache /*= true*/, bool seekable /*= false*/,
     size_t internalBufferSize /*= 128 * 1024 */ ) const
@@ -49,6 +49,24 @@ namespace FB
         std::string m_msg;
     };
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @struct AsyncCallStats
+    ///
+    /// @brief  Counters for the calls made through BrowserHost::ScheduleAsyncCall.  Calls scheduled
+    ///         while a main thread wakeup is already pending are run by that same wakeup, so
+    ///         calls / wakeups is the average number of calls per browser round trip.
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    struct AsyncCallStats
+    {
+        AsyncCallStats() : wakeups(0), calls(0), largestBatch(0) { }
+
+        uint64_t wakeups;
+        uint64_t calls;
+        size_t largestBatch;
+    };
+
     FB_FORWARD_PTR(AsyncCallManager);
     FB_FORWARD_PTR(BrowserStreamManager);
 
@@ -97,6 +115,10 @@ namespace FB
         /// The provided function will be called with the userData on the main thread. If the
         /// plugin instance is shutting down this may fail and return false
         ///
+        /// Calls are queued per host and run in the order they were scheduled; only one wakeup is
+        /// requested from the browser while the queue is not empty, so a burst of calls from a
+        /// background thread costs a single round trip.
+        ///
         /// NOTE: This is a low level call; it is almost always better to use ScheduleOnMainThread
         ///
         /// @param  func     The function to call.
@@ -109,6 +131,16 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         bool ScheduleAsyncCall(void (*func)(void *), void *userData) const;
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn AsyncCallStats getAsyncCallStats() const
+        ///
+        /// @brief  Returns how many main thread wakeups were needed for the calls scheduled so far.
+        ///
+        /// @see ScheduleAsyncCall
+        /// @since 1.6
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        AsyncCallStats getAsyncCallStats() const;
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn template<class Functor> typename Functor::result_type CallOnMainThread(Functor func)
         ///
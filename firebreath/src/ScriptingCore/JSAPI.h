@@ -504,6 +504,60 @@ namespace FB
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         virtual variant Invoke(const std::string& methodName, const std::vector<variant>& args) = 0;
 
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual bool ResolveMethod(const std::string& methodName, MethodHandle& handle) const
+        ///
+        /// @brief  Looks up a method once so that the browser can call it again through InvokeResolved
+        ///         without going through the name.
+        ///
+        /// @param  methodName  Name of the method.
+        /// @param  handle      Receives the resolved method.
+        ///
+        /// @return false if the method is not accessible or the object does not support it
+        /// @since 1.6
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual bool ResolveMethod(const std::string& methodName, MethodHandle& handle) const
+        {
+            return false;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual bool InvokeResolved(const MethodHandle& handle, const std::vector<variant>& args,
+        /// variant& result)
+        ///
+        /// @brief  Calls a method previously resolved with ResolveMethod.
+        ///
+        /// @param  handle      The resolved method.
+        /// @param  args        The arguments.
+        /// @param  result      Receives the result of the method call.
+        ///
+        /// @return false if the handle is stale, in which case the caller should use Invoke instead
+        /// @since 1.6
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual bool InvokeResolved(const MethodHandle& handle, const std::vector<variant>& args, variant& result)
+        {
+            return false;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn virtual bool InvokeResolved(const MethodHandle& handle, const TypedArguments& args,
+        /// TypedResult& result)
+        ///
+        /// @brief  Calls a resolved FB::TypedMethod without building a variant list.
+        ///
+        /// @param  handle      The resolved method.
+        /// @param  args        The arguments in the browser's own representation.
+        /// @param  result      Receives the result of the method call.
+        ///
+        /// @return false if the handle is stale, the method is not typed or the arguments do not match
+        ///         its signature exactly; the caller should then use the variant overload
+        /// @since 1.6
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        virtual bool InvokeResolved(const MethodHandle& handle, const TypedArguments& args, TypedResult& result)
+        {
+            return false;
+        }
+
         ////////////////////////////////////////////////////////////////////////////////////////////////////
         /// @fn virtual variant Construct(const std::vector<variant>& args) = 0
         ///
@@ -26,9 +26,19 @@ bool FB::JSAPIAuto::s_allowDynamicAttributes = true;
 bool FB::JSAPIAuto::s_allowRemoveProperties = false;
 bool FB::JSAPIAuto::s_allowMethodObjects = true;
 
+static std::string conversionError(const FB::bad_variant_cast& ex)
+{
+    std::string errorMsg("Could not convert from ");
+    errorMsg += ex.from;
+    errorMsg += " to ";
+    errorMsg += ex.to;
+    return errorMsg;
+}
+
 FB::JSAPIAuto::JSAPIAuto(const std::string& description)
   : FB::JSAPIImpl(SecurityScope_Public),
     m_description(description),
+    m_methodGeneration(1),
     m_allowDynamicAttributes(FB::JSAPIAuto::s_allowDynamicAttributes), 
     m_allowRemoveProperties(FB::JSAPIAuto::s_allowRemoveProperties),
     m_allowMethodObjects(FB::JSAPIAuto::s_allowMethodObjects)
@@ -39,6 +49,7 @@ FB::JSAPIAuto::JSAPIAuto(const std::string& description)
 FB::JSAPIAuto::JSAPIAuto( const SecurityZone& securityLevel, const std::string& description /*= "<JSAPI-Auto Secure Javascript Object>"*/ )
   : FB::JSAPIImpl(securityLevel),
     m_description(description),
+    m_methodGeneration(1),
     m_allowDynamicAttributes(FB::JSAPIAuto::s_allowDynamicAttributes), 
     m_allowRemoveProperties(FB::JSAPIAuto::s_allowRemoveProperties),
     m_allowMethodObjects(FB::JSAPIAuto::s_allowMethodObjects)
@@ -83,6 +94,7 @@ void FB::JSAPIAuto::registerMethod(const std::string& name, const CallMethodFunc
     boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
     m_methodFunctorMap[name] = func;
     m_zoneMap[name] = getZone();
+    ++m_methodGeneration;
 }
 
 void FB::JSAPIAuto::unregisterMethod( const std::string& name )
@@ -91,6 +103,7 @@ void FB::JSAPIAuto::unregisterMethod( const std::string& name )
     if (fnd != m_methodFunctorMap.end()) {
         m_methodFunctorMap.erase(name);
         m_zoneMap.erase(name);
+        ++m_methodGeneration;
     }
 }
 
@@ -233,11 +246,7 @@ void FB::JSAPIAuto::SetProperty(const std::string& propertyName, const variant&
             try {
                 it->second.set(value);
             } catch (const FB::bad_variant_cast& ex) {
-                std::string errorMsg("Could not convert from ");
-                errorMsg += ex.from;
-                errorMsg += " to ";
-                errorMsg += ex.to;
-                throw FB::invalid_arguments(errorMsg);
+                throw FB::invalid_arguments(conversionError(ex));
             }
         } else {
             throw invalid_member(propertyName);
@@ -338,17 +347,61 @@ FB::variant FB::JSAPIAuto::Invoke(const std::string& methodName, const std::vect
 
             return it->second.call(args);
         } catch (const FB::bad_variant_cast& ex) {
-            std::string errorMsg("Could not convert from ");
-            errorMsg += ex.from;
-            errorMsg += " to ";
-            errorMsg += ex.to;
-            throw FB::invalid_arguments(errorMsg);
+            throw FB::invalid_arguments(conversionError(ex));
         }
     } else {
         throw invalid_member(methodName);
     }
 }
 
+bool FB::JSAPIAuto::ResolveMethod(const std::string& methodName, MethodHandle& handle) const
+{
+    boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+    if(!m_valid)
+        return false;
+
+    ZoneMap::const_iterator zone = m_zoneMap.find(methodName);
+    MethodFunctorMap::const_iterator it = m_methodFunctorMap.find(methodName);
+    if (it == m_methodFunctorMap.end() || !memberAccessible(zone))
+        return false;
+
+    handle.call = &it->second.call;
+    handle.typed = it->second.call.target<FB::TypedMethod>();
+    handle.zone = zone->second;
+    handle.generation = m_methodGeneration;
+    return true;
+}
+
+bool FB::JSAPIAuto::InvokeResolved(const MethodHandle& handle, const std::vector<variant>& args, variant& result)
+{
+    boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+    if(!m_valid)
+        throw object_invalidated();
+
+    // The functor may be gone, or the caller may have pushed a lower zone since
+    if (handle.generation != m_methodGeneration || getZone() < handle.zone)
+        return false;
+
+    try {
+        result = (*handle.call)(args);
+        return true;
+    } catch (const FB::bad_variant_cast& ex) {
+        throw FB::invalid_arguments(conversionError(ex));
+    }
+}
+
+bool FB::JSAPIAuto::InvokeResolved(const MethodHandle& handle, const TypedArguments& args, TypedResult& result)
+{
+    boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
+    if(!m_valid)
+        throw object_invalidated();
+
+    if (!handle.typed || handle.generation != m_methodGeneration || getZone() < handle.zone)
+        return false;
+
+    return handle.typed->invoke(args, result);
+}
+
 FB::variant FB::JSAPIAuto::Construct(const std::vector<variant> &args)
 {
     boost::recursive_mutex::scoped_lock lock(m_zoneMutex);
@@ -174,6 +174,9 @@ namespace FB {
         virtual size_t getMemberCount() const;
 
         virtual variant Invoke(const std::string& methodName, const std::vector<variant>& args);
+        virtual bool ResolveMethod(const std::string& methodName, MethodHandle& handle) const;
+        virtual bool InvokeResolved(const MethodHandle& handle, const std::vector<variant>& args, variant& result);
+        virtual bool InvokeResolved(const MethodHandle& handle, const TypedArguments& args, TypedResult& result);
         virtual variant Construct(const std::vector<variant>& args);
         virtual JSAPIPtr GetMethodObject(const std::string& methodObjName);
 
@@ -366,6 +369,8 @@ namespace FB {
         PropertyFunctorsMap m_propertyFunctorsMap;
         // Keeps track of the security zone of each member
         ZoneMap m_zoneMap;
+        // Changes whenever a method is registered or removed, so resolved handles go stale
+        unsigned int m_methodGeneration;
         
         const std::string m_description;
 
@@ -0,0 +1,324 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#ifndef H_FB_LockFreeQueue
+#define H_FB_LockFreeQueue
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  pragma intrinsic(_InterlockedCompareExchange, _InterlockedExchange, _ReadWriteBarrier)
+#elif defined(__linux__)
+#  include <unistd.h>
+#  include <sys/syscall.h>
+#  include <linux/futex.h>
+#  include <time.h>
+#  define FB_LOCKFREEQUEUE_FUTEX
+#endif
+
+#ifndef FB_LOCKFREEQUEUE_FUTEX
+#  include <boost/thread/mutex.hpp>
+#  include <boost/thread/condition_variable.hpp>
+#endif
+
+namespace FB {
+
+    namespace detail { namespace lockfree {
+#if defined(_MSC_VER)
+        typedef long atomic_t;
+
+        // x86 and x64 loads and stores already have acquire and release semantics
+        inline atomic_t load(volatile atomic_t* p) { atomic_t v = *p; _ReadWriteBarrier(); return v; }
+        inline void store(volatile atomic_t* p, atomic_t v) { _ReadWriteBarrier(); *p = v; }
+        inline bool cas(volatile atomic_t* p, atomic_t expected, atomic_t desired)
+        { return _InterlockedCompareExchange(p, desired, expected) == expected; }
+        inline void fence() { long dummy; _InterlockedExchange(&dummy, 0); }
+#else
+        typedef int atomic_t;
+
+#  if defined(__ATOMIC_ACQUIRE)
+        inline atomic_t load(volatile atomic_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+        inline void store(volatile atomic_t* p, atomic_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+#  else
+        inline atomic_t load(volatile atomic_t* p) { atomic_t v = *p; __sync_synchronize(); return v; }
+        inline void store(volatile atomic_t* p, atomic_t v) { __sync_synchronize(); *p = v; }
+#  endif
+        inline bool cas(volatile atomic_t* p, atomic_t expected, atomic_t desired)
+        { return __sync_bool_compare_and_swap(p, expected, desired); }
+        inline void fence() { __sync_synchronize(); }
+#endif
+
+        // Positions wrap around; compare them through unsigned arithmetic
+        inline atomic_t advance(atomic_t pos, unsigned long count)
+        { return static_cast<atomic_t>(static_cast<unsigned long>(pos) + count); }
+        inline long distance(atomic_t from, atomic_t to)
+        { return static_cast<atomic_t>(static_cast<unsigned long>(to) - static_cast<unsigned long>(from)); }
+    } }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  LockFreeQueue
+    ///
+    /// @brief  Bounded multi-producer/single-consumer queue with the interface of FB::SafeQueue
+    ///
+    /// Any number of threads may push; only one thread may pop. Producers claim a slot with a single
+    /// compare-and-swap and never wait on the consumer, and the consumer does not take a lock unless
+    /// it actually goes to sleep in wait_and_pop or timed_wait_and_pop. On Linux the sleep is a futex
+    /// wait; elsewhere it falls back to a condition variable.
+    ///
+    /// The capacity is rounded up to a power of two. push() yields until there is room; use
+    /// try_push() to find out that the queue is full instead.
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename Data>
+    class LockFreeQueue : boost::noncopyable
+    {
+    private:
+        typedef detail::lockfree::atomic_t atomic_t;
+
+        struct Cell
+        {
+            volatile atomic_t sequence;
+            Data data;
+        };
+
+        std::vector<Cell> the_cells;
+        atomic_t the_mask;
+        // Each index on its own cache line so that producers and the consumer do not share one
+        char pad0[64];
+        volatile atomic_t the_tail;
+        char pad1[64];
+        atomic_t the_head;
+        char pad2[64];
+        volatile atomic_t the_sleeping;
+#ifndef FB_LOCKFREEQUEUE_FUTEX
+        boost::mutex the_mutex;
+        boost::condition_variable the_condition_variable;
+#endif
+
+    public:
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn LockFreeQueue::LockFreeQueue(size_t capacity = 1024)
+        ///
+        /// @brief  Creates an empty queue.
+        ///
+        /// @param  capacity    The number of items the queue can hold, rounded up to a power of two.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        explicit LockFreeQueue(size_t capacity = 1024) : the_tail(0), the_head(0), the_sleeping(0)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+
+            the_cells.resize(size);
+            for (size_t i = 0; i < size; i++)
+                the_cells[i].sequence = static_cast<atomic_t>(i);
+            the_mask = static_cast<atomic_t>(size - 1);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn size_t LockFreeQueue::capacity() const
+        ///
+        /// @brief  Returns the number of items the queue can hold.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        size_t capacity() const
+        {
+            return the_cells.size();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool LockFreeQueue::try_push(Data const& data)
+        ///
+        /// @brief  Pushes an object onto the end of the queue unless it is full.
+        ///
+        /// @param  data    The data.
+        ///
+        /// @return false if the queue was full
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool try_push(Data const& data)
+        {
+            using namespace detail::lockfree;
+
+            Cell* cell;
+            atomic_t pos = load(&the_tail);
+            for (;;) {
+                cell = &the_cells[pos & the_mask];
+                long diff = distance(pos, load(&cell->sequence));
+                if (diff == 0) {
+                    if (cas(&the_tail, pos, advance(pos, 1)))
+                        break;
+                } else if (diff < 0) {
+                    return false;
+                }
+                pos = load(&the_tail);
+            }
+
+            cell->data = data;
+            store(&cell->sequence, advance(pos, 1));
+
+            // Pairs with the fence in sleep(): either the consumer sees the item or we see it asleep
+            fence();
+            if (load(&the_sleeping) && cas(&the_sleeping, 1, 0))
+                wake();
+            return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void LockFreeQueue::push(Data const& data)
+        ///
+        /// @brief  Pushes an object onto the end of the queue, yielding while it is full.
+        ///
+        /// Must not be called from the consumer thread, which is the only one that can make room.
+        ///
+        /// @param  data    The data.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void push(Data const& data)
+        {
+            while (!try_push(data))
+                boost::this_thread::yield();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool LockFreeQueue::empty() const
+        ///
+        /// @brief  Queries if the queue is empty. Only exact when called from the consumer thread.
+        ///
+        /// @return true if the Queue is empty, false if not.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool empty() const
+        {
+            using namespace detail::lockfree;
+
+            const Cell& cell = the_cells[the_head & the_mask];
+            return distance(advance(the_head, 1), load(const_cast<volatile atomic_t*>(&cell.sequence))) < 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool LockFreeQueue::try_pop(Data& popped_value)
+        ///
+        /// @brief  Try to pop a value off the front of the queue; if the queue is empty returns false
+        ///
+        /// @param [out] popped_value    The popped value.
+        ///
+        /// @return true if a value is returned, false if the queue was empty
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool try_pop(Data& popped_value)
+        {
+            using namespace detail::lockfree;
+
+            Cell& cell = the_cells[the_head & the_mask];
+            if (distance(advance(the_head, 1), load(&cell.sequence)) < 0)
+                return false;
+
+            popped_value = cell.data;
+            // Don't keep whatever the item refers to alive until the slot is reused
+            cell.data = Data();
+            store(&cell.sequence, advance(the_head, the_cells.size()));
+            the_head = advance(the_head, 1);
+            return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn bool LockFreeQueue::timed_wait_and_pop(Data& popped_value, const boost::posix_time::time_duration& duration)
+        ///
+        /// @brief  Tries to pop a value off the front of the queue; if the queue is empty it will wait
+        ///         for the specified duration until something is pushed onto the back of the queue
+        ///         by another thread or until the duration times out.
+        ///
+        /// @param [out] popped_value    The popped value.
+        /// @param duration              The duration of time for which to wait
+        ///
+        /// @return true if a value is returned, false if the queue was empty
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        bool timed_wait_and_pop(Data& popped_value, const boost::posix_time::time_duration& duration)
+        {
+            if (try_pop(popped_value))
+                return true;
+
+            sleep(&duration);
+            return try_pop(popped_value);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        /// @fn void LockFreeQueue::wait_and_pop(Data& popped_value)
+        ///
+        /// @brief  Tries to pop a value off the front of the queue; if the queue is empty it will wait
+        ///         indefinitely until something is pushed onto the back of the queue by another thread.
+        ///
+        /// @param [out] popped_value    The popped value.
+        ////////////////////////////////////////////////////////////////////////////////////////////////////
+        void wait_and_pop(Data& popped_value)
+        {
+            while (!try_pop(popped_value))
+                sleep(NULL);
+        }
+
+    private:
+        void sleep(const boost::posix_time::time_duration* duration)
+        {
+            using namespace detail::lockfree;
+
+            // Producers usually follow up quickly; a short spin saves both sides a system call
+            for (int spin = 0; spin < 200; spin++) {
+                if (!empty())
+                    return;
+                boost::this_thread::yield();
+            }
+
+            store(&the_sleeping, 1);
+            fence();
+            if (!empty()) {
+                store(&the_sleeping, 0);
+                return;
+            }
+
+#ifdef FB_LOCKFREEQUEUE_FUTEX
+            timespec timeout;
+            if (duration) {
+                timeout.tv_sec = duration->total_seconds();
+                timeout.tv_nsec = (duration->total_microseconds() % 1000000) * 1000;
+            }
+            // Returns right away if a producer already cleared the flag
+            syscall(SYS_futex, &the_sleeping, FUTEX_WAIT_PRIVATE, 1, duration ? &timeout : NULL, NULL, 0);
+#else
+            boost::mutex::scoped_lock lock(the_mutex);
+            while (load(&the_sleeping)) {
+                if (!duration) {
+                    the_condition_variable.wait(lock);
+                } else if (!the_condition_variable.timed_wait(lock, *duration)) {
+                    break;
+                }
+            }
+#endif
+            store(&the_sleeping, 0);
+        }
+
+        void wake()
+        {
+#ifdef FB_LOCKFREEQUEUE_FUTEX
+            syscall(SYS_futex, &the_sleeping, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+            // Taking the lock makes sure the consumer is either waiting already or will see the flag
+            { boost::mutex::scoped_lock lock(the_mutex); }
+            the_condition_variable.notify_one();
+#endif
+        }
+    };
+};
+
+#endif //H_FB_LockFreeQueue
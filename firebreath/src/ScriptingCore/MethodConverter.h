@@ -29,6 +29,7 @@ Copyright 2009 Georg Fritzsche, Firebreath development team
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 #include "ConverterUtils.h"
+#include "TypedMethod.h"
 
 #define _FB_MW_TPL(z, n, data) typename T##n
 #define _FB_MW_Tn(z, n, data) T##n
@@ -84,12 +85,13 @@ Copyright 2009 Georg Fritzsche, Firebreath development team
     make_method(C* instance, R (C::*function)(                                  \
         BOOST_PP_ENUM(n, _FB_MW_Tn, 0)))                                        \
     {                                                                           \
-        return boost::bind(                                                     \
+        return FB::detail::methods::make_typed_method(instance, function,      \
+            boost::bind(                                                        \
             FB::detail::methods::method_wrapper##n<C, R                         \
                 BOOST_PP_COMMA_IF(BOOST_PP_GREATER(n,0))                        \
                 BOOST_PP_ENUM(n, _FB_MW_Tn, 0)                                  \
                 , R (C::*)(BOOST_PP_ENUM(n, _FB_MW_Tn, 0))>(function),          \
-                instance, _1);                                                  \
+                instance, _1));                                                 \
     }                                                                           \
     template<class C, class R                                                   \
             BOOST_PP_COMMA_IF(BOOST_PP_GREATER(n,0))                            \
@@ -98,11 +100,12 @@ Copyright 2009 Georg Fritzsche, Firebreath development team
     make_method(C* instance, R (C::*function)(                                  \
         BOOST_PP_ENUM(n, _FB_MW_Tn, 0)) const)                                  \
     {                                                                           \
-            return boost::bind(FB::detail::methods::method_wrapper##n<C, R      \
+            return FB::detail::methods::make_typed_method(instance, function,  \
+            boost::bind(FB::detail::methods::method_wrapper##n<C, R             \
                 BOOST_PP_COMMA_IF(BOOST_PP_GREATER(n,0))                        \
                 BOOST_PP_ENUM(n, _FB_MW_Tn, 0)                                  \
             , R (C::*)(BOOST_PP_ENUM(n, _FB_MW_Tn, 0)) const>(function),        \
-            instance, _1);                                                      \
+            instance, _1));                                                     \
     }
 
 namespace FB
@@ -0,0 +1,301 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#pragma once
+#ifndef H_FB_TYPEDMETHOD
+#define H_FB_TYPEDMETHOD
+
+#include <string>
+#include <boost/function.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include "APITypes.h"
+#include "ConverterUtils.h"
+
+namespace FB
+{
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  TypedArguments
+    ///
+    /// @brief  Arguments of a call as the browser handed them over.
+    ///
+    /// Implemented by the browser cores on top of their native argument arrays. Each getter only
+    /// succeeds if the argument already has exactly that type; anything else is left to the
+    /// FB::variant conversion rules.
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class TypedArguments
+    {
+    public:
+        virtual ~TypedArguments() {}
+
+        virtual size_t size() const = 0;
+        virtual bool get(size_t index, int& value) const = 0;
+        virtual bool get(size_t index, double& value) const = 0;
+        virtual bool get(size_t index, bool& value) const = 0;
+        virtual bool get(size_t index, std::string& value) const = 0;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  TypedResult
+    ///
+    /// @brief  Receives the return value of a call made through FB::TypedMethod::invoke() and
+    ///         stores it straight into the browser's native result.
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class TypedResult
+    {
+    public:
+        virtual ~TypedResult() {}
+
+        virtual void setVoid() = 0;
+        virtual void set(int value) = 0;
+        virtual void set(double value) = 0;
+        virtual void set(bool value) = 0;
+        virtual void set(const std::string& value) = 0;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    /// @class  TypedMethod
+    ///
+    /// @brief  Method functor created by FB::make_method() for signatures that only use int, double,
+    ///         bool and std::string.
+    ///
+    /// Called as a CallMethodFunctor it behaves exactly like any other method. invoke() skips the
+    /// FB::VariantList entirely: the arguments go straight into the C++ parameters and the return
+    /// value straight into the result. It returns false without calling the method if the argument
+    /// count or any argument type does not match, in which case the caller falls back to the
+    /// variant call.
+    ///
+    /// @since 1.6
+    ////////////////////////////////////////////////////////////////////////////////////////////////////
+    class TypedMethod
+    {
+    public:
+        typedef FB::variant result_type;
+        typedef boost::function<bool (const TypedArguments&, TypedResult&)> InvokeFunctor;
+
+        TypedMethod(const CallMethodFunctor& call, const InvokeFunctor& invoke)
+            : m_call(call), m_invoke(invoke) {}
+
+        FB::variant operator()(const FB::VariantList& in) const { return m_call(in); }
+        bool invoke(const TypedArguments& args, TypedResult& result) const { return m_invoke(args, result); }
+
+    private:
+        CallMethodFunctor m_call;
+        InvokeFunctor m_invoke;
+    };
+
+    namespace detail { namespace methods
+    {
+        using FB::detail::plain_type;
+
+        template<typename T> struct typed_value : boost::false_type {};
+        template<> struct typed_value<int> : boost::true_type {};
+        template<> struct typed_value<double> : boost::true_type {};
+        template<> struct typed_value<bool> : boost::true_type {};
+        template<> struct typed_value<std::string> : boost::true_type {};
+
+        template<typename T> struct typed_arg : typed_value<typename plain_type<T>::type> {};
+        template<typename R> struct typed_return : typed_value<typename plain_type<R>::type> {};
+        template<> struct typed_return<void> : boost::true_type {};
+
+        template<typename R>
+        struct typed_call
+        {
+            template<class C, typename F>
+            static void call(TypedResult& result, C* instance, F f)
+            { result.set((instance->*f)()); }
+            template<class C, typename F, typename A0>
+            static void call(TypedResult& result, C* instance, F f, A0& a0)
+            { result.set((instance->*f)(a0)); }
+            template<class C, typename F, typename A0, typename A1>
+            static void call(TypedResult& result, C* instance, F f, A0& a0, A1& a1)
+            { result.set((instance->*f)(a0, a1)); }
+            template<class C, typename F, typename A0, typename A1, typename A2>
+            static void call(TypedResult& result, C* instance, F f, A0& a0, A1& a1, A2& a2)
+            { result.set((instance->*f)(a0, a1, a2)); }
+        };
+
+        template<>
+        struct typed_call<void>
+        {
+            template<class C, typename F>
+            static void call(TypedResult& result, C* instance, F f)
+            { (instance->*f)(); result.setVoid(); }
+            template<class C, typename F, typename A0>
+            static void call(TypedResult& result, C* instance, F f, A0& a0)
+            { (instance->*f)(a0); result.setVoid(); }
+            template<class C, typename F, typename A0, typename A1>
+            static void call(TypedResult& result, C* instance, F f, A0& a0, A1& a1)
+            { (instance->*f)(a0, a1); result.setVoid(); }
+            template<class C, typename F, typename A0, typename A1, typename A2>
+            static void call(TypedResult& result, C* instance, F f, A0& a0, A1& a1, A2& a2)
+            { (instance->*f)(a0, a1, a2); result.setVoid(); }
+        };
+
+        template<class C, typename R, typename F>
+        struct typed_invoker0
+        {
+            typedef bool result_type;
+            C* instance;
+            F f;
+            typed_invoker0(C* instance, F f) : instance(instance), f(f) {}
+            bool operator()(const TypedArguments& args, TypedResult& result) const
+            {
+                if (args.size() != 0)
+                    return false;
+                typed_call<R>::call(result, instance, f);
+                return true;
+            }
+        };
+
+        template<class C, typename R, typename T0, typename F>
+        struct typed_invoker1
+        {
+            typedef bool result_type;
+            C* instance;
+            F f;
+            typed_invoker1(C* instance, F f) : instance(instance), f(f) {}
+            bool operator()(const TypedArguments& args, TypedResult& result) const
+            {
+                typename plain_type<T0>::type a0;
+                if (args.size() != 1 || !args.get(0, a0))
+                    return false;
+                typed_call<R>::call(result, instance, f, a0);
+                return true;
+            }
+        };
+
+        template<class C, typename R, typename T0, typename T1, typename F>
+        struct typed_invoker2
+        {
+            typedef bool result_type;
+            C* instance;
+            F f;
+            typed_invoker2(C* instance, F f) : instance(instance), f(f) {}
+            bool operator()(const TypedArguments& args, TypedResult& result) const
+            {
+                typename plain_type<T0>::type a0;
+                typename plain_type<T1>::type a1;
+                if (args.size() != 2 || !args.get(0, a0) || !args.get(1, a1))
+                    return false;
+                typed_call<R>::call(result, instance, f, a0, a1);
+                return true;
+            }
+        };
+
+        template<class C, typename R, typename T0, typename T1, typename T2, typename F>
+        struct typed_invoker3
+        {
+            typedef bool result_type;
+            C* instance;
+            F f;
+            typed_invoker3(C* instance, F f) : instance(instance), f(f) {}
+            bool operator()(const TypedArguments& args, TypedResult& result) const
+            {
+                typename plain_type<T0>::type a0;
+                typename plain_type<T1>::type a1;
+                typename plain_type<T2>::type a2;
+                if (args.size() != 3 || !args.get(0, a0) || !args.get(1, a1) || !args.get(2, a2))
+                    return false;
+                typed_call<R>::call(result, instance, f, a0, a1, a2);
+                return true;
+            }
+        };
+
+        // The invoker is only turned into a functor, and so only compiled, for supported signatures
+        template<bool Typed>
+        struct typed_method_factory
+        {
+            template<typename Invoker>
+            static FB::CallMethodFunctor make(const FB::CallMethodFunctor& call, const Invoker&)
+            { return call; }
+        };
+
+        template<>
+        struct typed_method_factory<true>
+        {
+            template<typename Invoker>
+            static FB::CallMethodFunctor make(const FB::CallMethodFunctor& call, const Invoker& invoker)
+            { return FB::TypedMethod(call, invoker); }
+        };
+
+        // Any other signature keeps the plain variant call
+        template<class C, typename F>
+        inline FB::CallMethodFunctor make_typed_method(C*, F, const FB::CallMethodFunctor& call)
+        {
+            return call;
+        }
+
+        template<class C, typename R>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)(), const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value>::make(call,
+                typed_invoker0<C, R, R (C::*)()>(instance, f));
+        }
+
+        template<class C, typename R>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)() const, const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value>::make(call,
+                typed_invoker0<C, R, R (C::*)() const>(instance, f));
+        }
+
+        template<class C, typename R, typename T0>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)(T0), const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value && typed_arg<T0>::value>::make(call,
+                typed_invoker1<C, R, T0, R (C::*)(T0)>(instance, f));
+        }
+
+        template<class C, typename R, typename T0>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)(T0) const, const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value && typed_arg<T0>::value>::make(call,
+                typed_invoker1<C, R, T0, R (C::*)(T0) const>(instance, f));
+        }
+
+        template<class C, typename R, typename T0, typename T1>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)(T0, T1), const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value && typed_arg<T0>::value && typed_arg<T1>::value>::make(call,
+                typed_invoker2<C, R, T0, T1, R (C::*)(T0, T1)>(instance, f));
+        }
+
+        template<class C, typename R, typename T0, typename T1>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)(T0, T1) const, const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value && typed_arg<T0>::value && typed_arg<T1>::value>::make(call,
+                typed_invoker2<C, R, T0, T1, R (C::*)(T0, T1) const>(instance, f));
+        }
+
+        template<class C, typename R, typename T0, typename T1, typename T2>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)(T0, T1, T2), const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value && typed_arg<T0>::value && typed_arg<T1>::value && typed_arg<T2>::value>::make(call,
+                typed_invoker3<C, R, T0, T1, T2, R (C::*)(T0, T1, T2)>(instance, f));
+        }
+
+        template<class C, typename R, typename T0, typename T1, typename T2>
+        inline FB::CallMethodFunctor make_typed_method(C* instance, R (C::*f)(T0, T1, T2) const, const FB::CallMethodFunctor& call)
+        {
+            return typed_method_factory<typed_return<R>::value && typed_arg<T0>::value && typed_arg<T1>::value && typed_arg<T2>::value>::make(call,
+                typed_invoker3<C, R, T0, T1, T2, R (C::*)(T0, T1, T2) const>(instance, f));
+        }
+    } } // namespace detail::methods
+}
+
+#endif // H_FB_TYPEDMETHOD
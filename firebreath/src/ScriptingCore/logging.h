@@ -35,10 +35,32 @@ Copyright 2010 Facebook, Inc
     } while(0)
 #endif
 
+// Logging calls below FBLOG_MIN_LEVEL (one of the FB::Log::LogLevel values) are compiled out,
+// so their messages are never formatted. Release builds drop trace calls by default.
+#ifndef FBLOG_MIN_LEVEL
+#  ifdef NDEBUG
+#    define FBLOG_MIN_LEVEL 0x02
+#  else
+#    define FBLOG_MIN_LEVEL 0x01
+#  endif
+#endif
+
 #if !FB_NO_LOGGING_MACROS
-#  define FBLOG_TRACE(src, msg) FBLOG_LOG_BODY(trace, src, msg)
-#  define FBLOG_DEBUG(src, msg) FBLOG_LOG_BODY(debug, src, msg)
-#  define FBLOG_INFO(src, msg) FBLOG_LOG_BODY(info, src, msg)
+#  if FBLOG_MIN_LEVEL <= 0x01
+#    define FBLOG_TRACE(src, msg) FBLOG_LOG_BODY(trace, src, msg)
+#  else
+#    define FBLOG_TRACE(src, msg)
+#  endif
+#  if FBLOG_MIN_LEVEL <= 0x02
+#    define FBLOG_DEBUG(src, msg) FBLOG_LOG_BODY(debug, src, msg)
+#  else
+#    define FBLOG_DEBUG(src, msg)
+#  endif
+#  if FBLOG_MIN_LEVEL <= 0x04
+#    define FBLOG_INFO(src, msg) FBLOG_LOG_BODY(info, src, msg)
+#  else
+#    define FBLOG_INFO(src, msg)
+#  endif
 #  define FBLOG_WARN(src, msg) FBLOG_LOG_BODY(warn, src, msg)
 #  define FBLOG_ERROR(src, msg) FBLOG_LOG_BODY(error, src, msg)
 #  define FBLOG_FATAL(src, msg) FBLOG_LOG_BODY(fatal, src, msg)
@@ -0,0 +1,105 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#define BENCHMARK_CALLS 200000
+
+namespace bench
+{
+    // Counts the heap allocations made while it is in scope
+    class AllocationCounter
+    {
+    public:
+        AllocationCounter() : m_previous(s_active), m_count(0) { s_active = this; }
+        ~AllocationCounter() { s_active = m_previous; }
+
+        size_t count() const { return m_count; }
+
+        static void allocated()
+        {
+            if (s_active)
+                ++s_active->m_count;
+        }
+
+    private:
+        static AllocationCounter* s_active;
+        AllocationCounter* m_previous;
+        size_t m_count;
+    };
+
+    AllocationCounter* AllocationCounter::s_active = NULL;
+
+    class Stopwatch
+    {
+    public:
+        Stopwatch() : m_start(boost::posix_time::microsec_clock::universal_time()) {}
+
+        // Nanoseconds per call for the given number of calls since construction
+        double perCall(int calls) const
+        {
+            boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - m_start;
+            return elapsed.total_microseconds() * 1000.0 / calls;
+        }
+
+    private:
+        boost::posix_time::ptime m_start;
+    };
+}
+
+// The replacements only count; outside an AllocationCounter they are plain malloc and free
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#define BENCH_NOTHROW noexcept
+#else
+#define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define BENCH_NOTHROW throw()
+#endif
+
+void* operator new(std::size_t size) BENCH_THROW_BAD_ALLOC
+{
+    bench::AllocationCounter::allocated();
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) BENCH_THROW_BAD_ALLOC
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) BENCH_NOTHROW
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) BENCH_NOTHROW
+{
+    std::free(p);
+}
+
+#include "methodcache_bench.h"
+#include "typedmethod_bench.h"
+
+int main()
+{
+    int failures = 0;
+    failures += bench::methodCache();
+    failures += bench::typedMethod();
+    return failures;
+}
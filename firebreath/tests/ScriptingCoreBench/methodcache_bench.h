@@ -0,0 +1,66 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include <boost/make_shared.hpp>
+#include "JSAPIAuto.h"
+#include "variant_list.h"
+
+namespace bench
+{
+    class DispatchJSAPI : public FB::JSAPIAuto
+    {
+    public:
+        DispatchJSAPI() : calls(0)
+        {
+            // Enough methods that the lookup by name has a tree to walk
+            registerMethod("connect", make_method(this, &DispatchJSAPI::key));
+            registerMethod("disconnect", make_method(this, &DispatchJSAPI::key));
+            registerMethod("getStats", make_method(this, &DispatchJSAPI::key));
+            registerMethod("read", make_method(this, &DispatchJSAPI::key));
+            registerMethod("resize", make_method(this, &DispatchJSAPI::key));
+            registerMethod("write", make_method(this, &DispatchJSAPI::write));
+        }
+
+        int key(int keyCode) { return keyCode; }
+        int write(int keyCode) { ++calls; return keyCode; }
+
+        int calls;
+    };
+
+    // What NPJavascriptObject::Invoke does for a name it has seen before,
+    // compared to the lookup by name it did on every call
+    inline int methodCache()
+    {
+        boost::shared_ptr<DispatchJSAPI> api(boost::make_shared<DispatchJSAPI>());
+        FB::VariantList args(FB::variant_list_of(65));
+        FB::variant ret;
+
+        Stopwatch byNameClock;
+        for (int i = 0; i < BENCHMARK_CALLS; i++) {
+            ret = api->Invoke("write", args);
+        }
+        double byName = byNameClock.perCall(BENCHMARK_CALLS);
+
+        FB::MethodHandle handle;
+        api->ResolveMethod("write", handle);
+        Stopwatch resolvedClock;
+        for (int i = 0; i < BENCHMARK_CALLS; i++) {
+            api->InvokeResolved(handle, args, ret);
+        }
+        double resolved = resolvedClock.perCall(BENCHMARK_CALLS);
+
+        printf("JSAPIAuto::Invoke by name: %.1f ns/call, resolved: %.1f ns/call\n", byName, resolved);
+        return api->calls == 2 * BENCHMARK_CALLS ? 0 : 1;
+    }
+}
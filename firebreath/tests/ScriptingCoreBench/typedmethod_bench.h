@@ -0,0 +1,103 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include "typedmethod_fixtures.h"
+
+namespace bench
+{
+    struct Measurement
+    {
+        double nsPerCall;
+        double allocationsPerCall;
+    };
+
+    // What a browser core does with make_method today: fill the argument list, call, convert the result back
+    template<typename Result>
+    Measurement variantCalls(const FB::CallMethodFunctor& call, const typed::RawValue* values, size_t count)
+    {
+        FB::VariantList args;
+        args.reserve(count);
+        Result out = Result();
+
+        AllocationCounter allocations;
+        Stopwatch clock;
+        for (int i = 0; i < BENCHMARK_CALLS; i++) {
+            for (size_t n = 0; n < count; n++)
+                args.push_back(values[n].toVariant());
+            FB::variant ret = call(args);
+            out = ret.convert_cast<Result>();
+            args.clear();
+        }
+
+        Measurement m = { clock.perCall(BENCHMARK_CALLS), double(allocations.count()) / BENCHMARK_CALLS };
+        return m;
+    }
+
+    inline Measurement typedCalls(const FB::TypedMethod& method, const typed::RawValue* values, size_t count)
+    {
+        typed::RawArguments args(values, count);
+        typed::RawResult result;
+
+        AllocationCounter allocations;
+        Stopwatch clock;
+        for (int i = 0; i < BENCHMARK_CALLS; i++) {
+            method.invoke(args, result);
+        }
+
+        Measurement m = { clock.perCall(BENCHMARK_CALLS), double(allocations.count()) / BENCHMARK_CALLS };
+        return m;
+    }
+
+    inline void printMeasurements(const char* name, const Measurement& variant, const Measurement& typed)
+    {
+        printf("    %-12s variant: %6.1f ns/call %4.1f allocs/call, typed: %6.1f ns/call %4.1f allocs/call\n",
+            name, variant.nsPerCall, variant.allocationsPerCall, typed.nsPerCall, typed.allocationsPerCall);
+    }
+
+    // Returns the number of checks that failed
+    inline int typedMethod()
+    {
+        using namespace typed;
+        Terminal terminal;
+
+        printf("make_method calls through variants and through the typed path:\n");
+
+        FB::CallMethodFunctor write(FB::make_method(&terminal, &Terminal::write));
+        const RawValue keyCode[] = { RawValue(65) };
+        Measurement variantWrite = variantCalls<int>(write, keyCode, 1);
+        Measurement typedWrite = typedCalls(*typed::typedMethod(write), keyCode, 1);
+        printMeasurements("write(int)", variantWrite, typedWrite);
+
+        FB::CallMethodFunctor read(FB::make_method(&terminal, &Terminal::read));
+        Measurement variantRead = variantCalls<std::string>(read, NULL, 0);
+        Measurement typedRead = typedCalls(*typed::typedMethod(read), NULL, 0);
+        printMeasurements("read()", variantRead, typedRead);
+
+        FB::CallMethodFunctor resize(FB::make_method(&terminal, &Terminal::resize));
+        const RawValue size[] = { RawValue(80), RawValue(24), RawValue(true) };
+        Measurement variantResize = variantCalls<bool>(resize, size, 3);
+        Measurement typedResize = typedCalls(*typed::typedMethod(resize), size, 3);
+        printMeasurements("resize(...)", variantResize, typedResize);
+
+        // The point of the typed path is that scalar calls do not touch the heap
+        int failures = 0;
+        if (terminal.written != 2 * BENCHMARK_CALLS)
+            failures++;
+        if (typedWrite.allocationsPerCall != 0 || typedResize.allocationsPerCall != 0)
+            failures++;
+        if (typedRead.allocationsPerCall >= variantRead.allocationsPerCall)
+            failures++;
+        return failures;
+    }
+}
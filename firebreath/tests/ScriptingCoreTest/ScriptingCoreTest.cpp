@@ -28,6 +28,11 @@ Copyright 2009 Richard Bateman, Firebreath development team
 #include "jsarray_test.h"
 #include "TypeIDMap_test.h"
 #include "jscallback_test.h"
+#include "methodcache_test.h"
+#include "asynccall_test.h"
+#include "typedmethod_test.h"
+#include "lockfreequeue_test.h"
+#include "asynclog_test.h"
 
 int main()
 {
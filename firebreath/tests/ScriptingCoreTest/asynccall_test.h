@@ -0,0 +1,177 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include <vector>
+#include <utility>
+#include <boost/make_shared.hpp>
+#include "BrowserHost.h"
+
+namespace asynccall
+{
+    static std::vector<int> order;
+
+    static void record(void *userData)
+    {
+        order.push_back(static_cast<int>(reinterpret_cast<size_t>(userData)));
+    }
+
+    // A browser that queues wakeups until the test pumps the main thread, and can be told to
+    // refuse them
+    class FakeBrowserHost : public FB::BrowserHost
+    {
+    public:
+        FakeBrowserHost() : refuse(0), queueMeanwhile(false) { }
+
+        void pump()
+        {
+            WakeupList pending;
+            pending.swap(wakeups);
+            for (WakeupList::iterator it = pending.begin(); it != pending.end(); ++it) {
+                it->first(it->second);
+            }
+        }
+
+        typedef std::vector<std::pair<void (*)(void *), void *> > WakeupList;
+        mutable WakeupList wakeups;
+        // Number of wakeups to refuse before accepting them again
+        mutable int refuse;
+        // Queue a call while the next wakeup is being asked for, as another thread would
+        mutable bool queueMeanwhile;
+
+        void *getContextID() const { return NULL; }
+        FB::DOM::DocumentPtr getDOMDocument() { return FB::DOM::DocumentPtr(); }
+        FB::DOM::WindowPtr getDOMWindow() { return FB::DOM::WindowPtr(); }
+        FB::DOM::ElementPtr getDOMElement() { return FB::DOM::ElementPtr(); }
+        void evaluateJavaScript(const std::string &) { }
+        void DoDeferredRelease() const { }
+
+    private:
+        bool _scheduleAsyncCall(void (*func)(void *), void *userData) const
+        {
+            if (queueMeanwhile) {
+                queueMeanwhile = false;
+                const_cast<FakeBrowserHost*>(this)->ScheduleAsyncCall(&record, reinterpret_cast<void*>(1000));
+            }
+            if (refuse > 0) {
+                --refuse;
+                return false;
+            }
+            wakeups.push_back(std::make_pair(func, userData));
+            return true;
+        }
+        FB::BrowserStreamPtr _createStream(const std::string&, const FB::PluginEventSinkPtr&,
+                                           bool, bool, size_t) const { return FB::BrowserStreamPtr(); }
+        FB::BrowserStreamPtr _createPostStream(const std::string&, const FB::PluginEventSinkPtr&,
+                                               const std::string&, bool, bool, size_t) const { return FB::BrowserStreamPtr(); }
+    };
+}
+
+TEST(BrowserHost_BatchedAsyncCalls)
+{
+    PRINT_TESTNAME;
+
+    using namespace asynccall;
+    boost::shared_ptr<FakeBrowserHost> host(boost::make_shared<FakeBrowserHost>());
+    order.clear();
+
+    for (size_t i = 0; i < 100; i++) {
+        CHECK(host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(i)));
+    }
+    CHECK(host->wakeups.size() == 1);
+    CHECK(order.empty());
+
+    host->pump();
+    CHECK(order.size() == 100);
+    for (size_t i = 0; i < order.size(); i++) {
+        CHECK(order[i] == (int)i);
+    }
+
+    FB::AsyncCallStats stats(host->getAsyncCallStats());
+    CHECK(stats.wakeups == 1);
+    CHECK(stats.calls == 100);
+    CHECK(stats.largestBatch == 100);
+
+    // Once drained, the next call asks for a new wakeup
+    CHECK(host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(100)));
+    CHECK(host->wakeups.size() == 1);
+    host->pump();
+    CHECK(order.size() == 101);
+
+    host->shutdown();
+    CHECK(!host->ScheduleAsyncCall(&record, NULL));
+    order.clear();
+}
+
+TEST(BrowserHost_RefusedAsyncCall)
+{
+    PRINT_TESTNAME;
+
+    using namespace asynccall;
+    boost::shared_ptr<FakeBrowserHost> host(boost::make_shared<FakeBrowserHost>());
+    order.clear();
+
+    // A refused wakeup fails only the call that asked for it
+    host->refuse = 1;
+    CHECK(!host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(1)));
+    CHECK(host->wakeups.empty());
+    CHECK(host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(2)));
+    host->pump();
+    CHECK(order.size() == 1 && order[0] == 2);
+
+    // A call queued behind a refused one still gets its wakeup
+    order.clear();
+    host->refuse = 1;
+    host->queueMeanwhile = true;
+    CHECK(!host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(3)));
+    CHECK(host->wakeups.size() == 1);
+    host->pump();
+    CHECK(order.size() == 1 && order[0] == 1000);
+
+    // If the browser refuses that one too, the next call's wakeup runs it
+    order.clear();
+    host->refuse = 2;
+    host->queueMeanwhile = true;
+    CHECK(!host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(4)));
+    CHECK(host->wakeups.empty());
+    CHECK(host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(5)));
+    host->pump();
+    CHECK(order.size() == 2 && order[0] == 1000 && order[1] == 5);
+
+    host->shutdown();
+    order.clear();
+}
+
+TEST(BrowserHost_ShutdownRunsQueuedCallsInOrder)
+{
+    PRINT_TESTNAME;
+
+    using namespace asynccall;
+    boost::shared_ptr<FakeBrowserHost> host(boost::make_shared<FakeBrowserHost>());
+    order.clear();
+
+    for (size_t i = 0; i < 50; i++) {
+        CHECK(host->ScheduleAsyncCall(&record, reinterpret_cast<void*>(i)));
+    }
+
+    // Calls still queued at shutdown are run by it; the late wakeup then finds nothing to do
+    host->shutdown();
+    CHECK(order.size() == 50);
+    for (size_t i = 0; i < order.size(); i++) {
+        CHECK(order[i] == (int)i);
+    }
+    CHECK(!host->ScheduleAsyncCall(&record, NULL));
+    host->pump();
+    CHECK(order.size() == 50);
+    order.clear();
+}
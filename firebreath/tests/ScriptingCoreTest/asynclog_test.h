@@ -0,0 +1,128 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "AsyncLog.h"
+
+namespace asynclog
+{
+    // Collects lines on the writer thread; only read once the writer has stopped
+    class RecordingSink : public FB::Log::LogSink
+    {
+    public:
+        RecordingSink() : flushes(0) {}
+        void write(const std::string& line) { lines.push_back(line); }
+        void flush() { flushes++; }
+
+        std::vector<std::string> lines;
+        int flushes;
+    };
+
+    void logMany(FB::Log::AsyncLogWriter* writer, int count)
+    {
+        for (int i = 0; i < count; i++)
+            writer->log(FB::Log::LogLevel_Info, "message", __FILE__, __LINE__, "logMany");
+    }
+
+    bool endsWith(const std::string& str, const std::string& suffix)
+    {
+        return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+TEST(AsyncLogWriter_LevelsAndOrder)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<asynclog::RecordingSink> sink(new asynclog::RecordingSink());
+    FB::Log::AsyncLogWriter writer;
+    writer.addSink(sink);
+    writer.setLevel(FB::Log::LogLevel_Info);
+
+    // Nothing is queued before the writer runs
+    CHECK(!writer.log(FB::Log::LogLevel_Error, "early", __FILE__, __LINE__, "test"));
+
+    writer.start();
+    CHECK(!writer.log(FB::Log::LogLevel_Trace, "trace", __FILE__, __LINE__, "test"));
+    CHECK(!writer.log(FB::Log::LogLevel_Debug, "debug", __FILE__, __LINE__, "test"));
+    CHECK(writer.log(FB::Log::LogLevel_Info, "first", __FILE__, __LINE__, "test"));
+    CHECK(writer.log(FB::Log::LogLevel_Warn, "second", __FILE__, __LINE__, "test"));
+    CHECK(writer.log(FB::Log::LogLevel_Error, "third", __FILE__, __LINE__, "test"));
+    writer.stop();
+
+    CHECK(sink->lines.size() == 3);
+    if (sink->lines.size() == 3) {
+        CHECK(asynclog::endsWith(sink->lines[0], " - test - first"));
+        CHECK(sink->lines[0].find(" INFO  ") != std::string::npos);
+        CHECK(asynclog::endsWith(sink->lines[1], " - test - second"));
+        CHECK(sink->lines[1].find(" WARN  ") != std::string::npos);
+        CHECK(asynclog::endsWith(sink->lines[2], " - test - third"));
+    }
+    CHECK(sink->flushes >= 1);
+
+    // Stopped writers drop messages instead of queueing them forever
+    CHECK(!writer.log(FB::Log::LogLevel_Error, "late", __FILE__, __LINE__, "test"));
+}
+
+TEST(AsyncLogWriter_ManyThreads)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<asynclog::RecordingSink> sink(new asynclog::RecordingSink());
+    FB::Log::AsyncLogWriter writer(16384);
+    writer.addSink(sink);
+    writer.start();
+
+    std::vector<boost::shared_ptr<boost::thread> > threads;
+    for (int i = 0; i < 4; i++)
+        threads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&asynclog::logMany, &writer, 1000))));
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i]->join();
+    writer.stop();
+
+    CHECK(sink->lines.size() == 4000);
+}
+
+TEST(AsyncLogWriter_DropsWhenFull)
+{
+    PRINT_TESTNAME;
+
+    boost::shared_ptr<asynclog::RecordingSink> sink(new asynclog::RecordingSink());
+    FB::Log::AsyncLogWriter writer(4);
+    writer.addSink(sink);
+    writer.start();
+
+    // The writer can't keep up with a burst this size through a four slot ring; log() must not wait
+    int queued = 0;
+    for (int i = 0; i < 10000; i++) {
+        if (writer.log(FB::Log::LogLevel_Info, "burst", __FILE__, __LINE__, "test"))
+            queued++;
+    }
+    // Let the writer drain, then one more line carries the drop report
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    writer.log(FB::Log::LogLevel_Info, "after", __FILE__, __LINE__, "test");
+    writer.stop();
+
+    CHECK(queued < 10000);
+    bool reported = false;
+    for (size_t i = 0; i < sink->lines.size(); i++) {
+        if (sink->lines[i].find("log message(s) dropped") != std::string::npos)
+            reported = true;
+    }
+    CHECK(reported);
+    CHECK(asynclog::endsWith(sink->lines.back(), " - test - after"));
+}
@@ -0,0 +1,136 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include <cstdio>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "SafeQueue.h"
+#include "LockFreeQueue.h"
+
+#define QUEUE_BENCHMARK_PRODUCERS 4
+#define QUEUE_BENCHMARK_ITEMS 250000
+
+namespace lockfree
+{
+    // Items carry their producer in the high bits so the consumer can check per-producer order
+    inline int makeItem(int producer, int seq) { return (producer << 24) | seq; }
+    inline int itemProducer(int item) { return item >> 24; }
+    inline int itemSeq(int item) { return item & 0xffffff; }
+
+    template<class Queue>
+    void produce(Queue* queue, int producer, int count)
+    {
+        for (int i = 0; i < count; i++)
+            queue->push(makeItem(producer, i));
+    }
+
+    // Pops everything the producers push and returns false if anything arrived out of order
+    template<class Queue>
+    bool consume(Queue& queue, int producers, int count)
+    {
+        std::vector<int> next(producers, 0);
+        bool ordered = true;
+        for (int received = 0; received < producers * count; received++) {
+            int item;
+            queue.wait_and_pop(item);
+            if (itemSeq(item) != next[itemProducer(item)]++)
+                ordered = false;
+        }
+        return ordered;
+    }
+
+    // Time per item with several producer threads feeding the calling thread
+    template<class Queue>
+    double benchmarkQueue(Queue& queue, bool& ordered)
+    {
+        boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+        std::vector<boost::shared_ptr<boost::thread> > producers;
+        for (int p = 0; p < QUEUE_BENCHMARK_PRODUCERS; p++) {
+            producers.push_back(boost::shared_ptr<boost::thread>(new boost::thread(
+                boost::bind(&produce<Queue>, &queue, p, QUEUE_BENCHMARK_ITEMS))));
+        }
+        ordered = consume(queue, QUEUE_BENCHMARK_PRODUCERS, QUEUE_BENCHMARK_ITEMS);
+        for (size_t p = 0; p < producers.size(); p++)
+            producers[p]->join();
+        boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+
+        return elapsed.total_microseconds() * 1000.0 / (QUEUE_BENCHMARK_PRODUCERS * QUEUE_BENCHMARK_ITEMS);
+    }
+}
+
+TEST(LockFreeQueue_Basics)
+{
+    PRINT_TESTNAME;
+
+    FB::LockFreeQueue<int> queue(3);
+    CHECK(queue.capacity() == 4);
+    CHECK(queue.empty());
+
+    int value = 0;
+    CHECK(!queue.try_pop(value));
+
+    for (int i = 0; i < 4; i++)
+        CHECK(queue.try_push(i));
+    CHECK(!queue.try_push(4));
+    CHECK(!queue.empty());
+
+    // The ring wraps around several times without losing order
+    for (int i = 0; i < 20; i++) {
+        CHECK(queue.try_pop(value));
+        CHECK(value == i);
+        CHECK(queue.try_push(i + 4));
+    }
+    for (int i = 20; i < 24; i++) {
+        CHECK(queue.try_pop(value));
+        CHECK(value == i);
+    }
+    CHECK(queue.empty());
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    CHECK(!queue.timed_wait_and_pop(value, boost::posix_time::milliseconds(20)));
+    CHECK(boost::posix_time::microsec_clock::universal_time() - start >= boost::posix_time::milliseconds(15));
+}
+
+TEST(LockFreeQueue_Wakeup)
+{
+    PRINT_TESTNAME;
+
+    // A small ring keeps the producers blocked on a full queue and the consumer asleep in turns
+    FB::LockFreeQueue<int> queue(8);
+    boost::thread producer(boost::bind(&lockfree::produce<FB::LockFreeQueue<int> >, &queue, 0, 10000));
+    CHECK(lockfree::consume(queue, 1, 10000));
+    producer.join();
+    CHECK(queue.empty());
+}
+
+TEST(LockFreeQueue_ContentionBenchmark)
+{
+    PRINT_TESTNAME;
+
+    bool safeOrdered = false;
+    bool lockFreeOrdered = false;
+    FB::SafeQueue<int> safeQueue;
+    FB::LockFreeQueue<int> lockFreeQueue(4096);
+    double safe = lockfree::benchmarkQueue(safeQueue, safeOrdered);
+    double lockFree = lockfree::benchmarkQueue(lockFreeQueue, lockFreeOrdered);
+
+    CHECK(safeOrdered);
+    CHECK(lockFreeOrdered);
+    CHECK(lockFreeQueue.empty());
+    printf("    %d producers: SafeQueue %.1f ns/item, LockFreeQueue %.1f ns/item\n",
+        QUEUE_BENCHMARK_PRODUCERS, safe, lockFree);
+}
@@ -0,0 +1,92 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include <boost/make_shared.hpp>
+#include "JSAPIAuto.h"
+#include "variant_list.h"
+
+namespace methodcache
+{
+    class DispatchTestJSAPI : public FB::JSAPIAuto
+    {
+    public:
+        DispatchTestJSAPI() : calls(0)
+        {
+            registerMethod("sumOf", make_method(this, &DispatchTestJSAPI::sumOf));
+        }
+
+        int sumOf(int a, int b) { ++calls; return a + b; }
+        int productOf(int a, int b) { ++calls; return a * b; }
+
+        int calls;
+    };
+}
+
+TEST(JSAPIAuto_ResolveMethod)
+{
+    PRINT_TESTNAME;
+
+    using namespace methodcache;
+    boost::shared_ptr<DispatchTestJSAPI> api(boost::make_shared<DispatchTestJSAPI>());
+    FB::VariantList args(FB::variant_list_of(6)(7));
+    FB::variant ret;
+
+    FB::MethodHandle handle;
+    CHECK(!api->ResolveMethod("missing", handle));
+    CHECK(api->ResolveMethod("sumOf", handle));
+
+    // A resolved handle can be called any number of times
+    for (int i = 0; i < 2; i++) {
+        CHECK(api->InvokeResolved(handle, args, ret));
+        CHECK(ret.convert_cast<int>() == 13);
+    }
+    CHECK(api->calls == 2);
+
+    // Replacing the method makes the handle stale, the name finds the new one
+    api->registerMethod("sumOf", FB::make_method(api.get(), &DispatchTestJSAPI::productOf));
+    CHECK(!api->InvokeResolved(handle, args, ret));
+    CHECK(api->calls == 2);
+    CHECK(api->ResolveMethod("sumOf", handle));
+    CHECK(api->InvokeResolved(handle, args, ret));
+    CHECK(ret.convert_cast<int>() == 42);
+
+    // So does removing it
+    api->unregisterMethod("sumOf");
+    CHECK(!api->InvokeResolved(handle, args, ret));
+    CHECK(!api->ResolveMethod("sumOf", handle));
+    CHECK(api->calls == 3);
+}
+
+TEST(JSAPIAuto_ResolveMethodZone)
+{
+    PRINT_TESTNAME;
+
+    using namespace methodcache;
+    boost::shared_ptr<DispatchTestJSAPI> api(boost::make_shared<DispatchTestJSAPI>());
+    FB::VariantList args(FB::variant_list_of(6)(7));
+    FB::variant ret;
+    FB::MethodHandle handle;
+
+    // A method registered in a higher zone is resolved and called only from there
+    {
+        FB::scoped_zonelock _l(api, FB::SecurityScope_Local);
+        api->registerMethod("productOf", FB::make_method(api.get(), &DispatchTestJSAPI::productOf));
+        CHECK(api->ResolveMethod("productOf", handle));
+        CHECK(api->InvokeResolved(handle, args, ret));
+        CHECK(ret.convert_cast<int>() == 42);
+    }
+    CHECK(!api->InvokeResolved(handle, args, ret));
+    CHECK(!api->ResolveMethod("productOf", handle));
+    CHECK(api->calls == 1);
+}
@@ -0,0 +1,156 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#ifndef H_TYPEDMETHOD_FIXTURES
+#define H_TYPEDMETHOD_FIXTURES
+
+#include <string>
+#include <boost/optional.hpp>
+#include "JSAPIAuto.h"
+#include "TypedMethod.h"
+
+// Shared by typedmethod_test.h and the typed method benchmark
+namespace typed
+{
+    // Stands in for a browser's native argument array
+    struct RawValue
+    {
+        enum Type { Int, Double, Bool, String };
+
+        RawValue(int i) : type(Int), i(i), d(0), b(false), s(NULL) {}
+        RawValue(double d) : type(Double), i(0), d(d), b(false), s(NULL) {}
+        RawValue(bool b) : type(Bool), i(0), d(0), b(b), s(NULL) {}
+        RawValue(const char* s) : type(String), i(0), d(0), b(false), s(s) {}
+
+        FB::variant toVariant() const
+        {
+            switch (type) {
+                case Int: return i;
+                case Double: return d;
+                case Bool: return b;
+                default: return std::string(s);
+            }
+        }
+
+        Type type;
+        int i;
+        double d;
+        bool b;
+        const char* s;
+    };
+
+    class RawArguments : public FB::TypedArguments
+    {
+    public:
+        RawArguments(const RawValue* values, size_t count) : values(values), count(count) {}
+
+        size_t size() const { return count; }
+        bool get(size_t index, int& value) const
+        {
+            if (values[index].type != RawValue::Int)
+                return false;
+            value = values[index].i;
+            return true;
+        }
+        bool get(size_t index, double& value) const
+        {
+            if (values[index].type != RawValue::Double)
+                return false;
+            value = values[index].d;
+            return true;
+        }
+        bool get(size_t index, bool& value) const
+        {
+            if (values[index].type != RawValue::Bool)
+                return false;
+            value = values[index].b;
+            return true;
+        }
+        bool get(size_t index, std::string& value) const
+        {
+            if (values[index].type != RawValue::String)
+                return false;
+            value.assign(values[index].s);
+            return true;
+        }
+
+    private:
+        const RawValue* values;
+        size_t count;
+    };
+
+    // Keeps its string buffer between calls, like a browser result that is handed back right away
+    class RawResult : public FB::TypedResult
+    {
+    public:
+        enum Type { Unset, Void, Int, Double, Bool, String };
+
+        RawResult() : type(Unset), i(0), d(0), b(false) {}
+
+        void setVoid() { type = Void; }
+        void set(int value) { type = Int; i = value; }
+        void set(double value) { type = Double; d = value; }
+        void set(bool value) { type = Bool; b = value; }
+        void set(const std::string& value) { type = String; s.assign(value); }
+
+        Type type;
+        int i;
+        double d;
+        bool b;
+        std::string s;
+    };
+
+    class Terminal
+    {
+    public:
+        Terminal() : written(0), output("guest@beagle:~$ ls -la /usr/local/share\r\n") {}
+
+        int write(int keyCode) { ++written; return keyCode; }
+        std::string read() { return output; }
+        int size() const { return (int)output.size(); }
+        double scale(double factor, int columns) { return factor * columns; }
+        bool resize(int columns, int rows, bool notify) { return notify && columns > 0 && rows > 0; }
+        void send(const std::string& text) { output = text; }
+        std::string repeat(const std::string& text, int count) const
+        {
+            std::string out;
+            for (int i = 0; i < count; i++)
+                out += text;
+            return out;
+        }
+        int wide(long keyCode) { return (int)keyCode; }
+        int optional(const boost::optional<int>& keyCode) { return keyCode ? *keyCode : -1; }
+
+        int written;
+        std::string output;
+    };
+
+    class TerminalAPI : public FB::JSAPIAuto
+    {
+    public:
+        TerminalAPI(Terminal* terminal)
+        {
+            registerMethod("write", FB::make_method(terminal, &Terminal::write));
+            registerMethod("read", FB::make_method(terminal, &Terminal::read));
+            registerMethod("wide", FB::make_method(terminal, &Terminal::wide));
+        }
+    };
+
+    inline const FB::TypedMethod* typedMethod(const FB::CallMethodFunctor& call)
+    {
+        return call.target<FB::TypedMethod>();
+    }
+}
+
+#endif // H_TYPEDMETHOD_FIXTURES
@@ -0,0 +1,108 @@
+/**********************************************************\
+Original Author: jungilhan
+
+Created:    Oct 18, 2026
+License:    Dual license model; choose one of two:
+            New BSD License
+            http://www.opensource.org/licenses/bsd-license.php
+            - or -
+            GNU Lesser General Public License, version 2.1
+            http://www.gnu.org/licenses/lgpl-2.1.html
+
+Copyright 2026 jungilhan, Firebreath development team
+\**********************************************************/
+
+#include "typedmethod_fixtures.h"
+
+TEST(TypedMethod_Signatures)
+{
+    PRINT_TESTNAME;
+
+    using namespace typed;
+    Terminal terminal;
+
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::write)));
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::read)));
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::size)));
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::scale)));
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::resize)));
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::send)));
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::repeat)));
+
+    // Anything the typed path cannot represent exactly stays with the variant conversions
+    CHECK(!typedMethod(FB::make_method(&terminal, &Terminal::wide)));
+    CHECK(!typedMethod(FB::make_method(&terminal, &Terminal::optional)));
+}
+
+TEST(TypedMethod_Invoke)
+{
+    PRINT_TESTNAME;
+
+    using namespace typed;
+    Terminal terminal;
+    RawResult result;
+
+    FB::CallMethodFunctor write(FB::make_method(&terminal, &Terminal::write));
+    const RawValue keyCode[] = { RawValue(65) };
+    CHECK(typedMethod(write)->invoke(RawArguments(keyCode, 1), result));
+    CHECK(result.type == RawResult::Int && result.i == 65);
+    CHECK(terminal.written == 1);
+
+    // The typed method is still a regular method functor
+    CHECK(write(FB::variant_list_of(66)).convert_cast<int>() == 66);
+    CHECK(terminal.written == 2);
+
+    // Mismatches are refused before the method is called
+    const RawValue wrongType[] = { RawValue(65.0) };
+    CHECK(!typedMethod(write)->invoke(RawArguments(wrongType, 1), result));
+    CHECK(!typedMethod(write)->invoke(RawArguments(keyCode, 0), result));
+    const RawValue tooMany[] = { RawValue(65), RawValue(66) };
+    CHECK(!typedMethod(write)->invoke(RawArguments(tooMany, 2), result));
+    CHECK(terminal.written == 2);
+
+    const RawValue scale[] = { RawValue(1.5), RawValue(80) };
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::scale))->invoke(RawArguments(scale, 2), result));
+    CHECK(result.type == RawResult::Double && result.d == 120.0);
+
+    const RawValue resize[] = { RawValue(80), RawValue(24), RawValue(true) };
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::resize))->invoke(RawArguments(resize, 3), result));
+    CHECK(result.type == RawResult::Bool && result.b);
+
+    const RawValue text[] = { RawValue("exit\n") };
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::send))->invoke(RawArguments(text, 1), result));
+    CHECK(result.type == RawResult::Void && terminal.output == "exit\n");
+
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::read))->invoke(RawArguments(NULL, 0), result));
+    CHECK(result.type == RawResult::String && result.s == "exit\n");
+
+    const RawValue repeat[] = { RawValue("ab"), RawValue(3) };
+    CHECK(typedMethod(FB::make_method(&terminal, &Terminal::repeat))->invoke(RawArguments(repeat, 2), result));
+    CHECK(result.type == RawResult::String && result.s == "ababab");
+}
+
+TEST(TypedMethod_InvokeResolved)
+{
+    PRINT_TESTNAME;
+
+    using namespace typed;
+    Terminal terminal;
+    TerminalAPI api(&terminal);
+    RawResult result;
+    const RawValue keyCode[] = { RawValue(65) };
+
+    FB::MethodHandle handle;
+    CHECK(api.ResolveMethod("write", handle));
+    CHECK(handle.typed != NULL);
+    CHECK(api.InvokeResolved(handle, RawArguments(keyCode, 1), result));
+    CHECK(result.type == RawResult::Int && result.i == 65);
+
+    FB::MethodHandle wide;
+    CHECK(api.ResolveMethod("wide", wide));
+    CHECK(wide.typed == NULL);
+    CHECK(!api.InvokeResolved(wide, RawArguments(keyCode, 1), result));
+
+    // A stale handle must not reach the old functor
+    api.unregisterMethod("write");
+    CHECK(!api.InvokeResolved(handle, RawArguments(keyCode, 1), result));
+    CHECK(terminal.written == 1);
+}
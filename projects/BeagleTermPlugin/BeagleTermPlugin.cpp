@@ -10,10 +10,13 @@
 #include "BeagleTermPluginAPI.h"
 #include "BeagleTermPlugin.h"
 
-#include <iostream>
 #include <assert.h>
+#include "logging.h"
 
 #include "SSHTerminal.h"
+#include "SessionRegistry.h"
+#include "PreconnectPool.h"
+#include "ClusterSession.h"
 //#include "SSHTerminal.hpp"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -27,7 +30,8 @@ void BeagleTermPlugin::StaticInitialize()
 {
     // Place one-time initialization stuff here; As of FireBreath 1.4 this should only
     // be called once per process
-		std::cout << "[BeagleTermPlugin::StaticInitialize]" << std::endl;
+    FBLOG_INFO("BeagleTermPlugin", "StaticInitialize");
+    SSHTerminal::staticInitialize();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -41,7 +45,10 @@ void BeagleTermPlugin::StaticDeinitialize()
 {
     // Place one-time deinitialization stuff here. As of FireBreath 1.4 this should
     // always be called just before the plugin library is unloaded
-    std::cout << "[BeagleTermPlugin::StaticDeinitialize]" << std::endl;
+    FBLOG_INFO("BeagleTermPlugin", "StaticDeinitialize");
+    SessionRegistry::clear();
+    PreconnectPool::clear();
+    SSHTerminal::staticDeinitialize();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -52,6 +59,8 @@ void BeagleTermPlugin::StaticDeinitialize()
 BeagleTermPlugin::BeagleTermPlugin()
 {
     m_terminal = 0;
+    m_cluster = 0;
+    m_resumeGraceMs = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -73,7 +82,7 @@ void BeagleTermPlugin::onPluginReady()
     // created, and we are ready to interact with the page and such.  The
     // PluginWindow may or may not have already fire the AttachedEvent at
     // this point.
-    std::cout << "[BeagleTermPlugin::onPluginReady]" << std::endl;
+    FBLOG_DEBUG("BeagleTermPlugin", "onPluginReady");
 
 		assert(!m_terminal);
 		m_terminal = new SSHTerminal();
@@ -86,12 +95,59 @@ void BeagleTermPlugin::shutdown()
     // object should be released here so that this object can be safely
     // destroyed. This is the last point that shared_from_this and weak_ptr
     // references to this object will be valid
-    std::cout << "[BeagleTermPlugin::shutdown]" << std::endl;
+    FBLOG_DEBUG("BeagleTermPlugin", "shutdown");
 
 		if (m_terminal) {
-		    delete m_terminal;
+		    if (m_resumeGraceMs <= 0 || !SessionRegistry::park(m_resumeToken, m_terminal, m_resumeGraceMs))
+		        delete m_terminal;
 		    m_terminal = 0;
 		}
+
+		if (m_cluster) {
+		    delete m_cluster;
+		    m_cluster = 0;
+		}
+}
+
+ClusterSession* BeagleTermPlugin::getCluster()
+{
+    if (!m_cluster)
+        m_cluster = new ClusterSession();
+    return m_cluster;
+}
+
+int BeagleTermPlugin::connect(const std::string& host, const std::string& port, const std::string& user)
+{
+    if (!m_terminal->isConnected()) {
+        SSHTerminal* terminal = PreconnectPool::take(host, port, user);
+        if (terminal) {
+            delete m_terminal;
+            m_terminal = terminal;
+            return 0;
+        }
+    }
+
+    return m_terminal->connect(host, port, user);
+}
+
+std::string BeagleTermPlugin::setResumable(long graceMs)
+{
+    m_resumeGraceMs = graceMs;
+    m_resumeToken = graceMs > 0 ? SessionRegistry::newToken() : std::string();
+    return m_resumeToken;
+}
+
+bool BeagleTermPlugin::resume(const std::string& token)
+{
+    SSHTerminal* terminal = SessionRegistry::claim(token);
+    if (!terminal)
+        return false;
+
+    // Whatever this instance connected so far gives way to the resumed session
+    delete m_terminal;
+    m_terminal = terminal;
+    m_terminal->replayHistory();
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -15,7 +15,10 @@
 
 #include "PluginCore.h"
 
+#include <string>
+
 class SSHTerminal;
+class ClusterSession;
 
 FB_FORWARD_PTR(BeagleTermPlugin)
 class BeagleTermPlugin : public FB::PluginCore
@@ -57,9 +60,21 @@ public:
 
 public:
     SSHTerminal* getTerminal() { return m_terminal; }
+    ClusterSession* getCluster();
+
+    // Takes over a session the preconnect pool has ready for the host, or connects anew
+    int connect(const std::string& host, const std::string& port, const std::string& user);
+
+    // The terminal outlives this instance by graceMs when it shuts down; the
+    // token returned resumes it from another instance. 0 turns it off.
+    std::string setResumable(long graceMs);
+    bool resume(const std::string& token);
 
 private:
     SSHTerminal* m_terminal;
+    ClusterSession* m_cluster;
+    std::string m_resumeToken;
+    long m_resumeGraceMs;
 };
 
 #endif
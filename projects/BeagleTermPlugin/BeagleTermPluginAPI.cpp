@@ -11,10 +11,14 @@
 
 #include "BeagleTermPluginAPI.h"
 #include "SSHTerminal.h"
+#include "PreconnectPool.h"
+#include "ClusterSession.h"
 //#include "SSHTerminal.hpp"
 
-#include <iostream>
-#include <stdio.h>
+#include "logging.h"
+
+// Hosts of a cluster connecting at once
+#define CLUSTER_PARALLEL 16
 
 ///////////////////////////////////////////////////////////////////////////////
 /// @fn BeagleTermPluginAPI::BeagleTermPluginAPI(const BeagleTermPluginPtr& plugin, const FB::BrowserHostPtr host)
@@ -28,7 +32,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 BeagleTermPluginAPI::BeagleTermPluginAPI(const BeagleTermPluginPtr& plugin, const FB::BrowserHostPtr& host) : m_plugin(plugin), m_host(host)
 {
-    std::cout << "[BeagleTermPluginAPI::BeagleTermPluginAPI] " << std::endl;
+    FBLOG_DEBUG("BeagleTermPluginAPI", "created");
 
     // Properties
     registerProperty("host", make_property(this, &BeagleTermPluginAPI::getUrl, &BeagleTermPluginAPI::setUrl));
@@ -39,11 +43,32 @@ BeagleTermPluginAPI::BeagleTermPluginAPI(const BeagleTermPluginPtr& plugin, cons
     // Methods
     registerMethod("connect",  make_method(this, &BeagleTermPluginAPI::connect));
     registerMethod("disconnect",  make_method(this, &BeagleTermPluginAPI::disconnect));
+    registerMethod("preconnect",  make_method(this, &BeagleTermPluginAPI::preconnect));
     registerMethod("verifyKnownHost",  make_method(this, &BeagleTermPluginAPI::verifyKnownHost));
     registerMethod("writeKnownHost",  make_method(this, &BeagleTermPluginAPI::writeKnownHost));
     registerMethod("userauthPassword",  make_method(this, &BeagleTermPluginAPI::userauthPassword));
     registerMethod("write",  make_method(this, &BeagleTermPluginAPI::write));
+    registerMethod("resize",  make_method(this, &BeagleTermPluginAPI::resize));
     registerMethod("read",  make_method(this, &BeagleTermPluginAPI::read));
+    registerMethod("getStats",  make_method(this, &BeagleTermPluginAPI::getStats));
+    registerMethod("getConnectProfile",  make_method(this, &BeagleTermPluginAPI::getConnectProfile));
+    registerMethod("dumpTrace",  make_method(this, &BeagleTermPluginAPI::dumpTrace));
+    registerMethod("setTriggers",  make_method(this, &BeagleTermPluginAPI::setTriggers));
+    registerMethod("getTriggerEvents",  make_method(this, &BeagleTermPluginAPI::getTriggerEvents));
+    registerMethod("startRecording",  make_method(this, &BeagleTermPluginAPI::startRecording));
+    registerMethod("stopRecording",  make_method(this, &BeagleTermPluginAPI::stopRecording));
+    registerMethod("clusterStart",  make_method(this, &BeagleTermPluginAPI::clusterStart));
+    registerMethod("clusterStop",  make_method(this, &BeagleTermPluginAPI::clusterStop));
+    registerMethod("clusterWrite",  make_method(this, &BeagleTermPluginAPI::clusterWrite));
+    registerMethod("clusterRead",  make_method(this, &BeagleTermPluginAPI::clusterRead));
+    registerMethod("clusterStatus",  make_method(this, &BeagleTermPluginAPI::clusterStatus));
+    registerMethod("clusterResults",  make_method(this, &BeagleTermPluginAPI::clusterResults));
+    registerMethod("setKeepalive",  make_method(this, &BeagleTermPluginAPI::setKeepalive));
+    registerMethod("setResumable",  make_method(this, &BeagleTermPluginAPI::setResumable));
+    registerMethod("resume",  make_method(this, &BeagleTermPluginAPI::resume));
+    registerMethod("forwardLocal",  make_method(this, &BeagleTermPluginAPI::forwardLocal));
+    registerMethod("forwardDynamic",  make_method(this, &BeagleTermPluginAPI::forwardDynamic));
+    registerMethod("cancelForward",  make_method(this, &BeagleTermPluginAPI::cancelForward));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -120,54 +145,325 @@ void BeagleTermPluginAPI::connect(const std::string& host, const std::string& po
     }
 
     m_port = port;
-    std::cout << "[BeagleTermPluginAPI::connect] " << m_user + "@" + m_url + ":" + m_port<< std::endl;
+    FBLOG_INFO("BeagleTermPluginAPI", "connect " << m_user << "@" << m_url << ":" << m_port);
+
+    getPlugin()->connect(m_url, m_port, m_user);
+}
 
-    getPlugin()->getTerminal()->connect(m_url, m_port, m_user);
+void BeagleTermPluginAPI::preconnect(const std::string& host, const std::string& port, const boost::optional<std::string> user)
+{
+    std::string url = user.is_initialized() ? host : tokenizeHost(host);
+    std::string name = user.is_initialized() ? user.get() : tokenizeUser(host);
+    FBLOG_DEBUG("BeagleTermPluginAPI", "preconnect " << name << "@" << url << ":" << port);
+
+    PreconnectPool::start(url, port, name);
 }
 
 void BeagleTermPluginAPI::disconnect()
 {
-    std::cout << "[BeagleTermPluginAPI::disconnect] " << std::endl;
+    FBLOG_INFO("BeagleTermPluginAPI", "disconnect");
 
     getPlugin()->getTerminal()->disconnect();
 }
 
 int BeagleTermPluginAPI::verifyKnownHost()
 {
-    std::cout << "[BeagleTermPluginAPI::verifyKnownHost] " << std::endl;
+    FBLOG_DEBUG("BeagleTermPluginAPI", "verifyKnownHost");
 
     return getPlugin()->getTerminal()->verifyKnownHost(m_error);
 }
 
 int BeagleTermPluginAPI::writeKnownHost()
 {
-    std::cout << "[BeagleTermPluginAPI::writeKnownHost] " << std::endl;
+    FBLOG_DEBUG("BeagleTermPluginAPI", "writeKnownHost");
 
     return getPlugin()->getTerminal()->writeKnownHost();
 }
 
 int BeagleTermPluginAPI::userauthPassword(const std::string& password)
 {
-    std::cout << "[BeagleTermPluginAPI::userauthPassword] " << password << std::endl;
+    FBLOG_DEBUG("BeagleTermPluginAPI", "userauthPassword");
 
     return getPlugin()->getTerminal()->userauthPassword(password);
 }
 
 int BeagleTermPluginAPI::write(int keyCode)
 {
-    std::cout << "[BeagleTermPluginAPI::write] " << keyCode << " 0x" << std::hex << keyCode << std::endl;
-
+    FBLOG_TRACE("BeagleTermPluginAPI", "write " << keyCode << " 0x" << std::hex << keyCode);
 
     return getPlugin()->getTerminal()->write(static_cast<char>(keyCode));
 }
 
+void BeagleTermPluginAPI::resize(int columns, int rows)
+{
+    FBLOG_DEBUG("BeagleTermPluginAPI", "resize " << columns << "x" << rows);
+
+    getPlugin()->getTerminal()->resize(columns, rows);
+}
+
 std::string BeagleTermPluginAPI::read()
 {
-    std::cout << "[BeagleTermPluginAPI::read] " << std::endl;
+    FBLOG_TRACE("BeagleTermPluginAPI", "read");
 
     return getPlugin()->getTerminal()->read();
 }
 
+FB::VariantMap BeagleTermPluginAPI::getStats()
+{
+    SSHTerminal::Stats stats;
+    getPlugin()->getTerminal()->getStats(stats);
+
+    // Javascript numbers are doubles, so 64 bit counters are handed over as such
+    FB::VariantMap map;
+    map["bytesIn"] = static_cast<double>(stats.session.bytes_in);
+    map["bytesOut"] = static_cast<double>(stats.session.bytes_out);
+    map["packetsIn"] = static_cast<double>(stats.session.packets_in);
+    map["packetsOut"] = static_cast<double>(stats.session.packets_out);
+    map["socketReads"] = static_cast<double>(stats.session.read_calls);
+    map["socketWrites"] = static_cast<double>(stats.session.write_calls);
+    map["encryptUsec"] = static_cast<double>(stats.session.encrypt_ns / 1000);
+    map["decryptUsec"] = static_cast<double>(stats.session.decrypt_ns / 1000);
+    map["macUsec"] = static_cast<double>(stats.session.mac_ns / 1000);
+    map["bufferReallocs"] = static_cast<int>(stats.session.buffer_reallocs);
+    map["socketInQueue"] = static_cast<int>(stats.session.in_queue);
+    map["socketOutQueue"] = static_cast<int>(stats.session.out_queue);
+    map["rttSamples"] = static_cast<int>(stats.session.rtt_samples);
+    map["srttUsec"] = static_cast<double>(stats.session.srtt_us);
+
+    map["channelBytesIn"] = static_cast<double>(stats.channel.data_in);
+    map["channelBytesOut"] = static_cast<double>(stats.channel.data_out);
+    map["windowStalls"] = static_cast<int>(stats.channel.window_stalls);
+    map["windowStallUsec"] = static_cast<double>(stats.channel.window_stall_ns / 1000);
+    map["channelInQueue"] = static_cast<int>(stats.channel.in_queue);
+    map["channelOutQueue"] = static_cast<int>(stats.channel.out_queue);
+
+    map["writeCalls"] = static_cast<double>(stats.writeCalls);
+    map["readCalls"] = static_cast<double>(stats.readCalls);
+    map["pendingRender"] = static_cast<int>(stats.pendingRender);
+    map["pendingWrite"] = static_cast<int>(stats.pendingWrite);
+    map["reactorTasks"] = static_cast<int>(stats.reactorTasks);
+
+    map["localEcho"] = stats.localEcho;
+    map["echoConfirmed"] = static_cast<double>(stats.echoConfirmed);
+    map["echoFailed"] = static_cast<double>(stats.echoFailed);
+    map["echoRttUsec"] = static_cast<double>(stats.echoRoundTrip);
+
+    map["keepalivesSent"] = static_cast<int>(stats.session.keepalives_sent);
+    map["keepalivesAnswered"] = static_cast<int>(stats.session.keepalives_answered);
+    map["keepaliveMisses"] = stats.keepaliveMisses;
+    map["linkRttUsec"] = static_cast<double>(stats.linkRtt);
+    map["linkJitterUsec"] = static_cast<double>(stats.linkJitter);
+    map["linkDead"] = stats.linkDead;
+
+    map["triggerMatches"] = static_cast<double>(stats.triggerMatches);
+    map["triggerDropped"] = static_cast<double>(stats.triggerDropped);
+
+    map["recording"] = stats.recording;
+    map["recordingDropped"] = static_cast<double>(stats.recordingDropped);
+
+    map["forwardListeners"] = static_cast<int>(stats.forwarding.listeners);
+    map["forwardConnections"] = static_cast<int>(stats.forwarding.connections);
+    map["forwardAccepted"] = static_cast<double>(stats.forwarding.accepted);
+    map["forwardFailed"] = static_cast<double>(stats.forwarding.failed);
+    map["forwardBytesUp"] = static_cast<double>(stats.forwarding.bytesUp);
+    map["forwardBytesDown"] = static_cast<double>(stats.forwarding.bytesDown);
+    map["forwardBuffersInUse"] = static_cast<int>(stats.forwarding.buffersInUse);
+    map["forwardBuffersFree"] = static_cast<int>(stats.forwarding.buffersFree);
+    return map;
+}
+
+FB::VariantMap BeagleTermPluginAPI::getConnectProfile()
+{
+    const SSHTerminal::ConnectProfile& profile = getPlugin()->getTerminal()->getConnectProfile();
+
+    // Phases that have not been reached yet are 0
+    FB::VariantMap map;
+    map["dnsUsec"] = profile.dns;
+    map["tcpUsec"] = profile.tcp;
+    map["tcpAttempts"] = profile.attempts;
+    map["bannerUsec"] = profile.banner;
+    map["kexUsec"] = profile.kex;
+    map["kexCpuUsec"] = profile.kexCpu;
+    map["hostKeyUsec"] = profile.hostKey;
+    map["authUsec"] = profile.auth;
+    map["channelUsec"] = profile.channel;
+    map["ptyUsec"] = profile.pty;
+    map["shellUsec"] = profile.shell;
+    return map;
+}
+
+void BeagleTermPluginAPI::dumpTrace()
+{
+    FBLOG_DEBUG("BeagleTermPluginAPI", "dumpTrace");
+
+    getPlugin()->getTerminal()->dumpTrace();
+}
+
+int BeagleTermPluginAPI::setTriggers(const std::vector<std::string>& patterns)
+{
+    FBLOG_DEBUG("BeagleTermPluginAPI", "setTriggers: " << patterns.size() << " pattern(s)");
+
+    getPlugin()->getTerminal()->setTriggers(patterns);
+    return static_cast<int>(patterns.size());
+}
+
+FB::VariantList BeagleTermPluginAPI::getTriggerEvents()
+{
+    std::vector<SSHTerminal::TriggerEvent> events;
+    getPlugin()->getTerminal()->takeTriggerEvents(events);
+
+    FB::VariantList list;
+    for (size_t i = 0; i < events.size(); i++) {
+        FB::VariantMap map;
+        map["pattern"] = static_cast<int>(events[i].pattern);
+        map["text"] = events[i].text;
+        map["line"] = static_cast<double>(events[i].line);
+        map["column"] = static_cast<int>(events[i].column);
+        list.push_back(map);
+    }
+    return list;
+}
+
+bool BeagleTermPluginAPI::startRecording(const std::string& name, const boost::optional<bool> input)
+{
+    std::string path = SessionRecorder::pathFor(name);
+    if (path.empty()) {
+        FBLOG_WARN("BeagleTermPluginAPI", "startRecording: not a file name: " << name);
+        return false;
+    }
+
+    FBLOG_INFO("BeagleTermPluginAPI", "startRecording " << path);
+    return getPlugin()->getTerminal()->startRecording(path, input.is_initialized() && input.get());
+}
+
+void BeagleTermPluginAPI::stopRecording()
+{
+    FBLOG_INFO("BeagleTermPluginAPI", "stopRecording");
+
+    getPlugin()->getTerminal()->stopRecording();
+}
+
+int BeagleTermPluginAPI::clusterStart(const std::vector<std::string>& hosts, const std::string& password, const boost::optional<std::string> command)
+{
+    FBLOG_INFO("BeagleTermPluginAPI", "clusterStart: " << hosts.size() << " host(s)");
+
+    getPlugin()->getCluster()->start(hosts, password, command.is_initialized() ? command.get() : std::string(), CLUSTER_PARALLEL);
+    return static_cast<int>(hosts.size());
+}
+
+void BeagleTermPluginAPI::clusterStop()
+{
+    FBLOG_INFO("BeagleTermPluginAPI", "clusterStop");
+
+    getPlugin()->getCluster()->stop();
+}
+
+void BeagleTermPluginAPI::clusterWrite(const std::string& keys)
+{
+    FBLOG_TRACE("BeagleTermPluginAPI", "clusterWrite " << keys.size() << " byte(s)");
+
+    getPlugin()->getCluster()->write(keys);
+}
+
+FB::VariantList BeagleTermPluginAPI::clusterRead()
+{
+    ClusterSession* cluster = getPlugin()->getCluster();
+    std::vector<ClusterSession::Chunk> chunks;
+    cluster->takeOutput(chunks);
+
+    FB::VariantList list;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        FB::VariantMap map;
+        map["host"] = cluster->hostName(chunks[i].host);
+        map["data"] = chunks[i].data;
+        list.push_back(map);
+    }
+    return list;
+}
+
+FB::VariantList BeagleTermPluginAPI::clusterStatus()
+{
+    static const char* const states[] = { "pending", "connecting", "running", "done", "failed" };
+
+    std::vector<ClusterSession::HostStatus> status;
+    getPlugin()->getCluster()->takeStatus(status);
+
+    FB::VariantList list;
+    for (size_t i = 0; i < status.size(); i++) {
+        FB::VariantMap map;
+        map["host"] = status[i].name;
+        map["state"] = std::string(states[status[i].state]);
+        map["error"] = status[i].error;
+        map["exitStatus"] = status[i].exitStatus;
+        list.push_back(map);
+    }
+    return list;
+}
+
+FB::VariantList BeagleTermPluginAPI::clusterResults()
+{
+    ClusterSession* cluster = getPlugin()->getCluster();
+    std::vector<ClusterSession::Result> results;
+    cluster->results(results);
+
+    // One entry per distinct output, with every host that printed it
+    FB::VariantList list;
+    for (size_t i = 0; i < results.size(); i++) {
+        FB::VariantList hosts;
+        for (size_t j = 0; j < results[i].hosts.size(); j++)
+            hosts.push_back(cluster->hostName(results[i].hosts[j]));
+
+        FB::VariantMap map;
+        map["hosts"] = hosts;
+        map["output"] = results[i].output;
+        map["exitStatus"] = results[i].exitStatus;
+        list.push_back(map);
+    }
+    return list;
+}
+
+void BeagleTermPluginAPI::setKeepalive(long intervalMs, int maxMisses)
+{
+    FBLOG_DEBUG("BeagleTermPluginAPI", "setKeepalive: " << intervalMs << "ms, " << maxMisses << " miss(es)");
+
+    getPlugin()->getTerminal()->setKeepalive(intervalMs, maxMisses);
+}
+
+std::string BeagleTermPluginAPI::setResumable(long graceMs)
+{
+    FBLOG_DEBUG("BeagleTermPluginAPI", "setResumable: " << graceMs << "ms");
+
+    return getPlugin()->setResumable(graceMs);
+}
+
+bool BeagleTermPluginAPI::resume(const std::string& token)
+{
+    FBLOG_INFO("BeagleTermPluginAPI", "resume");
+
+    return getPlugin()->resume(token);
+}
+
+int BeagleTermPluginAPI::forwardLocal(int bindPort, const std::string& host, int port)
+{
+    FBLOG_INFO("BeagleTermPluginAPI", "forwardLocal: " << bindPort << " to " << host << ":" << port);
+
+    return getPlugin()->getTerminal()->forwardLocal(bindPort, host, port);
+}
+
+int BeagleTermPluginAPI::forwardDynamic(int bindPort)
+{
+    FBLOG_INFO("BeagleTermPluginAPI", "forwardDynamic: " << bindPort);
+
+    return getPlugin()->getTerminal()->forwardDynamic(bindPort);
+}
+
+bool BeagleTermPluginAPI::cancelForward(int bindPort)
+{
+    FBLOG_INFO("BeagleTermPluginAPI", "cancelForward: " << bindPort);
+
+    return getPlugin()->getTerminal()->cancelForward(bindPort);
+}
+
 std::string BeagleTermPluginAPI::tokenizeHost(std::string userNHost)
 {
     std::string host;
@@ -176,7 +472,7 @@ std::string BeagleTermPluginAPI::tokenizeHost(std::string userNHost)
     if (index >= 0) {
         host = userNHost.substr(index + 1);
     } else {
-        fprintf(stderr, "[BeagleTermPluginAPI::tokenizeHost] Invalid value of token: %s\n", userNHost.c_str());
+        FBLOG_WARN("BeagleTermPluginAPI", "tokenizeHost: invalid value of token: " << userNHost);
     }
 
     return host;
@@ -190,7 +486,7 @@ std::string BeagleTermPluginAPI::tokenizeUser(std::string userNHost)
     if (index >= 0) {
         user = userNHost.substr(0, index);
     } else {
-        fprintf(stderr, "[BeagleTermPluginAPI::tokenizeUser] Invalid value of token: %s\n", userNHost.c_str());
+        FBLOG_WARN("BeagleTermPluginAPI", "tokenizeUser: invalid value of token: " << userNHost);
     }
 
     return user;
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
 #include <boost/weak_ptr.hpp>
 #include "JSAPIAuto.h"
 #include "BrowserHost.h"
@@ -35,11 +36,33 @@ public:
 
     void connect(const std::string& host, const std::string& port, const boost::optional<std::string> user);
     void disconnect();
+    void preconnect(const std::string& host, const std::string& port, const boost::optional<std::string> user);
     int verifyKnownHost();
     int writeKnownHost();
     int userauthPassword(const std::string& password);
     int write(int keyCode);
+    void resize(int columns, int rows);
     std::string read();
+    FB::VariantMap getStats();
+    FB::VariantMap getConnectProfile();
+    void dumpTrace();
+    int setTriggers(const std::vector<std::string>& patterns);
+    FB::VariantList getTriggerEvents();
+    bool startRecording(const std::string& name, const boost::optional<bool> input);
+    void stopRecording();
+
+    int clusterStart(const std::vector<std::string>& hosts, const std::string& password, const boost::optional<std::string> command);
+    void clusterStop();
+    void clusterWrite(const std::string& keys);
+    FB::VariantList clusterRead();
+    FB::VariantList clusterStatus();
+    FB::VariantList clusterResults();
+    void setKeepalive(long intervalMs, int maxMisses);
+    std::string setResumable(long graceMs);
+    bool resume(const std::string& token);
+    int forwardLocal(int bindPort, const std::string& host, int port);
+    int forwardDynamic(int bindPort);
+    bool cancelForward(int bindPort);
 
 private:
     std::string tokenizeHost(std::string userNHost);
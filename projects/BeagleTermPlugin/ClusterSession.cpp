@@ -0,0 +1,351 @@
+#include "ClusterSession.h"
+#include "SSHReactor.h"
+
+#include <map>
+#include <string.h>
+#include <boost/bind.hpp>
+#include "logging.h"
+
+// Seconds a host has to answer each step of the connection
+#define CONNECT_TIMEOUT 10
+// Output kept per host for results(); what comes after is cut off
+#define HOST_OUTPUT_BYTES (1024 * 1024)
+// Output waiting for takeOutput(); the oldest chunks are dropped beyond it
+#define CHUNK_BYTES (4 * 1024 * 1024)
+
+namespace {
+
+// FNV-1a, to find hosts with the same output without comparing every pair
+boost::uint64_t hashOutput(const std::string& output)
+{
+    boost::uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < output.size(); i++) {
+        hash ^= static_cast<unsigned char>(output[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+ClusterSession::ClusterSession() : m_next(0), m_stopping(false), m_chunkBytes(0)
+{
+}
+
+ClusterSession::~ClusterSession()
+{
+    stop();
+}
+
+void ClusterSession::start(const std::vector<std::string>& hosts, const std::string& password, const std::string& command, size_t parallel)
+{
+    stop();
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_stopping = false;
+    m_next = 0;
+    m_password = password;
+    m_command = command;
+    m_chunks.clear();
+    m_chunkBytes = 0;
+
+    for (size_t i = 0; i < hosts.size(); i++) {
+        Host* host = new Host();
+        host->cluster = this;
+        host->index = i;
+        host->session = NULL;
+        host->channel = NULL;
+        host->reactor = NULL;
+        host->state = Pending;
+        host->exitStatus = -1;
+
+        // user@host[:port]
+        std::string target = hosts[i];
+        size_t at = target.find('@');
+        if (at != std::string::npos) {
+            host->user = target.substr(0, at);
+            target.erase(0, at + 1);
+        }
+        size_t colon = target.rfind(':');
+        host->port = colon != std::string::npos ? target.substr(colon + 1) : "22";
+        host->name = target.substr(0, colon);
+        m_hosts.push_back(host);
+    }
+
+    size_t workers = parallel < m_hosts.size() ? parallel : m_hosts.size();
+    for (size_t i = 0; i < workers; i++)
+        m_workers.create_thread(boost::bind(&ClusterSession::work, this));
+    FBLOG_INFO("ClusterSession", "start: " << m_hosts.size() << " host(s), " << workers << " at once");
+}
+
+void ClusterSession::stop()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workers.join_all();
+
+    std::vector<Host*> hosts;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        hosts.swap(m_hosts);
+    }
+
+    for (size_t i = 0; i < hosts.size(); i++) {
+        close(hosts[i]);
+        delete hosts[i];
+    }
+}
+
+void ClusterSession::write(const std::string& keys)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for (size_t i = 0; i < m_hosts.size(); i++) {
+        Host* host = m_hosts[i];
+        if (host->state == Running && m_command.empty())
+            host->reactor->post(boost::bind(&ClusterSession::writeHost, host, keys));
+    }
+}
+
+std::string ClusterSession::hostName(size_t index)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (index >= m_hosts.size())
+        return std::string();
+    return m_hosts[index]->user + "@" + m_hosts[index]->name;
+}
+
+void ClusterSession::takeOutput(std::vector<Chunk>& chunks)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    chunks.swap(m_chunks);
+    m_chunks.clear();
+    m_chunkBytes = 0;
+}
+
+void ClusterSession::takeStatus(std::vector<HostStatus>& status)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for (size_t i = 0; i < m_hosts.size(); i++) {
+        const Host* h = m_hosts[i];
+        HostStatus host = { h->user + "@" + h->name, h->state, h->error, h->exitStatus };
+        status.push_back(host);
+    }
+}
+
+void ClusterSession::results(std::vector<Result>& results)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+
+    // Hashed first; outputs that share a hash are compared before they are grouped
+    std::multimap<std::pair<boost::uint64_t, int>, size_t> groups;
+    for (size_t i = 0; i < m_hosts.size(); i++) {
+        const Host* host = m_hosts[i];
+        if (host->state != Done)
+            continue;
+
+        std::pair<boost::uint64_t, int> key(hashOutput(host->output), host->exitStatus);
+        std::multimap<std::pair<boost::uint64_t, int>, size_t>::iterator it = groups.lower_bound(key);
+        for (; it != groups.end() && it->first == key; ++it) {
+            if (results[it->second].output == host->output)
+                break;
+        }
+
+        if (it != groups.end() && it->first == key) {
+            results[it->second].hosts.push_back(i);
+        } else {
+            Result result;
+            result.hosts.push_back(i);
+            result.output = host->output;
+            result.exitStatus = host->exitStatus;
+            groups.insert(std::make_pair(key, results.size()));
+            results.push_back(result);
+        }
+    }
+}
+
+void ClusterSession::work()
+{
+    for (;;) {
+        Host* host;
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            if (m_stopping || m_next >= m_hosts.size())
+                return;
+            host = m_hosts[m_next++];
+            host->state = Connecting;
+        }
+
+        if (!open(host))
+            close(host);
+    }
+}
+
+// Runs on a worker; the host is the reactor's once it is running
+bool ClusterSession::open(Host* host)
+{
+    ssh::Session* session = new ssh::Session();
+    host->session = session;
+
+    long timeout = CONNECT_TIMEOUT;
+    session->setOption(SSH_OPTIONS_HOST, host->name.c_str());
+    session->setOption(SSH_OPTIONS_PORT_STR, host->port.c_str());
+    if (!host->user.empty())
+        session->setOption(SSH_OPTIONS_USER, host->user.c_str());
+    session->setOption(SSH_OPTIONS_TIMEOUT, &timeout);
+
+    if (session->connect() != SSH_OK) {
+        fail(host, session->getError());
+        return false;
+    }
+
+    if (session->isServerKnown() != SSH_SERVER_KNOWN_OK) {
+        fail(host, "host key is not in known_hosts or does not match it");
+        return false;
+    }
+
+    session->userauthNone();
+    if (session->userauthPassword(m_password.c_str()) != SSH_AUTH_SUCCESS) {
+        fail(host, session->getError());
+        return false;
+    }
+
+    host->channel = new ssh::Channel(*session);
+    if (host->channel->openSession() != SSH_OK) {
+        fail(host, session->getError());
+        return false;
+    }
+
+    int rc;
+    if (!m_command.empty()) {
+        rc = host->channel->requestExec(m_command.c_str());
+    } else {
+        rc = host->channel->requestPty();
+        if (rc == SSH_OK)
+            rc = host->channel->requestShell();
+    }
+    if (rc != SSH_OK) {
+        fail(host, session->getError());
+        return false;
+    }
+
+    // The close and exit status are caught from here on, while the output that
+    // came with the replies is drained from the channel buffer; the data
+    // callback only sees what arrives after it
+    memset(&host->callbacks, 0, sizeof(host->callbacks));
+    host->callbacks.userdata = host;
+    host->callbacks.channel_close_function = &ClusterSession::onClosed;
+    host->callbacks.channel_exit_status_function = &ClusterSession::onExitStatus;
+    ssh_callbacks_init(&host->callbacks);
+    ssh_set_channel_callbacks(host->channel->getCChannel(), &host->callbacks);
+
+    char buffer[4096];
+    int readBytes;
+    while ((readBytes = host->channel->readNonblocking(buffer, sizeof(buffer), false)) > 0)
+        onData(session->getCSession(), host->channel->getCChannel(), buffer, readBytes, 0, host);
+    host->callbacks.channel_data_function = &ClusterSession::onData;
+
+    SSHReactor* reactor = SSHReactor::acquire();
+    if (!reactor || !reactor->attach(session->getCSession())) {
+        SSHReactor::release(reactor);
+        memset(&host->callbacks, 0, sizeof(host->callbacks));
+        fail(host, "no reactor to run the session on");
+        return false;
+    }
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    host->reactor = reactor;
+    // A command may be done already
+    if (host->state == Connecting)
+        host->state = Running;
+    return true;
+}
+
+void ClusterSession::fail(Host* host, const std::string& error)
+{
+    FBLOG_WARN("ClusterSession", host->user << "@" << host->name << ": " << error);
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    host->state = Failed;
+    host->error = error;
+}
+
+void ClusterSession::close(Host* host)
+{
+    SSHReactor* reactor;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        reactor = host->reactor;
+        host->reactor = NULL;
+    }
+
+    if (reactor) {
+        // Waits for the keys already posted
+        reactor->detach(host->session->getCSession());
+        SSHReactor::release(reactor);
+    }
+
+    if (host->channel) {
+        if (host->channel->isOpen())
+            host->channel->close();
+        delete host->channel;
+        host->channel = NULL;
+    }
+    if (host->session) {
+        if (host->session->isConnected())
+            host->session->silentDisconnect();
+        delete host->session;
+        host->session = NULL;
+    }
+}
+
+void ClusterSession::writeHost(Host* host, std::string keys)
+{
+    if (host->channel->isOpen() && !host->channel->isEof())
+        host->channel->write(keys.data(), keys.size());
+}
+
+int ClusterSession::onData(ssh_session session, ssh_channel channel, void* data, uint32_t len, int isStderr, void* userdata)
+{
+    Host* host = static_cast<Host*>(userdata);
+    ClusterSession* self = host->cluster;
+    const char* bytes = static_cast<const char*>(data);
+
+    boost::mutex::scoped_lock lock(self->m_mutex);
+    size_t room = HOST_OUTPUT_BYTES - host->output.size();
+    host->output.append(bytes, len < room ? len : room);
+
+    // Runs of output from one host make one chunk
+    if (!self->m_chunks.empty() && self->m_chunks.back().host == host->index) {
+        self->m_chunks.back().data.append(bytes, len);
+    } else {
+        Chunk chunk;
+        chunk.host = host->index;
+        chunk.data.assign(bytes, len);
+        self->m_chunks.push_back(chunk);
+    }
+    self->m_chunkBytes += len;
+
+    size_t drop = 0;
+    while (self->m_chunkBytes > CHUNK_BYTES && drop + 1 < self->m_chunks.size())
+        self->m_chunkBytes -= self->m_chunks[drop++].data.size();
+    self->m_chunks.erase(self->m_chunks.begin(), self->m_chunks.begin() + drop);
+    return len;
+}
+
+void ClusterSession::onClosed(ssh_session session, ssh_channel channel, void* userdata)
+{
+    Host* host = static_cast<Host*>(userdata);
+
+    boost::mutex::scoped_lock lock(host->cluster->m_mutex);
+    host->state = Done;
+}
+
+void ClusterSession::onExitStatus(ssh_session session, ssh_channel channel, int exitStatus, void* userdata)
+{
+    Host* host = static_cast<Host*>(userdata);
+
+    boost::mutex::scoped_lock lock(host->cluster->m_mutex);
+    host->exitStatus = exitStatus;
+}
@@ -0,0 +1,107 @@
+#ifndef CLUSTERSESSION_H_
+#define CLUSTERSESSION_H_
+
+#define SSH_NO_CPP_EXCEPTIONS
+#include "libssh/libsshpp.hpp"
+#include "libssh/callbacks.h"
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/noncopyable.hpp>
+
+class SSHReactor;
+
+// Runs one command on many hosts, or types the same keys into a shell on
+// each. A few threads connect and authenticate, one host at a time each, so a
+// host that is slow to answer holds up one of them and not the rest; hosts
+// that are up are handed to the reactors, which stream their output. Hosts
+// are checked against known_hosts and never trusted on first use.
+class ClusterSession : boost::noncopyable {
+public:
+    enum State { Pending, Connecting, Running, Done, Failed };
+
+    struct HostStatus {
+        std::string name;
+        State state;
+        std::string error;
+        int exitStatus;         // -1 until the command reports one
+    };
+
+    // Output of one host, in the order it arrived across hosts
+    struct Chunk {
+        size_t host;
+        std::string data;
+    };
+
+    // Hosts that finished with the same output and exit status
+    struct Result {
+        std::vector<size_t> hosts;
+        std::string output;
+        int exitStatus;
+    };
+
+public:
+    ClusterSession();
+    ~ClusterSession();
+
+    // Hosts are user@host or user@host:port. With a command each host runs
+    // it, otherwise each opens a shell for write().
+    void start(const std::vector<std::string>& hosts, const std::string& password, const std::string& command, size_t parallel);
+    // Waits for the connections in progress, then closes every session
+    void stop();
+
+    // Types keys into every shell that is running
+    void write(const std::string& keys);
+
+    // user@host of the host at index, as start() was given it
+    std::string hostName(size_t index);
+
+    void takeOutput(std::vector<Chunk>& chunks);
+    void takeStatus(std::vector<HostStatus>& status);
+    void results(std::vector<Result>& results);
+
+private:
+    struct Host {
+        ClusterSession* cluster;
+        size_t index;
+        std::string user;
+        std::string name;
+        std::string port;
+
+        ssh::Session* session;
+        ssh::Channel* channel;
+        struct ssh_channel_callbacks_struct callbacks;
+        SSHReactor* reactor;
+
+        State state;
+        std::string error;
+        int exitStatus;
+        std::string output;
+    };
+
+    void work();
+    bool open(Host* host);
+    void fail(Host* host, const std::string& error);
+    void close(Host* host);
+    static void writeHost(Host* host, std::string keys);
+
+    static int onData(ssh_session session, ssh_channel channel, void* data, uint32_t len, int isStderr, void* userdata);
+    static void onClosed(ssh_session session, ssh_channel channel, void* userdata);
+    static void onExitStatus(ssh_session session, ssh_channel channel, int exitStatus, void* userdata);
+
+private:
+    boost::mutex m_mutex;
+    boost::thread_group m_workers;
+    std::vector<Host*> m_hosts;
+    size_t m_next;              // the next host a worker connects to
+    bool m_stopping;
+    std::string m_password;
+    std::string m_command;
+
+    std::vector<Chunk> m_chunks;
+    size_t m_chunkBytes;
+};
+
+#endif /* CLUSTERSESSION_H_ */
@@ -40,6 +40,26 @@ public:
     {
         BeagleTermPlugin::StaticDeinitialize();
     }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// @see FB::FactoryBase::getLoggingMethods
+    ///////////////////////////////////////////////////////////////////////////////
+    void getLoggingMethods(FB::Log::LogMethodList& outMethods)
+    {
+        outMethods.push_back(std::make_pair(FB::Log::LogMethod_Console, std::string()));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// @see FB::FactoryBase::getLogLevel
+    ///////////////////////////////////////////////////////////////////////////////
+    FB::Log::LogLevel getLogLevel()
+    {
+#ifdef NDEBUG
+        return FB::Log::LogLevel_Info;
+#else
+        return FB::Log::LogLevel_Trace;
+#endif
+    }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
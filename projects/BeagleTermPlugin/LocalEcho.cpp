@@ -0,0 +1,442 @@
+#include "LocalEcho.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Predictions show once keys take this long to echo, and hide again below the lower bound
+#define SLOW_ECHO_USEC 30000
+#define FAST_ECHO_USEC 20000
+// Failed predictions in a row after which prediction waits for the next Enter
+#define MAX_FAIL_STREAK 3
+// Keys the server has not echoed yet, beyond which prediction starts over
+#define MAX_PREDICTIONS 256
+// Longest control sequence and line followed in the server output
+#define MAX_SEQUENCE 32
+#define MAX_LINE_CELLS 1024
+
+namespace {
+
+// Echoes of a backspace by common line editors, longest first
+const char* const BACKSPACE_ECHOES[] = { "\b\x1b[K", "\b \b", "\b\x1b[1P", "\b\x1b[P", "\b" };
+const char* const LEFT_ECHOES[] = { "\x1b[D", "\b" };
+
+bool startsWith(const std::string& stream, size_t pos, const char* prefix)
+{
+    return stream.compare(pos, strlen(prefix), prefix) == 0;
+}
+
+size_t matchAny(const std::string& stream, size_t pos, const char* const* echoes, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (startsWith(stream, pos, echoes[i]))
+            return strlen(echoes[i]);
+    }
+    return 0;
+}
+
+void moveCursor(int columns, std::string& out)
+{
+    char sequence[16];
+    if (columns > 0)
+        snprintf(sequence, sizeof(sequence), "\x1b[%dC", columns);
+    else if (columns < 0)
+        snprintf(sequence, sizeof(sequence), "\x1b[%dD", -columns);
+    else
+        return;
+    out += sequence;
+}
+
+} // namespace
+
+LocalEcho::LocalEcho()
+{
+    reset();
+}
+
+void LocalEcho::reset()
+{
+    m_predictions.clear();
+    m_keyState = KeyNormal;
+    m_epochConfirmed = false;
+    m_moved = false;
+    m_drawn = false;
+    m_column = m_low = m_high = 0;
+    m_outputState = OutputGround;
+    m_sequence.clear();
+    m_line.clear();
+    m_lineColumn = 0;
+    m_lineKnown = true;
+    m_alternateScreen = false;
+    m_suspended = false;
+    m_slow = false;
+    m_failStreak = 0;
+    m_srtt = 0;
+    m_confirmed = m_failed = 0;
+}
+
+void LocalEcho::keyTyped(char key, boost::int64_t nowUsec, std::string& out)
+{
+    // Cursor keys arrive one byte at a time as ESC [ C and ESC [ D
+    if (m_keyState == KeyEscape) {
+        m_keyState = key == '[' ? KeyCsi : KeyNormal;
+        if (m_keyState == KeyNormal)
+            newEpoch(out);
+        return;
+    }
+    if (m_keyState == KeyCsi) {
+        m_keyState = KeyNormal;
+        if (key == 'C')
+            predict(Right, key, nowUsec, out);
+        else if (key == 'D')
+            predict(Left, key, nowUsec, out);
+        else
+            newEpoch(out);
+        return;
+    }
+
+    // Editing in the middle of a line shifts its tail, which is not predicted
+    if (key >= 0x20 && key < 0x7f && !m_moved) {
+        predict(Char, key, nowUsec, out);
+    } else if ((key == 0x7f || key == '\b') && !m_moved) {
+        predict(Backspace, key, nowUsec, out);
+    } else if (key == '\x1b') {
+        m_keyState = KeyEscape;
+    } else {
+        newEpoch(out);
+        if (key == '\r' || key == '\n')
+            m_suspended = false;
+    }
+}
+
+void LocalEcho::serverOutput(std::string& stream, size_t start, boost::int64_t nowUsec)
+{
+    bool shown = m_drawn;
+    if (m_drawn) {
+        std::string undo;
+        undraw(undo);
+        stream.insert(start, undo);
+        start += undo.size();
+    }
+
+    // A sequence cut off by the end of the last output is finished before any echo
+    size_t pos = start;
+    while (pos < stream.size() && m_outputState != OutputGround)
+        parseOutput(stream[pos++]);
+    size_t echoed = pos;
+
+    while (!m_predictions.empty() && pos < stream.size()) {
+        const Prediction& prediction = m_predictions.front();
+        size_t length = matchEcho(prediction, stream, pos);
+        if (!length)
+            break;
+
+        long sample = static_cast<long>(nowUsec - prediction.sentUsec);
+        m_srtt = m_srtt ? m_srtt + (sample - m_srtt) / 8 : sample;
+        m_confirmed++;
+        m_failStreak = 0;
+        m_epochConfirmed = true;
+        m_predictions.pop_front();
+        pos += length;
+    }
+
+    for (size_t i = echoed; i < stream.size(); i++)
+        parseOutput(stream[i]);
+
+    // The server did something else with the keys
+    if (pos < stream.size() && !m_predictions.empty()) {
+        if (shown) {
+            m_failed++;
+            if (++m_failStreak >= MAX_FAIL_STREAK)
+                m_suspended = true;
+        }
+        m_predictions.clear();
+        m_epochConfirmed = false;
+    } else if (!active()) {
+        m_predictions.clear();
+        m_epochConfirmed = false;
+    }
+
+    if (m_srtt > SLOW_ECHO_USEC)
+        m_slow = true;
+    else if (m_srtt < FAST_ECHO_USEC)
+        m_slow = false;
+
+    if (visible()) {
+        for (size_t i = 0; i < m_predictions.size(); i++)
+            draw(m_predictions[i], stream);
+    }
+}
+
+void LocalEcho::predict(Kind kind, char ch, boost::int64_t nowUsec, std::string& out)
+{
+    if (!active())
+        return;
+
+    if (m_predictions.size() >= MAX_PREDICTIONS) {
+        newEpoch(out);
+        return;
+    }
+
+    Prediction prediction = { kind, ch, nowUsec };
+    m_predictions.push_back(prediction);
+    if (kind == Left || kind == Right)
+        m_moved = true;
+
+    if (visible())
+        draw(prediction, out);
+}
+
+void LocalEcho::newEpoch(std::string& out)
+{
+    undraw(out);
+    m_predictions.clear();
+    m_epochConfirmed = false;
+    m_moved = false;
+}
+
+bool LocalEcho::visible() const
+{
+    // Drawing inside an escape sequence would break it up, and cells that are not known cannot be
+    // put back
+    return m_epochConfirmed && m_slow && active() && m_outputState == OutputGround && m_lineKnown;
+}
+
+void LocalEcho::draw(const Prediction& prediction, std::string& out)
+{
+    m_drawn = true;
+    switch (prediction.kind) {
+    case Char:
+        out += "\x1b[4m";
+        out += prediction.ch;
+        out += "\x1b[24m";
+        m_column++;
+        if (m_high < m_column)
+            m_high = m_column;
+        break;
+    case Backspace:
+        // The terminal does not move left of the first column
+        if (m_lineColumn + m_column <= 0)
+            break;
+        out += "\b \b";
+        m_column--;
+        if (m_low > m_column)
+            m_low = m_column;
+        break;
+    case Left:
+        if (m_lineColumn + m_column <= 0)
+            break;
+        out += "\b";
+        m_column--;
+        break;
+    case Right:
+        out += "\x1b[C";
+        m_column++;
+        break;
+    }
+}
+
+void LocalEcho::undraw(std::string& out)
+{
+    if (!m_drawn)
+        return;
+
+    // Put back every cell a prediction wrote, then return to where the server left the cursor
+    moveCursor(m_low - m_column, out);
+    for (int column = m_lineColumn + m_low; column < m_lineColumn + m_high; column++)
+        out += column < static_cast<int>(m_line.size()) ? m_line[column] : " ";
+    moveCursor(-m_high, out);
+
+    m_drawn = false;
+    m_column = m_low = m_high = 0;
+}
+
+size_t LocalEcho::matchEcho(const Prediction& prediction, const std::string& stream, size_t pos) const
+{
+    switch (prediction.kind) {
+    case Char:
+        return stream[pos] == prediction.ch ? 1 : 0;
+    case Backspace:
+        return matchAny(stream, pos, BACKSPACE_ECHOES, sizeof(BACKSPACE_ECHOES) / sizeof(BACKSPACE_ECHOES[0]));
+    case Left:
+        return matchAny(stream, pos, LEFT_ECHOES, sizeof(LEFT_ECHOES) / sizeof(LEFT_ECHOES[0]));
+    case Right:
+        // Line editors move right by printing the character under the cursor again
+        if (startsWith(stream, pos, "\x1b[C"))
+            return 3;
+        return stream[pos] >= 0x20 && stream[pos] < 0x7f ? 1 : 0;
+    }
+    return 0;
+}
+
+void LocalEcho::parseOutput(char c)
+{
+    unsigned char b = c;
+    switch (m_outputState) {
+    case OutputGround:
+        if (b == 0x1b) {
+            m_sequence.clear();
+            m_outputState = OutputEscape;
+        } else {
+            printed(c);
+        }
+        break;
+    case OutputEscape:
+        if (b == '[') {
+            m_sequence.clear();
+            m_outputState = OutputCsi;
+        } else if (b == ']' || b == 'P' || b == 'X' || b == '^' || b == '_') {
+            m_outputState = OutputString;
+        } else if (b >= 0x20 && b < 0x30) {
+            // Intermediate bytes, as in the charset designation ESC ( B
+            if (m_sequence.size() < MAX_SEQUENCE)
+                m_sequence += c;
+        } else if (b == 0x18 || b == 0x1a) {
+            m_outputState = OutputGround;
+        } else if (b == 0x1b) {
+            m_sequence.clear();
+        } else if (b < 0x20) {
+            printed(c);
+        } else {
+            // ESC = and ESC > switch the keypad; ESC 7, ESC 8, ESC M and the like move the cursor
+            if (m_sequence.empty() && b != '=' && b != '>')
+                m_lineKnown = false;
+            m_outputState = OutputGround;
+        }
+        break;
+    case OutputCsi:
+        if (b >= 0x40 && b < 0x7f) {
+            controlSequence(c);
+            m_outputState = OutputGround;
+        } else if (b >= 0x20) {
+            if (m_sequence.size() < MAX_SEQUENCE)
+                m_sequence += c;
+        } else if (b == 0x18 || b == 0x1a) {
+            m_outputState = OutputGround;
+        } else if (b == 0x1b) {
+            m_sequence.clear();
+            m_outputState = OutputEscape;
+        } else {
+            // Control characters take effect in the middle of a sequence
+            printed(c);
+        }
+        break;
+    case OutputString:
+        // OSC, DCS and the like end with BEL or ESC backslash
+        if (b == 0x07 || b == 0x18 || b == 0x1a)
+            m_outputState = OutputGround;
+        else if (b == 0x1b)
+            m_outputState = OutputStringEscape;
+        break;
+    case OutputStringEscape:
+        m_sequence.clear();
+        m_outputState = OutputEscape;
+        if (b == '\\')
+            m_outputState = OutputGround;
+        else
+            parseOutput(c);
+        break;
+    }
+}
+
+void LocalEcho::printed(char c)
+{
+    unsigned char b = c;
+    if (b == '\r') {
+        m_lineColumn = 0;
+    } else if (b == '\n' || b == '\v' || b == '\f') {
+        // Taken to be a fresh line, as at the bottom of the screen where a shell prompts
+        m_line.clear();
+        m_lineKnown = true;
+    } else if (b == '\b') {
+        if (m_lineColumn > 0)
+            m_lineColumn--;
+    } else if (b == '\t') {
+        m_lineKnown = false;
+    } else if (b < 0x20 || b == 0x7f) {
+        // BEL and the like draw nothing
+    } else if (b >= 0x80 && b < 0xc0) {
+        if (m_lineColumn > 0 && m_lineColumn <= static_cast<int>(m_line.size()))
+            m_line[m_lineColumn - 1] += c;
+    } else {
+        // Characters from U+0800 on may take two columns, which is not followed
+        if (b >= 0xe0)
+            m_lineKnown = false;
+        setCell(m_lineColumn++, std::string(1, c));
+    }
+}
+
+void LocalEcho::controlSequence(char final)
+{
+    // Private modes: ESC [ ? 47 h, 1047 h and 1049 h switch to the alternate screen, l back, as
+    // any parameter of the list
+    if (!m_sequence.empty() && m_sequence[0] >= '<' && m_sequence[0] <= '?') {
+        if (m_sequence[0] != '?' || (final != 'h' && final != 'l'))
+            return;
+
+        for (size_t pos = 1; pos <= m_sequence.size(); ) {
+            size_t end = m_sequence.find(';', pos);
+            if (end == std::string::npos)
+                end = m_sequence.size();
+            std::string mode = m_sequence.substr(pos, end - pos);
+            if (mode == "47" || mode == "1047" || mode == "1049")
+                m_alternateScreen = final == 'h';
+            pos = end + 1;
+        }
+        return;
+    }
+
+    int n = atoi(m_sequence.c_str());
+    int count = n > 0 ? (n < MAX_LINE_CELLS ? n : MAX_LINE_CELLS) : 1;
+    int size = static_cast<int>(m_line.size());
+    switch (final) {
+    case 'm': case 'h': case 'l': case 'n': case 'c': case 'q': case 't':
+        // Attributes, modes and reports
+        break;
+    case 'C':
+        m_lineColumn += count;
+        break;
+    case 'D':
+        m_lineColumn = m_lineColumn > count ? m_lineColumn - count : 0;
+        break;
+    case 'G':
+        m_lineColumn = count - 1;
+        break;
+    case 'K':
+        if (n == 0 && m_lineColumn < size)
+            m_line.resize(m_lineColumn);
+        else if (n == 1)
+            for (int i = 0; i <= m_lineColumn && i < size; i++)
+                m_line[i] = " ";
+        else if (n == 2)
+            m_line.clear();
+        break;
+    case 'P':
+        if (m_lineColumn < size)
+            m_line.erase(m_line.begin() + m_lineColumn, m_line.begin() + (count < size - m_lineColumn ? m_lineColumn + count : size));
+        break;
+    case '@':
+        if (m_lineColumn < size)
+            m_line.insert(m_line.begin() + m_lineColumn, count, " ");
+        break;
+    case 'X':
+        for (int i = m_lineColumn; i < m_lineColumn + count && i < size; i++)
+            m_line[i] = " ";
+        break;
+    default:
+        // Anything else may move the cursor to another line
+        m_lineKnown = false;
+        break;
+    }
+}
+
+void LocalEcho::setCell(int column, const std::string& cell)
+{
+    if (column >= MAX_LINE_CELLS) {
+        m_lineKnown = false;
+        return;
+    }
+    if (column >= static_cast<int>(m_line.size()))
+        m_line.resize(column + 1, " ");
+    m_line[column] = cell;
+}
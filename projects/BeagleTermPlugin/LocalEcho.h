@@ -0,0 +1,96 @@
+#ifndef LOCALECHO_H_
+#define LOCALECHO_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <boost/cstdint.hpp>
+
+// Speculative local echo, in the manner of mosh. Keys are drawn into the
+// output stream before the server echoes them: printable characters
+// underlined, cursor keys as cursor movement. Predictions are drawn from where
+// the server output left the cursor, so they are taken back in front of the
+// next server output; the keys it echoes are confirmed and the rest redrawn
+// after it. The server output is followed closely enough to draw only between
+// escape sequences and to put back the cells of the current line that
+// predictions covered.
+//
+// Nothing is shown until the server confirms the first key typed after Enter
+// or a key that cannot be predicted, so password prompts stay blank, nor
+// while keys echo faster than the eye notices. Prediction stops on the
+// alternate screen of full-screen applications and after repeated failures,
+// until the next Enter.
+class LocalEcho {
+public:
+    LocalEcho();
+
+    void reset();
+
+    // Appends to out what to draw for a key sent to the server
+    void keyTyped(char key, boost::int64_t nowUsec, std::string& out);
+    // stream[start..] is server output just appended; predictions on screen
+    // are taken back in front of it and the unconfirmed ones redrawn after it
+    void serverOutput(std::string& stream, size_t start, boost::int64_t nowUsec);
+
+    bool active() const { return !m_alternateScreen && !m_suspended; }
+    size_t confirmed() const { return m_confirmed; }
+    size_t failed() const { return m_failed; }
+    // Smoothed time from a key to its echo, 0 until measured
+    long roundTrip() const { return m_srtt; }
+
+private:
+    enum Kind { Char, Backspace, Left, Right };
+    enum KeyState { KeyNormal, KeyEscape, KeyCsi };
+    enum OutputState { OutputGround, OutputEscape, OutputCsi, OutputString, OutputStringEscape };
+
+    struct Prediction {
+        Kind kind;
+        char ch;
+        boost::int64_t sentUsec;
+    };
+
+    void predict(Kind kind, char ch, boost::int64_t nowUsec, std::string& out);
+    void newEpoch(std::string& out);
+    bool visible() const;
+
+    void draw(const Prediction& prediction, std::string& out);
+    void undraw(std::string& out);
+    size_t matchEcho(const Prediction& prediction, const std::string& stream, size_t pos) const;
+
+    void parseOutput(char c);
+    void printed(char c);
+    void controlSequence(char final);
+    void setCell(int column, const std::string& cell);
+
+private:
+    std::deque<Prediction> m_predictions;
+    KeyState m_keyState;
+    bool m_epochConfirmed;
+    bool m_moved;           // the cursor left the end of the line in this epoch
+
+    // Cursor column and the cells drawn, relative to where the server left the cursor
+    bool m_drawn;
+    int m_column;
+    int m_low;
+    int m_high;
+
+    // Where the server output stands: inside an escape sequence or not, and the
+    // current line as the server drew it, while that can be followed
+    OutputState m_outputState;
+    std::string m_sequence;
+    std::vector<std::string> m_line;
+    int m_lineColumn;
+    bool m_lineKnown;
+
+    bool m_alternateScreen;
+    bool m_suspended;
+    bool m_slow;
+    int m_failStreak;
+    long m_srtt;
+
+    size_t m_confirmed;
+    size_t m_failed;
+};
+
+#endif /* LOCALECHO_H_ */
@@ -47,6 +47,10 @@ set(FBSTRING_MIMEType "application/x-beagletermplugin")
 
 set (FB_GUI_DISABLED 1)
 
+# Log through FireBreath's asynchronous logger so that logging never blocks
+# the browser's main thread on console or file I/O
+set (FB_ASYNC_LOGGING 1)
+
 # Mac plugin settings. If your plugin does not draw, set these all to 0
 set(FBMAC_USE_QUICKDRAW 0)
 set(FBMAC_USE_CARBON 1)
@@ -0,0 +1,838 @@
+#include "PortForwarder.h"
+#include "SSHReactor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <boost/bind.hpp>
+#include "logging.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define SHUT_WR SD_SEND
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// Bytes in each pooled relay buffer, and the idle buffers kept for reuse
+#define RELAY_BUFFER_BYTES (16 * 1024)
+#define RELAY_POOL_BUFFERS 256
+// Buffers a connection moves each way per pass before the others get a turn
+#define RELAY_ROUNDS 4
+// Connections taken from a listener per pass
+#define ACCEPT_BATCH 64
+// Forwarded connections open at once; more are turned away
+#define MAX_CONNECTIONS 8192
+// Longer than any SOCKS5 greeting or request
+#define SOCKS_MAX_BYTES 600
+
+#define SOCKS_VERSION 5
+#define SOCKS_NO_AUTH 0
+#define SOCKS_NO_METHOD 0xff
+#define SOCKS_CONNECT 1
+#define SOCKS_IPV4 1
+#define SOCKS_DOMAIN 3
+#define SOCKS_IPV6 4
+#define SOCKS_SUCCEEDED 0
+#define SOCKS_FAILURE 1
+#define SOCKS_BAD_COMMAND 7
+#define SOCKS_BAD_ADDRESS 8
+
+namespace {
+
+#ifdef _WIN32
+bool wouldBlock()
+{
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+void closeSocket(socket_t fd)
+{
+    closesocket(fd);
+}
+
+void setNonblocking(socket_t fd)
+{
+    u_long nonblocking = 1;
+    ioctlsocket(fd, FIONBIO, &nonblocking);
+}
+#else
+bool wouldBlock()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+void closeSocket(socket_t fd)
+{
+    ::close(fd);
+}
+
+void setNonblocking(socket_t fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+}
+#endif
+
+// Bytes sent, 0 if the socket is full, -1 on error
+int sendSome(socket_t fd, const char* data, size_t len)
+{
+    int sent = send(fd, data, static_cast<int>(len), MSG_NOSIGNAL);
+    if (sent < 0)
+        return wouldBlock() ? 0 : -1;
+    return sent;
+}
+
+void listenFailed(const char* step, int port)
+{
+    FBLOG_WARN("PortForwarder", "listen " << port << ": " << step << " failed, " << strerror(errno));
+}
+
+void formatIPv6(const unsigned char* address, std::string& host)
+{
+    char group[8];
+    for (int i = 0; i < 16; i += 2) {
+        snprintf(group, sizeof(group), i ? ":%x" : "%x", (address[i] << 8) | address[i + 1]);
+        host += group;
+    }
+}
+
+} // namespace
+
+PortForwarder::PortForwarder() : m_session(NULL), m_reactor(NULL), m_pumpPosted(false), m_buffersInUse(0),
+    m_accepted(0), m_failed(0), m_bytesUp(0), m_bytesDown(0)
+{
+}
+
+PortForwarder::~PortForwarder()
+{
+    stop();
+    for (size_t i = 0; i < m_freeBuffers.size(); i++)
+        delete[] m_freeBuffers[i];
+}
+
+void PortForwarder::start(ssh_session session, SSHReactor* reactor)
+{
+    m_session = session;
+    m_reactor = reactor;
+}
+
+void PortForwarder::stop()
+{
+    while (!m_listeners.empty())
+        closeListener(m_listeners.begin()->second);
+
+    // The session goes away with them, so no open is waited for
+    while (!m_connections.empty()) {
+        Connection* c = *m_connections.begin();
+        c->remoteClosed = true;
+        close(c);
+    }
+
+    m_ready.clear();
+    for (size_t i = 0; i < m_dead.size(); i++)
+        delete m_dead[i];
+    m_dead.clear();
+    m_session = NULL;
+    m_reactor = NULL;
+}
+
+int PortForwarder::listenLocal(int bindPort, const std::string& host, int port)
+{
+    if (host.empty() || port <= 0 || port > 65535)
+        return -1;
+    return openListener(bindPort, false, host, port);
+}
+
+int PortForwarder::listenDynamic(int bindPort)
+{
+    return openListener(bindPort, true, std::string(), 0);
+}
+
+int PortForwarder::openListener(int bindPort, bool dynamic, const std::string& host, int port)
+{
+    if (!m_reactor || bindPort < 0 || bindPort > 65535 || m_listeners.count(bindPort))
+        return -1;
+
+    socket_t fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd == SSH_INVALID_SOCKET) {
+        listenFailed("socket", bindPort);
+        return -1;
+    }
+
+#ifndef _WIN32
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#endif
+
+    // Other users of this machine could connect to a wider address
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<unsigned short>(bindPort));
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        listenFailed("bind", bindPort);
+        closeSocket(fd);
+        return -1;
+    }
+    if (::listen(fd, SOMAXCONN) != 0 || getsockname(fd, (sockaddr*)&addr, &len) != 0) {
+        listenFailed("listen", bindPort);
+        closeSocket(fd);
+        return -1;
+    }
+    setNonblocking(fd);
+
+    Listener* listener = new Listener();
+    listener->forwarder = this;
+    listener->fd = fd;
+    listener->port = ntohs(addr.sin_port);
+    listener->dynamic = dynamic;
+    listener->host = host;
+    listener->hostPort = port;
+    listener->pending = false;
+    if (!m_reactor->watch(fd, POLLIN, &PortForwarder::onListener, listener)) {
+        closeSocket(fd);
+        delete listener;
+        return -1;
+    }
+
+    m_listeners[listener->port] = listener;
+    if (dynamic)
+        FBLOG_INFO("PortForwarder", "listen " << listener->port << ": SOCKS5");
+    else
+        FBLOG_INFO("PortForwarder", "listen " << listener->port << ": to " << host << ":" << port);
+    return listener->port;
+}
+
+bool PortForwarder::cancel(int bindPort)
+{
+    std::map<int, Listener*>::iterator it = m_listeners.find(bindPort);
+    if (it == m_listeners.end())
+        return false;
+
+    closeListener(it->second);
+    FBLOG_INFO("PortForwarder", "cancel " << bindPort);
+    return true;
+}
+
+void PortForwarder::closeListener(Listener* listener)
+{
+    m_reactor->unwatch(listener->fd);
+    closeSocket(listener->fd);
+    m_listeners.erase(listener->port);
+    delete listener;
+}
+
+void PortForwarder::accept(Listener* listener)
+{
+    listener->pending = false;
+
+    // What is left over is polled again
+    for (int i = 0; i < ACCEPT_BATCH; i++) {
+        sockaddr_in peer;
+        socklen_t len = sizeof(peer);
+        socket_t fd = ::accept(listener->fd, (sockaddr*)&peer, &len);
+        if (fd == SSH_INVALID_SOCKET) {
+            if (!wouldBlock())
+                FBLOG_WARN("PortForwarder", "accept " << listener->port << ": " << strerror(errno));
+            return;
+        }
+
+        if (m_connections.size() >= MAX_CONNECTIONS) {
+            FBLOG_WARN("PortForwarder", "accept " << listener->port << ": " << MAX_CONNECTIONS << " connections open already");
+            closeSocket(fd);
+            m_failed++;
+            continue;
+        }
+
+        setNonblocking(fd);
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+
+        Connection* c = new Connection();
+        c->forwarder = this;
+        c->fd = fd;
+        c->channel = NULL;
+        c->phase = listener->dynamic ? SocksGreeting : Opening;
+        c->dynamic = listener->dynamic;
+        c->host = listener->host;
+        c->port = listener->hostPort;
+        c->peerHost = inet_ntoa(peer.sin_addr);
+        c->peerPort = ntohs(peer.sin_port);
+        memset(&c->up, 0, sizeof(c->up));
+        memset(&c->down, 0, sizeof(c->down));
+        c->channelBuffered = 0;
+        c->events = c->phase == SocksGreeting ? POLLIN : 0;
+        c->queued = c->readable = c->writable = false;
+        c->opened = c->localEof = c->eofSent = false;
+        c->remoteEof = c->remoteClosed = c->shutdownSent = false;
+        c->failed = c->abandoned = c->hungUp = false;
+        c->watched = true;
+
+        if (!m_reactor->watch(fd, c->events, &PortForwarder::onSocket, c)) {
+            closeSocket(fd);
+            delete c;
+            m_failed++;
+            continue;
+        }
+        m_connections.insert(c);
+        m_accepted++;
+
+        if (c->phase == Opening)
+            openChannel(c);
+    }
+}
+
+void PortForwarder::openChannel(Connection* c)
+{
+    c->phase = Opening;
+    c->channel = ssh_channel_new(m_session);
+    if (!c->channel) {
+        c->failed = true;
+        markReady(c);
+        return;
+    }
+
+    // Callbacks only note what happened; pump() acts on it
+    memset(&c->callbacks, 0, sizeof(c->callbacks));
+    c->callbacks.userdata = c;
+    c->callbacks.channel_data_function = &PortForwarder::onChannelData;
+    c->callbacks.channel_eof_function = &PortForwarder::onChannelEof;
+    c->callbacks.channel_close_function = &PortForwarder::onChannelClosed;
+    c->callbacks.channel_write_wontblock_function = &PortForwarder::onChannelWritable;
+    ssh_callbacks_init(&c->callbacks);
+    ssh_set_channel_callbacks(c->channel, &c->callbacks);
+    ssh_channel_set_blocking(c->channel, 0);
+
+    if (ssh_channel_open_forward(c->channel, c->host.c_str(), c->port, c->peerHost.c_str(), c->peerPort) == SSH_ERROR) {
+        FBLOG_WARN("PortForwarder", "open " << c->host << ":" << c->port << ": " << ssh_get_error(m_session));
+        // No answer is coming to wait for
+        c->remoteClosed = true;
+        c->failed = true;
+        markReady(c);
+    }
+    // Nothing is read from the socket until the server answers
+    updateEvents(c);
+}
+
+void PortForwarder::service(Connection* c)
+{
+    if (c->abandoned) {
+        if (ssh_channel_is_open(c->channel))
+            c->opened = true;
+        if (c->opened || c->remoteClosed)
+            finish(c);
+        return;
+    }
+
+    if (c->failed) {
+        m_failed++;
+        close(c);
+        return;
+    }
+
+    switch (c->phase) {
+    case SocksGreeting:
+    case SocksRequest:
+        c->readable = false;
+        if (!readSocks(c)
+            || (c->phase == SocksGreeting && !socksGreeting(c))
+            || (c->phase == SocksRequest && !socksRequest(c))) {
+            m_failed++;
+            close(c);
+            return;
+        }
+        if (c->phase == Opening)
+            openChannel(c);
+        break;
+
+    case Opening:
+        if (ssh_channel_is_open(c->channel)) {
+            c->opened = true;
+            c->phase = Relaying;
+            if (c->dynamic && !sendSocksReply(c, SOCKS_SUCCEEDED)) {
+                m_failed++;
+                close(c);
+                return;
+            }
+            relay(c);
+        } else if (c->remoteClosed) {
+            FBLOG_DEBUG("PortForwarder", "open " << c->host << ":" << c->port << " refused");
+            if (c->dynamic)
+                sendSocksReply(c, SOCKS_FAILURE);
+            m_failed++;
+            close(c);
+        } else {
+            updateEvents(c);
+        }
+        break;
+
+    case Relaying:
+        relay(c);
+        break;
+    }
+}
+
+// Appends what the socket has to the handshake, false once it is closed or too long
+bool PortForwarder::readSocks(Connection* c)
+{
+    char buffer[SOCKS_MAX_BYTES];
+    int received = recv(c->fd, buffer, sizeof(buffer), 0);
+    if (received == 0 || (received < 0 && !wouldBlock()))
+        return false;
+
+    if (received > 0)
+        c->socks.append(buffer, received);
+    return c->socks.size() <= SOCKS_MAX_BYTES;
+}
+
+// VER NMETHODS METHODS; only connections without authentication are taken
+bool PortForwarder::socksGreeting(Connection* c)
+{
+    const std::string& s = c->socks;
+    if (s.size() < 2)
+        return true;
+    if (static_cast<unsigned char>(s[0]) != SOCKS_VERSION)
+        return false;
+
+    size_t length = 2 + static_cast<unsigned char>(s[1]);
+    if (s.size() < length)
+        return true;
+
+    bool noAuth = s.find(static_cast<char>(SOCKS_NO_AUTH), 2) < length;
+    char reply[2] = { SOCKS_VERSION, static_cast<char>(noAuth ? SOCKS_NO_AUTH : SOCKS_NO_METHOD) };
+    if (sendSome(c->fd, reply, sizeof(reply)) != sizeof(reply) || !noAuth)
+        return false;
+
+    c->socks.erase(0, length);
+    c->phase = SocksRequest;
+    return socksRequest(c);
+}
+
+// VER CMD RSV ATYP DST.ADDR DST.PORT; only CONNECT is supported
+bool PortForwarder::socksRequest(Connection* c)
+{
+    const std::string& s = c->socks;
+    if (s.size() < 5)
+        return true;
+    if (static_cast<unsigned char>(s[0]) != SOCKS_VERSION)
+        return false;
+    if (static_cast<unsigned char>(s[1]) != SOCKS_CONNECT) {
+        sendSocksReply(c, SOCKS_BAD_COMMAND);
+        return false;
+    }
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+    size_t address = 4;
+    size_t length;
+    switch (p[3]) {
+    case SOCKS_IPV4:
+        length = 4;
+        break;
+    case SOCKS_DOMAIN:
+        address = 5;
+        length = p[4];
+        break;
+    case SOCKS_IPV6:
+        length = 16;
+        break;
+    default:
+        sendSocksReply(c, SOCKS_BAD_ADDRESS);
+        return false;
+    }
+    if (s.size() < address + length + 2)
+        return true;
+
+    std::string host;
+    if (p[3] == SOCKS_IPV4) {
+        char ip[16];
+        snprintf(ip, sizeof(ip), "%u.%u.%u.%u", p[4], p[5], p[6], p[7]);
+        host = ip;
+    } else if (p[3] == SOCKS_IPV6) {
+        formatIPv6(p + 4, host);
+    } else {
+        host = s.substr(address, length);
+    }
+    if (host.empty() || host.find('\0') != std::string::npos) {
+        sendSocksReply(c, SOCKS_BAD_ADDRESS);
+        return false;
+    }
+
+    c->host = host;
+    c->port = (p[address + length] << 8) | p[address + length + 1];
+
+    // Data the client sent on without waiting for the reply
+    size_t used = address + length + 2;
+    if (s.size() > used) {
+        c->up.data = acquireBuffer();
+        c->up.begin = 0;
+        c->up.end = s.size() - used;
+        memcpy(c->up.data, s.data() + used, c->up.end);
+    }
+    c->socks.clear();
+    c->phase = Opening;
+    return true;
+}
+
+bool PortForwarder::sendSocksReply(Connection* c, unsigned char status)
+{
+    // Bound to 0.0.0.0:0, which clients do not use
+    char reply[10] = { SOCKS_VERSION, static_cast<char>(status), 0, SOCKS_IPV4, 0, 0, 0, 0, 0, 0 };
+    return sendSome(c->fd, reply, sizeof(reply)) == sizeof(reply);
+}
+
+void PortForwarder::relay(Connection* c)
+{
+    if ((c->writable || !c->down.data) && !flushDown(c)) {
+        m_failed++;
+        close(c);
+        return;
+    }
+    c->writable = false;
+
+    if (!c->remoteClosed && !pumpUp(c)) {
+        m_failed++;
+        close(c);
+        return;
+    }
+    c->readable = false;
+
+    bool drained = !c->down.data && c->channelBuffered == 0;
+    if (c->remoteEof && drained && !c->shutdownSent) {
+        shutdown(c->fd, SHUT_WR);
+        c->shutdownSent = true;
+    }
+
+    // Done once both sides have said all they had, or the server gave up
+    if (drained && (c->remoteClosed || (c->remoteEof && c->eofSent))) {
+        close(c);
+        return;
+    }
+    updateEvents(c);
+}
+
+// Moves data from the channel to the socket, false on a socket error
+bool PortForwarder::flushDown(Connection* c)
+{
+    for (int round = 0; round < RELAY_ROUNDS; round++) {
+        if (!c->down.data) {
+            if (c->channelBuffered == 0)
+                break;
+
+            // Left unread by onChannelData(); reading it lets the window grow again
+            c->down.data = acquireBuffer();
+            size_t want = c->channelBuffered < RELAY_BUFFER_BYTES ? c->channelBuffered : RELAY_BUFFER_BYTES;
+            int read = ssh_channel_read_nonblocking(c->channel, c->down.data, static_cast<uint32_t>(want), 0);
+            if (read <= 0) {
+                c->channelBuffered = 0;
+                releaseBuffer(c->down);
+                break;
+            }
+            c->channelBuffered -= read;
+            c->down.begin = 0;
+            c->down.end = read;
+        }
+
+        int sent = sendSome(c->fd, c->down.data + c->down.begin, c->down.end - c->down.begin);
+        if (sent < 0)
+            return false;
+        c->down.begin += sent;
+        m_bytesDown += sent;
+        if (c->down.begin < c->down.end)
+            break;
+        releaseBuffer(c->down);
+    }
+    return true;
+}
+
+// Moves data from the socket to the channel, no more than its window takes,
+// false on an error
+bool PortForwarder::pumpUp(Connection* c)
+{
+    for (int round = 0; round < RELAY_ROUNDS; round++) {
+        if (!c->up.data) {
+            uint32_t window = ssh_channel_window_size(c->channel);
+            if (c->localEof || window == 0)
+                break;
+
+            c->up.data = acquireBuffer();
+            size_t want = window < RELAY_BUFFER_BYTES ? window : RELAY_BUFFER_BYTES;
+            int received = recv(c->fd, c->up.data, static_cast<int>(want), 0);
+            if (received <= 0) {
+                releaseBuffer(c->up);
+                if (received < 0 && wouldBlock())
+                    break;
+                if (received < 0)
+                    return false;
+                c->localEof = true;
+                break;
+            }
+            c->up.begin = 0;
+            c->up.end = received;
+        }
+
+        // A short write means the window or the send queue is full; the
+        // channel says when it takes more
+        int written = ssh_channel_write(c->channel, c->up.data + c->up.begin, static_cast<uint32_t>(c->up.end - c->up.begin));
+        if (written < 0)
+            return false;
+        c->up.begin += written;
+        m_bytesUp += written;
+        if (c->up.begin < c->up.end)
+            break;
+        releaseBuffer(c->up);
+    }
+
+    if (c->localEof && !c->up.data && !c->eofSent) {
+        ssh_channel_send_eof(c->channel);
+        c->eofSent = true;
+    }
+    return true;
+}
+
+// Polls the socket only for what the connection can act on, so a stalled
+// side does not wake the reactor over and over
+void PortForwarder::updateEvents(Connection* c)
+{
+    short events = 0;
+    if (c->phase == SocksGreeting || c->phase == SocksRequest) {
+        events = POLLIN;
+    } else if (c->phase == Relaying) {
+        if (!c->localEof && !c->remoteClosed && !c->up.data && ssh_channel_window_size(c->channel) > 0)
+            events |= POLLIN;
+        // Data left in the channel once the rounds ran out goes out as the socket takes it
+        if (c->down.data || c->channelBuffered > 0)
+            events |= POLLOUT;
+    }
+
+    // A socket that hung up reports it whatever is polled for, so with nothing to poll for it
+    // leaves the reactor; the channel callbacks drive what is left, and its errors end it
+    if (c->hungUp && events == 0) {
+        if (c->watched) {
+            m_reactor->unwatch(c->fd);
+            c->watched = false;
+        }
+        return;
+    }
+
+    if (events != c->events) {
+        m_reactor->setEvents(c->fd, events);
+        c->events = events;
+    }
+}
+
+void PortForwarder::close(Connection* c)
+{
+    if (c->fd != SSH_INVALID_SOCKET) {
+        if (c->watched)
+            m_reactor->unwatch(c->fd);
+        closeSocket(c->fd);
+        c->fd = SSH_INVALID_SOCKET;
+    }
+    releaseBuffer(c->up);
+    releaseBuffer(c->down);
+
+    // Freed before the server answers, its channel would stay open there
+    if (c->channel && c->phase == Opening && !ssh_channel_is_open(c->channel) && !c->remoteClosed) {
+        c->abandoned = true;
+        return;
+    }
+    if (c->channel && ssh_channel_is_open(c->channel))
+        c->opened = true;
+    finish(c);
+}
+
+void PortForwarder::finish(Connection* c)
+{
+    if (c->channel) {
+        // Also answers a close from the server, which libssh does not
+        if (c->opened)
+            ssh_channel_close(c->channel);
+        ssh_channel_free(c->channel);
+        c->channel = NULL;
+    }
+
+    m_connections.erase(c);
+    m_dead.push_back(c);
+}
+
+char* PortForwarder::acquireBuffer()
+{
+    m_buffersInUse++;
+    if (m_freeBuffers.empty())
+        return new char[RELAY_BUFFER_BYTES];
+
+    char* buffer = m_freeBuffers.back();
+    m_freeBuffers.pop_back();
+    return buffer;
+}
+
+void PortForwarder::releaseBuffer(Pending& pending)
+{
+    if (!pending.data)
+        return;
+
+    m_buffersInUse--;
+    if (m_freeBuffers.size() < RELAY_POOL_BUFFERS)
+        m_freeBuffers.push_back(pending.data);
+    else
+        delete[] pending.data;
+    pending.data = NULL;
+    pending.begin = pending.end = 0;
+}
+
+void PortForwarder::markReady(Connection* c)
+{
+    if (!c->queued) {
+        c->queued = true;
+        m_ready.push_back(c);
+    }
+    schedulePump();
+}
+
+void PortForwarder::schedulePump()
+{
+    if (!m_pumpPosted && m_reactor) {
+        m_pumpPosted = true;
+        m_reactor->post(boost::bind(&PortForwarder::pump, this));
+    }
+}
+
+void PortForwarder::pump()
+{
+    m_pumpPosted = false;
+
+    // Accepting may close listeners; the map is walked from a copy
+    std::vector<Listener*> listeners;
+    for (std::map<int, Listener*>::iterator it = m_listeners.begin(); it != m_listeners.end(); ++it) {
+        if (it->second->pending)
+            listeners.push_back(it->second);
+    }
+    for (size_t i = 0; i < listeners.size(); i++)
+        accept(listeners[i]);
+
+    // Connections are marked again while they are served, by what they write
+    // and read; those go in the next round
+    while (!m_ready.empty()) {
+        std::vector<Connection*> ready;
+        ready.swap(m_ready);
+        for (size_t i = 0; i < ready.size(); i++) {
+            Connection* c = ready[i];
+            c->queued = false;
+            if (m_connections.count(c))
+                service(c);
+        }
+    }
+
+    for (size_t i = 0; i < m_dead.size(); i++)
+        delete m_dead[i];
+    m_dead.clear();
+}
+
+void PortForwarder::getStats(Stats& stats)
+{
+    stats.listeners = m_listeners.size();
+    stats.connections = m_connections.size();
+    stats.accepted = m_accepted;
+    stats.failed = m_failed;
+    stats.bytesUp = m_bytesUp;
+    stats.bytesDown = m_bytesDown;
+    stats.buffersInUse = m_buffersInUse;
+    stats.buffersFree = m_freeBuffers.size();
+}
+
+int PortForwarder::onListener(socket_t fd, int revents, void* userdata)
+{
+    Listener* listener = static_cast<Listener*>(userdata);
+    listener->pending = true;
+    listener->forwarder->schedulePump();
+    return 0;
+}
+
+int PortForwarder::onSocket(socket_t fd, int revents, void* userdata)
+{
+    Connection* c = static_cast<Connection*>(userdata);
+    if (revents & (POLLIN | POLLHUP | POLLERR))
+        c->readable = true;
+    if (revents & (POLLHUP | POLLERR))
+        c->hungUp = true;
+    if (revents & POLLOUT)
+        c->writable = true;
+    c->forwarder->markReady(c);
+    return 0;
+}
+
+int PortForwarder::onChannelData(ssh_session session, ssh_channel channel, void* data, uint32_t len, int isStderr, void* userdata)
+{
+    Connection* c = static_cast<Connection*>(userdata);
+    if (isStderr)
+        return len;
+
+    // Whatever is not taken stays in the channel, where it holds the window
+    // back, and is offered again with the next data
+    c->channelBuffered = len;
+    if (c->phase != Relaying || c->down.data || c->fd == SSH_INVALID_SOCKET)
+        return 0;
+
+    const char* bytes = static_cast<const char*>(data);
+    int sent = sendSome(c->fd, bytes, len);
+    if (sent < 0) {
+        c->failed = true;
+        c->channelBuffered = 0;
+        c->forwarder->markReady(c);
+        return len;
+    }
+    c->forwarder->m_bytesDown += sent;
+
+    // The socket is full; a buffer of it waits for POLLOUT
+    uint32_t taken = sent;
+    if (taken < len) {
+        Pending& down = c->down;
+        down.data = c->forwarder->acquireBuffer();
+        down.begin = 0;
+        down.end = len - taken < RELAY_BUFFER_BYTES ? len - taken : RELAY_BUFFER_BYTES;
+        memcpy(down.data, bytes + taken, down.end);
+        taken += down.end;
+        c->forwarder->markReady(c);
+    }
+    c->channelBuffered = len - taken;
+    return taken;
+}
+
+void PortForwarder::onChannelEof(ssh_session session, ssh_channel channel, void* userdata)
+{
+    Connection* c = static_cast<Connection*>(userdata);
+    c->remoteEof = true;
+    c->forwarder->markReady(c);
+}
+
+void PortForwarder::onChannelClosed(ssh_session session, ssh_channel channel, void* userdata)
+{
+    Connection* c = static_cast<Connection*>(userdata);
+    c->remoteEof = true;
+    c->remoteClosed = true;
+    c->forwarder->markReady(c);
+}
+
+void PortForwarder::onChannelWritable(ssh_session session, ssh_channel channel, uint32_t bytes, void* userdata)
+{
+    Connection* c = static_cast<Connection*>(userdata);
+    c->forwarder->markReady(c);
+}
@@ -0,0 +1,157 @@
+#ifndef PORTFORWARDER_H_
+#define PORTFORWARDER_H_
+
+#include "libssh/libssh.h"
+#include "libssh/callbacks.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+class SSHReactor;
+
+// Local (-L) and dynamic SOCKS5 (-D) forwarding over a session the reactor
+// owns. Listeners take connections on the loopback interface only, and each
+// connection gets a direct-tcpip channel of its own, opened without waiting
+// for the server. Sockets are nonblocking and polled by the reactor, so
+// connections cost no thread. A socket is read no faster than the channel
+// window takes its data, and while a socket cannot take more, what the
+// channel receives is left unread there and holds its window back.
+//
+// Everything but the constructor runs on the reactor thread.
+class PortForwarder : boost::noncopyable {
+public:
+    struct Stats {
+        size_t listeners;
+        size_t connections;
+        size_t accepted;
+        size_t failed;              // turned away, refused by the server or cut off
+        boost::uint64_t bytesUp;    // from the local sockets to the server
+        boost::uint64_t bytesDown;
+        size_t buffersInUse;
+        size_t buffersFree;
+    };
+
+public:
+    PortForwarder();
+    ~PortForwarder();
+
+    void start(ssh_session session, SSHReactor* reactor);
+    // Closes every listener and connection
+    void stop();
+
+    // Return the port listened on, which bindPort 0 leaves to the system, or -1
+    int listenLocal(int bindPort, const std::string& host, int port);
+    int listenDynamic(int bindPort);
+    // Stops listening; the connections already made go on
+    bool cancel(int bindPort);
+
+    void getStats(Stats& stats);
+
+private:
+    enum Phase { SocksGreeting, SocksRequest, Opening, Relaying };
+
+    // A relay buffer from the pool, with bytes [begin, end) waiting in it
+    struct Pending {
+        char* data;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Listener {
+        PortForwarder* forwarder;
+        socket_t fd;
+        int port;
+        bool dynamic;
+        std::string host;
+        int hostPort;
+        bool pending;           // has connections to accept
+    };
+
+    struct Connection {
+        PortForwarder* forwarder;
+        socket_t fd;
+        ssh_channel channel;
+        struct ssh_channel_callbacks_struct callbacks;
+        Phase phase;
+        bool dynamic;           // answers a SOCKS request before relaying
+        std::string socks;      // the handshake bytes not parsed yet
+        std::string host;
+        int port;
+        std::string peerHost;
+        int peerPort;
+
+        Pending up;             // read from the socket, for the channel
+        Pending down;           // from the channel, for the socket
+        size_t channelBuffered; // received and left unread in the channel
+        short events;
+
+        bool queued;            // waits in m_ready
+        bool readable;
+        bool writable;
+        bool opened;
+        bool localEof;
+        bool eofSent;
+        bool remoteEof;
+        bool remoteClosed;
+        bool shutdownSent;
+        bool failed;
+        bool abandoned;         // closed locally, waits for the answer to its open
+        bool hungUp;            // the socket reported POLLHUP or POLLERR
+        bool watched;           // the reactor polls the socket
+    };
+
+    int openListener(int bindPort, bool dynamic, const std::string& host, int port);
+    void closeListener(Listener* listener);
+    void accept(Listener* listener);
+
+    void openChannel(Connection* c);
+    void service(Connection* c);
+    bool socksGreeting(Connection* c);
+    bool socksRequest(Connection* c);
+    bool readSocks(Connection* c);
+    bool sendSocksReply(Connection* c, unsigned char status);
+    void relay(Connection* c);
+    bool flushDown(Connection* c);
+    bool pumpUp(Connection* c);
+    void updateEvents(Connection* c);
+    void close(Connection* c);
+    void finish(Connection* c);
+
+    char* acquireBuffer();
+    void releaseBuffer(Pending& pending);
+
+    void markReady(Connection* c);
+    void schedulePump();
+    void pump();
+
+    static int onListener(socket_t fd, int revents, void* userdata);
+    static int onSocket(socket_t fd, int revents, void* userdata);
+    static int onChannelData(ssh_session session, ssh_channel channel, void* data, uint32_t len, int isStderr, void* userdata);
+    static void onChannelEof(ssh_session session, ssh_channel channel, void* userdata);
+    static void onChannelClosed(ssh_session session, ssh_channel channel, void* userdata);
+    static void onChannelWritable(ssh_session session, ssh_channel channel, uint32_t bytes, void* userdata);
+
+private:
+    ssh_session m_session;
+    SSHReactor* m_reactor;
+
+    std::map<int, Listener*> m_listeners;
+    std::set<Connection*> m_connections;
+    std::vector<Connection*> m_ready;
+    std::vector<Connection*> m_dead;    // deleted once no pass can reach them
+    bool m_pumpPosted;
+
+    std::vector<char*> m_freeBuffers;
+    size_t m_buffersInUse;
+
+    size_t m_accepted;
+    size_t m_failed;
+    boost::uint64_t m_bytesUp;
+    boost::uint64_t m_bytesDown;
+};
+
+#endif /* PORTFORWARDER_H_ */
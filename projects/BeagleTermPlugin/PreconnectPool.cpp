@@ -0,0 +1,215 @@
+#include "PreconnectPool.h"
+#include "SSHTerminal.h"
+#include "SSHReactor.h"
+
+#include <boost/bind.hpp>
+#include "logging.h"
+
+// Sessions connecting or ready at once
+#define POOL_SIZE 4
+// A ready session is dropped before servers give up on its authentication
+#define READY_USEC 60000000
+// How long the page waits for a session still connecting before it connects on its own
+#define TAKE_WAIT_MSEC 2000
+
+std::list<PreconnectPool::Entry> PreconnectPool::s_entries;
+unsigned long PreconnectPool::s_nextId = 0;
+std::list<boost::thread*> PreconnectPool::s_threads;
+bool PreconnectPool::s_closing = false;
+boost::mutex PreconnectPool::s_mutex;
+boost::condition_variable PreconnectPool::s_changed;
+
+namespace {
+
+std::string makeKey(const std::string& host, const std::string& port, const std::string& user)
+{
+    return user + "@" + host + ":" + port;
+}
+
+void deleteAll(std::list<SSHTerminal*>& garbage)
+{
+    for (std::list<SSHTerminal*>::iterator it = garbage.begin(); it != garbage.end(); ++it)
+        delete *it;
+    garbage.clear();
+}
+
+void joinAll(std::list<boost::thread*>& threads)
+{
+    for (std::list<boost::thread*>::iterator it = threads.begin(); it != threads.end(); ++it) {
+        (*it)->join();
+        delete *it;
+    }
+    threads.clear();
+}
+
+} // namespace
+
+void PreconnectPool::start(const std::string& host, const std::string& port, const std::string& user)
+{
+    if (host.empty() || port.empty() || user.empty())
+        return;
+
+    std::string key = makeKey(host, port, user);
+    std::list<SSHTerminal*> garbage;
+    std::list<boost::thread*> finished;
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        if (s_closing)
+            return;
+
+        evict(garbage);
+        reap(finished);
+        for (std::list<Entry>::iterator it = s_entries.begin(); it != s_entries.end(); ++it) {
+            if (it->key == key) {
+                s_entries.splice(s_entries.begin(), s_entries, it);
+                lock.unlock();
+                deleteAll(garbage);
+                joinAll(finished);
+                return;
+            }
+        }
+
+        // Make room from the oldest session that is ready; those in progress are left alone
+        if (s_entries.size() >= POOL_SIZE) {
+            for (std::list<Entry>::reverse_iterator it = s_entries.rbegin(); it != s_entries.rend(); ++it) {
+                if (it->terminal) {
+                    garbage.push_back(it->terminal);
+                    s_entries.erase(--it.base());
+                    break;
+                }
+            }
+        }
+        if (s_entries.size() < POOL_SIZE) {
+            Entry entry = { ++s_nextId, key, NULL, 0 };
+            s_entries.push_front(entry);
+            s_threads.push_back(new boost::thread(&PreconnectPool::run, entry.id, host, port, user));
+            FBLOG_INFO("PreconnectPool", "start: " << key);
+        }
+    }
+
+    deleteAll(garbage);
+    joinAll(finished);
+}
+
+SSHTerminal* PreconnectPool::take(const std::string& host, const std::string& port, const std::string& user)
+{
+    std::string key = makeKey(host, port, user);
+    std::list<SSHTerminal*> garbage;
+    SSHTerminal* terminal = NULL;
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        evict(garbage);
+
+        std::list<Entry>::iterator it = s_entries.begin();
+        while (it != s_entries.end() && it->key != key)
+            ++it;
+
+        if (it != s_entries.end()) {
+            // Connecting again from the page would only start over, but the page is not kept
+            // waiting on a host that is slow to answer
+            unsigned long id = it->id;
+            boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(TAKE_WAIT_MSEC);
+            while ((it = find(id)) != s_entries.end() && !it->terminal) {
+                if (!s_changed.timed_wait(lock, deadline))
+                    break;
+            }
+
+            // run() deletes a session whose entry is gone once it is done
+            if (it != s_entries.end()) {
+                terminal = it->terminal;
+                s_entries.erase(it);
+                if (!terminal)
+                    FBLOG_INFO("PreconnectPool", "take: " << key << " is still connecting, gave up on it");
+            }
+        }
+    }
+
+    deleteAll(garbage);
+    if (terminal)
+        FBLOG_INFO("PreconnectPool", "take: " << key);
+    return terminal;
+}
+
+void PreconnectPool::clear()
+{
+    std::list<boost::thread*> threads;
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        s_closing = true;
+        threads.swap(s_threads);
+    }
+
+    // Sessions still connecting are deleted by their threads, before libssh is finalized
+    joinAll(threads);
+
+    std::list<SSHTerminal*> garbage;
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        for (std::list<Entry>::iterator it = s_entries.begin(); it != s_entries.end(); ++it)
+            garbage.push_back(it->terminal);
+        s_entries.clear();
+    }
+
+    deleteAll(garbage);
+}
+
+void PreconnectPool::run(unsigned long id, std::string host, std::string port, std::string user)
+{
+    SSHTerminal* terminal = new SSHTerminal();
+    terminal->connect(host, port, user);
+
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        std::list<Entry>::iterator it = find(id);
+        if (it != s_entries.end()) {
+            if (terminal->isConnected() && !s_closing) {
+                it->terminal = terminal;
+                it->readyUsec = SSHReactor::monotonicUsec();
+                terminal = NULL;
+            } else {
+                s_entries.erase(it);
+            }
+        }
+        s_changed.notify_all();
+    }
+
+    if (terminal) {
+        FBLOG_INFO("PreconnectPool", "run: " << user << "@" << host << ":" << port << " did not connect");
+        delete terminal;
+    }
+}
+
+std::list<PreconnectPool::Entry>::iterator PreconnectPool::find(unsigned long id)
+{
+    std::list<Entry>::iterator it = s_entries.begin();
+    while (it != s_entries.end() && it->id != id)
+        ++it;
+    return it;
+}
+
+// Takes the sessions that have waited too long out of the pool; called with s_mutex held
+void PreconnectPool::evict(std::list<SSHTerminal*>& garbage)
+{
+    boost::int64_t now = SSHReactor::monotonicUsec();
+    for (std::list<Entry>::iterator it = s_entries.begin(); it != s_entries.end();) {
+        if (it->terminal && now - it->readyUsec > READY_USEC) {
+            garbage.push_back(it->terminal);
+            it = s_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Takes the threads that are done out of the list, to be joined; called with s_mutex held
+void PreconnectPool::reap(std::list<boost::thread*>& finished)
+{
+    for (std::list<boost::thread*>::iterator it = s_threads.begin(); it != s_threads.end();) {
+        if ((*it)->timed_join(boost::posix_time::seconds(0))) {
+            finished.push_back(*it);
+            it = s_threads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef PRECONNECTPOOL_H_
+#define PRECONNECTPOOL_H_
+
+#include <list>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+
+class SSHTerminal;
+
+// Sessions connected ahead of the page that will use them, from what the user
+// types in the omnibox. The host is resolved, and TCP and the key exchange
+// done, on a thread of their own, so the page starts at authentication. The
+// pool holds a few of the latest hosts; the oldest ready one makes room.
+class PreconnectPool {
+public:
+    // Returns at once; nothing happens if the host is already in the pool
+    static void start(const std::string& host, const std::string& port, const std::string& user);
+    // Returns the session connected to the host, waiting a little if it is
+    // still in progress, or NULL. The caller owns it.
+    static SSHTerminal* take(const std::string& host, const std::string& port, const std::string& user);
+    // Joins the connecting threads and deletes the sessions in the pool
+    static void clear();
+
+private:
+    struct Entry {
+        unsigned long id;
+        std::string key;
+        SSHTerminal* terminal;  // NULL while connecting
+        boost::int64_t readyUsec;
+    };
+
+    static void run(unsigned long id, std::string host, std::string port, std::string user);
+    static std::list<Entry>::iterator find(unsigned long id);
+    static void evict(std::list<SSHTerminal*>& garbage);
+    static void reap(std::list<boost::thread*>& finished);
+
+private:
+    static std::list<Entry> s_entries;      // most recently wanted first
+    static unsigned long s_nextId;
+    static std::list<boost::thread*> s_threads;    // until joined
+    static bool s_closing;
+    static boost::mutex s_mutex;
+    static boost::condition_variable s_changed;
+};
+
+#endif /* PRECONNECTPOOL_H_ */
@@ -0,0 +1,409 @@
+#include "SSHReactor.h"
+
+#include <errno.h>
+#include <string.h>
+#include "logging.h"
+#include <boost/bind.hpp>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+std::vector<SSHReactor*> SSHReactor::s_pool;
+boost::mutex SSHReactor::s_poolMutex;
+
+namespace {
+
+#ifdef _WIN32
+// Windows can only poll sockets, so the reactor wakes itself with a datagram
+// sent to a loopback socket connected to its own address
+bool openWakeFds(socket_t fds[2])
+{
+    socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET)
+        return false;
+
+    sockaddr_in addr;
+    int len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) != 0
+        || getsockname(s, (sockaddr*)&addr, &len) != 0
+        || ::connect(s, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        closesocket(s);
+        return false;
+    }
+
+    u_long nonblocking = 1;
+    ioctlsocket(s, FIONBIO, &nonblocking);
+    fds[0] = fds[1] = s;
+    return true;
+}
+
+void closeWakeFds(socket_t fds[2])
+{
+    closesocket(fds[0]);
+}
+
+void signalWakeFd(socket_t fd)
+{
+    send(fd, "w", 1, 0);
+}
+
+void drainWakeFd(socket_t fd)
+{
+    char buffer[64];
+    while (recv(fd, buffer, sizeof(buffer), 0) > 0);
+}
+#else
+bool openWakeFds(socket_t fds[2])
+{
+    if (pipe(fds) != 0)
+        return false;
+
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    return true;
+}
+
+void closeWakeFds(socket_t fds[2])
+{
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void signalWakeFd(socket_t fd)
+{
+    while (::write(fd, "w", 1) < 0 && errno == EINTR);
+}
+
+void drainWakeFd(socket_t fd)
+{
+    char buffer[64];
+    while (::read(fd, buffer, sizeof(buffer)) > 0);
+}
+#endif
+
+// Runs a task and tells the thread waiting in SSHReactor::call() it is done
+void runAndSignal(const SSHReactor::Task& task, boost::mutex* mutex, boost::condition_variable* done, bool* finished)
+{
+    task();
+
+    boost::mutex::scoped_lock lock(*mutex);
+    *finished = true;
+    done->notify_all();
+}
+
+void attachSession(ssh_event event, ssh_session session, bool* result)
+{
+    *result = ssh_event_add_session(event, session) == SSH_OK;
+}
+
+} // namespace
+
+void SSHReactor::startPool(size_t threads)
+{
+    boost::mutex::scoped_lock lock(s_poolMutex);
+    if (!s_pool.empty())
+        return;
+
+    for (size_t i = 0; i < threads; i++) {
+        SSHReactor* reactor = new SSHReactor();
+        if (!reactor->start()) {
+            FBLOG_ERROR("SSHReactor", "could not start reactor thread");
+            delete reactor;
+            break;
+        }
+        s_pool.push_back(reactor);
+    }
+    FBLOG_INFO("SSHReactor", s_pool.size() << " reactor thread(s)");
+}
+
+void SSHReactor::stopPool()
+{
+    std::vector<SSHReactor*> pool;
+    {
+        boost::mutex::scoped_lock lock(s_poolMutex);
+        pool.swap(s_pool);
+    }
+
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i]->stop();
+        delete pool[i];
+    }
+}
+
+SSHReactor* SSHReactor::acquire()
+{
+    boost::mutex::scoped_lock lock(s_poolMutex);
+    SSHReactor* best = NULL;
+    for (size_t i = 0; i < s_pool.size(); i++) {
+        if (!best || s_pool[i]->m_sessions < best->m_sessions)
+            best = s_pool[i];
+    }
+
+    if (best)
+        best->m_sessions++;
+    return best;
+}
+
+void SSHReactor::release(SSHReactor* reactor)
+{
+    boost::mutex::scoped_lock lock(s_poolMutex);
+    if (reactor && reactor->m_sessions > 0)
+        reactor->m_sessions--;
+}
+
+boost::int64_t SSHReactor::monotonicUsec()
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    // Whole seconds and the remainder apart; counter * 1000000 overflows within days at 10 MHz
+    boost::int64_t seconds = counter.QuadPart / frequency.QuadPart;
+    boost::int64_t remainder = counter.QuadPart % frequency.QuadPart;
+    return seconds * 1000000 + remainder * 1000000 / frequency.QuadPart;
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return static_cast<boost::int64_t>(mach_absolute_time() * timebase.numer / timebase.denom / 1000);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<boost::int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+SSHReactor::SSHReactor() : m_event(NULL), m_nextTimer(0), m_wakePending(false), m_stopping(false), m_sessions(0)
+{
+    m_wakeFds[0] = m_wakeFds[1] = SSH_INVALID_SOCKET;
+}
+
+SSHReactor::~SSHReactor()
+{
+    if (m_event)
+        ssh_event_free(m_event);
+
+    if (m_wakeFds[0] != SSH_INVALID_SOCKET)
+        closeWakeFds(m_wakeFds);
+}
+
+bool SSHReactor::start()
+{
+    if (!openWakeFds(m_wakeFds)) {
+        m_wakeFds[0] = m_wakeFds[1] = SSH_INVALID_SOCKET;
+        return false;
+    }
+
+    m_event = ssh_event_new();
+    if (!m_event || ssh_event_add_fd(m_event, m_wakeFds[0], POLLIN, &SSHReactor::onWake, this) != SSH_OK)
+        return false;
+
+    m_thread = boost::thread(&SSHReactor::run, this);
+    return true;
+}
+
+void SSHReactor::stop()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stopping = true;
+    }
+    wake();
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void SSHReactor::run()
+{
+    for (;;) {
+        // Tasks run between polls, never from inside a poll callback, so they
+        // may use blocking session calls that poll this same event context
+        ssh_event_dopoll(m_event, pollTimeout());
+        runTimers();
+        runTasks();
+
+        boost::mutex::scoped_lock lock(m_mutex);
+        if (m_stopping && m_tasks.empty())
+            break;
+    }
+}
+
+void SSHReactor::runTasks()
+{
+    std::vector<Task> tasks;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        tasks.swap(m_tasks);
+    }
+
+    for (size_t i = 0; i < tasks.size(); i++)
+        tasks[i]();
+}
+
+void SSHReactor::runTimers()
+{
+    boost::int64_t now = monotonicUsec();
+    for (;;) {
+        Task task;
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            std::map<TimerId, Timer>::iterator due = m_timers.end();
+            for (std::map<TimerId, Timer>::iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
+                if (it->second.deadline <= now && (due == m_timers.end() || it->second.deadline < due->second.deadline))
+                    due = it;
+            }
+            if (due == m_timers.end())
+                break;
+
+            task = due->second.task;
+            m_timers.erase(due);
+        }
+        task();
+    }
+}
+
+// Milliseconds until the next timer is due, -1 without timers
+int SSHReactor::pollTimeout()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    // Posted by the reactor thread itself, which does not wake itself up
+    if (!m_tasks.empty())
+        return 0;
+    if (m_timers.empty())
+        return -1;
+
+    boost::int64_t next = m_timers.begin()->second.deadline;
+    for (std::map<TimerId, Timer>::const_iterator it = m_timers.begin(); it != m_timers.end(); ++it) {
+        if (it->second.deadline < next)
+            next = it->second.deadline;
+    }
+
+    boost::int64_t wait = next - monotonicUsec();
+    if (wait <= 0)
+        return 0;
+    // Rounded up, or poll() returns just before the deadline and spins
+    return static_cast<int>((wait + 999) / 1000);
+}
+
+int SSHReactor::onWake(socket_t fd, int revents, void* userdata)
+{
+    SSHReactor* self = static_cast<SSHReactor*>(userdata);
+
+    // Clear the flag first so a post() racing with the drain signals again
+    {
+        boost::mutex::scoped_lock lock(self->m_mutex);
+        self->m_wakePending = false;
+    }
+    drainWakeFd(fd);
+    return 0;
+}
+
+void SSHReactor::wake()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if (m_wakePending)
+            return;
+        m_wakePending = true;
+    }
+    signalWakeFd(m_wakeFds[1]);
+}
+
+void SSHReactor::post(const Task& task)
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_tasks.push_back(task);
+    }
+
+    if (boost::this_thread::get_id() != m_thread.get_id())
+        wake();
+}
+
+void SSHReactor::call(const Task& task)
+{
+    if (boost::this_thread::get_id() == m_thread.get_id()) {
+        task();
+        return;
+    }
+
+    bool finished = false;
+    post(boost::bind(&runAndSignal, task, &m_mutex, &m_done, &finished));
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!finished)
+        m_done.wait(lock);
+}
+
+size_t SSHReactor::pendingTasks()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_tasks.size();
+}
+
+SSHReactor::TimerId SSHReactor::schedule(const Task& task, long delayMs)
+{
+    TimerId id;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        id = ++m_nextTimer;
+        Timer& timer = m_timers[id];
+        timer.deadline = monotonicUsec() + static_cast<boost::int64_t>(delayMs) * 1000;
+        timer.task = task;
+    }
+
+    // The reactor thread works out its poll timeout again before sleeping
+    if (boost::this_thread::get_id() != m_thread.get_id())
+        wake();
+    return id;
+}
+
+void SSHReactor::cancel(TimerId id)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_timers.erase(id);
+}
+
+bool SSHReactor::attach(ssh_session session)
+{
+    bool result = false;
+    call(boost::bind(&attachSession, m_event, session, &result));
+    return result;
+}
+
+void SSHReactor::detach(ssh_session session)
+{
+    call(boost::bind(&ssh_event_remove_session, m_event, session));
+}
+
+bool SSHReactor::watch(socket_t fd, short events, ssh_event_callback callback, void* userdata)
+{
+    return ssh_event_add_fd(m_event, fd, events, callback, userdata) == SSH_OK;
+}
+
+void SSHReactor::setEvents(socket_t fd, short events)
+{
+    ssh_event_set_fd_events(m_event, fd, events);
+}
+
+void SSHReactor::unwatch(socket_t fd)
+{
+    ssh_event_remove_fd(m_event, fd);
+}
@@ -0,0 +1,91 @@
+#ifndef SSHREACTOR_H_
+#define SSHREACTOR_H_
+
+#include "libssh/libssh.h"
+
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+// Polls the sockets of many sessions from one thread. Every session attached
+// to a reactor must only be used from its thread; other threads hand work over
+// with post() or call(). The thread sleeps in poll() until the next timer is
+// due, so idle sessions cost no wakeups besides their own timers.
+class SSHReactor : boost::noncopyable {
+public:
+    typedef boost::function<void ()> Task;
+    typedef unsigned long TimerId;
+
+    static void startPool(size_t threads);
+    static void stopPool();
+
+    // Returns the reactor serving the fewest sessions, or NULL if the pool is not running
+    static SSHReactor* acquire();
+    static void release(SSHReactor* reactor);
+
+    static boost::int64_t monotonicUsec();
+
+public:
+    bool attach(ssh_session session);
+    void detach(ssh_session session);
+
+    void post(const Task& task);
+    void call(const Task& task);
+
+    // Tasks posted but not yet run
+    size_t pendingTasks();
+
+    // Runs a task on the reactor thread once delayMs have passed
+    TimerId schedule(const Task& task, long delayMs);
+    // Call from the reactor thread, where the timer cannot be running meanwhile
+    void cancel(TimerId id);
+
+    // Polls a socket of the caller's along with the sessions. Call these from
+    // the reactor thread, but not from a poll callback: those run while the
+    // sockets are walked, so they may only change what a socket is polled for
+    bool watch(socket_t fd, short events, ssh_event_callback callback, void* userdata);
+    void setEvents(socket_t fd, short events);
+    void unwatch(socket_t fd);
+
+private:
+    SSHReactor();
+    ~SSHReactor();
+
+    bool start();
+    void stop();
+    void run();
+    void wake();
+    void runTasks();
+    void runTimers();
+    int pollTimeout();
+
+    static int onWake(socket_t fd, int revents, void* userdata);
+
+private:
+    static std::vector<SSHReactor*> s_pool;
+    static boost::mutex s_poolMutex;
+
+private:
+    ssh_event m_event;
+    socket_t m_wakeFds[2];
+    boost::thread m_thread;
+
+    boost::mutex m_mutex;
+    boost::condition_variable m_done;
+    std::vector<Task> m_tasks;
+    // A reactor serves a handful of sessions, so the timers are searched rather than sorted
+    struct Timer {
+        boost::int64_t deadline;
+        Task task;
+    };
+    std::map<TimerId, Timer> m_timers;
+    TimerId m_nextTimer;
+    bool m_wakePending;
+    bool m_stopping;
+    size_t m_sessions;
+};
+
+#endif /* SSHREACTOR_H_ */
@@ -1,24 +1,96 @@
 #include "SSHTerminal.h"
+#include "SSHReactor.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
-#include <iostream>
+
+#include <boost/bind.hpp>
+#include "logging.h"
 
 //#define FILE_LOG
 #define SAFE_DELETE(x) if ((x) != NULL) { delete x; x = NULL; }
 
-SSHTerminal::SSHTerminal() : m_channel(new ssh::Channel(m_session))
+// Ephemeral key exchange keypairs kept ready for the next connections
+#define KEX_PRECOMPUTE_COUNT 4
+// Threads polling the sockets of all terminals in the process
+#define REACTOR_THREAD_COUNT 1
+// Packet level events kept per session, written to the log when a connection fails
+#define TRACE_EVENT_COUNT 1024
+// Output kept to redraw the screen and scrollback of a resumed session
+#define HISTORY_BYTES (256 * 1024)
+// Pty size until the page tells its own, 1920 x 1080
+#define DEFAULT_COLUMNS 237
+#define DEFAULT_ROWS 58
+// A window drag is sent to the server once it has rested this long
+#define RESIZE_DEBOUNCE_MS 100
+// Trigger matches kept for the page to take; older ones are dropped
+#define TRIGGER_EVENT_COUNT 4096
+// Keepalive interval, and the intervals without an answer after which the link is dead
+#define KEEPALIVE_INTERVAL_MS 15000
+#define KEEPALIVE_MAX_MISSES 3
+
+boost::thread SSHTerminal::s_precomputeThread;
+boost::mutex SSHTerminal::s_precomputeMutex;
+
+void SSHTerminal::staticInitialize()
 {
-    std::cout << "[BeagleTermPlugin::SSHTerminal]" << std::endl;
+    // The keypair pool is filled from a background thread
+    ssh_threads_set_callbacks(ssh_threads_get_pthread());
+    ssh_init();
+
+    precomputeKeys();
+    SSHReactor::startPool(REACTOR_THREAD_COUNT);
+}
+
+void SSHTerminal::staticDeinitialize()
+{
+    SSHReactor::stopPool();
+
+    {
+        boost::mutex::scoped_lock lock(s_precomputeMutex);
+        if (s_precomputeThread.joinable())
+            s_precomputeThread.join();
+    }
+
+    ssh_finalize();
+}
+
+void SSHTerminal::precomputeKeys()
+{
+    // Sessions also connect from the threads of the preconnect pool
+    boost::mutex::scoped_lock lock(s_precomputeMutex);
+
+    // Still running from a previous refill
+    if (s_precomputeThread.joinable() && !s_precomputeThread.timed_join(boost::posix_time::seconds(0)))
+        return;
+
+    s_precomputeThread = boost::thread(&ssh_kex_precompute, (const char*)NULL, KEX_PRECOMPUTE_COUNT);
+}
+
+SSHTerminal::SSHTerminal() : m_channel(new ssh::Channel(m_session)), m_reactor(NULL), m_flushPosted(false), m_closed(false),
+    m_columns(DEFAULT_COLUMNS), m_rows(DEFAULT_ROWS), m_resizeTimer(0), m_triggerMatches(0), m_triggerDropped(0),
+    m_writeCalls(0), m_readCalls(0)
+{
+    FBLOG_DEBUG("SSHTerminal", "created");
+    memset(&m_profile, 0, sizeof(m_profile));
+    memset(&m_keepalive, 0, sizeof(m_keepalive));
+    m_keepalive.intervalMs = KEEPALIVE_INTERVAL_MS;
+    m_keepalive.maxMisses = KEEPALIVE_MAX_MISSES;
+
+    memset(&m_sessionCallbacks, 0, sizeof(m_sessionCallbacks));
+    m_sessionCallbacks.userdata = this;
+    m_sessionCallbacks.log_function = &SSHTerminal::onLog;
+    ssh_callbacks_init(&m_sessionCallbacks);
+    ssh_set_callbacks(m_session.getCSession(), &m_sessionCallbacks);
     init();
 }
 
 SSHTerminal::~SSHTerminal()
 {
-    std::cout << "[BeagleTermPlugin::~SSHTerminal]" << std::endl;
+    FBLOG_DEBUG("SSHTerminal", "destroyed");
     cleanup();
 }
 
@@ -34,7 +106,7 @@ void SSHTerminal::cleanup()
 
 int SSHTerminal::connect(const std::string& host, const std::string& port, const std::string& user)
 {
-    std::cout << "[INFO] connect: " << user << "@" << host << ":" << port << std::endl;
+    FBLOG_INFO("SSHTerminal", "connect: " << user << "@" << host << ":" << port);
 
     if (m_session.isConnected())
         return -1;
@@ -42,16 +114,49 @@ int SSHTerminal::connect(const std::string& host, const std::string& port, const
     if (host.empty() || port.empty() || user.empty())
         return -1;
 
+    m_decoder.reset();
+    m_echo.reset();
+    m_triggers.reset();
+    m_triggerEvents.clear();
+    m_received.clear();
+    m_outgoing.clear();
+    m_history.clear();
+    m_closed = false;
+    m_writeCalls = m_readCalls = 0;
+    m_keepalive.misses = 0;
+    m_keepalive.rtt = m_keepalive.jitter = 0;
+    m_keepalive.dead = false;
+    memset(&m_profile, 0, sizeof(m_profile));
+
     m_session.setOption(SSH_OPTIONS_HOST, host.c_str());
     m_session.setOption(SSH_OPTIONS_PORT_STR, port.c_str());
     m_session.setOption(SSH_OPTIONS_USER, user.c_str());
 
+    int traceSize = TRACE_EVENT_COUNT;
+    m_session.setOption(SSH_OPTIONS_TRACE_SIZE, &traceSize);
+
     m_session.connect();
+
+    m_profile.attempts = m_session.getConnectTiming(&m_profile.dns, &m_profile.tcp);
+    m_session.getHandshakeTiming(&m_profile.banner, &m_profile.kex);
+    FBLOG_INFO("SSHTerminal", "connect: dns " << m_profile.dns << "us, tcp " << m_profile.tcp << "us, "
+               << m_profile.attempts << " attempt(s), banner " << m_profile.banner << "us, kex "
+               << m_profile.kex << "us");
+
+    const char* kex = NULL;
+    m_profile.kexCpu = m_session.getKexCpuTime(&kex);
+    if (kex)
+        FBLOG_INFO("SSHTerminal", "connect: kex " << kex << " " << m_profile.kexCpu << "us cpu");
+
+    // Replace the keypair this connection used
+    precomputeKeys();
     return 0;
 }
 
 void SSHTerminal::disconnect()
 {
+    detachReactor();
+
     if (m_channel && m_channel->isOpen()) {
         m_channel->sendEof();
         m_channel->close();
@@ -73,17 +178,15 @@ int SSHTerminal::verifyKnownHost(std::string& error)
     if (hash && length > 0)
         hexa = ssh_get_hexa(hash, length);
 
+    boost::int64_t start = SSHReactor::monotonicUsec();
     int state = m_session.isServerKnown();
+    m_profile.hostKey = static_cast<long>(SSHReactor::monotonicUsec() - start);
     switch (state) {
     case SSH_SERVER_KNOWN_OK:
         break;
     case SSH_SERVER_KNOWN_CHANGED:
         retCode = -1;
 
-        fprintf(stderr, "Host key for server changed : server's one is now :\n");
-        fprintf(stderr, "Public key hash is %s\n", hexa);
-        fprintf(stderr, "For security reason, connection will be stopped\n");
-
         error = "Host key for server changed : server's one is now :\n";
         error += "Public key hash: ";
         error += std::string(hexa, strlen(hexa)) + "\n";
@@ -92,29 +195,17 @@ int SSHTerminal::verifyKnownHost(std::string& error)
     case SSH_SERVER_FOUND_OTHER:
         retCode = -1;
 
-        fprintf(stderr, "The host key for this server was not found but an other type of key exists.\n");
-        fprintf(stderr, "An attacker might change the default server key to confuse your client"
-                        "into thinking the key does not exist\n"
-                        "We advise you to rerun the client with -d or -r for more safety.\n");
-
         error = "The host key for this server was not found but an other type of key exists.\n";
         error += "An attacker might change the default server key to confuse your client";
         error += "into thinking the key does not exist\n";
         error += "We advise you to rerun the client with -d or -r for more safety.\n";
         break;
     case SSH_SERVER_FILE_NOT_FOUND:
-        fprintf(stderr, "Could not find known host file. If you accept the host key here,\n");
-        fprintf(stderr, "the file will be automatically created.\n");
-
         error = "Could not find known host file. If you accept the host key here,\n";
         error += "the file will be automatically created.\n";
     case SSH_SERVER_NOT_KNOWN:
         retCode = 1;
 
-        fprintf(stderr, "The server is unknown.\n");
-        fprintf(stderr, "Public key hash is %s\n", hexa);
-        fprintf(stderr, "Do you trust the host key (yes/no)? ");
-
         error = "The server is unknown.\n";
         error += "Public key hash is ";
         error += std::string(hexa, strlen(hexa)) + "\n";
@@ -124,10 +215,12 @@ int SSHTerminal::verifyKnownHost(std::string& error)
         retCode = -1;
 
         error = m_session.getError();
-        fprintf(stderr, "%s", error.c_str());
         break;
     } // switch
 
+    if (retCode != 0)
+        FBLOG_WARN("SSHTerminal", "verifyKnownHost: " << error);
+
     if (hexa)
         ssh_string_free_char(hexa);
     ssh_clean_pubkey_hash(&hash);
@@ -138,7 +231,7 @@ int SSHTerminal::verifyKnownHost(std::string& error)
 int SSHTerminal::writeKnownHost()
 {
     if (m_session.writeKnownhost() < 0) {
-        fprintf(stderr, "[SSHTerminal::writeKnownHost] error %s\n", strerror(errno));
+        FBLOG_ERROR("SSHTerminal", "writeKnownHost: " << strerror(errno));
         return -1;
     }
 
@@ -150,31 +243,327 @@ int SSHTerminal::userauthPassword(const std::string& password)
     if (m_channel && m_channel->isOpen())
         return -1;
 
+    boost::int64_t start = SSHReactor::monotonicUsec();
     m_session.userauthNone();
+    int auth = m_session.userauthPassword(password.c_str());
+    m_profile.auth = static_cast<long>(SSHReactor::monotonicUsec() - start);
 
-    switch (m_session.userauthPassword(password.c_str())) {
+    switch (auth) {
     case SSH_AUTH_SUCCESS:
+        start = SSHReactor::monotonicUsec();
         m_channel->openSession();
-        m_channel->requestPty();
-        m_channel->changePtySize(237, 58); // 1920 x 1080
+        m_profile.channel = static_cast<long>(SSHReactor::monotonicUsec() - start);
+
+        start = SSHReactor::monotonicUsec();
+        m_channel->requestPty("xterm", m_columns, m_rows);
+        m_profile.pty = static_cast<long>(SSHReactor::monotonicUsec() - start);
+
+        start = SSHReactor::monotonicUsec();
         m_channel->requestShell();
+        m_profile.shell = static_cast<long>(SSHReactor::monotonicUsec() - start);
+
+        FBLOG_INFO("SSHTerminal", "userauthPassword: hostkey " << m_profile.hostKey << "us, auth "
+                   << m_profile.auth << "us, channel " << m_profile.channel << "us, pty "
+                   << m_profile.pty << "us, shell " << m_profile.shell << "us");
+
+        if (!attachReactor())
+            FBLOG_INFO("SSHTerminal", "userauthPassword: no reactor, reading from read()");
         break;
 
     case SSH_AUTH_DENIED:
     case SSH_AUTH_PARTIAL:
     default:
-        fprintf(stderr, "[SSHTerminal::userauthPassword] %s", m_session.getError());
+        FBLOG_WARN("SSHTerminal", "userauthPassword: " << m_session.getError());
         return -1;
     }
 
     return 0;
 }
 
+bool SSHTerminal::attachReactor()
+{
+    SSHReactor* reactor = SSHReactor::acquire();
+    if (!reactor)
+        return false;
+
+    // Output that arrived with the shell replies is already buffered; the data
+    // callback only sees what comes after it
+    char buffer[4096];
+    int readBytes;
+    size_t start = m_received.size();
+    while ((readBytes = m_channel->readNonblocking(buffer, sizeof(buffer), false)) > 0)
+        m_decoder.decode(buffer, readBytes, m_received);
+    outputArrived(start);
+
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+    m_callbacks.userdata = this;
+    m_callbacks.channel_data_function = &SSHTerminal::onChannelData;
+    m_callbacks.channel_eof_function = &SSHTerminal::onChannelClosed;
+    m_callbacks.channel_close_function = &SSHTerminal::onChannelClosed;
+    ssh_callbacks_init(&m_callbacks);
+    ssh_set_channel_callbacks(m_channel->getCChannel(), &m_callbacks);
+
+    if (!reactor->attach(m_session.getCSession())) {
+        memset(&m_callbacks, 0, sizeof(m_callbacks));
+        SSHReactor::release(reactor);
+        return false;
+    }
+
+    m_forwarder.start(m_session.getCSession(), reactor);
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_reactor = reactor;
+    }
+
+    reactor->call(boost::bind(&SSHTerminal::startKeepalive, this, reactor));
+    return true;
+}
+
+void SSHTerminal::detachReactor()
+{
+    SSHReactor* reactor;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        reactor = m_reactor;
+        m_reactor = NULL;
+    }
+
+    if (!reactor)
+        return;
+
+    reactor->call(boost::bind(&SSHTerminal::stopTimers, this, reactor));
+    reactor->call(boost::bind(&PortForwarder::stop, &m_forwarder));
+
+    // Waits for the writes already posted; the session is ours again afterwards
+    reactor->detach(m_session.getCSession());
+    SSHReactor::release(reactor);
+    memset(&m_callbacks, 0, sizeof(m_callbacks));
+}
+
+void SSHTerminal::setKeepalive(long intervalMs, int maxMisses)
+{
+    SSHReactor* reactor;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        reactor = m_reactor;
+    }
+
+    if (reactor)
+        reactor->call(boost::bind(&SSHTerminal::configureKeepalive, this, intervalMs, maxMisses));
+    else
+        configureKeepalive(intervalMs, maxMisses);
+}
+
+void SSHTerminal::configureKeepalive(long intervalMs, int maxMisses)
+{
+    m_keepalive.intervalMs = intervalMs > 0 ? intervalMs : 0;
+    m_keepalive.maxMisses = maxMisses > 0 ? maxMisses : 1;
+
+    // Restarted so a shorter interval takes effect now
+    SSHReactor* reactor = m_keepalive.reactor;
+    if (reactor) {
+        stopKeepalive();
+        startKeepalive(reactor);
+    }
+}
+
+void SSHTerminal::startKeepalive(SSHReactor* reactor)
+{
+    struct ssh_session_stats stats;
+    ssh_get_session_stats(m_session.getCSession(), &stats);
+
+    m_keepalive.reactor = reactor;
+    m_keepalive.answered = stats.keepalives_answered;
+    m_keepalive.misses = 0;
+    if (m_keepalive.intervalMs > 0 && !m_keepalive.dead)
+        m_keepalive.timer = reactor->schedule(boost::bind(&SSHTerminal::keepaliveTick, this), m_keepalive.intervalMs);
+}
+
+void SSHTerminal::stopKeepalive()
+{
+    if (m_keepalive.reactor && m_keepalive.timer)
+        m_keepalive.reactor->cancel(m_keepalive.timer);
+    m_keepalive.reactor = NULL;
+    m_keepalive.timer = 0;
+}
+
+void SSHTerminal::stopTimers(SSHReactor* reactor)
+{
+    stopKeepalive();
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_resizeTimer) {
+        reactor->cancel(m_resizeTimer);
+        m_resizeTimer = 0;
+    }
+}
+
+void SSHTerminal::keepaliveTick()
+{
+    ssh_session session = m_session.getCSession();
+    struct ssh_session_stats stats;
+    ssh_get_session_stats(session, &stats);
+    m_keepalive.timer = 0;
+
+    if (stats.keepalives_answered != m_keepalive.answered) {
+        // RFC 6298 smoothing, the deviation taken against the previous average
+        long sample = stats.keepalive_rtt_us;
+        if (m_keepalive.rtt == 0) {
+            m_keepalive.rtt = sample;
+            m_keepalive.jitter = sample / 2;
+        } else {
+            long deviation = sample > m_keepalive.rtt ? sample - m_keepalive.rtt : m_keepalive.rtt - sample;
+            m_keepalive.jitter += (deviation - m_keepalive.jitter) / 4;
+            m_keepalive.rtt += (sample - m_keepalive.rtt) / 8;
+        }
+        m_keepalive.answered = stats.keepalives_answered;
+        m_keepalive.misses = 0;
+    } else if (stats.keepalives_sent != stats.keepalives_answered) {
+        m_keepalive.misses++;
+    }
+
+    if (m_keepalive.misses >= m_keepalive.maxMisses) {
+        FBLOG_WARN("SSHTerminal", "keepalive: no answer for " << m_keepalive.misses << " interval(s), link is dead");
+        m_keepalive.dead = true;
+
+        // read() reports the disconnection once the output is drained
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_closed = true;
+        return;
+    }
+
+    if (ssh_send_keepalive(session) != SSH_OK)
+        FBLOG_WARN("SSHTerminal", "keepalive: " << ssh_get_error(session));
+
+    m_keepalive.timer = m_keepalive.reactor->schedule(boost::bind(&SSHTerminal::keepaliveTick, this), m_keepalive.intervalMs);
+}
+
+void SSHTerminal::onLog(ssh_session session, int priority, const char* message, void* userdata)
+{
+    switch (priority) {
+    case SSH_LOG_NOLOG:
+    case SSH_LOG_RARE:
+        FBLOG_INFO("SSHTerminal", "libssh: " << message);
+        break;
+    case SSH_LOG_PROTOCOL:
+        FBLOG_DEBUG("SSHTerminal", "libssh: " << message);
+        break;
+    default:
+        FBLOG_TRACE("SSHTerminal", "libssh: " << message);
+        break;
+    }
+}
+
+int SSHTerminal::onChannelData(ssh_session session, ssh_channel channel, void* data, uint32_t len, int isStderr, void* userdata)
+{
+    SSHTerminal* self = static_cast<SSHTerminal*>(userdata);
+
+#ifdef FILE_LOG
+    FILE* log = fopen("terminal.log", "a");
+    fwrite(data, len, 1, log);
+    fclose(log);
+#endif
+
+    boost::mutex::scoped_lock lock(self->m_mutex);
+    size_t start = self->m_received.size();
+    self->m_decoder.decode(static_cast<const char*>(data), len, self->m_received);
+    self->outputArrived(start);
+    self->m_echo.serverOutput(self->m_received, start, SSHReactor::monotonicUsec());
+    return len;
+}
+
+void SSHTerminal::onChannelClosed(ssh_session session, ssh_channel channel, void* userdata)
+{
+    SSHTerminal* self = static_cast<SSHTerminal*>(userdata);
+
+    boost::mutex::scoped_lock lock(self->m_mutex);
+    if (self->m_closed)
+        return;
+
+    // A sequence cut off by the end of the output is shown as U+FFFD
+    size_t start = self->m_received.size();
+    self->m_decoder.finish(self->m_received);
+    self->outputArrived(start);
+    self->m_closed = true;
+}
+
+void SSHTerminal::flush()
+{
+    std::string outgoing;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        outgoing.swap(m_outgoing);
+        m_flushPosted = false;
+    }
+
+    if (!outgoing.empty() && m_channel->isOpen() && !m_channel->isEof())
+        m_channel->write(outgoing.data(), outgoing.size());
+}
+
+void SSHTerminal::resize(int columns, int rows)
+{
+    if (columns <= 0 || rows <= 0)
+        return;
+
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if (columns == m_columns && rows == m_rows)
+            return;
+
+        m_columns = columns;
+        m_rows = rows;
+        m_recorder.resize(columns, rows, SSHReactor::monotonicUsec());
+        if (m_reactor) {
+            // Sizes that come in meanwhile replace this one
+            if (!m_resizeTimer)
+                m_resizeTimer = m_reactor->schedule(boost::bind(&SSHTerminal::sendPtySize, this), RESIZE_DEBOUNCE_MS);
+            return;
+        }
+    }
+
+    if (m_channel && m_channel->isOpen())
+        m_channel->changePtySize(columns, rows);
+}
+
+void SSHTerminal::sendPtySize()
+{
+    int columns, rows;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        columns = m_columns;
+        rows = m_rows;
+        m_resizeTimer = 0;
+    }
+
+    if (m_channel->isOpen() && !m_channel->isEof())
+        m_channel->changePtySize(columns, rows);
+}
+
 int SSHTerminal::write(char keyCode)
 {
     if (!m_session.isConnected())
         return -1;
 
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_writeCalls++;
+        m_recorder.input(&keyCode, sizeof(char), SSHReactor::monotonicUsec());
+        // Drawn ahead of the echo; read() returns it with the server output
+        m_echo.keyTyped(keyCode, SSHReactor::monotonicUsec(), m_received);
+        if (m_reactor) {
+            if (m_closed)
+                return -1;
+
+            // Keys typed before the reactor gets to them go out in one write
+            m_outgoing += keyCode;
+            if (!m_flushPosted) {
+                m_flushPosted = true;
+                m_reactor->post(boost::bind(&SSHTerminal::flush, this));
+            }
+            return sizeof(char);
+        }
+    }
+
     if (!m_channel && (!m_channel->isOpen() || m_channel->isEof()))
         return -1;
 
@@ -186,6 +575,22 @@ std::string SSHTerminal::read()
     if (!m_session.isConnected())
         return std::string("SSH_CHANNEL_DISCONNECTED");
 
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_readCalls++;
+        if (m_reactor) {
+            if (m_received.empty() && m_closed)
+                return std::string("SSH_CHANNEL_DISCONNECTED");
+
+            std::string stream;
+            stream.swap(m_received);
+            remember(stream);
+            if (!stream.empty())
+                FBLOG_TRACE("SSHTerminal", "read: " << stream.size() << " byte(s)");
+            return stream;
+        }
+    }
+
     if (!m_channel && (!m_channel->isOpen() || m_channel->isEof()))
         return std::string("SSH_CHANNEL_DISCONNECTED");
 
@@ -199,10 +604,10 @@ std::string SSHTerminal::read()
 
     while ((readBytes = m_channel->readNonblocking(buffer, sizeof(buffer), false)) > 0) {
         if (readBytes) {
-            stream += std::string(buffer, readBytes);
+            m_decoder.decode(buffer, readBytes, stream);
 
 #ifdef FILE_LOG
-            fwrite(stream.c_str(), readBytes, 1, log);
+            fwrite(buffer, readBytes, 1, log);
 #endif
         } else {
             m_channel->sendEof();
@@ -214,8 +619,220 @@ std::string SSHTerminal::read()
     fclose(log);
 #endif
 
-    if (!stream.empty())
-        std::cout << stream << std::endl;
+    if (m_channel->isEof())
+        m_decoder.finish(stream);
 
+    if (!stream.empty())
+        FBLOG_TRACE("SSHTerminal", "read: " << stream.size() << " byte(s)");
+
+    // Predicted keys wait in m_received
+    boost::mutex::scoped_lock lock(m_mutex);
+    size_t start = m_received.size();
+    m_received += stream;
+    if (!stream.empty()) {
+        outputArrived(start);
+        m_echo.serverOutput(m_received, start, SSHReactor::monotonicUsec());
+    }
+    stream.clear();
+    stream.swap(m_received);
+    remember(stream);
     return stream;
 }
+
+void SSHTerminal::remember(const std::string& stream)
+{
+    m_history += stream;
+    if (m_history.size() <= HISTORY_BYTES)
+        return;
+
+    // Cut at a line break so the replay does not start inside an escape sequence
+    size_t cut = m_history.find('\n', m_history.size() - HISTORY_BYTES);
+    m_history.erase(0, cut == std::string::npos ? m_history.size() : cut + 1);
+}
+
+// Called with m_mutex held for the server output in m_received[start..],
+// before predictions are drawn into it
+void SSHTerminal::outputArrived(size_t start)
+{
+    if (start < m_received.size())
+        m_recorder.output(m_received.data() + start, m_received.size() - start, SSHReactor::monotonicUsec());
+
+    if (!m_triggers.patternCount())
+        return;
+
+    std::vector<TriggerEngine::Match> matches;
+    m_triggers.scan(m_received, start, matches);
+    m_triggerMatches += matches.size();
+    m_triggerEvents.insert(m_triggerEvents.end(), matches.begin(), matches.end());
+    if (m_triggerEvents.size() > TRIGGER_EVENT_COUNT) {
+        size_t drop = m_triggerEvents.size() - TRIGGER_EVENT_COUNT;
+        m_triggerEvents.erase(m_triggerEvents.begin(), m_triggerEvents.begin() + drop);
+        m_triggerDropped += drop;
+    }
+}
+
+bool SSHTerminal::startRecording(const std::string& path, bool input)
+{
+    // A recording in progress is finished first, without m_mutex
+    m_recorder.close();
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_recorder.open(path, m_columns, m_rows, input, SSHReactor::monotonicUsec());
+}
+
+void SSHTerminal::stopRecording()
+{
+    // Waits for the recording thread to reach the disk; the session keeps running meanwhile, and
+    // its output is no longer recorded
+    m_recorder.close();
+}
+
+void SSHTerminal::setTriggers(const std::vector<std::string>& patterns)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_triggers.setPatterns(patterns);
+    m_triggerEvents.clear();
+}
+
+void SSHTerminal::takeTriggerEvents(std::vector<TriggerEvent>& events)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for (size_t i = 0; i < m_triggerEvents.size(); i++) {
+        const TriggerEngine::Match& match = m_triggerEvents[i];
+        TriggerEvent event = { match.pattern, m_triggers.pattern(match.pattern), match.line, match.column };
+        events.push_back(event);
+    }
+    m_triggerEvents.clear();
+}
+
+void SSHTerminal::replayHistory()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_received.insert(0, m_history);
+    m_history.clear();
+}
+
+bool SSHTerminal::schedule(const SSHReactor::Task& task, long delayMs)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_reactor)
+        return false;
+
+    m_reactor->schedule(task, delayMs);
+    return true;
+}
+
+void SSHTerminal::getStats(Stats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    SSHReactor* reactor;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        reactor = m_reactor;
+        stats.writeCalls = m_writeCalls;
+        stats.readCalls = m_readCalls;
+        stats.pendingRender = m_received.size();
+        stats.pendingWrite = m_outgoing.size();
+        stats.localEcho = m_echo.active();
+        stats.echoConfirmed = m_echo.confirmed();
+        stats.echoFailed = m_echo.failed();
+        stats.echoRoundTrip = m_echo.roundTrip();
+        stats.triggerMatches = m_triggerMatches;
+        stats.triggerDropped = m_triggerDropped;
+        stats.recording = m_recorder.isOpen();
+        stats.recordingDropped = m_recorder.dropped();
+    }
+
+    // The counters are only written by the thread that owns the session, so
+    // they are copied there rather than read while it updates them
+    if (reactor) {
+        stats.reactorTasks = reactor->pendingTasks();
+        reactor->call(boost::bind(&SSHTerminal::snapshotStats, this, &stats));
+    } else {
+        snapshotStats(&stats);
+    }
+}
+
+void SSHTerminal::snapshotStats(Stats* stats)
+{
+    ssh_get_session_stats(m_session.getCSession(), &stats->session);
+    if (m_channel)
+        ssh_channel_get_stats(m_channel->getCChannel(), &stats->channel);
+
+    stats->linkRtt = m_keepalive.rtt;
+    stats->linkJitter = m_keepalive.jitter;
+    stats->keepaliveMisses = m_keepalive.misses;
+    stats->linkDead = m_keepalive.dead;
+    m_forwarder.getStats(stats->forwarding);
+}
+
+int SSHTerminal::forwardLocal(int bindPort, const std::string& host, int port)
+{
+    if (host.empty())
+        return -1;
+    return forward(bindPort, host, port);
+}
+
+int SSHTerminal::forwardDynamic(int bindPort)
+{
+    return forward(bindPort, std::string(), 0);
+}
+
+// An empty host makes a SOCKS5 listener
+int SSHTerminal::forward(int bindPort, const std::string& host, int port)
+{
+    SSHReactor* reactor;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        reactor = m_reactor;
+    }
+
+    // The channels are opened on the session, which only the reactor may use
+    int result = -1;
+    if (reactor)
+        reactor->call(boost::bind(&SSHTerminal::startForward, this, bindPort, &host, port, &result));
+    return result;
+}
+
+bool SSHTerminal::cancelForward(int bindPort)
+{
+    SSHReactor* reactor;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        reactor = m_reactor;
+    }
+
+    bool result = false;
+    if (reactor)
+        reactor->call(boost::bind(&SSHTerminal::stopForward, this, bindPort, &result));
+    return result;
+}
+
+void SSHTerminal::startForward(int bindPort, const std::string* host, int port, int* result)
+{
+    if (host->empty())
+        *result = m_forwarder.listenDynamic(bindPort);
+    else
+        *result = m_forwarder.listenLocal(bindPort, *host, port);
+}
+
+void SSHTerminal::stopForward(int bindPort, bool* result)
+{
+    *result = m_forwarder.cancel(bindPort);
+}
+
+void SSHTerminal::dumpTrace()
+{
+    SSHReactor* reactor;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        reactor = m_reactor;
+    }
+
+    // The ring is written by the thread that owns the session
+    if (reactor)
+        reactor->call(boost::bind(&ssh_trace_dump, m_session.getCSession()));
+    else
+        ssh_trace_dump(m_session.getCSession());
+}
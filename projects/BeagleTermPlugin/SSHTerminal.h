@@ -3,31 +3,195 @@
 
 #define SSH_NO_CPP_EXCEPTIONS
 #include "libssh/libsshpp.hpp"
+#include "libssh/callbacks.h"
+#include "UTF8Decoder.h"
+#include "LocalEcho.h"
+#include "TriggerEngine.h"
+#include "SessionRecorder.h"
+#include "SSHReactor.h"
+#include "PortForwarder.h"
 
+#include <deque>
 #include <string>
+#include <vector>
+#include <boost/thread.hpp>
 
 class SSHTerminal {
+public:
+    struct Stats {
+        struct ssh_session_stats session;
+        struct ssh_channel_stats channel;
+        size_t writeCalls;
+        size_t readCalls;
+        size_t pendingRender;   // decoded output read() has not returned yet
+        size_t pendingWrite;    // keys waiting for the reactor to send them
+        size_t reactorTasks;
+        bool localEcho;         // keys are predicted, not in a full-screen application
+        size_t echoConfirmed;
+        size_t echoFailed;
+        long echoRoundTrip;     // smoothed time from a key to its echo, in microseconds
+        long linkRtt;           // smoothed keepalive round trip, in microseconds
+        long linkJitter;        // mean deviation of the keepalive round trip
+        int keepaliveMisses;    // keepalive intervals in a row without an answer
+        bool linkDead;
+        size_t triggerMatches;
+        size_t triggerDropped;  // matches not taken before the queue filled up
+        bool recording;
+        size_t recordingDropped;
+        PortForwarder::Stats forwarding;
+    };
+
+    struct TriggerEvent {
+        size_t pattern;
+        std::string text;
+        size_t line;
+        size_t column;
+    };
+
+    // Wall clock time spent in each phase of the last connection, in microseconds
+    struct ConnectProfile {
+        long dns;
+        long tcp;
+        int attempts;
+        long banner;
+        long kex;
+        long kexCpu;
+        long hostKey;
+        long auth;
+        long channel;
+        long pty;
+        long shell;
+    };
+
+public:
+    static void staticInitialize();
+    static void staticDeinitialize();
+
 public:
     SSHTerminal();
     virtual ~SSHTerminal();
 
     int connect(const std::string& host, const std::string& port, const std::string& user);
     void disconnect();
+    bool isConnected() { return m_session.isConnected() != 0; }
 
     int verifyKnownHost(std::string& error);
     int writeKnownHost();
     int userauthPassword(const std::string& password);
 
+    // The pty size the server is told, once a window drag settles
+    void resize(int columns, int rows);
+
     int write(char keyCode);
     std::string read();
 
+    // A keepalive every intervalMs while the reactor owns the session, 0 for
+    // none; the link is given up after maxMisses intervals without an answer
+    void setKeepalive(long intervalMs, int maxMisses);
+
+    // Runs task on the reactor thread after delayMs; false without a reactor
+    bool schedule(const SSHReactor::Task& task, long delayMs);
+    // The next read() returns the recent output again, for a page that
+    // takes the session over with an empty screen
+    void replayHistory();
+
+    // Patterns looked for in the output from now on, replacing the previous set
+    void setTriggers(const std::vector<std::string>& patterns);
+    // The matches found since the last call, oldest first
+    void takeTriggerEvents(std::vector<TriggerEvent>& events);
+
+    // Records the output, and the keys typed if input is set, to path
+    bool startRecording(const std::string& path, bool input);
+    void stopRecording();
+
+    // Forwards connections to bindPort on the loopback interface to host:port
+    // (-L), or to wherever each asks as a SOCKS5 proxy (-D). Return the port
+    // listened on, which bindPort 0 leaves to the system, or -1
+    int forwardLocal(int bindPort, const std::string& host, int port);
+    int forwardDynamic(int bindPort);
+    bool cancelForward(int bindPort);
+
+    void getStats(Stats& stats);
+    void dumpTrace();
+    const ConnectProfile& getConnectProfile() const { return m_profile; }
+
 private:
+    static void precomputeKeys();
+
+    static void onLog(ssh_session session, int priority, const char* message, void* userdata);
+    static int onChannelData(ssh_session session, ssh_channel channel, void* data, uint32_t len, int isStderr, void* userdata);
+    static void onChannelClosed(ssh_session session, ssh_channel channel, void* userdata);
+
     void init();
     void cleanup();
 
+    bool attachReactor();
+    void detachReactor();
+    void flush();
+    void remember(const std::string& stream);
+    void outputArrived(size_t start);
+    void snapshotStats(Stats* stats);
+    int forward(int bindPort, const std::string& host, int port);
+    void startForward(int bindPort, const std::string* host, int port, int* result);
+    void stopForward(int bindPort, bool* result);
+
+    void startKeepalive(SSHReactor* reactor);
+    void stopKeepalive();
+    void stopTimers(SSHReactor* reactor);
+    void sendPtySize();
+    void configureKeepalive(long intervalMs, int maxMisses);
+    void keepaliveTick();
+
+private:
+    static boost::thread s_precomputeThread;
+    static boost::mutex s_precomputeMutex;
+
 private:
     ssh::Session m_session;
     ssh::Channel* m_channel;
+    UTF8Decoder m_decoder;
+    ConnectProfile m_profile;
+    struct ssh_callbacks_struct m_sessionCallbacks;
+
+    // Set while the reactor thread owns the session
+    SSHReactor* m_reactor;
+    struct ssh_channel_callbacks_struct m_callbacks;
+
+    // Owned by the reactor thread while one is attached
+    struct Keepalive {
+        long intervalMs;
+        int maxMisses;
+        SSHReactor* reactor;
+        SSHReactor::TimerId timer;
+        uint32_t answered;
+        int misses;
+        long rtt;
+        long jitter;
+        bool dead;
+    } m_keepalive;
+
+    // Owned by the reactor thread while one is attached
+    PortForwarder m_forwarder;
+
+    // Shared with the reactor thread
+    boost::mutex m_mutex;
+    std::string m_received;
+    std::string m_outgoing;
+    std::string m_history;      // the output read() returned last, for replayHistory()
+    LocalEcho m_echo;
+    TriggerEngine m_triggers;
+    std::deque<TriggerEngine::Match> m_triggerEvents;
+    size_t m_triggerMatches;
+    size_t m_triggerDropped;
+    SessionRecorder m_recorder;
+    bool m_flushPosted;
+    bool m_closed;
+    int m_columns;
+    int m_rows;
+    SSHReactor::TimerId m_resizeTimer;
+
+    size_t m_writeCalls;
+    size_t m_readCalls;
 };
 
 #endif /* SSHTERMINAL_H_ */
@@ -0,0 +1,233 @@
+#include "SessionPlayer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+boost::uint64_t getU64(const unsigned char* in, int bytes)
+{
+    boost::uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        value = (value << 8) | in[i];
+    return value;
+}
+
+// fseek() takes a long, which stops at 2 GiB on Windows and 32-bit builds
+int seekTo(FILE* file, boost::uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET);
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+bool earlier(boost::int64_t timeUsec, const SessionRecorder::IndexEntry& entry)
+{
+    return timeUsec < entry.timeUsec;
+}
+
+int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Appends the UTF-8 encoding of a code point below 0x10000
+void appendUtf8(std::string& out, unsigned int code)
+{
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+// Parses [seconds, "type", "data"] from an event line; the data is appended
+// to out only for output events
+bool parseEvent(const std::string& line, boost::int64_t& timeUsec, std::string& out, boost::int64_t limitUsec)
+{
+    if (line.empty() || line[0] != '[')
+        return false;
+
+    char* end;
+    double seconds = strtod(line.c_str() + 1, &end);
+    timeUsec = static_cast<boost::int64_t>(seconds * 1000000 + 0.5);
+    if (timeUsec > limitUsec)
+        return true;
+
+    size_t type = line.find('"', end - line.c_str());
+    if (type == std::string::npos || type + 2 >= line.size() || line[type + 1] != 'o')
+        return true;
+
+    size_t pos = line.find('"', type + 3);
+    if (pos == std::string::npos)
+        return false;
+
+    for (pos++; pos < line.size() && line[pos] != '"'; pos++) {
+        if (line[pos] != '\\') {
+            out += line[pos];
+            continue;
+        }
+        if (++pos >= line.size())
+            return false;
+
+        switch (line[pos]) {
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'u': {
+            unsigned int code = 0;
+            for (int i = 0; i < 4; i++) {
+                int digit = pos + 1 < line.size() ? hexDigit(line[++pos]) : -1;
+                if (digit < 0)
+                    return false;
+                code = (code << 4) | digit;
+            }
+            appendUtf8(out, code);
+            break;
+        }
+        default:
+            out += line[pos];
+            break;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+SessionPlayer::SessionPlayer() : m_castFile(NULL), m_keyFile(NULL)
+{
+}
+
+SessionPlayer::~SessionPlayer()
+{
+    close();
+}
+
+bool SessionPlayer::open(const std::string& path)
+{
+    close();
+
+    m_castFile = fopen(path.c_str(), "rb");
+    m_keyFile = fopen((path + ".keys").c_str(), "rb");
+    FILE* indexFile = fopen((path + ".idx").c_str(), "rb");
+    if (!m_castFile || !m_keyFile || !indexFile) {
+        if (indexFile)
+            fclose(indexFile);
+        close();
+        return false;
+    }
+
+    unsigned char header[SessionRecorder::INDEX_HEADER_SIZE];
+    bool valid = fread(header, sizeof(header), 1, indexFile) == 1 && memcmp(header, "BTIX", 4) == 0
+        && getU64(header + 4, 4) == 1;
+
+    // A recording still being written may end in a partial entry, which is left out
+    unsigned char entry[SessionRecorder::INDEX_ENTRY_SIZE];
+    while (valid && fread(entry, sizeof(entry), 1, indexFile) == 1) {
+        SessionRecorder::IndexEntry e;
+        e.timeUsec = static_cast<boost::int64_t>(getU64(entry, 8));
+        e.castOffset = getU64(entry + 8, 8);
+        e.keyOffset = getU64(entry + 16, 8);
+        e.keyLength = static_cast<boost::uint32_t>(getU64(entry + 24, 4));
+        m_index.push_back(e);
+    }
+    fclose(indexFile);
+
+    if (!valid || m_index.empty()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SessionPlayer::close()
+{
+    if (m_castFile)
+        fclose(m_castFile);
+    if (m_keyFile)
+        fclose(m_keyFile);
+    m_castFile = m_keyFile = NULL;
+    m_index.clear();
+}
+
+boost::int64_t SessionPlayer::lastKeyframe() const
+{
+    return m_index.empty() ? 0 : m_index.back().timeUsec;
+}
+
+bool SessionPlayer::seek(boost::int64_t timeUsec, std::string& screen)
+{
+    if (m_index.empty())
+        return false;
+
+    // The last keyframe at or before timeUsec; the first is at 0
+    std::vector<SessionRecorder::IndexEntry>::const_iterator it =
+        std::upper_bound(m_index.begin(), m_index.end(), timeUsec, earlier);
+    if (it != m_index.begin())
+        --it;
+
+    screen.assign(it->keyLength, '\0');
+    if (it->keyLength && (seekTo(m_keyFile, it->keyOffset) != 0
+            || fread(&screen[0], it->keyLength, 1, m_keyFile) != 1))
+        return false;
+
+    return playFrom(it->castOffset, timeUsec, screen);
+}
+
+bool SessionPlayer::replay(boost::int64_t timeUsec, std::string& screen)
+{
+    if (m_index.empty())
+        return false;
+
+    screen.clear();
+    return playFrom(m_index.front().castOffset, timeUsec, screen);
+}
+
+bool SessionPlayer::playFrom(boost::uint64_t castOffset, boost::int64_t timeUsec, std::string& screen)
+{
+    if (seekTo(m_castFile, castOffset) != 0)
+        return false;
+
+    std::string line;
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), m_castFile)) {
+        line += buffer;
+        if (line[line.size() - 1] != '\n')
+            continue;
+
+        boost::int64_t eventUsec;
+        if (!parseEvent(line, eventUsec, screen, timeUsec))
+            return false;
+        if (eventUsec > timeUsec)
+            break;
+        line.clear();
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef SESSIONPLAYER_H_
+#define SESSIONPLAYER_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "SessionRecorder.h"
+
+// Plays back what SessionRecorder wrote. The index is read whole, 32 bytes
+// per keyframe; the output at any time is drawn from the keyframe before it
+// and the events that follow, so a seek reads at most a keyframe interval.
+class SessionPlayer : boost::noncopyable {
+public:
+    SessionPlayer();
+    ~SessionPlayer();
+
+    bool open(const std::string& path);
+    void close();
+
+    // Time of the last keyframe, a lower bound of the length of the recording
+    boost::int64_t lastKeyframe() const;
+
+    // The output that draws the screen as it was at timeUsec into a reset
+    // terminal; false if it cannot be read
+    bool seek(boost::int64_t timeUsec, std::string& screen);
+    // The output from the start up to timeUsec, as a player without the index has to
+    bool replay(boost::int64_t timeUsec, std::string& screen);
+
+private:
+    bool playFrom(boost::uint64_t castOffset, boost::int64_t timeUsec, std::string& screen);
+
+private:
+    FILE* m_castFile;
+    FILE* m_keyFile;
+    std::vector<SessionRecorder::IndexEntry> m_index;
+};
+
+#endif /* SESSIONPLAYER_H_ */
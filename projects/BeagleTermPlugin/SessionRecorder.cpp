@@ -0,0 +1,329 @@
+#include "SessionRecorder.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include "logging.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Folder in the home directory recordings are written to
+#define RECORDINGS_FOLDER "BeagleTerm Recordings"
+// Output kept to draw a keyframe from, cut at a line break
+#define SCREEN_BYTES (64 * 1024)
+// A keyframe is taken after this long or this much output, whichever comes first
+#define KEYFRAME_USEC 30000000
+#define KEYFRAME_BYTES (256 * 1024)
+// The recording thread is woken once this much is waiting, or every second
+#define FLUSH_BYTES (64 * 1024)
+#define FLUSH_MS 1000
+// Beyond this much waiting for the disk, output is dropped rather than the session slowed down
+#define PENDING_BYTES (16 * 1024 * 1024)
+
+namespace {
+
+const char* const CLEAR_SEQUENCES[] = { "\x1b[2J", "\x1b" "c" };
+
+void putU32(std::string& out, boost::uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+void putU64(std::string& out, boost::uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+// Appends data as the body of a JSON string
+void appendJson(std::string& out, const char* data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (c < 0x20 || c == 0x7f) {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                out += escape;
+            } else {
+                out += static_cast<char>(c);
+            }
+            break;
+        }
+    }
+}
+
+void writeAll(FILE* file, const std::string& data)
+{
+    if (file && !data.empty() && fwrite(data.data(), 1, data.size(), file) != data.size())
+        FBLOG_WARN("SessionRecorder", "write: " << strerror(errno));
+}
+
+bool makeFolder(const std::string& path)
+{
+#ifdef _WIN32
+    return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+    return mkdir(path.c_str(), 0700) == 0 || errno == EEXIST;
+#endif
+}
+
+} // namespace
+
+std::string SessionRecorder::pathFor(const std::string& name)
+{
+    // Any page may load the plugin, so it names a file but never a place
+    if (name.empty() || name[0] == '.' || name.find_first_of("/\\:") != std::string::npos)
+        return std::string();
+
+#ifdef _WIN32
+    const char* home = getenv("USERPROFILE");
+    const char separator = '\\';
+#else
+    const char* home = getenv("HOME");
+    const char separator = '/';
+#endif
+    if (!home || !*home)
+        return std::string();
+
+    std::string folder = std::string(home) + separator + RECORDINGS_FOLDER;
+    if (!makeFolder(folder))
+        return std::string();
+    return folder + separator + name;
+}
+
+SessionRecorder::SessionRecorder() : m_stopping(false), m_castFile(NULL), m_indexFile(NULL), m_keyFile(NULL),
+    m_input(false), m_startUsec(0), m_castBytes(0), m_keyBytes(0), m_keyframeUsec(0), m_sinceKeyframe(0), m_dropped(0)
+{
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    close();
+}
+
+bool SessionRecorder::open(const std::string& path, int columns, int rows, bool input, boost::int64_t nowUsec)
+{
+    close();
+
+    FILE* castFile = fopen(path.c_str(), "wb");
+    FILE* indexFile = fopen((path + ".idx").c_str(), "wb");
+    FILE* keyFile = fopen((path + ".keys").c_str(), "wb");
+    if (!castFile || !indexFile || !keyFile) {
+        FBLOG_WARN("SessionRecorder", "open: " << path << ": " << strerror(errno));
+        if (castFile)
+            fclose(castFile);
+        if (indexFile)
+            fclose(indexFile);
+        if (keyFile)
+            fclose(keyFile);
+        return false;
+    }
+
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_castFile = castFile;
+    m_indexFile = indexFile;
+    m_keyFile = keyFile;
+    m_input = input;
+    m_startUsec = nowUsec;
+    m_castBytes = m_keyBytes = 0;
+    m_screen.clear();
+    m_sinceKeyframe = 0;
+    m_dropped = 0;
+    m_stopping = false;
+
+    char header[128];
+    snprintf(header, sizeof(header), "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %ld}\n",
+             columns, rows, static_cast<long>(time(NULL)));
+    m_cast = header;
+    m_castBytes = m_cast.size();
+
+    m_index = "BTIX";
+    putU32(m_index, 1);
+    keyframe(0);
+
+    m_thread = boost::thread(&SessionRecorder::run, this);
+    FBLOG_INFO("SessionRecorder", "open: " << path);
+    return true;
+}
+
+void SessionRecorder::close()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_stopping = true;
+        m_wake.notify_all();
+    }
+    if (m_thread.joinable())
+        m_thread.join();
+
+    // output() and input() look at m_castFile from the session's thread
+    FILE* files[3];
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        files[0] = m_castFile;
+        files[1] = m_indexFile;
+        files[2] = m_keyFile;
+        m_castFile = m_indexFile = m_keyFile = NULL;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (files[i])
+            fclose(files[i]);
+    }
+}
+
+bool SessionRecorder::isOpen()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_castFile && !m_stopping;
+}
+
+void SessionRecorder::output(const char* data, size_t len, boost::int64_t nowUsec)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_castFile || m_stopping || !len)
+        return;
+
+    if (m_cast.size() > PENDING_BYTES) {
+        m_dropped += len;
+        return;
+    }
+    event('o', data, len, nowUsec);
+
+    // A clear leaves nothing earlier on the screen
+    const char* end = data + len;
+    const char* last = NULL;
+    for (size_t i = 0; i < sizeof(CLEAR_SEQUENCES) / sizeof(CLEAR_SEQUENCES[0]); i++) {
+        const char* clear = CLEAR_SEQUENCES[i];
+        const char* clearEnd = clear + strlen(clear);
+        for (const char* found = std::search(data, end, clear, clearEnd); found != end;
+             found = std::search(found + 1, end, clear, clearEnd)) {
+            if (!last || found > last)
+                last = found;
+        }
+    }
+    if (last)
+        m_screen.assign(last, end - last);
+    else
+        m_screen.append(data, len);
+
+    if (m_screen.size() > SCREEN_BYTES) {
+        size_t cut = m_screen.find('\n', m_screen.size() - SCREEN_BYTES);
+        m_screen.erase(0, cut == std::string::npos ? m_screen.size() : cut + 1);
+    }
+
+    m_sinceKeyframe += len;
+    boost::int64_t elapsed = nowUsec - m_startUsec;
+    if (m_sinceKeyframe >= KEYFRAME_BYTES || elapsed - m_keyframeUsec >= KEYFRAME_USEC)
+        keyframe(elapsed);
+
+    if (m_cast.size() >= FLUSH_BYTES)
+        m_wake.notify_all();
+}
+
+void SessionRecorder::input(const char* data, size_t len, boost::int64_t nowUsec)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_castFile || m_stopping || !m_input || m_cast.size() > PENDING_BYTES)
+        return;
+
+    event('i', data, len, nowUsec);
+}
+
+void SessionRecorder::resize(int columns, int rows, boost::int64_t nowUsec)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (!m_castFile || m_stopping)
+        return;
+
+    char size[32];
+    int len = snprintf(size, sizeof(size), "%dx%d", columns, rows);
+    event('r', size, len, nowUsec);
+}
+
+size_t SessionRecorder::dropped()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_dropped;
+}
+
+// Called with m_mutex held
+void SessionRecorder::event(char type, const char* data, size_t len, boost::int64_t nowUsec)
+{
+    boost::int64_t elapsed = nowUsec - m_startUsec;
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "[%ld.%06ld, \"%c\", \"", static_cast<long>(elapsed / 1000000),
+             static_cast<long>(elapsed % 1000000), type);
+
+    size_t before = m_cast.size();
+    m_cast += prefix;
+    appendJson(m_cast, data, len);
+    m_cast += "\"]\n";
+    m_castBytes += m_cast.size() - before;
+}
+
+// Called with m_mutex held; the events after it start at the current end of the cast file
+void SessionRecorder::keyframe(boost::int64_t timeUsec)
+{
+    putU64(m_index, static_cast<boost::uint64_t>(timeUsec));
+    putU64(m_index, m_castBytes);
+    putU64(m_index, m_keyBytes);
+    putU32(m_index, static_cast<boost::uint32_t>(m_screen.size()));
+    putU32(m_index, 0);
+
+    m_keys += m_screen;
+    m_keyBytes += m_screen.size();
+    m_keyframeUsec = timeUsec;
+    m_sinceKeyframe = 0;
+}
+
+void SessionRecorder::run()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for (;;) {
+        if (!m_stopping && m_cast.size() < FLUSH_BYTES)
+            m_wake.timed_wait(lock, boost::posix_time::milliseconds(FLUSH_MS));
+
+        std::string cast, index, keys;
+        cast.swap(m_cast);
+        index.swap(m_index);
+        keys.swap(m_keys);
+        bool stopping = m_stopping;
+
+        // The index goes last, so it never points past what the other files hold
+        lock.unlock();
+        writeAll(m_castFile, cast);
+        writeAll(m_keyFile, keys);
+        fflush(m_castFile);
+        fflush(m_keyFile);
+        writeAll(m_indexFile, index);
+        fflush(m_indexFile);
+        lock.lock();
+
+        if (stopping)
+            break;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef SESSIONRECORDER_H_
+#define SESSIONRECORDER_H_
+
+#include <stdio.h>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include <boost/noncopyable.hpp>
+
+// Records a session as an asciicast v2 file, which common players read, and
+// two side files for seeking: path.keys holds keyframes, the output needed to
+// redraw the screen at some point, and path.idx their times and the offset in
+// the cast file where the events after each one start. A player finds the
+// keyframe before any time with a binary search over the index instead of
+// replaying from the start. The files are written from a thread of their own,
+// so recording costs the session thread a copy of the output.
+class SessionRecorder : boost::noncopyable {
+public:
+    // Fixed size little-endian records after an 8 byte header in path.idx
+    struct IndexEntry {
+        boost::int64_t timeUsec;    // since the start of the recording
+        boost::uint64_t castOffset;
+        boost::uint64_t keyOffset;
+        boost::uint32_t keyLength;
+    };
+    enum { INDEX_HEADER_SIZE = 8, INDEX_ENTRY_SIZE = 32 };
+
+public:
+    // Where a recording named by the page goes: a plain file name in the
+    // recordings folder of the user, or empty if the name is not one
+    static std::string pathFor(const std::string& name);
+
+public:
+    SessionRecorder();
+    ~SessionRecorder();
+
+    bool open(const std::string& path, int columns, int rows, bool input, boost::int64_t nowUsec);
+    // Waits for the recording thread to write what is left; output() and
+    // input() may be called meanwhile and are ignored
+    void close();
+    bool isOpen();
+
+    void output(const char* data, size_t len, boost::int64_t nowUsec);
+    // Ignored unless the recording was opened with input
+    void input(const char* data, size_t len, boost::int64_t nowUsec);
+    void resize(int columns, int rows, boost::int64_t nowUsec);
+
+    // Output left out because the disk could not keep up
+    size_t dropped();
+
+private:
+    void event(char type, const char* data, size_t len, boost::int64_t nowUsec);
+    void keyframe(boost::int64_t timeUsec);
+    void run();
+
+private:
+    boost::mutex m_mutex;
+    boost::condition_variable m_wake;
+    boost::thread m_thread;
+    bool m_stopping;
+
+    FILE* m_castFile;
+    FILE* m_indexFile;
+    FILE* m_keyFile;
+
+    // Written by the recording thread
+    std::string m_cast;
+    std::string m_index;
+    std::string m_keys;
+
+    bool m_input;
+    boost::int64_t m_startUsec;
+    boost::uint64_t m_castBytes;
+    boost::uint64_t m_keyBytes;
+    std::string m_screen;       // the output since the screen was last cleared, to draw a keyframe from
+    boost::int64_t m_keyframeUsec;
+    size_t m_sinceKeyframe;
+    size_t m_dropped;
+};
+
+#endif /* SESSIONRECORDER_H_ */
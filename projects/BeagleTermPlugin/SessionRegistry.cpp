@@ -0,0 +1,92 @@
+#include "SessionRegistry.h"
+#include "SSHTerminal.h"
+
+#include <stdio.h>
+#include <boost/bind.hpp>
+#include "logging.h"
+
+// Random bytes in a resume token
+#define TOKEN_BYTES 16
+
+std::map<std::string, SSHTerminal*> SessionRegistry::s_parked;
+boost::mutex SessionRegistry::s_mutex;
+
+std::string SessionRegistry::newToken()
+{
+    unsigned char random[TOKEN_BYTES];
+    if (!ssh_get_random(random, sizeof(random), 1))
+        return std::string();
+
+    std::string token;
+    char hex[3];
+    for (size_t i = 0; i < sizeof(random); i++) {
+        snprintf(hex, sizeof(hex), "%02x", random[i]);
+        token += hex;
+    }
+    return token;
+}
+
+bool SessionRegistry::park(const std::string& token, SSHTerminal* terminal, long graceMs)
+{
+    if (token.empty() || !terminal)
+        return false;
+
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        if (s_parked.count(token))
+            return false;
+        s_parked[token] = terminal;
+    }
+
+    // The timer only knows the token, so it is harmless once the terminal is claimed
+    if (!terminal->schedule(boost::bind(&SessionRegistry::expire, token), graceMs)) {
+        boost::mutex::scoped_lock lock(s_mutex);
+        s_parked.erase(token);
+        return false;
+    }
+
+    FBLOG_INFO("SessionRegistry", "park: kept for " << graceMs << "ms");
+    return true;
+}
+
+SSHTerminal* SessionRegistry::claim(const std::string& token)
+{
+    boost::mutex::scoped_lock lock(s_mutex);
+    std::map<std::string, SSHTerminal*>::iterator it = s_parked.find(token);
+    if (it == s_parked.end())
+        return NULL;
+
+    SSHTerminal* terminal = it->second;
+    s_parked.erase(it);
+    FBLOG_INFO("SessionRegistry", "claim: resumed");
+    return terminal;
+}
+
+void SessionRegistry::clear()
+{
+    std::map<std::string, SSHTerminal*> parked;
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        parked.swap(s_parked);
+    }
+
+    for (std::map<std::string, SSHTerminal*>::iterator it = parked.begin(); it != parked.end(); ++it)
+        delete it->second;
+}
+
+void SessionRegistry::expire(const std::string& token)
+{
+    SSHTerminal* terminal;
+    {
+        boost::mutex::scoped_lock lock(s_mutex);
+        std::map<std::string, SSHTerminal*>::iterator it = s_parked.find(token);
+        if (it == s_parked.end())
+            return;
+
+        terminal = it->second;
+        s_parked.erase(it);
+    }
+
+    FBLOG_INFO("SessionRegistry", "expire: nobody resumed the session");
+    delete terminal;
+}
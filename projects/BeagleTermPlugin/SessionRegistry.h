@@ -0,0 +1,36 @@
+#ifndef SESSIONREGISTRY_H_
+#define SESSIONREGISTRY_H_
+
+#include <map>
+#include <string>
+#include <boost/thread.hpp>
+
+class SSHTerminal;
+
+// Keeps the terminals of plugin instances that went away alive for a grace
+// period, so a page that reloads takes its authenticated session back with
+// the token it was given instead of connecting again. The registry lives in
+// the plugin process and goes with it.
+class SessionRegistry {
+public:
+    // An unguessable token; any page may load the plugin and present one
+    static std::string newToken();
+
+    // Takes the terminal over; it is disconnected and deleted on its reactor
+    // thread if nobody claims it within graceMs. Returns false, leaving the
+    // terminal to the caller, if it has no reactor to keep it running.
+    static bool park(const std::string& token, SSHTerminal* terminal, long graceMs);
+    // Returns the terminal parked under token and forgets it, or NULL
+    static SSHTerminal* claim(const std::string& token);
+    // Deletes the terminals still parked, before the reactors stop
+    static void clear();
+
+private:
+    static void expire(const std::string& token);
+
+private:
+    static std::map<std::string, SSHTerminal*> s_parked;
+    static boost::mutex s_mutex;
+};
+
+#endif /* SESSIONREGISTRY_H_ */
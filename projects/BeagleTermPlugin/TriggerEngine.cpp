@@ -0,0 +1,180 @@
+#include "TriggerEngine.h"
+
+#include <deque>
+
+namespace {
+
+// Characters in a UTF-8 string, not counting continuation bytes
+size_t characters(const std::string& text)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        if ((static_cast<unsigned char>(text[i]) & 0xc0) != 0x80)
+            count++;
+    }
+    return count;
+}
+
+} // namespace
+
+TriggerEngine::TriggerEngine()
+{
+    setPatterns(std::vector<std::string>());
+    reset();
+}
+
+void TriggerEngine::setPatterns(const std::vector<std::string>& patterns)
+{
+    m_patterns = patterns;
+    m_lengths.clear();
+    m_nodes.clear();
+    m_nodes.push_back(Node());
+    m_nodes[0].fail = 0;
+    m_nodes[0].output = -1;
+
+    // The trie of the patterns
+    for (size_t i = 0; i < patterns.size(); i++) {
+        const std::string& pattern = patterns[i];
+        m_lengths.push_back(characters(pattern));
+        if (pattern.empty())
+            continue;
+
+        int node = 0;
+        for (size_t j = 0; j < pattern.size(); j++) {
+            unsigned char byte = static_cast<unsigned char>(pattern[j]);
+            int next = child(node, byte);
+            if (next < 0) {
+                next = static_cast<int>(m_nodes.size());
+                m_nodes.push_back(Node());
+
+                std::vector<Edge>& edges = m_nodes[node].edges;
+                std::vector<Edge>::iterator it = edges.begin();
+                while (it != edges.end() && it->byte < byte)
+                    ++it;
+                Edge edge = { byte, next };
+                edges.insert(it, edge);
+            }
+            node = next;
+        }
+        m_nodes[node].ends.push_back(i);
+    }
+
+    for (int byte = 0; byte < 256; byte++) {
+        int next = child(0, static_cast<unsigned char>(byte));
+        m_root[byte] = next < 0 ? 0 : next;
+    }
+
+    // Fail links breadth first, so those of shorter prefixes are known
+    std::deque<int> queue;
+    for (size_t i = 0; i < m_nodes[0].edges.size(); i++) {
+        int next = m_nodes[0].edges[i].next;
+        m_nodes[next].fail = 0;
+        queue.push_back(next);
+    }
+    while (!queue.empty()) {
+        int node = queue.front();
+        queue.pop_front();
+
+        int fail = m_nodes[node].fail;
+        m_nodes[node].output = !m_nodes[node].ends.empty() ? node : m_nodes[fail].output;
+
+        for (size_t i = 0; i < m_nodes[node].edges.size(); i++) {
+            const Edge& edge = m_nodes[node].edges[i];
+            m_nodes[edge.next].fail = step(fail, edge.byte);
+            queue.push_back(edge.next);
+        }
+    }
+
+    m_state = 0;
+}
+
+void TriggerEngine::reset()
+{
+    m_state = 0;
+    m_escape = Normal;
+    m_line = 0;
+    m_column = 0;
+}
+
+void TriggerEngine::scan(const std::string& stream, size_t start, std::vector<Match>& matches)
+{
+    bool empty = m_nodes.size() == 1;
+    for (size_t i = start; i < stream.size(); i++) {
+        unsigned char byte = static_cast<unsigned char>(stream[i]);
+
+        switch (m_escape) {
+        case Escape:
+            m_escape = byte == '[' ? Csi : byte == ']' ? Osc : Normal;
+            continue;
+        case Csi:
+            // Parameters and intermediates up to the final byte
+            if (byte >= 0x40 && byte <= 0x7e)
+                m_escape = Normal;
+            continue;
+        case Osc:
+            // Ends with BEL, or with ESC \ whose backslash Escape takes
+            if (byte == 0x07)
+                m_escape = Normal;
+            else if (byte == 0x1b)
+                m_escape = Escape;
+            continue;
+        case Normal:
+            break;
+        }
+
+        if (byte < 0x20 || byte == 0x7f) {
+            if (byte == 0x1b) {
+                m_escape = Escape;
+            } else if (byte == '\n') {
+                m_line++;
+                m_column = 0;
+                m_state = 0;
+            } else if (byte == '\r') {
+                m_column = 0;
+                m_state = 0;
+            } else if (byte == '\b' && m_column > 0) {
+                m_column--;
+                m_state = 0;
+            }
+            continue;
+        }
+
+        if ((byte & 0xc0) != 0x80)
+            m_column++;
+        if (empty)
+            continue;
+
+        m_state = step(m_state, byte);
+        for (int node = m_nodes[m_state].output; node >= 0; node = m_nodes[m_nodes[node].fail].output) {
+            const std::vector<size_t>& ends = m_nodes[node].ends;
+            for (size_t j = 0; j < ends.size(); j++) {
+                size_t length = m_lengths[ends[j]];
+                Match match = { ends[j], m_line, m_column >= length ? m_column - length : 0 };
+                matches.push_back(match);
+            }
+        }
+    }
+}
+
+int TriggerEngine::child(int node, unsigned char byte) const
+{
+    const std::vector<Edge>& edges = m_nodes[node].edges;
+    for (size_t i = 0; i < edges.size() && edges[i].byte <= byte; i++) {
+        if (edges[i].byte == byte)
+            return edges[i].next;
+    }
+    return -1;
+}
+
+int TriggerEngine::step(int node, unsigned char byte) const
+{
+    for (;;) {
+        if (node == 0)
+            return m_root[byte];
+
+        int next = child(node, byte);
+        if (next >= 0)
+            return next;
+        node = m_nodes[node].fail;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef TRIGGERENGINE_H_
+#define TRIGGERENGINE_H_
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+// Finds a set of patterns in the server output with an Aho-Corasick
+// automaton, so the cost per byte does not grow with the number of patterns.
+// The stream is scanned as it arrives; a match may straddle two chunks.
+// Escape sequences are skipped and a pattern never spans a line, so
+// "\x1b[31mERROR" matches ERROR at the column it is shown in.
+class TriggerEngine {
+public:
+    struct Match {
+        size_t pattern;     // index in the patterns set
+        size_t line;        // lines since reset(), from 0
+        size_t column;      // characters from the start of the line, from 0
+    };
+
+public:
+    TriggerEngine();
+
+    // Replaces the patterns; empty ones are never matched
+    void setPatterns(const std::vector<std::string>& patterns);
+    const std::string& pattern(size_t index) const { return m_patterns[index]; }
+    size_t patternCount() const { return m_patterns.size(); }
+
+    // Forgets the position in the stream
+    void reset();
+
+    // Appends to matches the patterns that end in stream[start..]
+    void scan(const std::string& stream, size_t start, std::vector<Match>& matches);
+
+private:
+    enum EscapeState { Normal, Escape, Csi, Osc };
+
+    struct Edge {
+        unsigned char byte;
+        int next;
+    };
+
+    struct Node {
+        std::vector<Edge> edges;    // sorted by byte
+        int fail;
+        int output;         // nearest node on the fail chain, itself included, where patterns end; -1 for none
+        std::vector<size_t> ends;
+    };
+
+    int child(int node, unsigned char byte) const;
+    int step(int node, unsigned char byte) const;
+
+private:
+    std::vector<std::string> m_patterns;
+    std::vector<size_t> m_lengths;  // in characters
+    std::vector<Node> m_nodes;
+    int m_root[256];                // transitions from the root, where most bytes go
+
+    int m_state;
+    EscapeState m_escape;
+    size_t m_line;
+    size_t m_column;
+};
+
+#endif /* TRIGGERENGINE_H_ */
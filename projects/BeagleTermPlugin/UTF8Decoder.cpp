@@ -0,0 +1,131 @@
+#include "UTF8Decoder.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTF8_SSE2
+#endif
+
+static const char REPLACEMENT_CHARACTER[] = "\xEF\xBF\xBD";
+
+// Length of the ASCII run at the start of [p, end)
+static size_t asciiPrefix(const unsigned char* p, const unsigned char* end)
+{
+    const unsigned char* begin = p;
+
+#ifdef UTF8_SSE2
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(block);
+        if (mask) {
+            while (!(mask & 1)) {
+                mask >>= 1;
+                ++p;
+            }
+            return p - begin;
+        }
+        p += 16;
+    }
+#else
+    while (end - p >= 8) {
+        unsigned long long block;
+        memcpy(&block, p, sizeof(block));
+        if (block & 0x8080808080808080ULL)
+            break;
+        p += 8;
+    }
+#endif
+
+    while (p < end && *p < 0x80)
+        ++p;
+
+    return p - begin;
+}
+
+UTF8Decoder::UTF8Decoder()
+{
+    reset();
+}
+
+void UTF8Decoder::reset()
+{
+    m_pendingLength = 0;
+    m_needed = 0;
+    m_lower = 0x80;
+    m_upper = 0xBF;
+}
+
+void UTF8Decoder::start(unsigned char byte, std::string& out)
+{
+    // Second byte ranges from the Unicode well-formed byte sequences table,
+    // which rules out overlongs, surrogates and code points above U+10FFFF
+    m_lower = 0x80;
+    m_upper = 0xBF;
+
+    if (byte >= 0xC2 && byte <= 0xDF) {
+        m_needed = 1;
+    } else if (byte >= 0xE0 && byte <= 0xEF) {
+        m_needed = 2;
+        if (byte == 0xE0)
+            m_lower = 0xA0;
+        else if (byte == 0xED)
+            m_upper = 0x9F;
+    } else if (byte >= 0xF0 && byte <= 0xF4) {
+        m_needed = 3;
+        if (byte == 0xF0)
+            m_lower = 0x90;
+        else if (byte == 0xF4)
+            m_upper = 0x8F;
+    } else {
+        out.append(REPLACEMENT_CHARACTER, 3);
+        return;
+    }
+
+    m_pending[0] = byte;
+    m_pendingLength = 1;
+}
+
+void UTF8Decoder::decode(const char* data, size_t length, std::string& out)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+
+    while (p < end) {
+        if (!m_needed) {
+            size_t ascii = asciiPrefix(p, end);
+            if (ascii) {
+                out.append(reinterpret_cast<const char*>(p), ascii);
+                p += ascii;
+                continue;
+            }
+
+            start(*p++, out);
+            continue;
+        }
+
+        if (*p < m_lower || *p > m_upper) {
+            // The byte is not consumed, it may start the next sequence
+            out.append(REPLACEMENT_CHARACTER, 3);
+            reset();
+            continue;
+        }
+
+        m_pending[m_pendingLength++] = *p++;
+        m_lower = 0x80;
+        m_upper = 0xBF;
+
+        if (!--m_needed) {
+            out.append(reinterpret_cast<const char*>(m_pending), m_pendingLength);
+            m_pendingLength = 0;
+        }
+    }
+}
+
+void UTF8Decoder::finish(std::string& out)
+{
+    if (m_needed)
+        out.append(REPLACEMENT_CHARACTER, 3);
+
+    reset();
+}
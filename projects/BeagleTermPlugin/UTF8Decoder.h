@@ -0,0 +1,31 @@
+#ifndef UTF8DECODER_H_
+#define UTF8DECODER_H_
+
+#include <string>
+#include <stddef.h>
+
+// Streaming UTF-8 validator between the channel and the browser.
+// A sequence cut at the end of a chunk is carried over to the next one,
+// and every ill-formed subsequence is replaced by a single U+FFFD.
+class UTF8Decoder {
+public:
+    UTF8Decoder();
+
+    // Appends the well-formed part of the chunk to out
+    void decode(const char* data, size_t length, std::string& out);
+    // Flushes a sequence left incomplete by the last chunk
+    void finish(std::string& out);
+    void reset();
+
+private:
+    void start(unsigned char byte, std::string& out);
+
+private:
+    unsigned char m_pending[4];
+    size_t m_pendingLength;
+    size_t m_needed;
+    unsigned char m_lower;
+    unsigned char m_upper;
+};
+
+#endif /* UTF8DECODER_H_ */
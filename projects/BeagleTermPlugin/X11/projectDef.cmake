@@ -16,7 +16,9 @@ file (GLOB PLATFORM RELATIVE ${CMAKE_CURRENT_SOURCE_DIR}
 SOURCE_GROUP(X11 FILES ${PLATFORM})
 
 # use this to add preprocessor definitions
+# (recordings grow past 2 GiB, which a 32-bit off_t cannot reach)
 add_definitions(
+    -D_FILE_OFFSET_BITS=64
 )
 
 set (SOURCES
@@ -26,10 +28,6 @@ set (SOURCES
 
 add_x11_plugin(${PROJECT_NAME} SOURCES)
 
-# libssh 
-set (LIBSSH_PATH ${PROJECT_SOURCE_DIR}/../../3rdParty/libssh-0.5.2)
-include_directories(${LIBSSH_PATH}/include)
-
 # openssl
 set (OPENSSL_PATH ${PROJECT_SOURCE_DIR}/../../3rdParty/openssl-1.0.0e)
 include_directories(${OPENSSL_PATH}/include)
@@ -39,10 +37,34 @@ set (LIB32_PATH ${PROJECT_SOURCE_DIR}/../../3rdParty/lib32)
 
 # 3rd-party library for 64bit
 
+# libssh, built from the sources in 3rdParty, which carry changes of our own
+# that no released libssh has
+cmake_minimum_required (VERSION 2.8)
+include (ExternalProject)
+set (LIBSSH_PATH ${PROJECT_SOURCE_DIR}/../../3rdParty/libssh-0.5.2)
+set (LIBSSH_BUILD ${CMAKE_CURRENT_BINARY_DIR}/libssh)
+include_directories(${LIBSSH_PATH}/include)
+ExternalProject_Add(libssh
+    SOURCE_DIR ${LIBSSH_PATH}
+    BINARY_DIR ${LIBSSH_BUILD}
+    CMAKE_ARGS
+        -DCMAKE_C_COMPILER=${CMAKE_C_COMPILER}
+        -DCMAKE_C_FLAGS=${CMAKE_C_FLAGS}
+        -DCMAKE_BUILD_TYPE=${CMAKE_BUILD_TYPE}
+        -DWITH_STATIC_LIB=ON
+        -DWITH_LIBZ=OFF
+        -DOPENSSL_INCLUDE_DIRS=${OPENSSL_PATH}/include
+        -DOPENSSL_LIBRARIES=${LIB32_PATH}/libcrypto.a
+    BUILD_COMMAND ${CMAKE_MAKE_PROGRAM} ssh_static ssh_threads_static
+    INSTALL_COMMAND ""
+    )
+add_dependencies(${PROJECT_NAME} libssh)
+
 # add library dependencies here; leave ${PLUGIN_INTERNAL_DEPS} there unless you know what you're doing!
 target_link_libraries(${PROJECT_NAME}
     ${PLUGIN_INTERNAL_DEPS}
-    ${LIB32_PATH}/libssh.a    
+    ${LIBSSH_BUILD}/src/libssh.a
+    ${LIBSSH_BUILD}/src/threads/libssh_threads.a
     ${LIB32_PATH}/libcrypto.a        
     ${LIB32_PATH}/libssl.a
     -lrt      
@@ -0,0 +1,149 @@
+/*
+ * recordbench.cpp
+ * Records a synthetic session of the given length through SessionRecorder,
+ * then seeks in it with SessionPlayer and compares that with replaying from
+ * the start. The clock is simulated, so an hour records in seconds.
+ *
+ *   g++ -O2 -DFB_NO_LOGGING_MACROS=1 -I.. -I../../../firebreath/src/ScriptingCore \
+ *       recordbench.cpp ../SessionRecorder.cpp ../SessionPlayer.cpp \
+ *       -lboost_thread -lboost_system -o recordbench
+ *   ./recordbench -m 60 -r 20
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "SessionRecorder.h"
+#include "SessionPlayer.h"
+
+// A full screen redraw every this many seconds, as top would do
+#define REDRAW_SECONDS 30
+#define SEEKS 1000
+#define REPLAYS 10
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long fileSize(const std::string& path)
+{
+    struct stat sb;
+    return stat(path.c_str(), &sb) == 0 ? (long) sb.st_size : -1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage : recordbench [-m minutes] [-r events per second] [file]\n");
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    int minutes = 60;
+    int rate = 20;
+    std::string path = "recordbench.cast";
+    int i;
+
+    while ((i = getopt(argc, argv, "m:r:")) != -1) {
+        switch (i) {
+        case 'm':
+            minutes = atoi(optarg);
+            break;
+        case 'r':
+            rate = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind < argc)
+        path = argv[optind];
+    if (minutes <= 0 || rate <= 0)
+        usage();
+
+    srand(1);
+    boost::int64_t lengthUsec = static_cast<boost::int64_t>(minutes) * 60 * 1000000;
+    boost::int64_t stepUsec = 1000000 / rate;
+    size_t bytes = 0;
+    size_t events = 0;
+
+    SessionRecorder recorder;
+    if (!recorder.open(path, 80, 24, true, 0)) {
+        fprintf(stderr, "Could not open %s\n", path.c_str());
+        return 1;
+    }
+
+    double start = now();
+    char line[256];
+    for (boost::int64_t t = 0; t < lengthUsec; t += stepUsec) {
+        int len;
+        if (t % (REDRAW_SECONDS * 1000000LL) < stepUsec)
+            len = snprintf(line, sizeof(line), "\x1b[H\x1b[2Jtop - %lds up, load average: 0.%02d\r\n",
+                           (long) (t / 1000000), rand() % 100);
+        else
+            len = snprintf(line, sizeof(line), "%ld.%06ld host-%03d service[%d]: \x1b[3%dmrequest\x1b[0m %08x done in %dms\r\n",
+                           (long) (t / 1000000), (long) (t % 1000000), rand() % 500, rand() % 32768,
+                           rand() % 8, rand(), rand() % 1000);
+        recorder.output(line, len, t);
+        if (rand() % 10 == 0)
+            recorder.input("l", 1, t);
+        bytes += len;
+        events++;
+    }
+    double recorded = now();
+    recorder.close();
+    double closed = now();
+
+    printf("recorded %d minute(s): %lu event(s), %lu byte(s) of output\n", minutes,
+           (unsigned long) events, (unsigned long) bytes);
+    printf("  record  %8.3f s, %.1f MB/s, close %.3f s, %lu byte(s) dropped\n", recorded - start,
+           bytes / (recorded - start) / 1e6, closed - recorded, (unsigned long) recorder.dropped());
+    printf("  files   cast %ld, keys %ld, idx %ld byte(s)\n", fileSize(path), fileSize(path + ".keys"),
+           fileSize(path + ".idx"));
+
+    SessionPlayer player;
+    double opened = now();
+    if (!player.open(path)) {
+        fprintf(stderr, "Could not read %s\n", path.c_str());
+        return 1;
+    }
+    printf("  open    %8.3f ms\n", (now() - opened) * 1e3);
+
+    std::string screen;
+    double worst = 0;
+    double total = 0;
+    for (i = 0; i < SEEKS; i++) {
+        boost::int64_t t = (boost::int64_t) ((double) rand() / RAND_MAX * lengthUsec);
+        double s = now();
+        if (!player.seek(t, screen))
+            return 1;
+        double took = now() - s;
+        total += took;
+        if (took > worst)
+            worst = took;
+    }
+    printf("  seek    %8.3f ms mean, %.3f ms max over %d seek(s)\n", total / SEEKS * 1e3, worst * 1e3, SEEKS);
+
+    total = 0;
+    for (i = 0; i < REPLAYS; i++) {
+        boost::int64_t t = (boost::int64_t) ((double) rand() / RAND_MAX * lengthUsec);
+        double s = now();
+        if (!player.replay(t, screen))
+            return 1;
+        total += now() - s;
+    }
+    printf("  replay  %8.3f ms mean from the start over %d run(s)\n", total / REPLAYS * 1e3, REPLAYS);
+
+    player.close();
+    unlink(path.c_str());
+    unlink((path + ".keys").c_str());
+    unlink((path + ".idx").c_str());
+    return 0;
+}
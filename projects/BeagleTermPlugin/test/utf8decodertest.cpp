@@ -0,0 +1,103 @@
+/*
+ * utf8decodertest.cpp
+ * Checks UTF8Decoder against split, overlong, surrogate and otherwise
+ * ill-formed input. Every case is also fed one byte at a time, which must
+ * give the same output as the whole buffer at once.
+ *
+ *   g++ -O2 -I.. utf8decodertest.cpp ../UTF8Decoder.cpp -o utf8decodertest
+ *   ./utf8decodertest
+ */
+
+#include <stdio.h>
+#include <string>
+
+#include "UTF8Decoder.h"
+
+#define FFFD "\xEF\xBF\xBD"
+
+struct Case {
+    const char* name;
+    const char* input;
+    const char* expected;   // after finish()
+};
+
+static const Case CASES[] = {
+    { "ascii", "hello, world", "hello, world" },
+    { "two byte", "caf\xC3\xA9", "caf\xC3\xA9" },
+    { "three byte", "\xE2\x82\xAC 1", "\xE2\x82\xAC 1" },
+    { "four byte", "\xF0\x9F\x90\xB6", "\xF0\x9F\x90\xB6" },
+    { "long ascii run", "0123456789abcdef0123456789abcdef\xC3\xA9", "0123456789abcdef0123456789abcdef\xC3\xA9" },
+    { "lone continuation", "a\x80" "b", "a" FFFD "b" },
+    { "invalid lead bytes", "\xC0\xC1\xF5\xFF", FFFD FFFD FFFD FFFD },
+    { "overlong two byte", "\xC0\xAF", FFFD FFFD },
+    { "overlong three byte", "\xE0\x80\xAF", FFFD FFFD FFFD },
+    { "overlong four byte", "\xF0\x80\x80\xAF", FFFD FFFD FFFD FFFD },
+    { "surrogate", "\xED\xA0\x80", FFFD FFFD FFFD },
+    { "above U+10FFFF", "\xF4\x90\x80\x80", FFFD FFFD FFFD FFFD },
+    { "largest code point", "\xF4\x8F\xBF\xBF", "\xF4\x8F\xBF\xBF" },
+    { "cut by ascii", "\xE2\x82" "a", FFFD "a" },
+    { "cut by a lead byte", "\xE2\xC3\xA9", FFFD "\xC3\xA9" },
+    { "truncated at the end", "ok\xF0\x9F\x90", "ok" FFFD },
+    { "escape after a bad byte", "\xFF\x1B[0m", FFFD "\x1B[0m" },
+};
+
+static std::string decode(const std::string& input, size_t step)
+{
+    UTF8Decoder decoder;
+    std::string out;
+    for (size_t i = 0; i < input.size(); i += step)
+        decoder.decode(input.data() + i, input.size() - i < step ? input.size() - i : step, out);
+    decoder.finish(out);
+    return out;
+}
+
+static std::string escape(const std::string& s)
+{
+    std::string out;
+    char hex[8];
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = s[i];
+        if (c >= 0x20 && c < 0x7F) {
+            out += c;
+        } else {
+            snprintf(hex, sizeof(hex), "\\x%02X", c);
+            out += hex;
+        }
+    }
+    return out;
+}
+
+int main()
+{
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++) {
+        const Case& c = CASES[i];
+        std::string expected = c.expected;
+        size_t steps[] = { std::string(c.input).size() + 1, 1, 2, 3 };
+        for (size_t j = 0; j < sizeof(steps) / sizeof(steps[0]); j++) {
+            std::string out = decode(c.input, steps[j]);
+            if (out != expected) {
+                printf("FAIL %s, %u byte(s) at a time: got \"%s\", expected \"%s\"\n", c.name,
+                    (unsigned) steps[j], escape(out).c_str(), escape(expected).c_str());
+                failures++;
+            }
+        }
+    }
+
+    // finish() starts over, so a cut sequence does not swallow the next stream
+    UTF8Decoder decoder;
+    std::string out;
+    decoder.decode("\xE2\x82", 2, out);
+    decoder.finish(out);
+    decoder.decode("\xAC", 1, out);
+    decoder.finish(out);
+    if (out != FFFD FFFD) {
+        printf("FAIL finish: got \"%s\"\n", escape(out).c_str());
+        failures++;
+    }
+
+    if (!failures)
+        printf("ok\n");
+    return failures ? 1 : 0;
+}